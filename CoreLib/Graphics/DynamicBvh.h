@@ -0,0 +1,400 @@
+#ifndef CORE_LIB_GRAPHICS_DYNAMIC_BVH_H
+#define CORE_LIB_GRAPHICS_DYNAMIC_BVH_H
+
+#include "../Basic.h"
+#include "BBox.h"
+
+namespace CoreLib
+{
+	namespace Graphics
+	{
+		// Incrementally maintained bounding volume hierarchy over a set of moving boxes.
+		// Leaves store enlarged ("fat") bounds so that small movements do not require
+		// restructuring the tree; internal nodes are kept height-balanced with rotations.
+		template<typename T>
+		class DynamicBvh
+		{
+		public:
+			struct Node
+			{
+				BBox Bounds;
+				T UserData;
+				int Parent = -1; // next free node when the node is in the free list
+				int Child1 = -1, Child2 = -1;
+				int Height = -1; // -1 for free nodes, 0 for leaves
+				bool IsLeaf() const
+				{
+					return Child1 == -1;
+				}
+			};
+		private:
+			List<Node> nodes;
+			int root = -1;
+			int freeList = -1;
+			int leafCount = 0;
+			float fatMargin;
+			static float HalfArea(const BBox & box)
+			{
+				float dx = box.xMax - box.xMin;
+				float dy = box.yMax - box.yMin;
+				float dz = box.zMax - box.zMin;
+				return dx * dy + dy * dz + dz * dx;
+			}
+			static BBox Combine(const BBox & b0, const BBox & b1)
+			{
+				BBox rs = b0;
+				rs.Union(b1);
+				return rs;
+			}
+			static bool Contains(const BBox & outer, const BBox & inner)
+			{
+				return outer.xMin <= inner.xMin && outer.yMin <= inner.yMin && outer.zMin <= inner.zMin &&
+					outer.xMax >= inner.xMax && outer.yMax >= inner.yMax && outer.zMax >= inner.zMax;
+			}
+			BBox Fatten(const BBox & box)
+			{
+				float extent = Math::Max(box.xMax - box.xMin, Math::Max(box.yMax - box.yMin, box.zMax - box.zMin));
+				float margin = fatMargin + Math::Max(0.0f, extent) * 0.05f;
+				BBox rs = box;
+				rs.Min -= Vec3::Create(margin, margin, margin);
+				rs.Max += Vec3::Create(margin, margin, margin);
+				return rs;
+			}
+			int AllocNode()
+			{
+				int id;
+				if (freeList == -1)
+				{
+					id = nodes.Count();
+					nodes.Add(Node());
+				}
+				else
+				{
+					id = freeList;
+					freeList = nodes[id].Parent;
+					nodes[id] = Node();
+				}
+				nodes[id].Height = 0;
+				return id;
+			}
+			void FreeNode(int id)
+			{
+				nodes[id].UserData = T();
+				nodes[id].Parent = freeList;
+				nodes[id].Height = -1;
+				freeList = id;
+			}
+			void ReplaceChild(int parent, int oldChild, int newChild)
+			{
+				if (parent == -1)
+					root = newChild;
+				else if (nodes[parent].Child1 == oldChild)
+					nodes[parent].Child1 = newChild;
+				else
+					nodes[parent].Child2 = newChild;
+			}
+			void RefitAncestors(int id)
+			{
+				while (id != -1)
+				{
+					id = Balance(id);
+					auto & node = nodes[id];
+					node.Height = 1 + Math::Max(nodes[node.Child1].Height, nodes[node.Child2].Height);
+					node.Bounds = Combine(nodes[node.Child1].Bounds, nodes[node.Child2].Bounds);
+					id = node.Parent;
+				}
+			}
+			void InsertLeaf(int leaf)
+			{
+				if (root == -1)
+				{
+					root = leaf;
+					nodes[leaf].Parent = -1;
+					return;
+				}
+				// descend along the branch with the lowest surface area cost
+				BBox leafBounds = nodes[leaf].Bounds;
+				int id = root;
+				while (!nodes[id].IsLeaf())
+				{
+					auto & node = nodes[id];
+					float area = HalfArea(node.Bounds);
+					float combinedArea = HalfArea(Combine(node.Bounds, leafBounds));
+					float cost = 2.0f * combinedArea;
+					float inheritanceCost = 2.0f * (combinedArea - area);
+					auto childCost = [&](int child)
+					{
+						float newArea = HalfArea(Combine(nodes[child].Bounds, leafBounds));
+						if (nodes[child].IsLeaf())
+							return newArea + inheritanceCost;
+						return newArea - HalfArea(nodes[child].Bounds) + inheritanceCost;
+					};
+					float cost1 = childCost(node.Child1);
+					float cost2 = childCost(node.Child2);
+					if (cost < cost1 && cost < cost2)
+						break;
+					id = cost1 < cost2 ? node.Child1 : node.Child2;
+				}
+				int sibling = id;
+				int oldParent = nodes[sibling].Parent;
+				int newParent = AllocNode();
+				nodes[newParent].Parent = oldParent;
+				nodes[newParent].Bounds = Combine(leafBounds, nodes[sibling].Bounds);
+				nodes[newParent].Height = nodes[sibling].Height + 1;
+				nodes[newParent].Child1 = sibling;
+				nodes[newParent].Child2 = leaf;
+				ReplaceChild(oldParent, sibling, newParent);
+				nodes[sibling].Parent = newParent;
+				nodes[leaf].Parent = newParent;
+				RefitAncestors(newParent);
+			}
+			void RemoveLeaf(int leaf)
+			{
+				if (leaf == root)
+				{
+					root = -1;
+					return;
+				}
+				int parent = nodes[leaf].Parent;
+				int grandParent = nodes[parent].Parent;
+				int sibling = nodes[parent].Child1 == leaf ? nodes[parent].Child2 : nodes[parent].Child1;
+				ReplaceChild(grandParent, parent, sibling);
+				nodes[sibling].Parent = grandParent;
+				FreeNode(parent);
+				RefitAncestors(grandParent);
+			}
+			// performs a left or right rotation if node a is imbalanced, returns the new subtree root
+			int Balance(int a)
+			{
+				auto & A = nodes[a];
+				if (A.IsLeaf() || A.Height < 2)
+					return a;
+				int b = A.Child1, c = A.Child2;
+				auto & B = nodes[b];
+				auto & C = nodes[c];
+				int balance = C.Height - B.Height;
+				if (balance > 1)
+				{
+					// rotate C up
+					int f = C.Child1, g = C.Child2;
+					auto & F = nodes[f];
+					auto & G = nodes[g];
+					C.Child1 = a;
+					C.Parent = A.Parent;
+					A.Parent = c;
+					ReplaceChild(C.Parent, a, c);
+					if (F.Height > G.Height)
+					{
+						C.Child2 = f;
+						A.Child2 = g;
+						G.Parent = a;
+						A.Bounds = Combine(B.Bounds, G.Bounds);
+						C.Bounds = Combine(A.Bounds, F.Bounds);
+						A.Height = 1 + Math::Max(B.Height, G.Height);
+						C.Height = 1 + Math::Max(A.Height, F.Height);
+					}
+					else
+					{
+						C.Child2 = g;
+						A.Child2 = f;
+						F.Parent = a;
+						A.Bounds = Combine(B.Bounds, F.Bounds);
+						C.Bounds = Combine(A.Bounds, G.Bounds);
+						A.Height = 1 + Math::Max(B.Height, F.Height);
+						C.Height = 1 + Math::Max(A.Height, G.Height);
+					}
+					return c;
+				}
+				if (balance < -1)
+				{
+					// rotate B up
+					int d = B.Child1, e = B.Child2;
+					auto & D = nodes[d];
+					auto & E = nodes[e];
+					B.Child1 = a;
+					B.Parent = A.Parent;
+					A.Parent = b;
+					ReplaceChild(B.Parent, a, b);
+					if (D.Height > E.Height)
+					{
+						B.Child2 = d;
+						A.Child1 = e;
+						E.Parent = a;
+						A.Bounds = Combine(C.Bounds, E.Bounds);
+						B.Bounds = Combine(A.Bounds, D.Bounds);
+						A.Height = 1 + Math::Max(C.Height, E.Height);
+						B.Height = 1 + Math::Max(A.Height, D.Height);
+					}
+					else
+					{
+						B.Child2 = e;
+						A.Child1 = d;
+						D.Parent = a;
+						A.Bounds = Combine(C.Bounds, D.Bounds);
+						B.Bounds = Combine(A.Bounds, E.Bounds);
+						A.Height = 1 + Math::Max(C.Height, D.Height);
+						B.Height = 1 + Math::Max(A.Height, E.Height);
+					}
+					return b;
+				}
+				return a;
+			}
+			static bool RayBoxTest(const BBox & box, const Vec3 & origin, const Vec3 & invDir, float maxDist, float & tEntry)
+			{
+				float tmin = 0.0f, tmax = maxDist;
+				for (int i = 0; i < 3; i++)
+				{
+					float t0 = (box.Min[i] - origin[i]) * invDir[i];
+					float t1 = (box.Max[i] - origin[i]) * invDir[i];
+					if (invDir[i] < 0.0f)
+						Swap(t0, t1);
+					tmin = t0 > tmin ? t0 : tmin;
+					tmax = t1 < tmax ? t1 : tmax;
+				}
+				tEntry = tmin;
+				return tmin <= tmax;
+			}
+		public:
+			DynamicBvh(float margin = 0.0f)
+				: fatMargin(margin)
+			{}
+			int Count() const
+			{
+				return leafCount;
+			}
+			int GetHeight() const
+			{
+				return root == -1 ? 0 : nodes[root].Height;
+			}
+			int GetRoot() const
+			{
+				return root;
+			}
+			const Node & GetNode(int id) const
+			{
+				return nodes[id];
+			}
+			T & GetUserData(int proxyId)
+			{
+				return nodes[proxyId].UserData;
+			}
+			BBox GetFatBounds(int proxyId) const
+			{
+				return nodes[proxyId].Bounds;
+			}
+			// returns a proxy id that stays valid until the proxy is removed
+			int Insert(const BBox & bounds, const T & userData)
+			{
+				int leaf = AllocNode();
+				nodes[leaf].Bounds = Fatten(bounds);
+				nodes[leaf].UserData = userData;
+				InsertLeaf(leaf);
+				leafCount++;
+				return leaf;
+			}
+			void Remove(int proxyId)
+			{
+				RemoveLeaf(proxyId);
+				FreeNode(proxyId);
+				leafCount--;
+			}
+			// updates the bounds of a proxy, returns true if the tree had to be restructured
+			bool Move(int proxyId, const BBox & bounds)
+			{
+				if (Contains(nodes[proxyId].Bounds, bounds))
+					return false;
+				RemoveLeaf(proxyId);
+				nodes[proxyId].Bounds = Fatten(bounds);
+				InsertLeaf(proxyId);
+				return true;
+			}
+			void Clear()
+			{
+				nodes.Clear();
+				root = -1;
+				freeList = -1;
+				leafCount = 0;
+			}
+			// Visits leaves whose bounds are hit by the ray in front-to-back order of their entry distance.
+			// f(userData, tEntry, maxDist) returns the new maximum distance; subtrees that start beyond it are skipped.
+			static const int MaxTraversalStackSize = 128;
+			template<typename Func>
+			void RayCast(const Vec3 & origin, const Vec3 & dir, float maxDist, const Func & f)
+			{
+				if (root == -1)
+					return;
+				Vec3 invDir = Vec3::Create(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+				struct StackEntry
+				{
+					int Node;
+					float TEntry;
+				};
+				StackEntry stack[MaxTraversalStackSize];
+				int stackSize = 0;
+				float tEntry;
+				if (!RayBoxTest(nodes[root].Bounds, origin, invDir, maxDist, tEntry))
+					return;
+				stack[stackSize++] = StackEntry{ root, tEntry };
+				while (stackSize)
+				{
+					auto entry = stack[--stackSize];
+					if (entry.TEntry > maxDist)
+						continue;
+					auto & node = nodes[entry.Node];
+					if (node.IsLeaf())
+					{
+						maxDist = f(node.UserData, entry.TEntry, maxDist);
+						continue;
+					}
+					float t1, t2;
+					bool hit1 = RayBoxTest(nodes[node.Child1].Bounds, origin, invDir, maxDist, t1);
+					bool hit2 = RayBoxTest(nodes[node.Child2].Bounds, origin, invDir, maxDist, t2);
+					// push the far child first so that the near child is visited next
+					if (hit1 && hit2)
+					{
+						if (t1 <= t2)
+						{
+							stack[stackSize++] = StackEntry{ node.Child2, t2 };
+							stack[stackSize++] = StackEntry{ node.Child1, t1 };
+						}
+						else
+						{
+							stack[stackSize++] = StackEntry{ node.Child1, t1 };
+							stack[stackSize++] = StackEntry{ node.Child2, t2 };
+						}
+					}
+					else if (hit1)
+						stack[stackSize++] = StackEntry{ node.Child1, t1 };
+					else if (hit2)
+						stack[stackSize++] = StackEntry{ node.Child2, t2 };
+				}
+			}
+			// Visits all leaves whose bounds pass nodeTest(bounds); nodeTest is also used to reject internal nodes.
+			template<typename TestFunc, typename Func>
+			void Query(const TestFunc & nodeTest, const Func & f)
+			{
+				if (root == -1)
+					return;
+				int stack[MaxTraversalStackSize];
+				int stackSize = 0;
+				stack[stackSize++] = root;
+				while (stackSize)
+				{
+					int id = stack[--stackSize];
+					auto & node = nodes[id];
+					if (!nodeTest(node.Bounds))
+						continue;
+					if (node.IsLeaf())
+						f(node.UserData);
+					else
+					{
+						stack[stackSize++] = node.Child2;
+						stack[stackSize++] = node.Child1;
+					}
+				}
+			}
+		};
+	}
+}
+
+#endif
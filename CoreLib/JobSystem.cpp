@@ -0,0 +1,307 @@
+#include "JobSystem.h"
+
+using namespace CoreLib::Basic;
+
+namespace CoreLib
+{
+	namespace Threading
+	{
+		// Jobs are taken from a per-thread ring so that scheduling does not hit the heap.
+		// A slot that is still in flight when the ring wraps around falls back to new/delete.
+		const int JobPoolSize = 4096;
+		struct JobPool
+		{
+			Job Jobs[JobPoolSize];
+			unsigned int Next = 0;
+		};
+
+		thread_local RefPtr<JobPool> threadJobPool;
+		thread_local JobSystem * threadJobSystem = nullptr;
+		thread_local JobQueue * threadJobQueue = nullptr;
+		thread_local unsigned int threadStealSeed = 0;
+
+		JobQueue::JobQueue()
+		{
+			top = 0;
+			bottom = 0;
+			for (auto & job : buffer)
+				job.store(nullptr, std::memory_order_relaxed);
+		}
+
+		bool JobQueue::Push(Job * job)
+		{
+			long long b = bottom.load(std::memory_order_relaxed);
+			long long t = top.load(std::memory_order_acquire);
+			if (b - t >= Capacity)
+				return false;
+			buffer[b & (Capacity - 1)].store(job, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return true;
+		}
+
+		Job * JobQueue::Pop()
+		{
+			long long b = bottom.load(std::memory_order_relaxed) - 1;
+			bottom.store(b, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			long long t = top.load(std::memory_order_relaxed);
+			if (t > b)
+			{
+				bottom.store(b + 1, std::memory_order_relaxed);
+				return nullptr;
+			}
+			Job * job = buffer[b & (Capacity - 1)].load(std::memory_order_relaxed);
+			if (t == b)
+			{
+				// last job in the queue, race against thieves for it
+				if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+					job = nullptr;
+				bottom.store(b + 1, std::memory_order_relaxed);
+			}
+			return job;
+		}
+
+		Job * JobQueue::Steal()
+		{
+			long long t = top.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			long long b = bottom.load(std::memory_order_acquire);
+			if (t >= b)
+				return nullptr;
+			Job * job = buffer[t & (Capacity - 1)].load(std::memory_order_relaxed);
+			if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				return nullptr;
+			return job;
+		}
+
+		JobSystem::JobSystem(int workerCount)
+		{
+			injectedJobCount = 0;
+			pendingJobs = 0;
+			sleepingWorkers = 0;
+			terminate = false;
+			if (workerCount < 0)
+				workerCount = Math::Max(0, ParallelSystemInfo::GetProcessorCount() - 1);
+			for (int i = 0; i < workerCount; i++)
+				queues.Add(new JobQueue());
+			for (int i = 0; i < workerCount; i++)
+				workers.Add(new Thread(new ThreadProc([this, i]() { WorkerLoop(i); })));
+		}
+
+		JobSystem::~JobSystem()
+		{
+			{
+				std::lock_guard<std::mutex> lock(sleepMutex);
+				terminate = true;
+			}
+			wakeUp.notify_all();
+			for (auto & worker : workers)
+				worker->Join();
+		}
+
+		JobSystem * JobSystem::Instance()
+		{
+			static JobSystem instance;
+			return &instance;
+		}
+
+		void JobSystem::WorkerLoop(int workerId)
+		{
+			threadJobSystem = this;
+			threadJobQueue = queues[workerId].Ptr();
+			threadStealSeed = workerId * 0x9E3779B9u + 1;
+			int idleCount = 0;
+			while (!terminate.load(std::memory_order_relaxed))
+			{
+				if (RunPendingJob())
+				{
+					idleCount = 0;
+					continue;
+				}
+				if (++idleCount < 64)
+				{
+					_mm_pause();
+					continue;
+				}
+				idleCount = 0;
+				std::unique_lock<std::mutex> lock(sleepMutex);
+				sleepingWorkers++;
+				wakeUp.wait(lock, [this]() { return pendingJobs.load() > 0 || terminate.load(); });
+				sleepingWorkers--;
+			}
+		}
+
+		Job * JobSystem::AllocJob()
+		{
+			if (!threadJobPool)
+				threadJobPool = new JobPool();
+			Job * job = &threadJobPool->Jobs[threadJobPool->Next++ & (JobPoolSize - 1)];
+			if (job->InUse.load(std::memory_order_acquire))
+			{
+				job = new Job();
+				job->HeapAllocated = true;
+			}
+			job->InUse.store(true, std::memory_order_relaxed);
+			return job;
+		}
+
+		void JobSystem::FreeJob(Job * job)
+		{
+			if (job->Function == RunTask)
+				job->Task = Func<void>();
+			if (job->HeapAllocated)
+				delete job;
+			else
+				job->InUse.store(false, std::memory_order_release);
+		}
+
+		void JobSystem::Schedule(JobFunction function, void * data, JobCounter * counter, JobCounter * dependency)
+		{
+			ScheduleRange(function, data, 0, 0, counter, dependency);
+		}
+
+		void JobSystem::ScheduleRange(JobFunction function, void * data, int begin, int end, JobCounter * counter, JobCounter * dependency)
+		{
+			Job * job = AllocJob();
+			job->Function = function;
+			job->Data = data;
+			job->Begin = begin;
+			job->End = end;
+			job->Counter = counter;
+			Submit(job, dependency);
+		}
+
+		void JobSystem::RunTask(Job & job)
+		{
+			job.Task();
+		}
+
+		void JobSystem::Schedule(Func<void> task, JobCounter * counter, JobCounter * dependency)
+		{
+			Job * job = AllocJob();
+			job->Function = RunTask;
+			job->Data = nullptr;
+			job->Task = _Move(task);
+			job->Counter = counter;
+			Submit(job, dependency);
+		}
+
+		void JobSystem::Submit(Job * job, JobCounter * dependency)
+		{
+			if (job->Counter)
+				job->Counter->value.fetch_add(1);
+			if (dependency)
+			{
+				dependency->lock.Lock();
+				if (dependency->value.load() != 0)
+				{
+					dependency->waitingJobs.Add(job);
+					dependency->lock.Unlock();
+					return;
+				}
+				dependency->lock.Unlock();
+			}
+			PushJob(job);
+		}
+
+		void JobSystem::PushJob(Job * job)
+		{
+			if (threadJobSystem != this || !threadJobQueue->Push(job))
+			{
+				std::lock_guard<std::mutex> lock(injectionMutex);
+				injectedJobs.Add(job);
+				injectedJobCount++;
+			}
+			pendingJobs++;
+			if (sleepingWorkers.load() > 0)
+			{
+				std::lock_guard<std::mutex> lock(sleepMutex);
+				wakeUp.notify_one();
+			}
+		}
+
+		Job * JobSystem::PopInjectedJob()
+		{
+			if (injectedJobCount.load(std::memory_order_relaxed) == 0)
+				return nullptr;
+			std::lock_guard<std::mutex> lock(injectionMutex);
+			if (injectedJobHead == injectedJobs.Count())
+				return nullptr;
+			Job * job = injectedJobs[injectedJobHead++];
+			injectedJobCount--;
+			if (injectedJobHead == injectedJobs.Count())
+			{
+				injectedJobs.Clear();
+				injectedJobHead = 0;
+			}
+			return job;
+		}
+
+		Job * JobSystem::StealJob(JobQueue * ownQueue)
+		{
+			int queueCount = queues.Count();
+			if (queueCount == 0)
+				return nullptr;
+			threadStealSeed = threadStealSeed * 1664525u + 1013904223u;
+			int start = (int)((threadStealSeed >> 8) % (unsigned int)queueCount);
+			for (int i = 0; i < queueCount; i++)
+			{
+				auto queue = queues[(start + i) % queueCount].Ptr();
+				if (queue == ownQueue)
+					continue;
+				if (auto job = queue->Steal())
+					return job;
+			}
+			return nullptr;
+		}
+
+		bool JobSystem::RunPendingJob()
+		{
+			JobQueue * ownQueue = threadJobSystem == this ? threadJobQueue : nullptr;
+			Job * job = ownQueue ? ownQueue->Pop() : nullptr;
+			if (!job)
+				job = PopInjectedJob();
+			if (!job)
+				job = StealJob(ownQueue);
+			if (!job)
+				return false;
+			pendingJobs--;
+			Execute(job);
+			return true;
+		}
+
+		void JobSystem::Execute(Job * job)
+		{
+			job->Function(*job);
+			auto counter = job->Counter;
+			FreeJob(job);
+			if (counter)
+				SignalCounter(counter);
+		}
+
+		void JobSystem::SignalCounter(JobCounter * counter)
+		{
+			// decrement under the lock so that Wait cannot return while we still touch the counter
+			List<Job*> releasedJobs;
+			counter->lock.Lock();
+			if (counter->value.fetch_sub(1) == 1)
+				releasedJobs = _Move(counter->waitingJobs);
+			counter->lock.Unlock();
+			for (auto job : releasedJobs)
+				PushJob(job);
+		}
+
+		void JobSystem::Wait(JobCounter & counter)
+		{
+			while (!counter.IsDone())
+			{
+				if (!RunPendingJob())
+					_mm_pause();
+			}
+			// the thread that brought the counter to zero may still hold its lock
+			counter.lock.Lock();
+			counter.lock.Unlock();
+		}
+	}
+}
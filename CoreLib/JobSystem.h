@@ -0,0 +1,167 @@
+#ifndef CORE_LIB_JOB_SYSTEM_H
+#define CORE_LIB_JOB_SYSTEM_H
+
+#include <condition_variable>
+#include "Threading.h"
+
+namespace CoreLib
+{
+	namespace Threading
+	{
+		class JobSystem;
+		class JobCounter;
+		struct Job;
+
+		typedef void(*JobFunction)(Job & job);
+
+		struct Job
+		{
+			JobFunction Function = nullptr;
+			void * Data = nullptr;
+			int Begin = 0, End = 0;
+			JobCounter * Counter = nullptr; // decremented when the job finishes
+			CoreLib::Basic::Func<void> Task;
+			bool HeapAllocated = false;
+			std::atomic<bool> InUse;
+			Job()
+			{
+				InUse = false;
+			}
+		};
+
+		// Counts unfinished jobs. A job scheduled with a counter increments it and decrements it
+		// when done; jobs scheduled with a counter as dependency start once it reaches zero.
+		// A counter must outlive the jobs that reference it, JobSystem::Wait guarantees that.
+		class JobCounter
+		{
+			friend class JobSystem;
+		private:
+			std::atomic<int> value;
+			SpinLock lock;
+			CoreLib::Basic::List<Job*> waitingJobs;
+		public:
+			JobCounter()
+			{
+				value = 0;
+			}
+			JobCounter(const JobCounter &) = delete;
+			JobCounter & operator = (const JobCounter &) = delete;
+			int GetValue()
+			{
+				return value.load(std::memory_order_acquire);
+			}
+			bool IsDone()
+			{
+				return GetValue() == 0;
+			}
+		};
+
+		// Chase-Lev work-stealing deque. Only the owning thread may Push and Pop (LIFO end),
+		// any thread may Steal (FIFO end).
+		class JobQueue
+		{
+		public:
+			static const int Capacity = 4096;
+		private:
+			std::atomic<long long> top, bottom;
+			std::atomic<Job*> buffer[Capacity];
+		public:
+			JobQueue();
+			bool Push(Job * job);
+			Job * Pop();
+			Job * Steal();
+		};
+
+		// Work-stealing task scheduler. Every worker thread owns a JobQueue; jobs scheduled from a
+		// worker go to its own queue, jobs scheduled from other threads go to a shared injection queue.
+		// Threads that wait on a counter run pending jobs instead of blocking.
+		class JobSystem
+		{
+		private:
+			CoreLib::Basic::List<CoreLib::Basic::RefPtr<Thread>> workers;
+			CoreLib::Basic::List<CoreLib::Basic::RefPtr<JobQueue>> queues;
+			std::mutex injectionMutex;
+			CoreLib::Basic::List<Job*> injectedJobs;
+			int injectedJobHead = 0;
+			std::atomic<int> injectedJobCount;
+			std::atomic<int> pendingJobs;
+			std::atomic<int> sleepingWorkers;
+			std::atomic<bool> terminate;
+			std::mutex sleepMutex;
+			std::condition_variable wakeUp;
+			void WorkerLoop(int workerId);
+			Job * AllocJob();
+			void FreeJob(Job * job);
+			void Submit(Job * job, JobCounter * dependency);
+			void PushJob(Job * job);
+			Job * PopInjectedJob();
+			Job * StealJob(JobQueue * ownQueue);
+			void Execute(Job * job);
+			void SignalCounter(JobCounter * counter);
+			static void RunTask(Job & job);
+			template<typename F>
+			struct ParallelForData
+			{
+				JobSystem * System;
+				const F * Body;
+				int GrainSize;
+			};
+			template<typename F>
+			static void ParallelForJob(Job & job)
+			{
+				auto & data = *(ParallelForData<F>*)job.Data;
+				int begin = job.Begin, end = job.End;
+				// keep splitting off the upper half so that idle workers can steal large ranges
+				while (end - begin > data.GrainSize)
+				{
+					int mid = begin + ((end - begin) >> 1);
+					data.System->ScheduleRange(ParallelForJob<F>, job.Data, mid, end, job.Counter);
+					end = mid;
+				}
+				for (int i = begin; i < end; i++)
+					(*data.Body)(i);
+			}
+		public:
+			// workerCount < 0 creates one worker per processor besides the calling thread
+			JobSystem(int workerCount = -1);
+			~JobSystem();
+			static JobSystem * Instance();
+			int GetWorkerCount()
+			{
+				return workers.Count();
+			}
+			void Schedule(JobFunction function, void * data, JobCounter * counter = nullptr, JobCounter * dependency = nullptr);
+			// the job takes over task; pass a temporary, since Func copies share a non-atomic reference count
+			void Schedule(CoreLib::Basic::Func<void> task, JobCounter * counter = nullptr, JobCounter * dependency = nullptr);
+			void ScheduleRange(JobFunction function, void * data, int begin, int end, JobCounter * counter = nullptr, JobCounter * dependency = nullptr);
+			// runs one pending job on the calling thread, returns false if none was found
+			bool RunPendingJob();
+			// returns once counter reaches zero, running pending jobs in the meantime
+			void Wait(JobCounter & counter);
+			// calls body(i) for every i in [begin, end); grainSize <= 0 picks a grain from the worker count
+			template<typename F>
+			void ParallelFor(int begin, int end, const F & body, int grainSize = 0)
+			{
+				if (end <= begin)
+					return;
+				if (grainSize <= 0)
+					grainSize = CoreLib::Basic::Math::Max(1, (end - begin) / ((workers.Count() + 1) * 8));
+				if (workers.Count() == 0 || end - begin <= grainSize)
+				{
+					for (int i = begin; i < end; i++)
+						body(i);
+					return;
+				}
+				ParallelForData<F> data;
+				data.System = this;
+				data.Body = &body;
+				data.GrainSize = grainSize;
+				JobCounter counter;
+				ScheduleRange(ParallelForJob<F>, &data, begin, end, &counter);
+				Wait(counter);
+			}
+		};
+	}
+}
+
+#endif
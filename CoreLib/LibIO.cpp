@@ -6,6 +6,12 @@
 #include <sys/stat.h>
 #ifdef _WIN32
 #include <direct.h>
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #endif
 namespace CoreLib
 {
@@ -246,6 +252,74 @@ namespace CoreLib
 			return _Move(buffer);
 		}
 
+		MemoryMappedFile::MemoryMappedFile(const CoreLib::Basic::String & fileName)
+		{
+#ifdef _WIN32
+			auto handle = CreateFileW(fileName.ToWString(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+			if (handle == INVALID_HANDLE_VALUE)
+				throw IOException("Cannot open file '" + fileName + "'.");
+			fileHandle = handle;
+			LARGE_INTEGER size;
+			if (!GetFileSizeEx(handle, &size) || size.QuadPart > 0x7FFFFFFF)
+			{
+				CloseHandle(handle);
+				throw IOException("Cannot map file '" + fileName + "'.");
+			}
+			length = (int)size.QuadPart;
+			// empty files cannot be mapped on Windows
+			if (length == 0)
+				return;
+			mappingHandle = CreateFileMappingW(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (mappingHandle)
+				data = (unsigned char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+			if (!data)
+			{
+				if (mappingHandle)
+					CloseHandle(mappingHandle);
+				CloseHandle(handle);
+				throw IOException("Cannot map file '" + fileName + "'.");
+			}
+#else
+			int fd = open(fileName.Buffer(), O_RDONLY);
+			if (fd == -1)
+				throw IOException("Cannot open file '" + fileName + "'.");
+			struct stat statVar;
+			if (fstat(fd, &statVar) != 0 || statVar.st_size > 0x7FFFFFFF)
+			{
+				close(fd);
+				throw IOException("Cannot map file '" + fileName + "'.");
+			}
+			length = (int)statVar.st_size;
+			if (length)
+			{
+				auto ptr = mmap(nullptr, (size_t)length, PROT_READ, MAP_PRIVATE, fd, 0);
+				if (ptr == MAP_FAILED)
+				{
+					close(fd);
+					throw IOException("Cannot map file '" + fileName + "'.");
+				}
+				data = (unsigned char*)ptr;
+			}
+			// the mapping keeps its own reference to the file
+			close(fd);
+#endif
+		}
+
+		MemoryMappedFile::~MemoryMappedFile()
+		{
+#ifdef _WIN32
+			if (data)
+				UnmapViewOfFile(data);
+			if (mappingHandle)
+				CloseHandle(mappingHandle);
+			if (fileHandle)
+				CloseHandle(fileHandle);
+#else
+			if (data)
+				munmap(data, (size_t)length);
+#endif
+		}
+
 		void File::WriteAllText(const CoreLib::Basic::String & fileName, const CoreLib::Basic::String & text)
 		{
 			StreamWriter writer(new FileStream(fileName, FileMode::Create));
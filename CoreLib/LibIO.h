@@ -19,6 +19,26 @@ namespace CoreLib
 			static void WriteAllText(const CoreLib::Basic::String & fileName, const CoreLib::Basic::String & text);
 		};
 
+		// Read-only mapping of a whole file into the address space. The view returned by GetData
+		// stays valid until the object is destroyed. Throws IOException if the file cannot be mapped.
+		class MemoryMappedFile : public CoreLib::Basic::Object
+		{
+		private:
+#ifdef _WIN32
+			void * fileHandle = nullptr;
+			void * mappingHandle = nullptr;
+#endif
+			unsigned char * data = nullptr;
+			int length = 0;
+		public:
+			MemoryMappedFile(const CoreLib::Basic::String & fileName);
+			~MemoryMappedFile();
+			CoreLib::ArrayView<unsigned char> GetData()
+			{
+				return CoreLib::ArrayView<unsigned char>(data, length);
+			}
+		};
+
 		class Path
 		{
 		public:
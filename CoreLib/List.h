@@ -206,9 +206,6 @@ namespace CoreLib
 				int tmpCount = this->_count;
 				this->_count = other._count;
 				other._count = tmpCount;
-				TAllocator tmpAlloc = _Move(this->allocator);
-				this->allocator = _Move(other.allocator);
-				other.allocator = _Move(tmpAlloc);
 			}
 
 			T* ReleaseBuffer()
@@ -3,9 +3,13 @@
 
 #include "Common.h"
 
+#ifdef _WIN32
 #define VC_EXTRALEAN
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
+#else
+#include <time.h>
+#endif
 
 namespace CoreLib
 {
@@ -13,15 +17,23 @@ namespace CoreLib
 	{
 		typedef long long TimePoint;
 		typedef long long Duration;
+		// TimePoint and Duration are in ticks of a monotonic clock, QueryPerformanceCounter on Windows
+		// and CLOCK_MONOTONIC (nanoseconds) elsewhere
 		class PerformanceCounter
 		{
 			static TimePoint frequency;
 		public:
 			static inline TimePoint Start() 
 			{
+#ifdef _WIN32
 				TimePoint rs;
 				QueryPerformanceCounter((LARGE_INTEGER*)&rs);
 				return rs;
+#else
+				timespec ts;
+				clock_gettime(CLOCK_MONOTONIC, &ts);
+				return (TimePoint)ts.tv_sec * 1000000000ll + ts.tv_nsec;
+#endif
 			}
 			static inline Duration End(TimePoint counter)
 			{
@@ -31,11 +43,21 @@ namespace CoreLib
 			{
 				return (float)ToSeconds(Start() - counter);
 			}
-			static inline double ToSeconds(Duration duration)
+			static inline TimePoint GetFrequency()
 			{
 				if (frequency == 0)
+				{
+#ifdef _WIN32
 					QueryPerformanceFrequency((LARGE_INTEGER*)&frequency);
-				auto rs = duration / (double)frequency;
+#else
+					frequency = 1000000000ll;
+#endif
+				}
+				return frequency;
+			}
+			static inline double ToSeconds(Duration duration)
+			{
+				auto rs = duration / (double)GetFrequency();
 				return rs;
 			}
 		};
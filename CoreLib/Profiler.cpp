@@ -0,0 +1,144 @@
+#include "Profiler.h"
+#include "Threading.h"
+#include "LibIO.h"
+
+using namespace CoreLib::Basic;
+using namespace CoreLib::Threading;
+
+namespace CoreLib
+{
+	namespace Diagnostics
+	{
+		struct ThreadZoneBuffer : public RefObject
+		{
+			ProfileZone Zones[Profiler::ZonesPerThread];
+			std::atomic<long long> Count; // total zones written in the current capture, only the owner thread writes
+			int CaptureId = -1;
+			int ThreadIndex = 0;
+		};
+
+		std::atomic<bool> Profiler::capturing;
+		static std::atomic<int> currentCaptureId;
+		static SpinLock threadBuffersLock;
+		static List<RefPtr<ThreadZoneBuffer>> threadBuffers; // kept alive after threads exit so that their zones can be exported
+		thread_local ThreadZoneBuffer * threadZoneBuffer = nullptr;
+
+		void Profiler::BeginCapture()
+		{
+			currentCaptureId++;
+			capturing = true;
+		}
+
+		void Profiler::EndCapture()
+		{
+			capturing = false;
+		}
+
+		void Profiler::RecordZone(const char * name, TimePoint begin, TimePoint end)
+		{
+			auto buffer = threadZoneBuffer;
+			if (!buffer)
+			{
+				buffer = new ThreadZoneBuffer();
+				buffer->Count = 0;
+				threadBuffersLock.Lock();
+				buffer->ThreadIndex = threadBuffers.Count();
+				threadBuffers.Add(buffer);
+				threadBuffersLock.Unlock();
+				threadZoneBuffer = buffer;
+			}
+			int captureId = currentCaptureId.load(std::memory_order_relaxed);
+			if (buffer->CaptureId != captureId)
+			{
+				buffer->CaptureId = captureId;
+				buffer->Count.store(0, std::memory_order_relaxed);
+			}
+			auto count = buffer->Count.load(std::memory_order_relaxed);
+			auto & zone = buffer->Zones[count & (ZonesPerThread - 1)];
+			zone.Name = name;
+			zone.Begin = begin;
+			zone.End = end;
+			buffer->Count.store(count + 1, std::memory_order_release);
+		}
+
+		// trace event timestamps are in microseconds, written with integer math to keep nanosecond precision
+		static void AppendMicroseconds(StringBuilder & sb, Duration ticks, TimePoint frequency)
+		{
+			long long ns = ticks / frequency * 1000000000ll + ticks % frequency * 1000000000ll / frequency;
+			long long fraction = ns % 1000;
+			sb << ns / 1000 << '.';
+			if (fraction < 100)
+				sb << '0';
+			if (fraction < 10)
+				sb << '0';
+			sb << fraction;
+		}
+
+		static void AppendEscaped(StringBuilder & sb, const char * str)
+		{
+			for (auto ptr = str; *ptr; ptr++)
+			{
+				if (*ptr == '\"' || *ptr == '\\')
+					sb << '\\';
+				sb << *ptr;
+			}
+		}
+
+		String Profiler::ExportChromeTrace()
+		{
+			auto frequency = PerformanceCounter::GetFrequency();
+			int captureId = currentCaptureId.load();
+			threadBuffersLock.Lock();
+			List<ThreadZoneBuffer*> buffers;
+			for (auto & buffer : threadBuffers)
+			{
+				if (buffer->CaptureId == captureId)
+					buffers.Add(buffer.Ptr());
+			}
+			threadBuffersLock.Unlock();
+
+			TimePoint startTime = 0;
+			bool hasZone = false;
+			for (auto buffer : buffers)
+			{
+				auto count = buffer->Count.load(std::memory_order_acquire);
+				for (auto i = Math::Max(0ll, count - ZonesPerThread); i < count; i++)
+				{
+					auto begin = buffer->Zones[i & (ZonesPerThread - 1)].Begin;
+					if (!hasZone || begin < startTime)
+						startTime = begin;
+					hasZone = true;
+				}
+			}
+
+			StringBuilder sb;
+			sb << "{\"traceEvents\":[";
+			bool first = true;
+			for (auto buffer : buffers)
+			{
+				auto count = buffer->Count.load(std::memory_order_acquire);
+				for (auto i = Math::Max(0ll, count - ZonesPerThread); i < count; i++)
+				{
+					auto & zone = buffer->Zones[i & (ZonesPerThread - 1)];
+					if (!first)
+						sb << ",";
+					first = false;
+					sb << "\n{\"name\":\"";
+					AppendEscaped(sb, zone.Name);
+					sb << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << buffer->ThreadIndex << ",\"ts\":";
+					AppendMicroseconds(sb, zone.Begin - startTime, frequency);
+					sb << ",\"dur\":";
+					AppendMicroseconds(sb, zone.End - zone.Begin, frequency);
+					sb << "}";
+				}
+			}
+			sb << "\n]}\n";
+			return sb.ProduceString();
+		}
+
+		void Profiler::SaveChromeTrace(const String & fileName)
+		{
+			CoreLib::IO::File::WriteAllText(fileName, ExportChromeTrace());
+		}
+	}
+}
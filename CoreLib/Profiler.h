@@ -0,0 +1,72 @@
+#ifndef CORELIB_PROFILER_H
+#define CORELIB_PROFILER_H
+
+#include <atomic>
+#include "Basic.h"
+#include "PerformanceCounter.h"
+
+namespace CoreLib
+{
+	namespace Diagnostics
+	{
+		struct ProfileZone
+		{
+			const char * Name; // must outlive the capture, normally a string literal
+			TimePoint Begin, End;
+		};
+
+		// Records timed zones from any thread while a capture is active. Every thread writes into its own
+		// fixed-size ring buffer, so recording a zone takes no lock; when a ring is full the oldest zones of
+		// that thread are overwritten. Captures can be exported in Chrome's trace event format (chrome://tracing).
+		class Profiler
+		{
+		private:
+			static std::atomic<bool> capturing;
+		public:
+			static const int ZonesPerThread = 1 << 16;
+			// discards the zones recorded so far and starts recording
+			static void BeginCapture();
+			static void EndCapture();
+			static inline bool IsCapturing()
+			{
+				return capturing.load(std::memory_order_relaxed);
+			}
+			static void RecordZone(const char * name, TimePoint begin, TimePoint end);
+			// should be called after EndCapture, once the recording threads are idle
+			static CoreLib::Basic::String ExportChromeTrace();
+			static void SaveChromeTrace(const CoreLib::Basic::String & fileName);
+		};
+
+		class ProfileScope
+		{
+		private:
+			const char * name;
+			TimePoint begin;
+			bool active;
+		public:
+			ProfileScope(const char * zoneName)
+			{
+				active = Profiler::IsCapturing();
+				if (active)
+				{
+					name = zoneName;
+					begin = PerformanceCounter::Start();
+				}
+			}
+			~ProfileScope()
+			{
+				if (active)
+					Profiler::RecordZone(name, begin, PerformanceCounter::Start());
+			}
+			ProfileScope(const ProfileScope &) = delete;
+			ProfileScope & operator = (const ProfileScope &) = delete;
+		};
+	}
+}
+
+#define CORELIB_PROFILE_CONCAT_IMPL(a, b) a##b
+#define CORELIB_PROFILE_CONCAT(a, b) CORELIB_PROFILE_CONCAT_IMPL(a, b)
+// times the rest of the enclosing scope as a zone named by the string literal name
+#define PROFILE_ZONE(name) CoreLib::Diagnostics::ProfileScope CORELIB_PROFILE_CONCAT(profileZone_, __LINE__)(name)
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef CORE_LIB_RADIX_SORT_H
+#define CORE_LIB_RADIX_SORT_H
+
+#include "List.h"
+#include <string.h>
+
+namespace CoreLib
+{
+	namespace Basic
+	{
+		// Stable LSD radix sort of items in ascending order of their 64-bit Key member, eight bits per pass.
+		// Passes over bytes that are the same in every key are skipped. scratch is used as the second buffer,
+		// the two lists may be swapped.
+		template<typename T, typename TAllocator>
+		void RadixSortByKey(List<T, TAllocator> & items, List<T, TAllocator> & scratch)
+		{
+			const int RadixBits = 8;
+			const int BucketCount = 1 << RadixBits;
+			const int PassCount = 64 / RadixBits;
+			int count = items.Count();
+			if (count < 2)
+				return;
+			int histogram[PassCount][BucketCount];
+			memset(histogram, 0, sizeof(histogram));
+			for (int i = 0; i < count; i++)
+			{
+				unsigned long long key = items[i].Key;
+				for (int pass = 0; pass < PassCount; pass++)
+					histogram[pass][(key >> (pass * RadixBits)) & (BucketCount - 1)]++;
+			}
+			scratch.SetSize(count);
+			for (int pass = 0; pass < PassCount; pass++)
+			{
+				int shift = pass * RadixBits;
+				auto & bucketSizes = histogram[pass];
+				if (bucketSizes[(items[0].Key >> shift) & (BucketCount - 1)] == count)
+					continue;
+				int offsets[BucketCount];
+				int offset = 0;
+				for (int i = 0; i < BucketCount; i++)
+				{
+					offsets[i] = offset;
+					offset += bucketSizes[i];
+				}
+				T * src = items.Buffer();
+				T * dst = scratch.Buffer();
+				for (int i = 0; i < count; i++)
+					dst[offsets[(src[i].Key >> shift) & (BucketCount - 1)]++] = src[i];
+				items.SwapWith(scratch);
+			}
+		}
+	}
+}
+
+#endif
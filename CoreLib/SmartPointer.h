@@ -1,6 +1,7 @@
 #ifndef FUNDAMENTAL_LIB_SMART_POINTER_H
 #define FUNDAMENTAL_LIB_SMART_POINTER_H
 
+#include <atomic>
 #include "TypeTraits.h"
 
 namespace CoreLib
@@ -33,6 +34,24 @@ namespace CoreLib
 			friend class RefPtrImpl;
 		private:
 			int _refCount = 0;
+			void AddReference()
+			{
+				_refCount++;
+			}
+			// returns true if the caller held the last reference
+			bool RemoveReference()
+			{
+				if (_refCount > 1)
+				{
+					_refCount--;
+					return false;
+				}
+				return true;
+			}
+			void DetachReference()
+			{
+				_refCount--;
+			}
 		public:
 			ReferenceCounted() {}
 			ReferenceCounted(const ReferenceCounted &)
@@ -41,6 +60,46 @@ namespace CoreLib
 			}
 		};
 
+		// Intrusive reference count that can be shared between threads. Taking a reference is a
+		// relaxed increment; dropping one is a release decrement, and the thread that drops the
+		// last reference issues an acquire fence before destroying the object.
+		class ThreadSafeReferenceCounted
+		{
+			template<typename T, bool b, typename Destructor>
+			friend class RefPtrImpl;
+		private:
+			std::atomic<int> _refCount;
+			void AddReference()
+			{
+				_refCount.fetch_add(1, std::memory_order_relaxed);
+			}
+			bool RemoveReference()
+			{
+				if (_refCount.fetch_sub(1, std::memory_order_release) == 1)
+				{
+					std::atomic_thread_fence(std::memory_order_acquire);
+					return true;
+				}
+				return false;
+			}
+			void DetachReference()
+			{
+				_refCount.fetch_sub(1, std::memory_order_relaxed);
+			}
+		public:
+			ThreadSafeReferenceCounted()
+			{
+				_refCount.store(0, std::memory_order_relaxed);
+			}
+			ThreadSafeReferenceCounted(const ThreadSafeReferenceCounted &)
+			{
+				_refCount.store(0, std::memory_order_relaxed);
+			}
+			ThreadSafeReferenceCounted & operator = (const ThreadSafeReferenceCounted &)
+			{
+				return *this;
+			}
+		};
 
 		class RefObject : public ReferenceCounted
 		{
@@ -49,13 +108,27 @@ namespace CoreLib
 			{}
 		};
 
+		// RefObject for objects that are referenced from more than one thread
+		class ThreadSafeRefObject : public ThreadSafeReferenceCounted
+		{
+		public:
+			virtual ~ThreadSafeRefObject()
+			{}
+		};
+
 		template<typename T, bool HasBuiltInCounter, typename Destructor>
 		class RefPtrImpl
 		{
 		};
 
+		template<typename T>
+		struct HasBuiltInRefCount
+		{
+			enum { Value = IsBaseOf<ReferenceCounted, T>::Value || IsBaseOf<ThreadSafeReferenceCounted, T>::Value };
+		};
+
 		template<typename T, typename Destructor = RefPtrDefaultDestructor>
-		using RefPtr = RefPtrImpl<T, IsBaseOf<ReferenceCounted, T>::Value, Destructor>;
+		using RefPtr = RefPtrImpl<T, HasBuiltInRefCount<T>::Value, Destructor>;
 
         template<typename T, typename Destructor = RefPtrDefaultDestructor>
         using ObjPtr = CoreLib::Basic::RefPtrImpl<T, true, RefPtrDefaultDestructor>;
@@ -310,7 +383,7 @@ namespace CoreLib
 				pointer = ptr.pointer;
 				if (ptr)
 				{
-					ptr->_refCount++;
+					ptr->AddReference();
 				}
 			}
 
@@ -323,7 +396,7 @@ namespace CoreLib
 				pointer = ptr.pointer;
 				if (ptr)
 				{
-					ptr->_refCount++;
+					ptr->AddReference();
 				}
 				return *this;
 			}
@@ -336,7 +409,7 @@ namespace CoreLib
 					pointer = ptr;
 					if (ptr)
 					{
-						ptr->_refCount++;
+						ptr->AddReference();
 					}
 				}
 				return *this;
@@ -348,7 +421,7 @@ namespace CoreLib
 					Unreference();
 					pointer = ptr.pointer;
 					if (pointer)
-						pointer->_refCount++;
+						pointer->AddReference();
 				}
 				return *this;
 			}
@@ -383,7 +456,7 @@ namespace CoreLib
 					result.pointer = dynamic_cast<U*>(pointer);
 					if (result.pointer)
 					{
-						result.pointer->_refCount++;
+						result.pointer->AddReference();
 					}
 				}
 				return result;
@@ -410,7 +483,7 @@ namespace CoreLib
 			{
 				if (pointer)
 				{
-					pointer->_refCount--;
+					pointer->DetachReference();
 				}
 				auto rs = pointer;
 				pointer = 0;
@@ -425,11 +498,7 @@ namespace CoreLib
 			{
 				if (pointer)
 				{
-					if (pointer->_refCount > 1)
-					{
-						pointer->_refCount--;
-					}
-					else
+					if (pointer->RemoveReference())
 					{
 						Destructor destructor;
 						destructor(pointer);
@@ -285,6 +285,7 @@ namespace CoreLib
 					else
 						break;
 				}
+				ptr += (int)i;
 				return i;
 			}
 			virtual Int64 Write(const void * pbuffer, Int64 length)
@@ -2,12 +2,16 @@
 
 #ifdef _WIN32
 #include <windows.h>
+#include <intrin.h>
 #elif MACOS
 #include <sys/param.h>
 #include <sys/sysctl.h>
 #else
 #include <unistd.h>
 #endif
+#if !defined(_WIN32) && (defined(__i386__) || defined(__x86_64__))
+#include <cpuid.h>
+#endif
 
 namespace CoreLib
 {
@@ -46,5 +50,37 @@ namespace CoreLib
 			return sysconf(_SC_NPROCESSORS_ONLN);
 		#endif
 		}
+
+		bool ParallelSystemInfo::IsAVXSupported()
+		{
+			static int supported = -1;
+			if (supported != -1)
+				return supported != 0;
+			supported = 0;
+		#ifdef _WIN32
+			int info[4];
+			__cpuid(info, 1);
+			bool osxsave = (info[2] & (1 << 27)) != 0;
+			bool avx = (info[2] & (1 << 28)) != 0;
+			// the OS must save the upper halves of the YMM registers on context switches
+			if (osxsave && avx && (_xgetbv(0) & 6) == 6)
+				supported = 1;
+		#elif defined(__i386__) || defined(__x86_64__)
+			unsigned int eax, ebx, ecx, edx;
+			if (__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+			{
+				bool osxsave = (ecx & (1 << 27)) != 0;
+				bool avx = (ecx & (1 << 28)) != 0;
+				if (osxsave && avx)
+				{
+					unsigned int xcr0Low, xcr0High;
+					__asm__("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+					if ((xcr0Low & 6) == 6)
+						supported = 1;
+				}
+			}
+		#endif
+			return supported != 0;
+		}
 	}
 }
\ No newline at end of file
@@ -49,6 +49,8 @@ namespace CoreLib
 		{
 		public:
 			static int GetProcessorCount();
+			// true if both the CPU and the OS support 256-bit AVX instructions
+			static bool IsAVXSupported();
 		};
 
 		typedef CoreLib::Basic::Event<> ThreadProc;
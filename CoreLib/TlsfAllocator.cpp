@@ -0,0 +1,216 @@
+#include "TlsfAllocator.h"
+#include "LibMath.h"
+#include <cassert>
+
+namespace CoreLib
+{
+	namespace Basic
+	{
+		static inline int Log2Floor64(unsigned long long x)
+		{
+			unsigned int high = (unsigned int)(x >> 32);
+			if (high)
+				return 32 + (int)Math::Log2Floor(high);
+			return (int)Math::Log2Floor((unsigned int)x);
+		}
+
+		static inline int LowestBit(unsigned long long x)
+		{
+			return Log2Floor64(x & (~x + 1));
+		}
+
+		static inline void MapSize(long long size, int & firstLevel, int & secondLevel, int firstLevelShift, int secondLevelBits)
+		{
+			if (size < (1ll << firstLevelShift))
+			{
+				firstLevel = 0;
+				secondLevel = (int)(size >> (firstLevelShift - secondLevelBits));
+			}
+			else
+			{
+				int log2Size = Log2Floor64((unsigned long long)size);
+				firstLevel = log2Size - firstLevelShift + 1;
+				secondLevel = (int)(size >> (log2Size - secondLevelBits)) - (1 << secondLevelBits);
+			}
+		}
+
+		void TlsfAllocator::Init(long long size, int alignment)
+		{
+			assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+			log2Granularity = (int)Math::Log2Floor((unsigned int)alignment);
+			blocks.Clear();
+			unusedBlocks.Clear();
+			allocatedBlocks.Clear();
+			firstLevelBitmap = 0;
+			for (int i = 0; i < FirstLevelCount; i++)
+			{
+				secondLevelBitmaps[i] = 0;
+				for (int j = 0; j < SecondLevelCount; j++)
+					freeLists[i][j] = InvalidBlock;
+			}
+			stats = TlsfAllocatorStats();
+			stats.TotalSize = (size >> log2Granularity) << log2Granularity;
+			if (stats.TotalSize)
+			{
+				int block = NewBlock();
+				blocks[block].Size = size >> log2Granularity;
+				InsertFreeBlock(block);
+			}
+		}
+
+		int TlsfAllocator::NewBlock()
+		{
+			if (unusedBlocks.Count())
+			{
+				int block = unusedBlocks.Last();
+				unusedBlocks.RemoveAt(unusedBlocks.Count() - 1);
+				blocks[block] = Block();
+				return block;
+			}
+			blocks.Add(Block());
+			return blocks.Count() - 1;
+		}
+
+		void TlsfAllocator::ReleaseBlock(int block)
+		{
+			unusedBlocks.Add(block);
+		}
+
+		void TlsfAllocator::InsertFreeBlock(int block)
+		{
+			auto & b = blocks[block];
+			int fl, sl;
+			MapSize(b.Size, fl, sl, FirstLevelShift, SecondLevelBits);
+			b.IsFree = true;
+			b.PrevFree = InvalidBlock;
+			b.NextFree = freeLists[fl][sl];
+			if (b.NextFree != InvalidBlock)
+				blocks[b.NextFree].PrevFree = block;
+			freeLists[fl][sl] = block;
+			firstLevelBitmap |= (1ull << fl);
+			secondLevelBitmaps[fl] |= (1u << sl);
+		}
+
+		void TlsfAllocator::RemoveFreeBlock(int block)
+		{
+			auto & b = blocks[block];
+			int fl, sl;
+			MapSize(b.Size, fl, sl, FirstLevelShift, SecondLevelBits);
+			if (b.PrevFree != InvalidBlock)
+				blocks[b.PrevFree].NextFree = b.NextFree;
+			else
+				freeLists[fl][sl] = b.NextFree;
+			if (b.NextFree != InvalidBlock)
+				blocks[b.NextFree].PrevFree = b.PrevFree;
+			if (freeLists[fl][sl] == InvalidBlock)
+			{
+				secondLevelBitmaps[fl] &= ~(1u << sl);
+				if (!secondLevelBitmaps[fl])
+					firstLevelBitmap &= ~(1ull << fl);
+			}
+			b.IsFree = false;
+			b.PrevFree = b.NextFree = InvalidBlock;
+		}
+
+		// absorbs the physical successor of block, which must be free and not in a free list
+		void TlsfAllocator::MergeWithNext(int block)
+		{
+			int next = blocks[block].NextPhysical;
+			blocks[block].Size += blocks[next].Size;
+			blocks[block].NextPhysical = blocks[next].NextPhysical;
+			if (blocks[block].NextPhysical != InvalidBlock)
+				blocks[blocks[block].NextPhysical].PrevPhysical = block;
+			ReleaseBlock(next);
+		}
+
+		long long TlsfAllocator::Alloc(long long size)
+		{
+			if (size <= 0)
+				return InvalidOffset;
+			long long granules = ((size - 1) >> log2Granularity) + 1;
+			// round the search size up to the next second level, so that every block in the found list fits
+			long long searchSize = granules;
+			if (searchSize >= SmallBlockSize)
+				searchSize += (1ll << (Log2Floor64((unsigned long long)searchSize) - SecondLevelBits)) - 1;
+			int fl, sl;
+			MapSize(searchSize, fl, sl, FirstLevelShift, SecondLevelBits);
+			if (fl >= FirstLevelCount)
+				return InvalidOffset;
+			unsigned int slMap = secondLevelBitmaps[fl] & (~0u << sl);
+			if (!slMap)
+			{
+				unsigned long long flMap = (fl + 1 < 64) ? (firstLevelBitmap & (~0ull << (fl + 1))) : 0;
+				if (!flMap)
+					return InvalidOffset;
+				fl = LowestBit(flMap);
+				slMap = secondLevelBitmaps[fl];
+			}
+			sl = LowestBit(slMap);
+			int block = freeLists[fl][sl];
+			RemoveFreeBlock(block);
+			if (blocks[block].Size > granules)
+			{
+				int remainder = NewBlock();
+				auto & b = blocks[block];
+				auto & r = blocks[remainder];
+				r.Offset = b.Offset + granules;
+				r.Size = b.Size - granules;
+				r.PrevPhysical = block;
+				r.NextPhysical = b.NextPhysical;
+				if (r.NextPhysical != InvalidBlock)
+					blocks[r.NextPhysical].PrevPhysical = remainder;
+				b.NextPhysical = remainder;
+				b.Size = granules;
+				InsertFreeBlock(remainder);
+			}
+			blocks[block].RequestedSize = size;
+			allocatedBlocks[blocks[block].Offset] = block;
+			stats.AllocationCount++;
+			stats.BytesAllocated += granules << log2Granularity;
+			stats.BytesRequested += size;
+			return blocks[block].Offset << log2Granularity;
+		}
+
+		void TlsfAllocator::Free(long long offset)
+		{
+			int block = InvalidBlock;
+			long long granuleOffset = offset >> log2Granularity;
+			if (!allocatedBlocks.TryGetValue(granuleOffset, block))
+				throw InvalidOperationException("freeing a range that is not allocated.");
+			allocatedBlocks.Remove(granuleOffset);
+			stats.AllocationCount--;
+			stats.BytesAllocated -= blocks[block].Size << log2Granularity;
+			stats.BytesRequested -= blocks[block].RequestedSize;
+			int next = blocks[block].NextPhysical;
+			if (next != InvalidBlock && blocks[next].IsFree)
+			{
+				RemoveFreeBlock(next);
+				MergeWithNext(block);
+			}
+			int prev = blocks[block].PrevPhysical;
+			if (prev != InvalidBlock && blocks[prev].IsFree)
+			{
+				RemoveFreeBlock(prev);
+				MergeWithNext(prev);
+				block = prev;
+			}
+			InsertFreeBlock(block);
+		}
+
+		TlsfAllocatorStats TlsfAllocator::GetStats() const
+		{
+			auto rs = stats;
+			rs.BytesFree = rs.TotalSize - rs.BytesAllocated;
+			rs.FreeBlockCount = blocks.Count() - unusedBlocks.Count() - rs.AllocationCount;
+			// the largest block is in the highest non-empty free list, which needs to be searched
+			if (firstLevelBitmap)
+			{
+				int fl = Log2Floor64(firstLevelBitmap);
+				int sl = (int)Math::Log2Floor(secondLevelBitmaps[fl]);
+				for (int block = freeLists[fl][sl]; block != InvalidBlock; block = blocks[block].NextFree)
+					rs.LargestFreeBlock = Math::Max(rs.LargestFreeBlock, blocks[block].Size << log2Granularity);
+			}
+			return rs;
+		}
+	}
+}
@@ -0,0 +1,77 @@
+#ifndef CORE_LIB_TLSF_ALLOCATOR_H
+#define CORE_LIB_TLSF_ALLOCATOR_H
+
+#include "Basic.h"
+
+namespace CoreLib
+{
+	namespace Basic
+	{
+		struct TlsfAllocatorStats
+		{
+			long long TotalSize = 0;
+			long long BytesAllocated = 0; // including the rounding of requests to the allocation granularity
+			long long BytesRequested = 0;
+			long long BytesFree = 0;
+			long long LargestFreeBlock = 0;
+			int AllocationCount = 0;
+			int FreeBlockCount = 0;
+			// 0 when all free space is in one block, approaching 1 as free space splits into small blocks
+			float GetFragmentation() const
+			{
+				return BytesFree ? 1.0f - (float)((double)LargestFreeBlock / (double)BytesFree) : 0.0f;
+			}
+		};
+
+		// Two-level segregated fit allocator of ranges within a heap of a given size. The heap memory is never
+		// touched: block headers are kept in a separate list, so the heap can be a device buffer. Sizes are
+		// rounded up to the alignment only, and both Alloc and Free run in constant time.
+		class TlsfAllocator
+		{
+		private:
+			static const int SecondLevelBits = 5;
+			static const int SecondLevelCount = 1 << SecondLevelBits;
+			// sizes below SmallBlockSize granules share the first level 0, one second level per size
+			static const int FirstLevelShift = SecondLevelBits;
+			static const int SmallBlockSize = 1 << FirstLevelShift;
+			static const int FirstLevelCount = 64 - FirstLevelShift + 1;
+			static const int InvalidBlock = -1;
+			struct Block
+			{
+				long long Offset = 0, Size = 0; // in granules
+				long long RequestedSize = 0;
+				int PrevPhysical = InvalidBlock, NextPhysical = InvalidBlock;
+				int PrevFree = InvalidBlock, NextFree = InvalidBlock;
+				bool IsFree = false;
+			};
+			List<Block> blocks;
+			List<int> unusedBlocks;
+			Dictionary<long long, int> allocatedBlocks; // offset in granules -> block
+			unsigned long long firstLevelBitmap = 0;
+			unsigned int secondLevelBitmaps[FirstLevelCount];
+			int freeLists[FirstLevelCount][SecondLevelCount];
+			int log2Granularity = 0;
+			TlsfAllocatorStats stats;
+			int NewBlock();
+			void ReleaseBlock(int block);
+			void InsertFreeBlock(int block);
+			void RemoveFreeBlock(int block);
+			void MergeWithNext(int block);
+		public:
+			static const long long InvalidOffset = -1;
+			TlsfAllocator() = default;
+			TlsfAllocator(long long size, int alignment)
+			{
+				Init(size, alignment);
+			}
+			// alignment must be a power of two, all offsets and sizes are rounded to it
+			void Init(long long size, int alignment);
+			// returns the offset of the allocated range, or InvalidOffset if no free block is large enough
+			long long Alloc(long long size);
+			void Free(long long offset);
+			TlsfAllocatorStats GetStats() const;
+		};
+	}
+}
+
+#endif
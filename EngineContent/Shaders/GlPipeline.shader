@@ -14,6 +14,8 @@ pipeline StandardPipeline
     {
         return project(vertAttribIn);
     }
+    [InstanceId]
+    extern @CoarseVertex int instanceId;
     
     extern @Fragment CoarseVertex CoarseVertexIn;
     import(CoarseVertex->Fragment) standardImport<T>()
@@ -54,6 +56,8 @@ pipeline TessellationPipeline : StandardPipeline
     [VertexInput]
     extern @CoarseVertex MeshVertex vertAttribs;
     import(MeshVertex->CoarseVertex) vertexImport() { return project(vertAttribs); }
+    [InstanceId]
+    extern @CoarseVertex int instanceId;
     
     // implicit import operator CoarseVertex->CornerPoint
     extern @CornerPoint CoarseVertex[] CoarseVertex_ControlPoint;
@@ -88,6 +88,32 @@ module NoAnimation
     }
 }
 
+module InstancedNoAnimation
+{
+    param StructuredBuffer<mat4> instanceTransforms;
+
+    require vec3 vertPos;
+    require vec3 vertNormal;
+    require vec3 vertTangent;
+    require vec3 vertBinormal;
+
+    @CoarseVertex mat4 modelMatrix = instanceTransforms[instanceId];
+
+    public @CoarseVertex vec3 coarseVertPos = vertPos;
+    public @CoarseVertex vec3 coarseVertNormal = vertNormal;
+    public @CoarseVertex vec3 coarseVertTangent = vertTangent;
+    public @CoarseVertex vec3 coarseVertBinormal = vertBinormal;
+
+    public vec3 worldTransformPos(vec3 pos)
+    {
+        return (modelMatrix * vec4(pos, 1)).xyz;
+    }
+    public vec3 worldTransformTangent(vec3 tangent)
+    {
+        return normalize(mat3(modelMatrix) * tangent);
+    }
+}
+
 struct SkinningResult
 {
     vec3 pos;
@@ -432,12 +458,21 @@ module Lighting
     public param mat4[8] lightMatrix;
     public param vec4[2] zPlanes;
     public param vec4 ambient;
+    public param int directionalLightCount;
+    public param int clusterTilesX;
+    public param int clusterTilesY;
+    public param int clusterSlices;
+    public param vec4 clusterDepthParams;
     public param StructuredBuffer<Light> lights;
     public param StructuredBuffer<LightProbe> lightProbes;
     public param SamplerState envMapSampler;
     public param Texture2DArrayShadow shadowMapArray;
     public param SamplerComparisonState shadowMapSampler;
     public param TextureCubeArray envMap;
+    // (offset << 12) | count per cluster, see LightBinningPass
+    public param StructuredBuffer<uint> lightClusters;
+    // light indices of the clusters, two 16 bit indices per element
+    public param StructuredBuffer<uint> lightIndices;
 
     require vec3 normal;   
     require vec3 albedo;
@@ -447,6 +482,7 @@ module Lighting
     require vec3 cameraPos;
     require float selfShadow(vec3 lightDir);
     require mat4 viewTransform;
+    require mat4 viewProjectionTransform;
     require bool isDoubleSided;
     require SamplerState textureSampler;
 
@@ -512,8 +548,23 @@ module Lighting
                     (diffuseColor + fspecularColor * PhongApprox(roughness_in, RoL)) * shadow;
         }
 
-        for (int i = 0; i < lightCount; i++)
+        // the directional lights, then the point and spot lights binned to the cluster of this pixel
+        vec4 clipPos = viewProjectionTransform * vec4(pos, 1.0);
+        vec2 screenPos = clamp(clipPos.xy / clipPos.w * 0.5 + 0.5, vec2(0.0), vec2(0.999));
+        int clusterSlice = clamp(int(log(max(-viewPos.z, 1e-4)) * clusterDepthParams.x + clusterDepthParams.y), 0, clusterSlices - 1);
+        int clusterId = (clusterSlice * clusterTilesY + int(screenPos.y * clusterTilesY)) * clusterTilesX + int(screenPos.x * clusterTilesX);
+        uint cluster = lightClusters[clusterId];
+        int clusterLightOffset = int(cluster >> 12);
+        int clusterLightCount = int(cluster & 4095);
+        for (int li = 0; li < directionalLightCount + clusterLightCount; li++)
         {
+            int i = li;
+            if (li >= directionalLightCount)
+            {
+                int indexId = clusterLightOffset + li - directionalLightCount;
+                uint packedIndices = lightIndices[indexId >> 1];
+                i = int((indexId & 1) != 0 ? packedIndices >> 16 : packedIndices & 65535);
+            }
             Light light = lights[i];
             uint lightType = light.lightType_shadowMapId & 65535;
             uint shadowMapId = light.lightType_shadowMapId >> 16;
@@ -524,7 +575,8 @@ module Lighting
                 vec3 path = light.position - pos;
                 float dist = dot(path, path);
                 lightDir = normalize(path);
-                actualDecay = 1.0 / max(1.0, dist * light.decay);
+                // lights are binned by radius, so they must not reach beyond it
+                actualDecay = dist < light.radius * light.radius ? 1.0 / max(1.0, dist * light.decay) : 0.0;
                 if (lightType == 2)
                 {
                     float ang = acos(dot(lightDir, UnpackDir(light.direction)));
@@ -51,6 +51,8 @@ int __stdcall wWinMain(
 			CommandLineParser parser(Application::GetCommandLine());
 			if (parser.OptionExists("-vk"))
 				args.API = RenderAPI::Vulkan;
+			if (parser.OptionExists("-null_renderer"))
+				args.API = RenderAPI::Null;
 			if (parser.OptionExists("-dir"))
 				args.GameDirectory = RemoveQuote(parser.GetOptionValue("-dir"));
 			if (parser.OptionExists("-enginedir"))
@@ -59,6 +61,8 @@ int __stdcall wWinMain(
 				args.GpuId = StringToInt(parser.GetOptionValue("-gpu"));
 			if (parser.OptionExists("-recompileshaders"))
 				args.RecompileShaders = true;
+			if (parser.OptionExists("-parallel_tick"))
+				args.ParallelActorTick = true;
 			if (parser.OptionExists("-level"))
 				args.StartupLevelName = parser.GetOptionValue("-level");
 			if (parser.OptionExists("-recdir"))
@@ -85,6 +89,8 @@ int __stdcall wWinMain(
 				appParams.DumpRenderStats = true;
 				appParams.RenderStatsDumpFileName = RemoveQuote(parser.GetOptionValue("-dumpstat"));
 			}
+			if (parser.OptionExists("-profile"))
+				appParams.ProfileFileName = RemoveQuote(parser.GetOptionValue("-profile"));
 			if (parser.OptionExists("-width"))
 			{
 				w = StringToInt(parser.GetOptionValue("-width"));
@@ -1,6 +1,7 @@
 #include "Actor.h"
 #include "Engine.h"
 #include "Model.h"
+#include "LevelFile.h"
 
 namespace GameEngine
 {
@@ -104,11 +105,56 @@ namespace GameEngine
 		SerializeFields(sb);
 		sb << "}\n";
 	}
+	void Actor::ParseBinary(Level * plevel, LevelFileReader & reader, int actorId, bool & isInvalid)
+	{
+		level = plevel;
+		auto & record = reader.GetActor(actorId);
+		CoreLib::List<CoreLib::String> errors;
+		if (!reader.ReadProperties(actorId, this, errors))
+		{
+			for (auto & error : errors)
+				Print("Actor '%s': %s\n", reader.GetStringBuffer(record.ClassName), error.Buffer());
+			isInvalid = true;
+		}
+		if (record.Fields == LevelFileNone)
+			return;
+		// fields written by SerializeFields are kept as text and parsed like in the text format
+		CoreLib::Text::TokenReader parser(reader.GetString(record.Fields));
+		try
+		{
+			while (!parser.IsEnd())
+			{
+				auto fieldName = parser.ReadToken();
+				if (!ParseField(fieldName.Content, parser))
+				{
+					Print("Actor '%s' does not have property '%s'.\n", reader.GetStringBuffer(record.ClassName), fieldName.Content.Buffer());
+					isInvalid = true;
+					return;
+				}
+			}
+		}
+		catch (CoreLib::Text::TextFormatException)
+		{
+			Print("Cannot parse fields of actor '%s'.\n", reader.GetStringBuffer(record.ClassName));
+			isInvalid = true;
+		}
+	}
+	void Actor::SerializeToBinary(LevelFileWriter & writer)
+	{
+		CoreLib::StringBuilder sb;
+		SerializeFields(sb);
+		writer.AddActor(GetTypeName(), this, sb.ProduceString());
+	}
 	VectorMath::Vec3 Actor::GetPosition()
 	{
 		auto l = LocalTransform.GetValue();
 		return VectorMath::Vec3::Create(l.values[12], l.values[13], l.values[14]);
 	}
+	void Actor::NotifyChanged()
+	{
+		if (level)
+			level->NotifyActorChanged(this);
+	}
 	Actor::~Actor()
 	{
 		OnUnload();
@@ -17,11 +17,23 @@ namespace GameEngine
 	{
         Util, Drawable, Light, EnvMap, Atmosphere, BoundingVolume, Camera, UserController, ToneMapping
 	};
+	const int EngineActorTypeCount = (int)EngineActorType::ToneMapping + 1;
+
+	// How the level's SceneCullingTree tracks an actor. Static and movable actors must only add
+	// drawables whose bounds lie within Actor::Bounds; static actors call
+	// SceneCullingTree::UpdateActor when their bounds change, movable actors are refit every frame.
+	enum class DrawableMobility
+	{
+		None, Static, Movable
+	};
 
 	class RendererService;
 	class DrawableSink;
     class ModelDrawableInstance;
     class Drawable;
+	class AnimationLodSettings;
+	class RenderStat;
+	struct CullFrustum;
 
 	struct GetDrawablesParameter
 	{
@@ -30,9 +42,17 @@ namespace GameEngine
 		VectorMath::Vec3 CameraPos, CameraDir;
 		bool IsEditorMode = false;
 		bool UseSkeleton = true;
+		// animation LOD selection, disabled if AnimationLod is null
+		const AnimationLodSettings * AnimationLod = nullptr;
+		CullFrustum * CameraFrustum = nullptr;
+		float ProjectionScale = 1.0f; // 0.5 / tan(fovY / 2)
+		int FrameId = 0;
+		RenderStat * Stats = nullptr;
 	};
 
 	class Level;
+	class LevelFileReader;
+	class LevelFileWriter;
 
 	class Actor : public PropertyContainer
 	{
@@ -56,18 +76,30 @@ namespace GameEngine
 		CoreLib::Graphics::BBox Bounds;
 		CoreLib::List<CoreLib::RefPtr<Actor>> SubComponents;
 		virtual void Tick() { }
+		// Actors returning true may tick on a worker thread when the engine's parallel actor tick
+		// is enabled. Such a Tick may only modify the actor itself and its physics objects.
+		virtual bool IsTickThreadSafe() { return false; }
+		// Thread-safe actors that must finish their Tick before this actor's Tick starts.
+		virtual void GetTickDependencies(CoreLib::List<Actor*> & /*dependencies*/) {}
 		virtual EngineActorType GetEngineType() = 0;
+		virtual DrawableMobility GetDrawableMobility() { return DrawableMobility::None; }
 		virtual void OnLoad() {};
 		virtual void OnUnload() {};
 		virtual void RegisterUI(GraphicsUI::UIEntry *) {}
 		virtual void Parse(Level * plevel, CoreLib::Text::TokenReader & parser, bool & isInvalid);
 		virtual void SerializeToText(CoreLib::StringBuilder & sb);
+		// compiled level counterparts of Parse and SerializeToText, see LevelFile.h
+		virtual void ParseBinary(Level * plevel, LevelFileReader & reader, int actorId, bool & isInvalid);
+		virtual void SerializeToBinary(LevelFileWriter & writer);
 		virtual void GetDrawables(const GetDrawablesParameter & /*params*/) {}
 		virtual CoreLib::String GetTypeName() { return "Actor"; }
 		void SetLevel(Level * plevel)
 		{
 			level = plevel;
 		}
+		// Bumps the level's version counter for this actor's engine type, see Level::GetActorTypeVersion.
+		// Called automatically when any property of a registered actor changes.
+		void NotifyChanged();
 		VectorMath::Matrix4 GetLocalTransform()
 		{
 			return LocalTransform.GetValue();
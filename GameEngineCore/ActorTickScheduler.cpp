@@ -0,0 +1,144 @@
+#include "ActorTickScheduler.h"
+#include "Actor.h"
+#include "Engine.h"
+#include "CoreLib/Profiler.h"
+
+using namespace CoreLib;
+using namespace CoreLib::Threading;
+
+namespace GameEngine
+{
+	bool ActorTickScheduler::BuildGraph()
+	{
+		nodeIds.Clear();
+		for (int i = 0; i < nodes.Count(); i++)
+			nodeIds[nodes[i].TargetActor] = i;
+		dependencyEdges.Clear();
+		for (int i = 0; i < nodes.Count(); i++)
+		{
+			dependencyBuffer.Clear();
+			nodes[i].TargetActor->GetTickDependencies(dependencyBuffer);
+			for (auto dependency : dependencyBuffer)
+			{
+				// dependencies on actors outside of the parallel phase are already satisfied
+				int dependencyId;
+				if (dependency == nodes[i].TargetActor || !nodeIds.TryGetValue(dependency, dependencyId))
+					continue;
+				dependencyEdges.Add(dependencyId);
+				dependencyEdges.Add(i);
+				nodes[i].DependencyCount++;
+				nodes[dependencyId].DependentCount++;
+			}
+		}
+		int edgeCount = dependencyEdges.Count() >> 1;
+		if (edgeCount == 0)
+			return true;
+		int offset = 0;
+		for (auto & node : nodes)
+		{
+			node.FirstDependent = offset;
+			offset += node.DependentCount;
+			node.DependentCount = 0;
+		}
+		dependents.SetSize(edgeCount);
+		for (int i = 0; i < dependencyEdges.Count(); i += 2)
+		{
+			auto & node = nodes[dependencyEdges[i]];
+			dependents[node.FirstDependent + node.DependentCount++] = dependencyEdges[i + 1];
+		}
+
+		// reject cyclic dependencies, they would never be scheduled
+		CoreLib::List<int> remaining, ready;
+		remaining.SetSize(nodes.Count());
+		for (int i = 0; i < nodes.Count(); i++)
+		{
+			remaining[i] = nodes[i].DependencyCount;
+			if (remaining[i] == 0)
+				ready.Add(i);
+		}
+		int visitedCount = 0;
+		while (ready.Count())
+		{
+			auto & node = nodes[ready.Last()];
+			ready.RemoveAt(ready.Count() - 1);
+			visitedCount++;
+			for (int i = 0; i < node.DependentCount; i++)
+			{
+				int dependent = dependents[node.FirstDependent + i];
+				if (--remaining[dependent] == 0)
+					ready.Add(dependent);
+			}
+		}
+		return visitedCount == nodes.Count();
+	}
+
+	void ActorTickScheduler::ScheduleNode(int nodeId)
+	{
+		JobSystem::Instance()->ScheduleRange(TickJob, this, nodeId, nodeId + 1, &tickCounter);
+	}
+
+	void ActorTickScheduler::RunNode(int nodeId)
+	{
+		auto & node = nodes[nodeId];
+		{
+			PROFILE_ZONE("Actor::Tick");
+			node.TargetActor->Tick();
+		}
+		for (int i = 0; i < node.DependentCount; i++)
+		{
+			int dependent = dependents[node.FirstDependent + i];
+			if (remainingDependencies[dependent].fetch_sub(1, std::memory_order_acq_rel) == 1)
+				ScheduleNode(dependent);
+		}
+	}
+
+	void ActorTickScheduler::TickJob(Job & job)
+	{
+		((ActorTickScheduler*)job.Data)->RunNode(job.Begin);
+	}
+
+	void ActorTickScheduler::Tick(EnumerableDictionary<String, ObjPtr<Actor>> & actors)
+	{
+		nodes.Clear();
+		for (auto & actor : actors)
+		{
+			if (actor.Value->IsTickThreadSafe())
+			{
+				TickNode node;
+				node.TargetActor = actor.Value.Ptr();
+				node.DependencyCount = 0;
+				node.FirstDependent = 0;
+				node.DependentCount = 0;
+				nodes.Add(node);
+			}
+			else
+				actor.Value->Tick();
+		}
+		if (nodes.Count() == 0)
+			return;
+		if (!BuildGraph())
+		{
+			if (!cycleReported)
+			{
+				Print("Actor tick dependencies contain a cycle, ticking thread-safe actors serially.\n");
+				cycleReported = true;
+			}
+			for (auto & node : nodes)
+				node.TargetActor->Tick();
+			return;
+		}
+		if (remainingDependenciesCapacity < nodes.Count())
+		{
+			remainingDependenciesCapacity = nodes.Count();
+			remainingDependencies = new std::atomic<int>[remainingDependenciesCapacity];
+		}
+		for (int i = 0; i < nodes.Count(); i++)
+			remainingDependencies[i].store(nodes[i].DependencyCount, std::memory_order_relaxed);
+		for (int i = 0; i < nodes.Count(); i++)
+		{
+			if (nodes[i].DependencyCount == 0)
+				ScheduleNode(i);
+		}
+		JobSystem::Instance()->Wait(tickCounter);
+	}
+}
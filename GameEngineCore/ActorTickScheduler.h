@@ -0,0 +1,41 @@
+#ifndef GAME_ENGINE_ACTOR_TICK_SCHEDULER_H
+#define GAME_ENGINE_ACTOR_TICK_SCHEDULER_H
+
+#include "CoreLib/Basic.h"
+#include "CoreLib/JobSystem.h"
+
+namespace GameEngine
+{
+	class Actor;
+
+	// Ticks the actors of a level for one frame. Actors that are not thread-safe tick first,
+	// serially and in level order, on the calling thread. The thread-safe actors then tick as a
+	// task graph on the JobSystem, each one starting after the actors returned by its GetTickDependencies.
+	class ActorTickScheduler
+	{
+	private:
+		struct TickNode
+		{
+			Actor * TargetActor;
+			int DependencyCount;
+			int FirstDependent, DependentCount; // range in dependents
+		};
+		CoreLib::List<TickNode> nodes;
+		CoreLib::List<int> dependents;
+		CoreLib::List<int> dependencyEdges; // (dependency, dependent) pairs
+		CoreLib::RefPtr<std::atomic<int>, CoreLib::RefPtrArrayDestructor> remainingDependencies;
+		int remainingDependenciesCapacity = 0;
+		CoreLib::Dictionary<Actor*, int> nodeIds;
+		CoreLib::List<Actor*> dependencyBuffer;
+		CoreLib::Threading::JobCounter tickCounter;
+		bool cycleReported = false;
+		bool BuildGraph();
+		void ScheduleNode(int nodeId);
+		void RunNode(int nodeId);
+		static void TickJob(CoreLib::Threading::Job & job);
+	public:
+		void Tick(CoreLib::EnumerableDictionary<CoreLib::String, CoreLib::ObjPtr<Actor>> & actors);
+	};
+}
+
+#endif
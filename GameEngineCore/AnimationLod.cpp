@@ -0,0 +1,64 @@
+#include "AnimationLod.h"
+#include "Skeleton.h"
+
+using namespace CoreLib;
+using namespace VectorMath;
+
+namespace GameEngine
+{
+	void AnimationLodState::Select(const AnimationLodSettings * settings, int frameId, bool inCameraView, float screenSize)
+	{
+		Settings = settings;
+		FrameId = frameId;
+		Lod = 0;
+		if (!settings)
+			return;
+		if (!inCameraView)
+		{
+			Lod = AnimationLodCount - 1;
+			return;
+		}
+		while (Lod < AnimationLodCount - 2 && screenSize < settings->ScreenSizeThresholds[Lod])
+			Lod++;
+	}
+
+	int AnimationLodState::GetLod(int frameId) const
+	{
+		if (!Settings)
+			return 0;
+		if (FrameId != frameId && FrameId != frameId - 1)
+			return AnimationLodCount - 1;
+		return Lod;
+	}
+
+	bool AnimationLodState::IsUpdateDue(int frameId) const
+	{
+		if (!Settings)
+			return true;
+		int interval = Math::Max(1, Settings->UpdateIntervals[GetLod(frameId)]);
+		return (unsigned int)(frameId + Phase) % (unsigned int)interval == 0;
+	}
+
+	float GetProjectedSize(const CoreLib::Graphics::BBox & bounds, const VectorMath::Vec3 & cameraPos, float projectionScale)
+	{
+		float size = (bounds.Max - bounds.Min).Length();
+		float distance = ((bounds.Min + bounds.Max) * 0.5f - cameraPos).Length() - size * 0.5f;
+		// the camera is inside the bounding sphere
+		if (distance <= 0.0f)
+			return FLT_MAX;
+		return size * projectionScale / distance;
+	}
+
+	void GetReducedBoneSet(const Skeleton * skeleton, int maxDepth, CoreLib::List<bool> & animatedBones)
+	{
+		auto & bones = skeleton->Bones;
+		List<int> depth;
+		depth.SetSize(bones.Count());
+		animatedBones.SetSize(bones.Count());
+		for (int i = 0; i < bones.Count(); i++)
+		{
+			depth[i] = bones[i].ParentId == -1 ? 0 : depth[bones[i].ParentId] + 1;
+			animatedBones[i] = depth[i] <= maxDepth;
+		}
+	}
+}
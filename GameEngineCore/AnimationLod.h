@@ -0,0 +1,50 @@
+#ifndef GAME_ENGINE_ANIMATION_LOD_H
+#define GAME_ENGINE_ANIMATION_LOD_H
+
+#include "CoreLib/Basic.h"
+#include "CoreLib/Graphics/BBox.h"
+#include "EngineLimits.h"
+
+namespace GameEngine
+{
+	class Skeleton;
+
+	class AnimationLodSettings
+	{
+	public:
+		// a mesh in the camera view uses the first LOD whose threshold its projected size (bounds diagonal
+		// relative to the view height) is not below, the last two LODs are for smaller meshes and for
+		// meshes outside the camera view (e.g. only visible to a shadow view)
+		float ScreenSizeThresholds[AnimationLodCount - 2] = { 0.2f, 0.05f };
+		// the pose of a mesh at LOD i is evaluated every UpdateIntervals[i] frames
+		int UpdateIntervals[AnimationLodCount] = { 1, 2, 4, 8 };
+		// from this LOD on, bones deeper than ReducedBoneDepth in the hierarchy keep their bind pose
+		int ReducedBonesLod = 2;
+		int ReducedBoneDepth = 8;
+	};
+
+	// Animation LOD of one skeletal mesh, selected by the renderer each frame the mesh is drawn.
+	// Meshes spread their throttled updates over different frames through their Phase.
+	class AnimationLodState
+	{
+	public:
+		const AnimationLodSettings * Settings = nullptr; // null if the last selection had animation LOD disabled
+		int Lod = 0;
+		int Phase = 0;
+		int FrameId = -1; // frame of the last selection
+		void Select(const AnimationLodSettings * settings, int frameId, bool inCameraView, float screenSize);
+		// the LOD that applies to frameId: the last selection, or the last LOD if the mesh was
+		// not drawn in the previous frame
+		int GetLod(int frameId) const;
+		bool IsUpdateDue(int frameId) const;
+	};
+
+	// size of the bounds diagonal relative to the view height at the bounds' distance from cameraPos,
+	// projectionScale is 0.5 / tan(fovY / 2)
+	float GetProjectedSize(const CoreLib::Graphics::BBox & bounds, const VectorMath::Vec3 & cameraPos, float projectionScale);
+
+	// marks the bones of a topologically sorted skeleton whose depth (the root has depth 0) is at most maxDepth
+	void GetReducedBoneSet(const Skeleton * skeleton, int maxDepth, CoreLib::List<bool> & animatedBones);
+}
+
+#endif
@@ -13,14 +13,53 @@ namespace GameEngine
 		float animTime = fmod(time * anim->Speed, anim->Duration);
         for (int i = 0; i < skeleton->Bones.Count(); i++)
             p.Transforms[i] = skeleton->Bones[i].BindPose;
+		for (auto & channel : anim->Channels)
+			if (channel.BoneId == -1)
+				skeleton->BoneMapping.TryGetValue(channel.BoneName, channel.BoneId);
+		if (animatedBones)
+		{
+			channelMask.SetSize(anim->Channels.Count());
+			for (int i = 0; i < anim->Channels.Count(); i++)
+			{
+				int boneId = anim->Channels[i].BoneId;
+				channelMask[i] = boneId != -1 && (boneId >= animatedBones->Count() || (*animatedBones)[boneId]);
+			}
+		}
+		channelTransforms.SetSize(anim->Channels.Count());
+		anim->Sample(animTime, samplingContext, channelTransforms.Buffer(), animatedBones ? channelMask.Buffer() : nullptr);
 		for (int i = 0; i < anim->Channels.Count(); i++)
 		{
-			if (anim->Channels[i].BoneId == -1)
-				skeleton->BoneMapping.TryGetValue(anim->Channels[i].BoneName, anim->Channels[i].BoneId);
-			if (anim->Channels[i].BoneId != - 1)
+			int boneId = anim->Channels[i].BoneId;
+			if (boneId != -1 && (!animatedBones || channelMask[i]))
+				p.Transforms[boneId] = channelTransforms[i];
+		}
+	}
+
+	void CompressedAnimationSynthesizer::GetPose(Pose & p, float time)
+	{
+		p.Transforms.SetSize(skeleton->Bones.Count());
+		float animTime = fmod(time * anim->Speed, anim->Duration);
+		for (int i = 0; i < skeleton->Bones.Count(); i++)
+			p.Transforms[i] = skeleton->Bones[i].BindPose;
+		for (auto & track : anim->Tracks)
+			if (track.BoneId == -1)
+				skeleton->BoneMapping.TryGetValue(track.BoneName, track.BoneId);
+		if (animatedBones)
+		{
+			trackMask.SetSize(anim->Tracks.Count());
+			for (int i = 0; i < anim->Tracks.Count(); i++)
 			{
-				p.Transforms[anim->Channels[i].BoneId] = anim->Channels[i].Sample(animTime);
+				int boneId = anim->Tracks[i].BoneId;
+				trackMask[i] = boneId != -1 && (boneId >= animatedBones->Count() || (*animatedBones)[boneId]);
 			}
 		}
+		trackTransforms.SetSize(anim->Tracks.Count());
+		anim->Sample(animTime, trackTransforms.Buffer(), animatedBones ? trackMask.Buffer() : nullptr);
+		for (int i = 0; i < anim->Tracks.Count(); i++)
+		{
+			int boneId = anim->Tracks[i].BoneId;
+			if (boneId != -1 && (!animatedBones || trackMask[i]))
+				p.Transforms[boneId] = trackTransforms[i];
+		}
 	}
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define ANIMATION_SYNTHESIZER_H
 
 #include "Skeleton.h"
+#include "CompressedAnimation.h"
 #include "MotionGraph.h"
 #include "CoreLib/LibMath.h"
 #include "CatmullSpline.h"
@@ -13,8 +14,16 @@ namespace GameEngine
 {
 	class AnimationSynthesizer : public CoreLib::RefObject
 	{	
+	protected:
+		const CoreLib::List<bool> * animatedBones = nullptr;
     public:
 		virtual void GetPose(Pose & p, float time) = 0;
+		// restricts the following GetPose calls to the bones marked in the list (indexed by skeleton bone),
+		// the other bones keep their bind pose; null animates all bones. Synthesizers may ignore it.
+		void SetAnimatedBones(const CoreLib::List<bool> * bones)
+		{
+			animatedBones = bones;
+		}
 	};
 
 	class SimpleAnimationSynthesizer : public AnimationSynthesizer
@@ -22,12 +31,36 @@ namespace GameEngine
 	private:
 		Skeleton * skeleton = nullptr;
 		SkeletalAnimation * anim = nullptr;
+		AnimationSamplingContext samplingContext;
+		CoreLib::List<BoneTransformation> channelTransforms;
+		CoreLib::List<bool> channelMask;
 	public:
 		SimpleAnimationSynthesizer() = default;
 		SimpleAnimationSynthesizer(Skeleton * pSkeleton, SkeletalAnimation * pAnim)
 			: skeleton(pSkeleton), anim(pAnim)
 		{}
 		void SetSource(Skeleton * pSkeleton, SkeletalAnimation * pAnim)
+		{
+			this->skeleton = pSkeleton;
+			this->anim = pAnim;
+			samplingContext.Reset();
+		}
+		virtual void GetPose(Pose & p, float time) override;
+	};
+
+	class CompressedAnimationSynthesizer : public AnimationSynthesizer
+	{
+	private:
+		Skeleton * skeleton = nullptr;
+		CompressedSkeletalAnimation * anim = nullptr;
+		CoreLib::List<BoneTransformation> trackTransforms;
+		CoreLib::List<bool> trackMask;
+	public:
+		CompressedAnimationSynthesizer() = default;
+		CompressedAnimationSynthesizer(Skeleton * pSkeleton, CompressedSkeletalAnimation * pAnim)
+			: skeleton(pSkeleton), anim(pAnim)
+		{}
+		void SetSource(Skeleton * pSkeleton, CompressedSkeletalAnimation * pAnim)
 		{
 			this->skeleton = pSkeleton;
 			this->anim = pAnim;
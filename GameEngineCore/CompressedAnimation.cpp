@@ -0,0 +1,316 @@
+#include "CompressedAnimation.h"
+#include "CoreLib/LibMath.h"
+
+namespace GameEngine
+{
+	using namespace CoreLib;
+	using namespace CoreLib::IO;
+	using namespace VectorMath;
+
+	// all but the largest component of a unit quaternion lie within [-1/sqrt(2), 1/sqrt(2)]
+	static const float QuaternionComponentRange = 0.70710678f;
+	static const float RotationQuantizationScale = 32767.0f;
+	static const float RangeQuantizationScale = 65535.0f;
+
+	static void EncodeRotation(const Quaternion & rotation, unsigned short * dest)
+	{
+		float components[4] = { rotation.x, rotation.y, rotation.z, rotation.w };
+		float length = rotation.Length();
+		int largest = 0;
+		for (int i = 1; i < 4; i++)
+			if (fabs(components[i]) > fabs(components[largest]))
+				largest = i;
+		// q and -q are the same rotation, so the dropped component is always positive
+		float scale = (components[largest] < 0.0f ? -1.0f : 1.0f) / length;
+		int j = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			if (i == largest)
+				continue;
+			float v = Math::Clamp(components[i] * scale * (0.5f / QuaternionComponentRange) + 0.5f, 0.0f, 1.0f);
+			dest[j++] = (unsigned short)(v * RotationQuantizationScale + 0.5f);
+		}
+		// the index of the dropped component goes into the top bits of the first two values
+		dest[0] |= (unsigned short)((largest & 2) << 14);
+		dest[1] |= (unsigned short)((largest & 1) << 15);
+	}
+
+	static inline Quaternion DecodeRotation(const unsigned short * src)
+	{
+		const float decodeScale = 2.0f * QuaternionComponentRange / RotationQuantizationScale;
+		int largest = ((src[0] >> 14) & 2) | (src[1] >> 15);
+		float a = (src[0] & 0x7FFF) * decodeScale - QuaternionComponentRange;
+		float b = (src[1] & 0x7FFF) * decodeScale - QuaternionComponentRange;
+		float c = (src[2] & 0x7FFF) * decodeScale - QuaternionComponentRange;
+		float d = sqrt(Math::Max(0.0f, 1.0f - a * a - b * b - c * c));
+		switch (largest)
+		{
+		case 0:
+			return Quaternion(d, a, b, c);
+		case 1:
+			return Quaternion(a, d, b, c);
+		case 2:
+			return Quaternion(a, b, d, c);
+		default:
+			return Quaternion(a, b, c, d);
+		}
+	}
+
+	static void EncodeRange(const Vec3 & value, const Vec3 & min, const Vec3 & extent, unsigned short * dest)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			float v = extent[i] > 0.0f ? Math::Clamp((value[i] - min[i]) / extent[i], 0.0f, 1.0f) : 0.0f;
+			dest[i] = (unsigned short)(v * RangeQuantizationScale + 0.5f);
+		}
+	}
+
+	// interpolates the quantized values before decoding, which is the same as lerping the decoded values
+	static inline Vec3 DecodeRange(const unsigned short * src0, const unsigned short * src1, float t, const Vec3 & min, const Vec3 & extent)
+	{
+		Vec3 rs;
+		for (int i = 0; i < 3; i++)
+		{
+			float q = (float)src0[i] + ((float)src1[i] - (float)src0[i]) * t;
+			rs[i] = min[i] + q * (extent[i] * (1.0f / RangeQuantizationScale));
+		}
+		return rs;
+	}
+
+	static bool FindRange(const List<Vec3> & values, float tolerance, Vec3 & min, Vec3 & extent)
+	{
+		Vec3 max = values[0];
+		min = values[0];
+		for (auto & v : values)
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				min[i] = Math::Min(min[i], v[i]);
+				max[i] = Math::Max(max[i], v[i]);
+			}
+		}
+		extent = max - min;
+		return extent.x > tolerance || extent.y > tolerance || extent.z > tolerance;
+	}
+
+	static float EstimateSampleRate(const SkeletalAnimation & anim)
+	{
+		float rate = 0.0f;
+		for (auto & channel : anim.Channels)
+		{
+			int count = channel.KeyFrames.Count();
+			if (count < 2)
+				continue;
+			float span = channel.KeyFrames[count - 1].Time - channel.KeyFrames[0].Time;
+			if (span > 0.0f)
+				rate = Math::Max(rate, (count - 1) / span);
+		}
+		if (rate == 0.0f)
+			return 30.0f;
+		// key times are usually whole frames, so snap off the rounding error of their sum
+		float roundedRate = floor(rate + 0.5f);
+		if (fabs(rate - roundedRate) < 1e-3f * roundedRate)
+			rate = roundedRate;
+		return rate;
+	}
+
+	void CompressedSkeletalAnimation::Compress(const SkeletalAnimation & anim, const AnimationCompressionSettings & settings)
+	{
+		Name = anim.Name;
+		Speed = anim.Speed;
+		Duration = anim.Duration;
+		SampleRate = settings.SampleRate > 0.0f ? settings.SampleRate : EstimateSampleRate(anim);
+		KeyCount = Math::Max(1, (int)ceil(Duration * SampleRate - 1e-3f) + 1);
+		FrameStride = 0;
+		Tracks.Clear();
+		KeyData.Clear();
+
+		// resample all channels at uniformly spaced key times
+		List<List<BoneTransformation>> samples;
+		List<Vec3> translations, scales;
+		for (auto & channel : anim.Channels)
+		{
+			if (channel.KeyFrames.Count() == 0)
+				continue;
+			samples.Add(List<BoneTransformation>());
+			auto & trackSamples = samples.Last();
+			trackSamples.SetSize(KeyCount);
+			translations.SetSize(KeyCount);
+			scales.SetSize(KeyCount);
+			for (int k = 0; k < KeyCount; k++)
+			{
+				trackSamples[k] = channel.Sample(k / SampleRate);
+				translations[k] = trackSamples[k].Translation;
+				scales[k] = trackSamples[k].Scale;
+			}
+
+			CompressedAnimationTrack track;
+			track.BoneName = channel.BoneName;
+			track.BoneId = channel.BoneId;
+			auto rotation0 = trackSamples[0].Rotation;
+			track.ConstantRotation = rotation0 * (1.0f / rotation0.Length());
+			for (int k = 1; k < KeyCount; k++)
+			{
+				auto rotation = trackSamples[k].Rotation * (1.0f / trackSamples[k].Rotation.Length());
+				if (Quaternion::Dot(rotation, track.ConstantRotation) < 0.0f)
+					rotation = -rotation;
+				auto diff = rotation - track.ConstantRotation;
+				if (Math::Max(Math::Max(fabs(diff.x), fabs(diff.y)), Math::Max(fabs(diff.z), fabs(diff.w))) > settings.RotationTolerance)
+				{
+					track.RotationOffset = FrameStride;
+					FrameStride += 3;
+					break;
+				}
+			}
+			if (FindRange(translations, settings.TranslationTolerance, track.TranslationMin, track.TranslationExtent))
+			{
+				track.TranslationOffset = FrameStride;
+				FrameStride += 3;
+			}
+			else
+				track.TranslationExtent.SetZero();
+			if (FindRange(scales, settings.ScaleTolerance, track.ScaleMin, track.ScaleExtent))
+			{
+				track.ScaleOffset = FrameStride;
+				FrameStride += 3;
+			}
+			else
+				track.ScaleExtent.SetZero();
+			Tracks.Add(track);
+		}
+
+		KeyData.SetSize(KeyCount * FrameStride);
+		for (int i = 0; i < Tracks.Count(); i++)
+		{
+			auto & track = Tracks[i];
+			for (int k = 0; k < KeyCount; k++)
+			{
+				auto frame = KeyData.Buffer() + k * FrameStride;
+				auto & transform = samples[i][k];
+				if (track.RotationOffset != -1)
+					EncodeRotation(transform.Rotation, frame + track.RotationOffset);
+				if (track.TranslationOffset != -1)
+					EncodeRange(transform.Translation, track.TranslationMin, track.TranslationExtent, frame + track.TranslationOffset);
+				if (track.ScaleOffset != -1)
+					EncodeRange(transform.Scale, track.ScaleMin, track.ScaleExtent, frame + track.ScaleOffset);
+			}
+		}
+	}
+
+	static inline void DecodeTrack(const CompressedAnimationTrack & track, const unsigned short * frame0, const unsigned short * frame1, float t,
+		BoneTransformation & result)
+	{
+		if (track.RotationOffset != -1)
+		{
+			auto q0 = DecodeRotation(frame0 + track.RotationOffset);
+			auto q1 = DecodeRotation(frame1 + track.RotationOffset);
+			if (Quaternion::Dot(q0, q1) < 0.0f)
+				q1 = -q1;
+			auto q = Quaternion::Lerp(q0, q1, t);
+			result.Rotation = q * (1.0f / q.Length());
+		}
+		else
+			result.Rotation = track.ConstantRotation;
+		if (track.TranslationOffset != -1)
+			result.Translation = DecodeRange(frame0 + track.TranslationOffset, frame1 + track.TranslationOffset, t, track.TranslationMin, track.TranslationExtent);
+		else
+			result.Translation = track.TranslationMin;
+		if (track.ScaleOffset != -1)
+			result.Scale = DecodeRange(frame0 + track.ScaleOffset, frame1 + track.ScaleOffset, t, track.ScaleMin, track.ScaleExtent);
+		else
+			result.Scale = track.ScaleMin;
+	}
+
+	void CompressedSkeletalAnimation::SampleTrack(int trackId, float animTime, BoneTransformation & result) const
+	{
+		float keyPos = Math::Clamp(animTime * SampleRate, 0.0f, (float)(KeyCount - 1));
+		int key0 = (int)keyPos;
+		int key1 = Math::Min(key0 + 1, KeyCount - 1);
+		DecodeTrack(Tracks[trackId], KeyData.Buffer() + key0 * FrameStride, KeyData.Buffer() + key1 * FrameStride, keyPos - key0, result);
+	}
+
+	void CompressedSkeletalAnimation::Sample(float animTime, BoneTransformation * result, const bool * trackMask) const
+	{
+		float keyPos = Math::Clamp(animTime * SampleRate, 0.0f, (float)(KeyCount - 1));
+		int key0 = (int)keyPos;
+		int key1 = Math::Min(key0 + 1, KeyCount - 1);
+		float t = keyPos - key0;
+		auto frame0 = KeyData.Buffer() + key0 * FrameStride;
+		auto frame1 = KeyData.Buffer() + key1 * FrameStride;
+		for (int i = 0; i < Tracks.Count(); i++)
+			if (!trackMask || trackMask[i])
+				DecodeTrack(Tracks[i], frame0, frame1, t, result[i]);
+	}
+
+	int CompressedSkeletalAnimation::GetDataSize() const
+	{
+		return KeyData.Count() * (int)sizeof(unsigned short) + Tracks.Count() * (int)sizeof(CompressedAnimationTrack);
+	}
+
+	void CompressedSkeletalAnimation::SaveToStream(CoreLib::IO::Stream * stream)
+	{
+		BinaryWriter writer(stream);
+		writer.Write(Name);
+		writer.Write(Speed);
+		writer.Write(Duration);
+		writer.Write(SampleRate);
+		writer.Write(KeyCount);
+		writer.Write(FrameStride);
+		writer.Write(Tracks.Count());
+		for (auto & track : Tracks)
+		{
+			writer.Write(track.BoneName);
+			writer.Write(track.RotationOffset);
+			writer.Write(track.TranslationOffset);
+			writer.Write(track.ScaleOffset);
+			writer.Write(track.ConstantRotation);
+			writer.Write(track.TranslationMin);
+			writer.Write(track.TranslationExtent);
+			writer.Write(track.ScaleMin);
+			writer.Write(track.ScaleExtent);
+		}
+		writer.Write(KeyData);
+		writer.ReleaseStream();
+	}
+
+	void CompressedSkeletalAnimation::LoadFromStream(CoreLib::IO::Stream * stream)
+	{
+		BinaryReader reader(stream);
+		reader.Read(Name);
+		reader.Read(Speed);
+		reader.Read(Duration);
+		reader.Read(SampleRate);
+		reader.Read(KeyCount);
+		reader.Read(FrameStride);
+		Tracks.SetSize(reader.ReadInt32());
+		for (auto & track : Tracks)
+		{
+			reader.Read(track.BoneName);
+			track.BoneId = -1;
+			reader.Read(track.RotationOffset);
+			reader.Read(track.TranslationOffset);
+			reader.Read(track.ScaleOffset);
+			reader.Read(track.ConstantRotation);
+			reader.Read(track.TranslationMin);
+			reader.Read(track.TranslationExtent);
+			reader.Read(track.ScaleMin);
+			reader.Read(track.ScaleExtent);
+		}
+		reader.Read(KeyData);
+		reader.ReleaseStream();
+	}
+
+	void CompressedSkeletalAnimation::SaveToFile(const CoreLib::String & filename)
+	{
+		RefPtr<FileStream> stream = new FileStream(filename, FileMode::Create);
+		SaveToStream(stream.Ptr());
+		stream->Close();
+	}
+
+	void CompressedSkeletalAnimation::LoadFromFile(const CoreLib::String & filename)
+	{
+		RefPtr<FileStream> stream = new FileStream(filename, FileMode::Open);
+		LoadFromStream(stream.Ptr());
+		stream->Close();
+	}
+}
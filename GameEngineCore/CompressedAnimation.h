@@ -0,0 +1,60 @@
+#ifndef GAME_ENGINE_COMPRESSED_ANIMATION_H
+#define GAME_ENGINE_COMPRESSED_ANIMATION_H
+
+#include "Skeleton.h"
+
+namespace GameEngine
+{
+	class AnimationCompressionSettings
+	{
+	public:
+		// keys per second of the compressed clip, 0 to use the key density of the source channels
+		float SampleRate = 0.0f;
+		// a component whose resampled values stay within these tolerances is stored once for the whole clip
+		float RotationTolerance = 1e-5f;
+		float TranslationTolerance = 1e-5f;
+		float ScaleTolerance = 1e-5f;
+	};
+
+	class CompressedAnimationTrack
+	{
+	public:
+		CoreLib::String BoneName;
+		int BoneId = -1;
+		// offsets of the quantized components within a key frame, -1 if the component is constant
+		int RotationOffset = -1, TranslationOffset = -1, ScaleOffset = -1;
+		VectorMath::Quaternion ConstantRotation = VectorMath::Quaternion(0.0f, 0.0f, 0.0f, 1.0f);
+		// a quantized value q decodes to Min + q * Extent / 65535, a constant component is Min
+		VectorMath::Vec3 TranslationMin, TranslationExtent;
+		VectorMath::Vec3 ScaleMin, ScaleExtent;
+	};
+
+	// Skeletal animation resampled to uniformly spaced keys, so the keys around a time are found without a search.
+	// Rotations are stored as the three smallest quaternion components in 15 bits each, translations and
+	// scales as 16 bit values within the range of their track, and components that do not change are not
+	// stored per key at all. The keys of all tracks are interleaved frame by frame.
+	class CompressedSkeletalAnimation
+	{
+	public:
+		CoreLib::String Name;
+		float Speed = 1.0f;
+		float Duration = 0.0f;
+		float SampleRate = 30.0f;
+		int KeyCount = 0;
+		int FrameStride = 0; // in unsigned shorts
+		CoreLib::List<CompressedAnimationTrack> Tracks;
+		CoreLib::List<unsigned short> KeyData;
+		void Compress(const SkeletalAnimation & anim, const AnimationCompressionSettings & settings = AnimationCompressionSettings());
+		void SampleTrack(int trackId, float animTime, BoneTransformation & result) const;
+		// samples all tracks at animTime, result must hold Tracks.Count() transforms;
+		// tracks whose trackMask entry is false are skipped and their result is left unchanged
+		void Sample(float animTime, BoneTransformation * result, const bool * trackMask = nullptr) const;
+		int GetDataSize() const;
+		void SaveToStream(CoreLib::IO::Stream * stream);
+		void LoadFromStream(CoreLib::IO::Stream * stream);
+		void SaveToFile(const CoreLib::String & filename);
+		void LoadFromFile(const CoreLib::String & filename);
+	};
+}
+
+#endif
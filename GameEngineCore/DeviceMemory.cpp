@@ -50,5 +50,36 @@ namespace GameEngine
 			buffer->SetDataAsync(offset, bufferPtr + offset, length);
 	}
 
+	void DeviceHeap::Init(HardwareRenderer * hwRenderer, BufferUsage usage, int log2BufferSize, int alignment)
+	{
+		buffer = hwRenderer->CreateBuffer(usage, 1 << log2BufferSize);
+		allocator.Init(1ll << log2BufferSize, alignment);
+	}
+
+	void TransientDeviceMemory::Init(HardwareRenderer * hwRenderer, BufferUsage usage, int log2RegionSize, int regionCount, int pAlignment)
+	{
+		regionSize = 1 << log2RegionSize;
+		alignment = pAlignment;
+		buffer = hwRenderer->CreateMappedBuffer(usage, regionSize * regionCount);
+		bufferPtr = (unsigned char*)buffer->Map(0, regionSize * regionCount);
+		regionOffset = 0;
+		allocPtr = 0;
+	}
+
+	void TransientDeviceMemory::Reset(int frameVersion)
+	{
+		regionOffset = frameVersion * regionSize;
+		allocPtr.store(0, std::memory_order_relaxed);
+	}
+
+	int TransientDeviceMemory::Alloc(int size)
+	{
+		int alignedSize = (size + alignment - 1) / alignment * alignment;
+		int offset = allocPtr.fetch_add(alignedSize, std::memory_order_relaxed);
+		if (offset + alignedSize > regionSize)
+			return -1;
+		return regionOffset + offset;
+	}
+
 }
 
@@ -1,7 +1,9 @@
 #ifndef GAME_ENGINE_DEVICE_MEMORY_H
 #define GAME_ENGINE_DEVICE_MEMORY_H
 
+#include <atomic>
 #include "CoreLib/MemoryPool.h"
+#include "CoreLib/TlsfAllocator.h"
 #include "HardwareRenderer.h"
 
 namespace GameEngine
@@ -30,6 +32,78 @@ namespace GameEngine
 		}
 		void SetDataAsync(int offset, void * data, int length);
 	};
+
+	// Device buffer suballocated by a TLSF allocator, for long-lived ranges of arbitrary size such as mesh
+	// vertices and indices. Sizes are only rounded to the alignment, and unlike DeviceMemory no host copy
+	// of the buffer is kept.
+	class DeviceHeap
+	{
+	private:
+		CoreLib::TlsfAllocator allocator;
+		CoreLib::RefPtr<Buffer> buffer;
+	public:
+		static const long long InvalidOffset = CoreLib::TlsfAllocator::InvalidOffset;
+		void Init(HardwareRenderer * hwRenderer, BufferUsage usage, int log2BufferSize, int alignment);
+		// returns the offset of the range in the buffer, or InvalidOffset if the heap is exhausted
+		long long Alloc(long long size)
+		{
+			return allocator.Alloc(size);
+		}
+		void Free(long long offset)
+		{
+			allocator.Free(offset);
+		}
+		void SetDataAsync(long long offset, void * data, int length)
+		{
+			buffer->SetDataAsync((int)offset, data, length);
+		}
+		Buffer * GetBuffer()
+		{
+			return buffer.Ptr();
+		}
+		CoreLib::TlsfAllocatorStats GetStats()
+		{
+			return allocator.GetStats();
+		}
+	};
+
+	// Linear allocator for data that is rewritten every frame it is used, such as skeletal poses and
+	// shadow view uniforms. The mapped buffer holds one region per in-flight frame; allocations bump
+	// an atomic offset within the current region, so any thread can allocate without a lock, and the
+	// whole region is released at once by Reset when the GPU has finished the frame that used it.
+	class TransientDeviceMemory
+	{
+	private:
+		CoreLib::RefPtr<Buffer> buffer;
+		unsigned char * bufferPtr = nullptr;
+		int regionSize = 0;
+		int alignment = 1;
+		int regionOffset = 0;
+		std::atomic<int> allocPtr;
+	public:
+		TransientDeviceMemory()
+		{
+			allocPtr = 0;
+		}
+		void Init(HardwareRenderer * hwRenderer, BufferUsage usage, int log2RegionSize, int regionCount, int alignment);
+		// starts allocating from region frameVersion, all previous allocations in that region become invalid
+		void Reset(int frameVersion);
+		// returns the offset of the allocation in the buffer, or -1 if the current region is exhausted
+		int Alloc(int size);
+		void * GetPtr(int offset)
+		{
+			return bufferPtr + offset;
+		}
+		Buffer * GetBuffer()
+		{
+			return buffer.Ptr();
+		}
+		int GetAllocatedSize()
+		{
+			int allocated = allocPtr.load(std::memory_order_relaxed);
+			return allocated < regionSize ? allocated : regionSize;
+		}
+	};
 }
 
 #endif
\ No newline at end of file
@@ -15,6 +15,9 @@ namespace GameEngine
 		lblNumMaterials = new Label(this);
 		lblCpuTime = new Label(this);
 		lblPipelineLookupTime = new Label(this);
+		lblVertexMemory = new Label(this);
+		lblIndexMemory = new Label(this);
+		lblAnimationLod = new Label(this);
 
 		lblFps->Posit(emToPixel(0.5f), emToPixel(0.5f), emToPixel(20.0f), emToPixel(1.5f));
 		lblNumWorldPasses->Posit(emToPixel(0.5f), emToPixel(1.5f), emToPixel(20.0f), emToPixel(1.5f));
@@ -23,8 +26,11 @@ namespace GameEngine
 		lblPipelineLookupTime->Posit(emToPixel(0.5f), emToPixel(4.5f), emToPixel(20.0f), emToPixel(1.5f));
 		lblNumShaders->Posit(emToPixel(0.5f), emToPixel(5.5f), emToPixel(20.0f), emToPixel(1.5f));
 		lblNumMaterials->Posit(emToPixel(0.5f), emToPixel(6.5f), emToPixel(20.0f), emToPixel(1.5f));
+		lblVertexMemory->Posit(emToPixel(0.5f), emToPixel(7.5f), emToPixel(20.0f), emToPixel(1.5f));
+		lblIndexMemory->Posit(emToPixel(0.5f), emToPixel(8.5f), emToPixel(20.0f), emToPixel(1.5f));
+		lblAnimationLod->Posit(emToPixel(0.5f), emToPixel(9.5f), emToPixel(20.0f), emToPixel(1.5f));
 		SetWidth(emToPixel(14.0f));
-		SetHeight(emToPixel(10.2f));
+		SetHeight(emToPixel(13.2f));
 	}
 
 	void DrawCallStatForm::SetNumDrawCalls(int val)
@@ -57,6 +63,35 @@ namespace GameEngine
 		lblPipelineLookupTime->SetText(sb.ToString());
 	}
 
+	static CoreLib::String FormatMemoryStats(const char * name, const CoreLib::TlsfAllocatorStats & stats)
+	{
+		CoreLib::StringBuilder sb(256);
+		sb << name << ": " << CoreLib::String(stats.BytesAllocated / (1024.0f * 1024.0f), "%.1f") << "/"
+			<< CoreLib::String(stats.TotalSize / (1024.0f * 1024.0f), "%.0f") << "MB, frag "
+			<< CoreLib::String(stats.GetFragmentation() * 100.0f, "%.0f") << "%";
+		return sb.ProduceString();
+	}
+
+	void DrawCallStatForm::SetGeometryMemoryStats(const CoreLib::TlsfAllocatorStats & vertexStats, const CoreLib::TlsfAllocatorStats & indexStats)
+	{
+		lblVertexMemory->SetText(FormatMemoryStats("Vertex Mem", vertexStats));
+		lblIndexMemory->SetText(FormatMemoryStats("Index Mem", indexStats));
+	}
+
+	void DrawCallStatForm::SetAnimationLodStats(const int (&numAnimatedMeshes)[AnimationLodCount], int numPoseUpdates)
+	{
+		CoreLib::StringBuilder sb(256);
+		sb << "Anim LOD: ";
+		for (int i = 0; i < AnimationLodCount; i++)
+		{
+			if (i > 0)
+				sb << "/";
+			sb << numAnimatedMeshes[i];
+		}
+		sb << ", " << numPoseUpdates << " poses";
+		lblAnimationLod->SetText(sb.ProduceString());
+	}
+
 	void DrawCallStatForm::SetFrameRenderTime(float val)
 	{
 		static int i = 0;
@@ -2,6 +2,8 @@
 #define GAME_ENGINE_DRAW_CALL_STAT_FORM_H
 
 #include "CoreLib/LibUI/LibUI.h"
+#include "CoreLib/TlsfAllocator.h"
+#include "EngineLimits.h"
 
 namespace GameEngine
 {
@@ -17,6 +19,9 @@ namespace GameEngine
 		GraphicsUI::Label * lblFps;
 		GraphicsUI::Label * lblCpuTime;
 		GraphicsUI::Label * lblPipelineLookupTime;
+		GraphicsUI::Label * lblVertexMemory;
+		GraphicsUI::Label * lblIndexMemory;
+		GraphicsUI::Label * lblAnimationLod;
 
 	public:
 		DrawCallStatForm(GraphicsUI::UIEntry * parent);
@@ -26,6 +31,8 @@ namespace GameEngine
 		void SetNumWorldPasses(int val);
 		void SetCpuTime(float time, float pipelineLookupTime);
 		void SetFrameRenderTime(float val);
+		void SetGeometryMemoryStats(const CoreLib::TlsfAllocatorStats & vertexStats, const CoreLib::TlsfAllocatorStats & indexStats);
+		void SetAnimationLodStats(const int (&numAnimatedMeshes)[AnimationLodCount], int numPoseUpdates);
 
 	};
 }
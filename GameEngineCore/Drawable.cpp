@@ -12,6 +12,7 @@ namespace GameEngine
 		for (auto & p : pipelineCache)
 			p = nullptr;
 		transformModule = new ModuleInstance();
+		VectorMath::Matrix4::CreateIdentityMatrix(transform);
 	}
 	Drawable::~Drawable()
 	{
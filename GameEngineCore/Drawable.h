@@ -27,12 +27,10 @@ namespace GameEngine
 		int indexBufferOffset;
 		int vertexCount = 0;
 		int indexCount = 0;
+		int Id = 0;
 		Buffer * GetVertexBuffer();
 		Buffer * GetIndexBuffer();
-		DrawableMesh(RendererSharedResource * pRenderRes)
-		{
-			renderRes = pRenderRes;
-		}
+		DrawableMesh(RendererSharedResource * pRenderRes);
 		~DrawableMesh();
 	};
 
@@ -41,7 +39,7 @@ namespace GameEngine
 		Static, Skeletal
 	};
 
-	class Drawable : public CoreLib::RefObject
+	class Drawable : public CoreLib::ThreadSafeRefObject
 	{
 		friend class RendererImpl;
 		friend class SceneResource;
@@ -56,11 +54,15 @@ namespace GameEngine
 		Skeleton * skeleton = nullptr;
 		CoreLib::Array<PipelineClass*, MaxWorldRenderPasses> pipelineCache;
 		SceneResource * scene = nullptr;
+		VectorMath::Matrix4 transform; // last static transform, read when drawing instanced
+		int transformChangeFrame = 0; // frame in which the static transform last changed
+		// skinning matrices of the last pose update that kept a copy, and the local transform they include
+		CoreLib::List<VectorMath::Matrix4> poseCopy;
+		VectorMath::Matrix4 poseCopyTransform;
 	public:
 		CoreLib::Graphics::BBox Bounds;
 		bool CastShadow = true;
         bool RenderCustomDepth = false;
-		unsigned int ReorderKey = 0;
 		Drawable(SceneResource * sceneRes);
 		~Drawable();
 		PipelineClass * GetPipeline(int passId, PipelineContext & pipelineManager);
@@ -69,6 +71,18 @@ namespace GameEngine
 			return transformModule;
 		}
 		bool IsTransparent();
+		inline DrawableType GetType()
+		{
+			return type;
+		}
+		inline const VectorMath::Matrix4 & GetTransform()
+		{
+			return transform;
+		}
+		inline int GetTransformChangeFrame()
+		{
+			return transformChangeFrame;
+		}
 		inline DrawableMesh * GetMesh()
 		{
 			return mesh.Ptr();
@@ -87,7 +101,16 @@ namespace GameEngine
 		}
 		void UpdateMaterialUniform();
 		void UpdateTransformUniform(const VectorMath::Matrix4 & localTransform);
-		void UpdateTransformUniform(const VectorMath::Matrix4 & localTransform, const Pose & pose, RetargetFile * retarget = nullptr);
+		void UpdateTransformUniform(const VectorMath::Matrix4 & localTransform, const Pose & pose, RetargetFile * retarget = nullptr,
+			bool keepCopy = false);
+		// uploads the skinning matrices kept by the last pose update again, moved to localTransform;
+		// returns false if that update did not keep a copy
+		bool ReuseTransformUniform(const VectorMath::Matrix4 & localTransform);
+		// whether the last pose update kept a copy for ReuseTransformUniform
+		inline bool CanReuseTransformUniform()
+		{
+			return poseCopy.Count() != 0;
+		}
 	};
 
 	class DrawableSink
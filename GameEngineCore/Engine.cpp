@@ -4,6 +4,7 @@
 #include "FreeRoamCameraController.h"
 #include "CoreLib/LibIO.h"
 #include "CoreLib/Tokenizer.h"
+#include "CoreLib/Profiler.h"
 #include "EngineLimits.h"
 #include "CoreLib/WinForm/WinApp.h"
 
@@ -71,9 +72,16 @@ namespace GameEngine
                         if (rs.Divisor != 0)
                         {
                             sb << String(rs.CpuTime * 1000.0f / rs.Divisor, "%.1f") << "\t" << String(rs.TotalTime * 1000.0f / rs.Divisor, "%.1f")
-                                << "\t" << rs.NumDrawCalls / rs.Divisor << "\n";
+                                << "\t" << rs.NumDrawCalls / rs.Divisor << "\t" << rs.NumPoseUpdates / rs.Divisor << "\n";
                         }
                     }
+                    if (auto submitted = GetNullHardwareRendererStats(renderer->GetHardwareRenderer()))
+                    {
+                        sb << "submitted\t" << submitted->RenderPasses << " passes\t" << submitted->CommandBuffers << " command buffers\t"
+                            << submitted->DrawCalls << " draws\t" << submitted->PipelineBinds << " pipelines\t"
+                            << submitted->DescriptorSetBinds << " descriptor sets\t" << submitted->BufferBinds << " buffers\t"
+                            << submitted->Dispatches << " dispatches\n";
+                    }
                     CoreLib::IO::File::WriteAllText(params.RenderStatsDumpFileName, sb.ProduceString());
                 }
                 mainWindow->Close();
@@ -134,7 +142,13 @@ namespace GameEngine
 			
 			GpuId = args.GpuId;
 			RecompileShaders = args.RecompileShaders;
+			ParallelActorTick = args.ParallelActorTick;
             params = args.LaunchParams;
+			if (params.ProfileFileName.Length())
+			{
+				profileFileName = params.ProfileFileName;
+				Diagnostics::Profiler::BeginCapture();
+			}
 
 			gameDir = Path::Normalize(args.GameDirectory);
 			engineDir = Path::Normalize(args.EngineDirectory);
@@ -199,6 +213,9 @@ namespace GameEngine
 			case RenderAPI::OpenGL:
 				Print("OpenGL: %s\n", renderer->GetHardwareRenderer()->GetRendererName().Buffer());
 				break;
+			case RenderAPI::Null:
+				Print("%s\n", renderer->GetHardwareRenderer()->GetRendererName().Buffer());
+				break;
 			}
 
 			auto configFile = Path::Combine(gameDir, "game.config");
@@ -236,6 +253,8 @@ namespace GameEngine
 
 	Engine::~Engine()
 	{
+		if (Diagnostics::Profiler::IsCapturing())
+			EndProfileCapture();
 		renderer->Wait();
         if (videoEncoder)
             videoEncoder->Close();
@@ -271,8 +290,24 @@ namespace GameEngine
 
 	static float aggregateTime = 0.0f;
 
+	void Engine::EndProfileCapture()
+	{
+		Diagnostics::Profiler::EndCapture();
+		profileFramesRemaining = 0;
+		try
+		{
+			Diagnostics::Profiler::SaveChromeTrace(profileFileName);
+			Print("profile saved to %S\n", profileFileName.ToWString());
+		}
+		catch (const IOException &)
+		{
+			Print("failed to save profile to %S\n", profileFileName.ToWString());
+		}
+	}
+
 	void Engine::Tick()
 	{
+		PROFILE_ZONE("Engine::Tick");
 		auto thisGameLogicTime = PerformanceCounter::Start();
 		gameLogicTimeDelta = PerformanceCounter::EndSeconds(lastGameLogicTime);
 
@@ -292,9 +327,34 @@ namespace GameEngine
 				levelToLoad = "";
 			}
 		}
-		level->GetPhysicsScene().Tick();
-		for (auto & actor : level->Actors)
-			actor.Value->Tick();
+		{
+			PROFILE_ZONE("UpdateStreaming");
+			level->UpdateStreaming(StreamingTimeBudget);
+			if (updateLightProbesAfterStreaming && !level->IsStreaming())
+			{
+				updateLightProbesAfterStreaming = false;
+				renderer->UpdateLightProbes();
+			}
+		}
+		{
+			PROFILE_ZONE("PhysicsTick");
+			level->GetPhysicsScene().Tick();
+		}
+		{
+			PROFILE_ZONE("ActorTick");
+			if (ParallelActorTick)
+			{
+				// actors ticked on worker threads may trace rays concurrently, which must not modify the scene
+				level->GetPhysicsScene().BeginParallelQueries();
+				actorTickScheduler.Tick(level->Actors);
+				level->GetPhysicsScene().EndParallelQueries();
+			}
+			else
+			{
+				for (auto & actor : level->Actors)
+					actor.Value->Tick();
+			}
+		}
 		if (levelEditor)
 		{
 			levelEditor->Tick();
@@ -308,18 +368,26 @@ namespace GameEngine
 		if (stats.Divisor == 0)
 			stats.StartTime = thisRenderingTime;
 
-		for (auto & f : syncFences[frameCounter % DynamicBufferLengthMultiplier])
 		{
-			f->Wait();
-			f->Reset();
+			PROFILE_ZONE("WaitForFrameFences");
+			for (auto & f : syncFences[frameCounter % DynamicBufferLengthMultiplier])
+			{
+				f->Wait();
+				f->Reset();
+			}
 		}
 		renderer->GetHardwareRenderer()->ResetTempBufferVersion(frameCounter % DynamicBufferLengthMultiplier);
+		renderer->GetSharedResource()->transientUniformMemory.Reset(frameCounter % DynamicBufferLengthMultiplier);
+		renderer->GetSharedResource()->transientStorageMemory.Reset(frameCounter % DynamicBufferLengthMultiplier);
 
 		auto cpuTimePoint = CoreLib::Diagnostics::PerformanceCounter::Start();
 
 		inDataTransfer = true;
 		
-		renderer->TakeSnapshot();
+		{
+			PROFILE_ZONE("TakeSnapshot");
+			renderer->TakeSnapshot();
+		}
 
         for (auto && sysWindow : uiSystemInterface->windowContexts)
         {
@@ -335,7 +403,10 @@ namespace GameEngine
 
         inDataTransfer = false;
 		renderer->GetHardwareRenderer()->TransferBarrier(frameCounter % DynamicBufferLengthMultiplier);
-		renderer->RenderFrame();
+		{
+			PROFILE_ZONE("RenderFrame");
+			renderer->RenderFrame();
+		}
 		
 		stats.CpuTime += CoreLib::Diagnostics::PerformanceCounter::EndSeconds(cpuTimePoint);
 
@@ -361,6 +432,8 @@ namespace GameEngine
 		{
 			drawCallStatForm->SetNumShaders(stats.NumShaders);
 			drawCallStatForm->SetNumMaterials(stats.NumMaterials);
+			auto sharedRes = renderer->GetSharedResource();
+			drawCallStatForm->SetGeometryMemoryStats(sharedRes->vertexBufferMemory.GetStats(), sharedRes->indexBufferMemory.GetStats());
 		}
 
 		if (stats.Divisor >= 500)
@@ -369,6 +442,10 @@ namespace GameEngine
 			drawCallStatForm->SetNumDrawCalls(stats.NumDrawCalls / stats.Divisor);
 			drawCallStatForm->SetNumWorldPasses(stats.NumPasses / stats.Divisor);
 			drawCallStatForm->SetCpuTime(stats.CpuTime / stats.Divisor, stats.PipelineLookupTime / stats.Divisor);
+			int numAnimatedMeshes[AnimationLodCount];
+			for (int i = 0; i < AnimationLodCount; i++)
+				numAnimatedMeshes[i] = stats.NumAnimatedMeshes[i] / stats.Divisor;
+			drawCallStatForm->SetAnimationLodStats(numAnimatedMeshes, stats.NumPoseUpdates / stats.Divisor);
 			static int ptr = 0;
 			stats.TotalTime = CoreLib::Diagnostics::PerformanceCounter::EndSeconds(stats.StartTime);
 			renderStats[ptr%renderStats.Count()] = stats;
@@ -377,6 +454,8 @@ namespace GameEngine
 			aggregateTime = 0.0f;
 		}
 		frameCounter++;
+		if (profileFramesRemaining > 0 && --profileFramesRemaining == 0)
+			EndProfileCapture();
 	}
 
 	void Engine::Resize()
@@ -440,6 +519,24 @@ namespace GameEngine
 				Print("Error: %s\n", e.Message.Buffer());
 			}
 		}
+		else if (parser.LookAhead("profile"))
+		{
+			try
+			{
+				parser.ReadToken();
+				int frames = parser.ReadInt();
+				profileFileName = parser.ReadStringLiteral();
+				if (frames > 0)
+				{
+					profileFramesRemaining = frames;
+					Diagnostics::Profiler::BeginCapture();
+				}
+			}
+			catch (Exception)
+			{
+				Print("usage: profile <frames> \"trace.json\"\n");
+			}
+		}
 		else if (parser.LookAhead("savelevel"))
 		{
 			try
@@ -552,6 +649,7 @@ namespace GameEngine
 			renderer->InitializeLevel(level.Ptr());
             startTime = PerformanceCounter::Start();
 			inDataTransfer = false;
+			updateLightProbesAfterStreaming = level->IsStreaming();
 		}
 		catch (const Exception & e)
 		{
@@ -568,6 +666,7 @@ namespace GameEngine
 		inDataTransfer = true;
 		renderer->InitializeLevel(level.Ptr());
 		inDataTransfer = false;
+		updateLightProbesAfterStreaming = level->IsStreaming();
 	}
 
 	Level * Engine::NewLevel()
@@ -597,6 +696,8 @@ namespace GameEngine
 
 	void Engine::UpdateLightProbes()
 	{
+		if (level)
+			level->FinishStreaming();
 		renderer->UpdateLightProbes();
 	}
 
@@ -15,6 +15,7 @@
 #include "LevelEditor.h"
 #include "OS.h"
 #include "VideoEncoder.h"
+#include "ActorTickScheduler.h"
 
 namespace GameEngine
 {
@@ -27,6 +28,7 @@ namespace GameEngine
         float Length = 10.0f;
         int FramesPerSecond = 30;
         int RunForFrames = 0; // run for this many frames and then terminate
+        String ProfileFileName; // profile the whole run and save it as a Chrome trace when the engine shuts down
     };
 	class EngineInitArguments
 	{
@@ -36,6 +38,7 @@ namespace GameEngine
 		int Width = 400, Height = 400;
 		int GpuId = 0;
 		bool RecompileShaders = false;
+		bool ParallelActorTick = false;
 		CoreLib::String GameDirectory, EngineDirectory, StartupLevelName;
         AppLaunchParameters LaunchParams;
 		CoreLib::RefPtr<LevelEditor> Editor;
@@ -69,6 +72,8 @@ namespace GameEngine
 		WindowBounds currentViewport;
 		GraphicsSettings graphicsSettings;
 		CoreLib::String levelToLoad;
+		// light probes of a new level are rendered again once its streamed resources are loaded
+		bool updateLightProbesAfterStreaming = false;
 		CoreLib::List<CoreLib::List<RefPtr<Fence>>> fencePool;
 		CoreLib::List<CoreLib::List<Fence*>> syncFences;
 	private:
@@ -81,6 +86,7 @@ namespace GameEngine
 		CoreLib::RefPtr<Renderer> renderer;
 		CoreLib::RefPtr<InputDispatcher> inputDispatcher;
 		CoreLib::RefPtr<LevelEditor> levelEditor;
+		ActorTickScheduler actorTickScheduler;
         CoreLib::RefPtr<SystemWindow> mainWindow;
         CoreLib::RefPtr<IVideoEncoder> videoEncoder;
         CoreLib::RefPtr<CoreLib::IO::Stream> videoEncodingStream;
@@ -89,6 +95,9 @@ namespace GameEngine
 		GraphicsUI::CommandForm * uiCommandForm = nullptr;
 		DrawCallStatForm * drawCallStatForm = nullptr;
 		CoreLib::RefPtr<UIWindowsSystemInterface> uiSystemInterface;
+		CoreLib::String profileFileName;
+		int profileFramesRemaining = 0;
+		void EndProfileCapture();
         void MainLoop(CoreLib::Object *, CoreLib::WinForm::EventArgs);
 		bool OnToggleConsoleAction(const CoreLib::String & actionName, ActionInput input);
 		void Resize();
@@ -187,6 +196,10 @@ namespace GameEngine
 	public:
 		int GpuId = 0;
 		bool RecompileShaders = false;
+		// tick thread-safe actors on the JobSystem, see Actor::IsTickThreadSafe
+		bool ParallelActorTick = false;
+		// seconds per frame spent finalizing streamed resources, see Level::UpdateStreaming
+		float StreamingTimeBudget = 0.002f;
 		static Engine * Instance()
 		{
 			if (!instance)
@@ -10,6 +10,11 @@ namespace GameEngine
 	const int EnvMapSize = 64;
 	const int DynamicBufferLengthMultiplier = 2; // double buffering for dynamic uniforms
 	const int MaxModuleInstances = 1<<20;
+	const int AnimationLodCount = 4;
+	const int LightClusterTilesX = 16;
+	const int LightClusterTilesY = 8;
+	const int LightClusterSlices = 24;
+	const int MaxClusterLightIndices = 1<<18;
 }
 
 #endif
\ No newline at end of file
@@ -1,4 +1,7 @@
 #include "FrustumCulling.h"
+#include "Drawable.h"
+#include "CoreLib/JobSystem.h"
+#include <xmmintrin.h>
 
 using namespace VectorMath;
 using namespace CoreLib;
@@ -65,6 +68,26 @@ namespace GameEngine
 		return true;
 	}
 
+	bool CullFrustum::IsBoxInsideFrustum(const CoreLib::Graphics::BBox & box)
+	{
+		for (int i = 0; i < 6; i++)
+		{
+			// test the negative vertex
+			Vec3 p = box.Max;
+			if (Planes[i].x >= 0)
+				p.x = box.Min.x;
+			if (Planes[i].y >= 0)
+				p.y = box.Min.y;
+			if (Planes[i].z >= 0)
+				p.z = box.Min.z;
+
+			float dist = Planes[i].x * p.x + Planes[i].y * p.y + Planes[i].z * p.z + Planes[i].w;
+			if (dist < 0)
+				return false;
+		}
+		return true;
+	}
+
 	CullFrustum::CullFrustum(CoreLib::Graphics::ViewFrustum f)
 	{
 		auto verts = f.GetVertices(f.zMin, f.zMax);
@@ -86,4 +109,72 @@ namespace GameEngine
 		FromVerts(verts.GetArrayView());
 	}
 
+	void MultiFrustumCuller::CullChunk(int chunkId)
+	{
+		int begin = chunkId * ChunkSize;
+		int end = Math::Min(begin + ChunkSize, drawableCount);
+		for (int i = begin; i < end; i++)
+		{
+			auto drawable = i < opaqueDrawables.Count() ? opaqueDrawables[i] : transparentDrawables[i - opaqueDrawables.Count()];
+			auto & bounds = drawable->Bounds;
+			boundsMinX[i] = bounds.Min.x; boundsMinY[i] = bounds.Min.y; boundsMinZ[i] = bounds.Min.z;
+			boundsMaxX[i] = bounds.Max.x; boundsMaxY[i] = bounds.Max.y; boundsMaxZ[i] = bounds.Max.z;
+		}
+		// ChunkSize is a multiple of 4, so only the last chunk has padding lanes
+		for (int i = end; i < boundsMinX.Count() && i < begin + ChunkSize; i++)
+		{
+			boundsMinX[i] = boundsMinY[i] = boundsMinZ[i] = 0.0f;
+			boundsMaxX[i] = boundsMaxY[i] = boundsMaxZ[i] = 0.0f;
+		}
+		memset(visibility.Buffer() + begin * maskStride, 0, (end - begin) * maskStride * sizeof(unsigned int));
+		for (int i = begin; i < end; i += 4)
+		{
+			__m128 minX = _mm_loadu_ps(boundsMinX.Buffer() + i);
+			__m128 minY = _mm_loadu_ps(boundsMinY.Buffer() + i);
+			__m128 minZ = _mm_loadu_ps(boundsMinZ.Buffer() + i);
+			__m128 maxX = _mm_loadu_ps(boundsMaxX.Buffer() + i);
+			__m128 maxY = _mm_loadu_ps(boundsMaxY.Buffer() + i);
+			__m128 maxZ = _mm_loadu_ps(boundsMaxZ.Buffer() + i);
+			int laneCount = Math::Min(4, end - i);
+			for (int f = 0; f < frusta.Count(); f++)
+			{
+				__m128 outside = _mm_setzero_ps();
+				for (int p = 0; p < 6; p++)
+				{
+					// test the positive vertex, same as IsBoxInFrustum
+					auto & plane = frusta[f].Planes[p];
+					__m128 dist = _mm_mul_ps(_mm_set1_ps(plane.x), plane.x >= 0 ? maxX : minX);
+					dist = _mm_add_ps(dist, _mm_mul_ps(_mm_set1_ps(plane.y), plane.y >= 0 ? maxY : minY));
+					dist = _mm_add_ps(dist, _mm_mul_ps(_mm_set1_ps(plane.z), plane.z >= 0 ? maxZ : minZ));
+					dist = _mm_add_ps(dist, _mm_set1_ps(plane.w));
+					outside = _mm_or_ps(outside, _mm_cmplt_ps(dist, _mm_setzero_ps()));
+				}
+				int visibleLanes = ~_mm_movemask_ps(outside) & ((1 << laneCount) - 1);
+				unsigned int bit = 1u << (f & 31);
+				auto mask = visibility.Buffer() + i * maskStride + (f >> 5);
+				for (int j = 0; j < laneCount; j++)
+				{
+					if (visibleLanes & (1 << j))
+						mask[j * maskStride] |= bit;
+				}
+			}
+		}
+	}
+
+	void MultiFrustumCuller::Cull(DrawableSink * drawableSink)
+	{
+		opaqueDrawables = drawableSink->GetDrawables(false);
+		transparentDrawables = drawableSink->GetDrawables(true);
+		drawableCount = opaqueDrawables.Count() + transparentDrawables.Count();
+		int paddedCount = (drawableCount + 3) & ~3;
+		boundsMinX.SetSize(paddedCount); boundsMinY.SetSize(paddedCount); boundsMinZ.SetSize(paddedCount);
+		boundsMaxX.SetSize(paddedCount); boundsMaxY.SetSize(paddedCount); boundsMaxZ.SetSize(paddedCount);
+		maskStride = Math::Max(1, (frusta.Count() + 31) >> 5);
+		visibility.SetSize(drawableCount * maskStride);
+		int chunkCount = (drawableCount + ChunkSize - 1) / ChunkSize;
+		Threading::JobSystem::Instance()->ParallelFor(0, chunkCount, [this](int chunkId)
+		{
+			CullChunk(chunkId);
+		}, 1);
+	}
 }
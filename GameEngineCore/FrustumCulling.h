@@ -6,6 +6,9 @@
 
 namespace GameEngine
 {
+	class Drawable;
+	class DrawableSink;
+
 	struct CullFrustum
 	{
 	private:
@@ -13,11 +16,57 @@ namespace GameEngine
 	public:
 		VectorMath::Vec4 Planes[6];
 		bool IsBoxInFrustum(CoreLib::Graphics::BBox box);
+		// returns true if the box lies entirely inside the frustum
+		bool IsBoxInsideFrustum(const CoreLib::Graphics::BBox & box);
 
 		CullFrustum(CoreLib::Graphics::ViewFrustum f);
 		CullFrustum(CoreLib::Graphics::Matrix4 invViewProj);
 
 		CullFrustum() = default;
 	};
+
+	// Culls the bounds of all drawables in a DrawableSink against a set of frusta (e.g. the camera
+	// and every shadow view) in a single sweep. Bounds are gathered into SoA arrays and tested four
+	// boxes at a time with SSE; the sweep is split into chunks that run on the JobSystem.
+	// The result is a visibility bitmask per drawable, bit i set if the drawable is in frustum i.
+	// A box is culled exactly when CullFrustum::IsBoxInFrustum would reject it.
+	class MultiFrustumCuller
+	{
+	private:
+		CoreLib::List<CullFrustum> frusta;
+		CoreLib::List<float> boundsMinX, boundsMinY, boundsMinZ, boundsMaxX, boundsMaxY, boundsMaxZ;
+		CoreLib::List<unsigned int> visibility;
+		CoreLib::ArrayView<Drawable*> opaqueDrawables, transparentDrawables;
+		int drawableCount = 0;
+		int maskStride = 0;
+		void CullChunk(int chunkId);
+	public:
+		static const int ChunkSize = 256;
+		void ClearFrusta()
+		{
+			frusta.Clear();
+		}
+		// returns the bit index of the frustum in the visibility masks
+		int AddFrustum(const CullFrustum & frustum)
+		{
+			frusta.Add(frustum);
+			return frusta.Count() - 1;
+		}
+		int GetFrustumCount()
+		{
+			return frusta.Count();
+		}
+		CoreLib::ArrayView<CullFrustum> GetFrusta()
+		{
+			return frusta.GetArrayView();
+		}
+		void Cull(DrawableSink * drawableSink);
+		// index refers to DrawableSink::GetDrawables(transparent) of the last culled sink
+		inline bool IsVisible(bool transparent, int index, int frustumId)
+		{
+			int id = transparent ? opaqueDrawables.Count() + index : index;
+			return (visibility[id * maskStride + (frustumId >> 5)] & (1u << (frustumId & 31))) != 0;
+		}
+	};
 }
 #endif
@@ -1922,6 +1922,7 @@ namespace GLL
 		DrawIndexed,
 		DrawIndexedInstanced,
 		Blit,
+		CopyTextureLayer,
 		ClearAttachments,
 		DispatchCompute,
 		MemBarrier
@@ -1947,6 +1948,12 @@ namespace GLL
 		GameEngine::Texture2D* src;
 		VectorMath::Vec2i dstOffset;
 	};
+	struct CopyTextureLayerData
+	{
+		GameEngine::Texture2DArray* dst;
+		GameEngine::Texture2DArray* src;
+		int dstLayer, srcLayer;
+	};
 	struct AttachmentData
 	{
 		int drawBufferMask = 1;
@@ -1982,6 +1989,7 @@ namespace GLL
 			PipelineData pipelineData;
 			DrawData draw;
 			BlitData blit;
+			CopyTextureLayerData copyLayer;
 			AttachmentData clear;
 			BindDescriptorSetData bindDesc;
 			DispatchComputeData compute;
@@ -2144,6 +2152,16 @@ namespace GLL
 			data.blit.dstOffset = destOffset;
 			buffer.Add(data);
 		}
+		virtual void CopyTextureLayer(GameEngine::Texture2DArray* dstImage, int dstLayer, GameEngine::Texture2DArray* srcImage, int srcLayer, TextureLayout /*layout*/) override
+		{
+			CommandData data;
+			data.command = Command::CopyTextureLayer;
+			data.copyLayer.dst = dstImage;
+			data.copyLayer.src = srcImage;
+			data.copyLayer.dstLayer = dstLayer;
+			data.copyLayer.srcLayer = srcLayer;
+			buffer.Add(data);
+		}
 		void ClearAttachmentsImpl(ArrayView<TextureUsage> attachments)
 		{
 			CommandData data;
@@ -2435,6 +2453,9 @@ namespace GLL
 					case Command::Blit:
 						Blit(command.blit.dst, command.blit.src, command.blit.dstOffset);
 						break;
+					case Command::CopyTextureLayer:
+						CopyTextureLayer(command.copyLayer.dst, command.copyLayer.dstLayer, command.copyLayer.src, command.copyLayer.srcLayer);
+						break;
 					case Command::MemBarrier:
 						glMemoryBarrier(command.memBarrier.bits);
 						break;
@@ -2676,6 +2697,9 @@ namespace GLL
 						SetWriteFrameBuffer(srcFrameBuffer);
 						setupFrameBuffer();
 						break;
+					case Command::CopyTextureLayer:
+						CopyTextureLayer(command.copyLayer.dst, command.copyLayer.dstLayer, command.copyLayer.src, command.copyLayer.srcLayer);
+						break;
 					case Command::ClearAttachments:
 						// TODO: ignoring drawBufferMask for now, assuming clearing all current framebuffer bindings
 						Clear(command.clear.depth, command.clear.drawBufferMask!=0, command.clear.stencil);
@@ -2698,6 +2722,14 @@ namespace GLL
 			srcFrameBuffer.SetDepthStencilRenderTarget(Texture2D());
 		}
 
+		void CopyTextureLayer(GameEngine::Texture2DArray* dstImage, int dstLayer, GameEngine::Texture2DArray* srcImage, int srcLayer)
+		{
+			auto src = dynamic_cast<GLL::Texture2DArray*>(srcImage);
+			auto dst = dynamic_cast<GLL::Texture2DArray*>(dstImage);
+			int width, height, layers;
+			src->GetSize(width, height, layers);
+			glCopyImageSubData(src->Handle, GL_TEXTURE_2D_ARRAY, 0, 0, 0, srcLayer, dst->Handle, GL_TEXTURE_2D_ARRAY, 0, 0, 0, dstLayer, width, height, 1);
+		}
 		void Blit(GameEngine::Texture2D* dstImage, GameEngine::Texture2D* srcImage, VectorMath::Vec2i dstOffset)
 		{
 			switch (reinterpret_cast<GLL::Texture2D*>(srcImage)->format)
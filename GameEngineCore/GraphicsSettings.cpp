@@ -20,6 +20,10 @@ namespace GameEngine
 				ShadowMapArraySize = StringToInt(settingsValue);
 			else if (settingsName == "ShadowMapResolution")
 				ShadowMapResolution = StringToInt(settingsValue);
+			else if (settingsName == "UseAnimationLod")
+				UseAnimationLod = settingsValue == "true";
+			else if (settingsName == "UseShadowMapCache")
+				UseShadowMapCache = settingsValue == "true";
 		}
 	}
 	void GraphicsSettings::SaveToFile(CoreLib::String fileName)
@@ -27,6 +31,8 @@ namespace GameEngine
 		StringBuilder sb;
 		sb << "ShadowMapArraySize = \"" << ShadowMapArraySize << "\"\n";
 		sb << "ShadowMapResolution = \"" << ShadowMapResolution << "\"\n";
+		sb << "UseAnimationLod = \"" << (UseAnimationLod ? "true" : "false") << "\"\n";
+		sb << "UseShadowMapCache = \"" << (UseShadowMapCache ? "true" : "false") << "\"\n";
 		File::WriteAllText(fileName, sb.ProduceString());
 	}
 }
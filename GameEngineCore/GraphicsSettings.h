@@ -2,6 +2,7 @@
 #define GAME_ENGINE_GRAPHICS_SETTINGS_H
 
 #include "CoreLib/Basic.h"
+#include "AnimationLod.h"
 
 namespace GameEngine
 {
@@ -11,6 +12,10 @@ namespace GameEngine
 		int ShadowMapArraySize = 8;
 		int ShadowMapResolution = 1024;
 		bool UsePipelineCache = true;
+		bool UseAnimationLod = true;
+		// keep the static casters of unchanged shadow views in spare layers of the shadow map array
+		bool UseShadowMapCache = true;
+		AnimationLodSettings AnimationLod;
 		void LoadFromFile(CoreLib::String fileName);
 		void SaveToFile(CoreLib::String fileName);
 	};
@@ -811,6 +811,9 @@ namespace GameEngine
 		virtual void DispatchCompute(int groupCountX, int groupCountY, int groupCountZ) = 0;
 		virtual void TransferLayout(CoreLib::ArrayView<Texture*> attachments, TextureLayoutTransfer transferDirection) = 0;
 		virtual void Blit(Texture2D* dstImage, Texture2D* srcImage, TextureLayout srcLayout, VectorMath::Vec2i destOffset) = 0;
+		// copies mip level 0 of a layer of srcImage to a layer of dstImage of the same size and format,
+		// both layers are in the given layout before and after the copy
+		virtual void CopyTextureLayer(Texture2DArray* dstImage, int dstLayer, Texture2DArray* srcImage, int srcLayer, TextureLayout layout) = 0;
 		virtual void ClearAttachments(FrameBuffer * frameBuffer) = 0;
 		virtual void MemoryAccessBarrier(MemoryBarrierType barrierType) = 0;
 	};
@@ -872,9 +875,27 @@ namespace GameEngine
         virtual VectorMath::ClipSpaceType GetClipSpaceType() = 0;
 	};
 
+	// Commands executed by a HardwareRenderer, accumulated since its creation
+	struct SubmittedCommandStats
+	{
+		int RenderPasses = 0;
+		int CommandBuffers = 0;
+		int DrawCalls = 0;
+		int PipelineBinds = 0;
+		int DescriptorSetBinds = 0;
+		int BufferBinds = 0;
+		int Dispatches = 0;
+		int Blits = 0;
+		int TextureCopies = 0;
+	};
+
 	// HardwareRenderer instance constructors
 	HardwareRenderer* CreateGLHardwareRenderer();
 	HardwareRenderer* CreateVulkanHardwareRenderer(int gpuId);
+	// CPU-only renderer that discards all GPU work, for running and profiling the engine without a GPU
+	HardwareRenderer* CreateNullHardwareRenderer();
+	// returns nullptr if hwRenderer was not created by CreateNullHardwareRenderer
+	SubmittedCommandStats* GetNullHardwareRendererStats(HardwareRenderer* hwRenderer);
 }
 
 #endif
\ No newline at end of file
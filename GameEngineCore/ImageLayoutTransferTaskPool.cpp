@@ -8,27 +8,34 @@ namespace GameEngine
 		ptr = 0;
 	}
 
-	GeneralRenderTask * ImageLayoutTransferTaskPool::NewImageLayoutTransferTask(CoreLib::ArrayView<Texture*> renderTargetTextures, CoreLib::ArrayView<Texture*> samplingTextures)
+	AsyncCommandBuffer * ImageLayoutTransferTaskPool::AllocCommandBuffer(GeneralRenderTask * & task)
 	{
-		GeneralRenderTask * result = nullptr;
-		AsyncCommandBuffer * cmdBuf = nullptr;
-		if (ptr < tasks.Count())
-		{
-			cmdBuf = commandBuffers[ptr].Ptr();
-			result = tasks[ptr++].Ptr();
-		}
-		else
+		if (ptr == tasks.Count())
 		{
 			commandBuffers.Add(new AsyncCommandBuffer(Engine::Instance()->GetRenderer()->GetHardwareRenderer(), 8));
 			tasks.Add(new GeneralRenderTask(commandBuffers.Last().Ptr()));
-			result = tasks.Last().Ptr();
-			cmdBuf = commandBuffers.Last().Ptr();
-			ptr++;
 		}
-		auto buf = cmdBuf->BeginRecording();
+		task = tasks[ptr].Ptr();
+		return commandBuffers[ptr++].Ptr();
+	}
+
+	GeneralRenderTask * ImageLayoutTransferTaskPool::NewImageLayoutTransferTask(CoreLib::ArrayView<Texture*> renderTargetTextures, CoreLib::ArrayView<Texture*> samplingTextures)
+	{
+		GeneralRenderTask * result = nullptr;
+		auto buf = AllocCommandBuffer(result)->BeginRecording();
 		buf->TransferLayout(renderTargetTextures, TextureLayoutTransfer::SampleToRenderAttachment);
 		buf->TransferLayout(samplingTextures, TextureLayoutTransfer::RenderAttachmentToSample);
 		buf->EndRecording();
 		return result;
 	}
+
+	GeneralRenderTask * ImageLayoutTransferTaskPool::NewTextureLayerCopyTask(Texture2DArray * texture, CoreLib::ArrayView<int> dstLayers, CoreLib::ArrayView<int> srcLayers, TextureLayout layout)
+	{
+		GeneralRenderTask * result = nullptr;
+		auto buf = AllocCommandBuffer(result)->BeginRecording();
+		for (int i = 0; i < dstLayers.Count(); i++)
+			buf->CopyTextureLayer(texture, dstLayers[i], texture, srcLayers[i], layout);
+		buf->EndRecording();
+		return result;
+	}
 }
\ No newline at end of file
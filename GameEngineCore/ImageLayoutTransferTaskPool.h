@@ -16,9 +16,12 @@ namespace GameEngine
 		CoreLib::List<CoreLib::RefPtr<AsyncCommandBuffer>> commandBuffers;
 		CoreLib::List<CoreLib::RefPtr<GeneralRenderTask>> tasks;
 		int ptr = 0;
+		AsyncCommandBuffer * AllocCommandBuffer(GeneralRenderTask * & task);
 	public:
 		void Reset();
 		GeneralRenderTask * NewImageLayoutTransferTask(CoreLib::ArrayView<Texture*> renderTargetTextures, CoreLib::ArrayView<Texture*> samplingTextures);
+		// copies layer srcLayers[i] of texture to layer dstLayers[i], the layers are in the given layout
+		GeneralRenderTask * NewTextureLayerCopyTask(Texture2DArray * texture, CoreLib::ArrayView<int> dstLayers, CoreLib::ArrayView<int> srcLayers, TextureLayout layout);
 	};
 }
 
@@ -4,6 +4,7 @@
 #include "CoreLib/Tokenizer.h"
 #include "MeshBuilder.h"
 #include "CameraActor.h"
+#include "LevelFile.h"
 
 namespace GameEngine
 {
@@ -56,11 +57,18 @@ namespace GameEngine
 
 	Level::Level(const CoreLib::String & fileName)
 	{
-		LoadFromText(File::ReadAllText(fileName));
+		if (Path::GetFileExt(fileName).ToLower() == "clevel")
+		{
+			MemoryMappedFile file(fileName);
+			LoadFromBinary(file.GetData());
+		}
+		else
+			LoadFromText(File::ReadAllText(fileName));
 		FileName = fileName;
 	}
 	void Level::LoadFromText(CoreLib::String text)
 	{
+		loadingFile = true;
 		Text::TokenReader parser(text);
 		auto errorRecover = [&]() 
 		{
@@ -141,20 +149,84 @@ namespace GameEngine
 				}
 			}
 		}
+		loadingFile = false;
+		Print("Num materials: %d\n", Materials.Count());
+	}
+	void Level::LoadFromBinary(CoreLib::ArrayView<unsigned char> data)
+	{
+		LevelFileReader reader;
+		if (!reader.Init(data))
+			throw IOException("Invalid compiled level file.");
+		loadingFile = true;
+		for (int i = 0; i < reader.GetActorCount(); i++)
+		{
+			auto className = reader.GetStringBuffer(reader.GetActor(i).ClassName);
+			ObjPtr<Actor> actor = Engine::Instance()->CreateActor(className);
+			if (!actor)
+			{
+				Print("Unknown actor class '%s' in actor record %d.\n", className, i);
+				continue;
+			}
+			bool isInvalid = false;
+			actor->ParseBinary(this, reader, i, isInvalid);
+			if (isInvalid)
+			{
+				Print("Error parsing actor record %d, ignoring the object.\n", i);
+				continue;
+			}
+			try
+			{
+				if (Actors.ContainsKey(actor->Name.GetValue()))
+				{
+					Print("error: an actor named '%S' already exists, ignoring second definition in actor record %d.\n",
+						actor->Name.GetValue().ToWString(), i);
+				}
+				else
+				{
+					RegisterActor(actor.Ptr());
+					if (actor->GetEngineType() == EngineActorType::Camera)
+						CurrentCamera = actor.As<CameraActor>();
+				}
+			}
+			catch (Exception e)
+			{
+				Print("OnLoad() error: an actor named '%S' failed to load, message: '%S'.\n", actor->Name.GetValue().ToWString(), e.Message.ToWString());
+			}
+		}
+		for (int i = 0; i < reader.GetHiddenSectionCount(); i++)
+			HiddenSections.Add(reader.GetHiddenSection(i));
+		loadingFile = false;
 		Print("Num materials: %d\n", Materials.Count());
 	}
 	void Level::SaveToFile(CoreLib::String fileName)
 	{
-		StringBuilder sb;
-		for (auto & actor : Actors)
-			actor.Value->SerializeToText(sb);
-		for (auto & sect : HiddenSections)
-			sb << "hidden " << sect << "\n";
-		File::WriteAllText(fileName, IndentText(sb.ProduceString()));
+		if (Path::GetFileExt(fileName).ToLower() == "clevel")
+		{
+			LevelFileWriter writer;
+			for (auto & actor : Actors)
+				actor.Value->SerializeToBinary(writer);
+			for (auto & sect : HiddenSections)
+				writer.AddHiddenSection(sect);
+			List<unsigned char> buffer;
+			writer.WriteToBuffer(buffer);
+			RefPtr<FileStream> stream = new FileStream(fileName, FileMode::Create);
+			stream->Write(buffer.Buffer(), buffer.Count());
+			stream->Close();
+		}
+		else
+		{
+			StringBuilder sb;
+			for (auto & actor : Actors)
+				actor.Value->SerializeToText(sb);
+			for (auto & sect : HiddenSections)
+				sb << "hidden " << sect << "\n";
+			File::WriteAllText(fileName, IndentText(sb.ProduceString()));
+		}
 		FileName = fileName;
 	}
 	Level::~Level()
 	{
+		streamer.Cancel();
         int count = Actors.Count();
 		for (int i = 0; i < count; i++)
 			UnregisterActor(Actors.First().Value.Ptr());
@@ -163,17 +235,36 @@ namespace GameEngine
         Meshes = decltype(Meshes)();
         Skeletons = decltype(Skeletons)();
         Animations = decltype(Animations)();
+        CompressedAnimations = decltype(CompressedAnimations)();
         RetargetFiles = decltype(RetargetFiles)();
         Actors = decltype(Actors)();
 	}
+	void Level::NotifyActorChanged(Actor * actor)
+	{
+		actorTypes.NotifyChanged(actor);
+	}
 	void Level::RegisterActor(Actor * actor)
 	{
 		Actors.Add(actor->Name.GetValue(), actor);
+		actor->SetLevel(this);
 		actor->OnLoad();
 		actor->RegisterUI(Engine::Instance()->GetUiEntry());
+		cullingTree.Add(actor);
+		actorTypes.Add(actor);
+		for (auto prop : actor->GetPropertyList())
+			prop->OnChanged.Bind(actor, &Actor::NotifyChanged);
 	}
 	void Level::UnregisterActor(Actor*actor)
 	{
+		for (auto prop : actor->GetPropertyList())
+			prop->OnChanged.Unbind(actor, &Actor::NotifyChanged);
+		actorTypes.Remove(actor);
+		RemoveStreamingCallbacks(streamingMeshes, actor);
+		RemoveStreamingCallbacks(streamingModels, actor);
+		RemoveStreamingCallbacks(streamingMaterials, actor);
+		RemoveStreamingCallbacks(streamingAnimations, actor);
+		RemoveStreamingCallbacks(streamingCompressedAnimations, actor);
+		cullingTree.Remove(actor);
 		actor->OnUnload();
         auto actorName = actor->Name.GetValue();
 		Actors[actorName] = nullptr;
@@ -335,6 +426,310 @@ namespace GameEngine
 		}
 		return result.Ptr();
 	}
+	CompressedSkeletalAnimation * Level::LoadCompressedAnimation(const CoreLib::String & fileName)
+	{
+		RefPtr<CompressedSkeletalAnimation> result = nullptr;
+		if (!CompressedAnimations.TryGetValue(fileName, result))
+		{
+			auto actualName = Engine::Instance()->FindFile(fileName, ResourceType::Mesh);
+			if (actualName.Length())
+			{
+				result = new CompressedSkeletalAnimation();
+				if (Path::GetFileExt(actualName).ToLower() == "canim")
+					result->LoadFromFile(actualName);
+				else
+				{
+					SkeletalAnimation anim;
+					anim.LoadFromFile(actualName);
+					result->Compress(anim);
+				}
+				CompressedAnimations[fileName] = result;
+			}
+			else
+			{
+				Print("error: cannot load animation \'%S\'\n", fileName.ToWString());
+				return nullptr;
+			}
+		}
+		return result.Ptr();
+	}
+	// shared between the load and finalize functions of a streaming request, see ResourceStreamer
+	template<typename T>
+	struct StreamedResource : public RefObject
+	{
+		String FileName;
+		RefPtr<T> Resource;
+		List<String> Errors;
+	};
+	// counts the streamed resources a resource waits for, OnFinished runs when the last one has finished
+	struct StreamingDependencies : public RefObject
+	{
+		int PendingCount = 1;
+		Func<void> OnFinished;
+		void Add()
+		{
+			PendingCount++;
+		}
+		void Finish()
+		{
+			if (--PendingCount == 0)
+				OnFinished();
+		}
+	};
+	template<typename T, typename LoadFunc, typename FinalizeFunc>
+	void Level::StreamResource(EnumerableDictionary<String, RefPtr<T>> & resources, StreamingRequests<T> & requests,
+		const String & fileName, const char * typeName, ResourceType resourceType, Actor * requester,
+		const Func<void, T*> & onLoaded, StreamingPriority priority, const LoadFunc & load, const FinalizeFunc & finalize)
+	{
+		StreamingCallback<T> callback;
+		callback.Requester = requester;
+		callback.OnLoaded = onLoaded;
+		RefPtr<T> resource;
+		if (resources.TryGetValue(fileName, resource))
+		{
+			callback.OnLoaded(resource.Ptr());
+			return;
+		}
+		if (auto callbacks = requests.TryGetValue(fileName))
+		{
+			callbacks->Add(callback);
+			return;
+		}
+		List<StreamingCallback<T>> callbacks;
+		callbacks.Add(callback);
+		requests[fileName] = _Move(callbacks);
+		if (!loadingFile)
+			priority = StreamingPriority::High;
+
+		RefPtr<StreamedResource<T>> result = new StreamedResource<T>();
+		// strings share their buffers through non-atomic reference counts, so the streaming thread gets its own copy
+		result->FileName = String(fileName.Buffer());
+		auto resourceMap = &resources;
+		auto requestMap = &requests;
+		streamer.Submit([=]()
+		{
+			try
+			{
+				auto actualName = Engine::Instance()->FindFile(result->FileName, resourceType);
+				if (actualName.Length())
+					result->Resource = load(actualName, result->Errors);
+			}
+			catch (const Exception & e)
+			{
+				result->Resource = nullptr;
+				result->Errors.Add(e.Message);
+			}
+		},
+		[=]()
+		{
+			for (auto & error : result->Errors)
+				Print("error: %S\n", error.ToWString());
+			// the resource may have been loaded synchronously in the meantime
+			if (resourceMap->ContainsKey(fileName) || !result->Resource)
+			{
+				FinishStreamingRequest(*resourceMap, *requestMap, fileName, typeName, result->Resource);
+				return;
+			}
+			finalize(result->Resource.Ptr(), [=]()
+			{
+				FinishStreamingRequest(*resourceMap, *requestMap, fileName, typeName, result->Resource);
+			});
+		}, priority);
+	}
+	template<typename T>
+	void Level::FinishStreamingRequest(EnumerableDictionary<String, RefPtr<T>> & resources, StreamingRequests<T> & requests,
+		const String & fileName, const char * typeName, RefPtr<T> resource)
+	{
+		RefPtr<T> loadedResource;
+		if (!resources.TryGetValue(fileName, loadedResource) && resource)
+		{
+			loadedResource = resource;
+			resources[fileName] = loadedResource;
+		}
+		if (!loadedResource)
+			Print("error: cannot load %s \'%S\'\n", typeName, fileName.ToWString());
+		// callbacks are taken one at a time in request order, since a callback may unregister actors
+		// waiting for the same file
+		while (auto callbacks = requests.TryGetValue(fileName))
+		{
+			if (callbacks->Count() == 0)
+			{
+				requests.Remove(fileName);
+				break;
+			}
+			auto onLoadedCallback = _Move(callbacks->First().OnLoaded);
+			callbacks->RemoveAt(0);
+			onLoadedCallback(loadedResource.Ptr());
+		}
+	}
+	template<typename T>
+	void Level::RemoveStreamingCallbacks(StreamingRequests<T> & requests, Actor * requester)
+	{
+		for (auto & request : requests)
+		{
+			auto & callbacks = request.Value;
+			for (int i = callbacks.Count() - 1; i >= 0; i--)
+			{
+				if (callbacks[i].Requester == requester)
+					callbacks.RemoveAt(i);
+			}
+		}
+	}
+	// the texture data read by a streaming request
+	struct StreamedTexture : public RefObject
+	{
+		String FileName;
+		CoreLib::Graphics::TextureFile File;
+		bool Loaded = false;
+		String Error;
+	};
+	void Level::StreamTexture(const CoreLib::String & fileName, const CoreLib::Func<void> & onLoaded)
+	{
+		Func<void> callback = onLoaded;
+		if (Engine::Instance()->GetRenderer()->GetSceneResource()->FindTexture(fileName))
+		{
+			callback();
+			return;
+		}
+		if (auto callbacks = streamingTextures.TryGetValue(fileName))
+		{
+			callbacks->Add(callback);
+			return;
+		}
+		List<Func<void>> callbacks;
+		callbacks.Add(callback);
+		streamingTextures[fileName] = _Move(callbacks);
+
+		RefPtr<StreamedTexture> result = new StreamedTexture();
+		result->FileName = String(fileName.Buffer());
+		streamer.Submit([=]()
+		{
+			try
+			{
+				result->Loaded = SceneResource::ReadTextureFile(result->FileName, result->File);
+			}
+			catch (const Exception & e)
+			{
+				result->Loaded = false;
+				result->Error = e.Message;
+			}
+		},
+		[=]()
+		{
+			if (result->Error.Length())
+				Print("error: %S\n", result->Error.ToWString());
+			// textures that cannot be read are left to SceneResource::LoadTexture, which substitutes the error texture
+			if (result->Loaded)
+				Engine::Instance()->GetRenderer()->GetSceneResource()->LoadTexture2D(fileName, result->File);
+			while (auto textureCallbacks = streamingTextures.TryGetValue(fileName))
+			{
+				if (textureCallbacks->Count() == 0)
+				{
+					streamingTextures.Remove(fileName);
+					break;
+				}
+				auto onTextureLoaded = _Move(textureCallbacks->First());
+				textureCallbacks->RemoveAt(0);
+				onTextureLoaded();
+			}
+		}, StreamingPriority::High);
+	}
+	void Level::LoadMeshAsync(const CoreLib::String & fileName, Actor * requester, const CoreLib::Func<void, Mesh*> & onLoaded,
+		StreamingPriority priority)
+	{
+		StreamResource(Meshes, streamingMeshes, fileName, "mesh", ResourceType::Mesh, requester, onLoaded, priority,
+			[](const String & actualName, List<String> &)
+			{
+				RefPtr<Mesh> mesh = new Mesh();
+				mesh->LoadFromFile(actualName);
+				return mesh;
+			},
+			[](Mesh *, Func<void> onFinalized) { onFinalized(); });
+	}
+	void Level::LoadModelAsync(const CoreLib::String & fileName, Actor * requester, const CoreLib::Func<void, Model*> & onLoaded,
+		StreamingPriority priority)
+	{
+		StreamResource(Models, streamingModels, fileName, "model", ResourceType::Mesh, requester, onLoaded, priority,
+			[](const String & actualName, List<String> & errors)
+			{
+				RefPtr<Model> model = new Model();
+				model->LoadGeometryFromString(File::ReadAllText(actualName), errors);
+				return model;
+			},
+			[this](Model * model, Func<void> onFinalized)
+			{
+				// the materials are streamed first, so resolving them does not read any files
+				RefPtr<StreamingDependencies> dependencies = new StreamingDependencies();
+				dependencies->OnFinished = [=]()
+				{
+					model->ResolveMaterials(this);
+					auto finished = onFinalized;
+					finished();
+				};
+				for (auto & materialFileName : model->GetMaterialFileNames())
+				{
+					dependencies->Add();
+					LoadMaterialAsync(materialFileName, nullptr, [=](Material *) { dependencies->Finish(); }, StreamingPriority::High);
+				}
+				dependencies->Finish();
+			});
+	}
+	void Level::LoadMaterialAsync(const CoreLib::String & fileName, Actor * requester, const CoreLib::Func<void, Material*> & onLoaded,
+		StreamingPriority priority)
+	{
+		StreamResource(Materials, streamingMaterials, fileName, "material", ResourceType::Material, requester, onLoaded, priority,
+			[](const String & actualName, List<String> &)
+			{
+				RefPtr<Material> material = new Material();
+				material->LoadFromFile(actualName);
+				return material;
+			},
+			[this](Material * material, Func<void> onFinalized)
+			{
+				// textures are uploaded before the material is handed out, so registering it with the renderer does not read any files
+				RefPtr<StreamingDependencies> dependencies = new StreamingDependencies();
+				dependencies->OnFinished = onFinalized;
+				for (auto & variable : material->Variables)
+				{
+					if (variable.Value.VarType != DynamicVariableType::Texture)
+						continue;
+					dependencies->Add();
+					StreamTexture(variable.Value.StringValue, [=]() { dependencies->Finish(); });
+				}
+				dependencies->Finish();
+			});
+	}
+	void Level::LoadSkeletalAnimationAsync(const CoreLib::String & fileName, Actor * requester, const CoreLib::Func<void, SkeletalAnimation*> & onLoaded,
+		StreamingPriority priority)
+	{
+		StreamResource(Animations, streamingAnimations, fileName, "animation", ResourceType::Mesh, requester, onLoaded, priority,
+			[](const String & actualName, List<String> &)
+			{
+				RefPtr<SkeletalAnimation> animation = new SkeletalAnimation();
+				animation->LoadFromFile(actualName);
+				return animation;
+			},
+			[](SkeletalAnimation *, Func<void> onFinalized) { onFinalized(); });
+	}
+	void Level::LoadCompressedAnimationAsync(const CoreLib::String & fileName, Actor * requester, const CoreLib::Func<void, CompressedSkeletalAnimation*> & onLoaded,
+		StreamingPriority priority)
+	{
+		StreamResource(CompressedAnimations, streamingCompressedAnimations, fileName, "animation", ResourceType::Mesh, requester, onLoaded, priority,
+			[](const String & actualName, List<String> &)
+			{
+				RefPtr<CompressedSkeletalAnimation> animation = new CompressedSkeletalAnimation();
+				if (Path::GetFileExt(actualName).ToLower() == "canim")
+					animation->LoadFromFile(actualName);
+				else
+				{
+					SkeletalAnimation anim;
+					anim.LoadFromFile(actualName);
+					animation->Compress(anim);
+				}
+				return animation;
+			},
+			[](CompressedSkeletalAnimation *, Func<void> onFinalized) { onFinalized(); });
+	}
 	Actor * Level::FindActor(const CoreLib::String & name)
 	{
 		RefPtr<Actor> result;
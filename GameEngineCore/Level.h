@@ -6,24 +6,100 @@
 #include "Actor.h"
 #include "Material.h"
 #include "Skeleton.h"
+#include "CompressedAnimation.h"
 #include "Physics.h"
+#include "SceneCullingTree.h"
+#include "ResourceStreamer.h"
+#include <atomic>
 
 namespace GameEngine
 {
     class Actor;
     class CameraActor;
+	enum class ResourceType;
+
+	// Registered actors grouped by EngineActorType, so per-frame passes do not scan all actors, and a
+	// version counter per type. Properties of actors ticked in parallel change on worker threads, so
+	// the counters are atomic.
+	class ActorTypeRegistry
+	{
+	private:
+		CoreLib::List<Actor*> actors[EngineActorTypeCount];
+		std::atomic<int> versions[EngineActorTypeCount] = {};
+	public:
+		void Add(Actor * actor)
+		{
+			actors[(int)actor->GetEngineType()].Add(actor);
+			NotifyChanged(actor);
+		}
+		// moves the last actor of the same type into the freed slot
+		void Remove(Actor * actor)
+		{
+			auto & typedActors = actors[(int)actor->GetEngineType()];
+			int index = typedActors.IndexOf(actor);
+			if (index != -1)
+				typedActors.FastRemoveAt(index);
+			NotifyChanged(actor);
+		}
+		void NotifyChanged(Actor * actor)
+		{
+			versions[(int)actor->GetEngineType()]++;
+		}
+		CoreLib::ArrayView<Actor*> GetActors(EngineActorType type)
+		{
+			return actors[(int)type].GetArrayView();
+		}
+		int GetVersion(EngineActorType type)
+		{
+			return versions[(int)type];
+		}
+	};
 
 	class Level : public CoreLib::Object
 	{
 	private:
 		PhysicsScene physicsScene;
+		SceneCullingTree cullingTree;
 		CoreLib::RefPtr<Model> errorModel;
+		ActorTypeRegistry actorTypes;
+		template<typename T>
+		struct StreamingCallback
+		{
+			Actor * Requester;
+			CoreLib::Func<void, T*> OnLoaded;
+		};
+		// callbacks waiting for each file being streamed
+		template<typename T>
+		using StreamingRequests = CoreLib::Dictionary<CoreLib::String, CoreLib::List<StreamingCallback<T>>>;
+		ResourceStreamer streamer;
+		bool loadingFile = false;
+		StreamingRequests<Mesh> streamingMeshes;
+		StreamingRequests<Model> streamingModels;
+		StreamingRequests<Material> streamingMaterials;
+		StreamingRequests<SkeletalAnimation> streamingAnimations;
+		StreamingRequests<CompressedSkeletalAnimation> streamingCompressedAnimations;
+		// textures are kept by the renderer's scene resource, these are the callbacks of the ones being read
+		CoreLib::Dictionary<CoreLib::String, CoreLib::List<CoreLib::Func<void>>> streamingTextures;
+		// The load function reads the file on a streaming thread. The finalize function runs on the main thread
+		// and calls its continuation once the resource is ready, possibly after streaming resources it depends on.
+		template<typename T, typename LoadFunc, typename FinalizeFunc>
+		void StreamResource(CoreLib::EnumerableDictionary<CoreLib::String, CoreLib::RefPtr<T>> & resources, StreamingRequests<T> & requests,
+			const CoreLib::String & fileName, const char * typeName, ResourceType resourceType, Actor * requester,
+			const CoreLib::Func<void, T*> & onLoaded, StreamingPriority priority, const LoadFunc & load, const FinalizeFunc & finalize);
+		template<typename T>
+		void FinishStreamingRequest(CoreLib::EnumerableDictionary<CoreLib::String, CoreLib::RefPtr<T>> & resources, StreamingRequests<T> & requests,
+			const CoreLib::String & fileName, const char * typeName, CoreLib::RefPtr<T> resource);
+		template<typename T>
+		void RemoveStreamingCallbacks(StreamingRequests<T> & requests, Actor * requester);
+		// reads a texture for the renderer on a streaming thread, onLoaded is called once it is uploaded or has failed to load
+		void StreamTexture(const CoreLib::String & fileName, const CoreLib::Func<void> & onLoaded);
 	public:
 		CoreLib::EnumerableDictionary<CoreLib::String, CoreLib::RefPtr<Material>> Materials;
 		CoreLib::EnumerableDictionary<CoreLib::String, CoreLib::RefPtr<Model>> Models;
 		CoreLib::EnumerableDictionary<CoreLib::String, CoreLib::RefPtr<Mesh>> Meshes;
 		CoreLib::EnumerableDictionary<CoreLib::String, CoreLib::RefPtr<Skeleton>> Skeletons;
 		CoreLib::EnumerableDictionary<CoreLib::String, CoreLib::RefPtr<SkeletalAnimation>> Animations;
+		CoreLib::EnumerableDictionary<CoreLib::String, CoreLib::RefPtr<CompressedSkeletalAnimation>> CompressedAnimations;
 
 		CoreLib::EnumerableDictionary<CoreLib::String, RetargetFile> RetargetFiles;
 		CoreLib::EnumerableDictionary<CoreLib::String, CoreLib::ObjPtr<Actor>> Actors;
@@ -31,6 +107,9 @@ namespace GameEngine
         CoreLib::ObjPtr<CameraActor> CurrentCamera;
 		CoreLib::String FileName;
 		void LoadFromText(CoreLib::String text);
+		// loads a compiled level (see LevelFile.h), data only needs to stay valid during the call
+		void LoadFromBinary(CoreLib::ArrayView<unsigned char> data);
+		// writes a compiled level if fileName has the .clevel extension, the text format otherwise
 		void SaveToFile(CoreLib::String fileName);
 		Level(const CoreLib::String & fileName);
 		Level() = default;
@@ -46,11 +125,62 @@ namespace GameEngine
 		Material * LoadErrorMaterial();
 		Material * CreateNewMaterial();
 		SkeletalAnimation * LoadSkeletalAnimation(const CoreLib::String & fileName);
+		// loads a .canim file, or compresses any other animation file on load
+		CompressedSkeletalAnimation * LoadCompressedAnimation(const CoreLib::String & fileName);
+		// Asynchronous versions of the loaders above. The file is read on a streaming thread, and
+		// onLoaded is called on the main thread from UpdateStreaming with the resource, or with nullptr
+		// if it cannot be loaded. If the resource is already loaded, onLoaded is called right away.
+		// Requesters show a placeholder until then; their pending callbacks are dropped when they are
+		// unregistered. Requests made while the level file is loaded are queued at the given priority,
+		// later ones come from actors spawned into the running level and are raised to High.
+		// A streamed model is handed out once its materials are loaded, and a streamed material once
+		// the textures it references are uploaded, so neither is read from disk on the main thread.
+		void LoadMeshAsync(const CoreLib::String & fileName, Actor * requester, const CoreLib::Func<void, Mesh*> & onLoaded,
+			StreamingPriority priority = StreamingPriority::Normal);
+		void LoadModelAsync(const CoreLib::String & fileName, Actor * requester, const CoreLib::Func<void, Model*> & onLoaded,
+			StreamingPriority priority = StreamingPriority::Normal);
+		void LoadMaterialAsync(const CoreLib::String & fileName, Actor * requester, const CoreLib::Func<void, Material*> & onLoaded,
+			StreamingPriority priority = StreamingPriority::Normal);
+		void LoadSkeletalAnimationAsync(const CoreLib::String & fileName, Actor * requester, const CoreLib::Func<void, SkeletalAnimation*> & onLoaded,
+			StreamingPriority priority = StreamingPriority::Normal);
+		void LoadCompressedAnimationAsync(const CoreLib::String & fileName, Actor * requester, const CoreLib::Func<void, CompressedSkeletalAnimation*> & onLoaded,
+			StreamingPriority priority = StreamingPriority::Normal);
+		// finalizes streamed resources for at most timeBudget seconds, called once per frame by the engine
+		void UpdateStreaming(float timeBudget)
+		{
+			streamer.Update(timeBudget);
+		}
+		// blocks until all streaming requests are finished
+		void FinishStreaming()
+		{
+			streamer.Flush();
+		}
+		bool IsStreaming()
+		{
+			return streamer.GetUnfinishedRequestCount() != 0;
+		}
 		Actor * FindActor(const CoreLib::String & name);
 		PhysicsScene & GetPhysicsScene()
 		{
 			return physicsScene;
 		}
+		SceneCullingTree & GetCullingTree()
+		{
+			return cullingTree;
+		}
+		// Dense list of the registered actors of the given engine type. Unregistering an actor
+		// moves the last actor of its type into the freed slot.
+		CoreLib::ArrayView<Actor*> GetActorsOfType(EngineActorType type)
+		{
+			return actorTypes.GetActors(type);
+		}
+		// Incremented whenever an actor of the given type is registered, unregistered or has a
+		// property changed. Per-frame passes compare it with the last seen value to skip work.
+		int GetActorTypeVersion(EngineActorType type)
+		{
+			return actorTypes.GetVersion(type);
+		}
+		void NotifyActorChanged(Actor * actor);
 		void RegisterActor(Actor * actor);
 		void UnregisterActor(Actor * actor);
 	};
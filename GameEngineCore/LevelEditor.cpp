@@ -181,13 +181,13 @@ namespace GameEngine
 
 			dlgOpen = new CoreLib::WinForm::FileDialog(Engine::Instance()->GetMainWindow());
 			dlgOpen->FileMustExist = true;
-			dlgOpen->Filter = "Level file|*.level";
+			dlgOpen->Filter = "Level file|*.level|Compiled level file|*.clevel";
 			dlgOpen->DefaultEXT = "level";
 			dlgOpen->FileName = Engine::Instance()->GetDirectory(false, ResourceType::Level) + "\\";
 			dlgSave = new CoreLib::WinForm::FileDialog(Engine::Instance()->GetMainWindow());
 			dlgSave->PathMustExist = true;
 			dlgSave->OverwritePrompt = true;
-			dlgSave->Filter = "Level file|*.level";
+			dlgSave->Filter = "Level file|*.level|Compiled level file|*.clevel";
 			dlgSave->DefaultEXT = "level";
 			dlgSave->FileName = dlgOpen->FileName;
 
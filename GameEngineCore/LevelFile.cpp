@@ -0,0 +1,275 @@
+#include "LevelFile.h"
+
+namespace GameEngine
+{
+	using namespace CoreLib;
+
+	int LevelFileWriter::AddString(const String & str)
+	{
+		int id = -1;
+		if (stringIds.TryGetValue(str, id))
+			return id;
+		id = strings.Count();
+		LevelFileString entry;
+		entry.Offset = (unsigned int)stringData.Count();
+		entry.Length = (unsigned int)str.Length();
+		strings.Add(entry);
+		if (str.Length())
+			stringData.AddRange(str.Buffer(), str.Length());
+		stringData.Add(0);
+		stringIds[str] = id;
+		return id;
+	}
+
+	int LevelFileWriter::AddResource(const String & typeName, const String & fileName)
+	{
+		auto key = typeName + "\n" + fileName;
+		int id = -1;
+		if (resourceIds.TryGetValue(key, id))
+			return id;
+		id = resources.Count();
+		LevelFileResource entry;
+		entry.TypeName = AddString(typeName);
+		entry.FileName = AddString(fileName);
+		resources.Add(entry);
+		resourceIds[key] = id;
+		return id;
+	}
+
+	void LevelFileWriter::AddActor(const String & className, PropertyContainer * container, const String & fields)
+	{
+		LevelFileActor actor;
+		actor.ClassName = AddString(className);
+		actor.FirstProperty = (unsigned int)properties.Count();
+		actor.Fields = fields.Length() ? AddString(fields) : LevelFileNone;
+		for (auto prop : container->GetPropertyList())
+		{
+			LevelFileProperty entry;
+			entry.Name = AddString(prop->GetName());
+			entry.Size = 0;
+			valueBuffer.Clear();
+			if (!prop->SerializeBinary(valueBuffer))
+			{
+				StringBuilder sb;
+				prop->Serialize(sb);
+				entry.Encoding = LevelFilePropertyEncoding::Text;
+				entry.Offset = AddString(sb.ProduceString());
+				properties.Add(entry);
+				continue;
+			}
+			// non-empty values of properties marked as resource(Type, ext) go to the resource table,
+			// the binary form of a string property is its text
+			String attrib = prop->GetAttribute();
+			if (valueBuffer.Count() && attrib.StartsWith("resource("))
+			{
+				int typeEnd = attrib.IndexOf(',');
+				if (typeEnd == -1)
+					typeEnd = attrib.IndexOf(')');
+				if (typeEnd == -1)
+					typeEnd = attrib.Length();
+				String fileName;
+				ParseBinaryValue(valueBuffer.GetArrayView(), fileName);
+				entry.Encoding = LevelFilePropertyEncoding::Resource;
+				entry.Offset = AddResource(attrib.SubString(9, typeEnd - 9).Trim(), fileName);
+			}
+			else
+			{
+				while (propertyData.Count() & 3)
+					propertyData.Add(0);
+				entry.Encoding = LevelFilePropertyEncoding::Binary;
+				entry.Offset = (unsigned int)propertyData.Count();
+				entry.Size = (unsigned int)valueBuffer.Count();
+				propertyData.AddRange(valueBuffer);
+			}
+			properties.Add(entry);
+		}
+		actor.PropertyCount = (unsigned int)properties.Count() - actor.FirstProperty;
+		actors.Add(actor);
+	}
+
+	void LevelFileWriter::AddHiddenSection(const String & text)
+	{
+		hiddenSections.Add(AddString(text));
+	}
+
+	void LevelFileWriter::WriteToBuffer(List<unsigned char> & buffer)
+	{
+		LevelFileHeader header;
+		unsigned int offset = sizeof(LevelFileHeader);
+		auto placeTable = [&](LevelFileTable & table, int count, int elementSize)
+		{
+			table.Offset = offset;
+			table.Count = (unsigned int)count;
+			offset += (unsigned int)(count * elementSize);
+		};
+		placeTable(header.Strings, strings.Count(), sizeof(LevelFileString));
+		placeTable(header.Resources, resources.Count(), sizeof(LevelFileResource));
+		placeTable(header.Actors, actors.Count(), sizeof(LevelFileActor));
+		placeTable(header.Properties, properties.Count(), sizeof(LevelFileProperty));
+		placeTable(header.HiddenSections, hiddenSections.Count(), sizeof(unsigned int));
+		unsigned int propertyDataOffset = (offset + 15) & ~15u;
+		unsigned int stringDataOffset = propertyDataOffset + (unsigned int)propertyData.Count();
+		header.FileSize = stringDataOffset + (unsigned int)stringData.Count();
+
+		buffer.Clear();
+		buffer.SetSize((int)header.FileSize);
+		memset(buffer.Buffer(), 0, buffer.Count());
+		auto writeTable = [&](const LevelFileTable & table, const void * src, int size)
+		{
+			if (size)
+				memcpy(buffer.Buffer() + table.Offset, src, size);
+		};
+		memcpy(buffer.Buffer(), &header, sizeof(header));
+		// offsets in the file are relative to its start, so they are fixed up here instead of on load
+		auto fileStrings = (LevelFileString*)(buffer.Buffer() + header.Strings.Offset);
+		for (int i = 0; i < strings.Count(); i++)
+		{
+			fileStrings[i] = strings[i];
+			fileStrings[i].Offset += stringDataOffset;
+		}
+		writeTable(header.Resources, resources.Buffer(), resources.Count() * sizeof(LevelFileResource));
+		writeTable(header.Actors, actors.Buffer(), actors.Count() * sizeof(LevelFileActor));
+		auto fileProperties = (LevelFileProperty*)(buffer.Buffer() + header.Properties.Offset);
+		for (int i = 0; i < properties.Count(); i++)
+		{
+			fileProperties[i] = properties[i];
+			if (fileProperties[i].Encoding == LevelFilePropertyEncoding::Binary)
+				fileProperties[i].Offset += propertyDataOffset;
+		}
+		writeTable(header.HiddenSections, hiddenSections.Buffer(), hiddenSections.Count() * sizeof(unsigned int));
+		if (propertyData.Count())
+			memcpy(buffer.Buffer() + propertyDataOffset, propertyData.Buffer(), propertyData.Count());
+		if (stringData.Count())
+			memcpy(buffer.Buffer() + stringDataOffset, stringData.Buffer(), stringData.Count());
+	}
+
+	template<typename T>
+	const T * LevelFileReader::GetTable(const LevelFileTable & table)
+	{
+		unsigned long long end = (unsigned long long)table.Offset + (unsigned long long)table.Count * sizeof(T);
+		if ((table.Offset & 3) || end > (unsigned long long)data.Count())
+			return nullptr;
+		return (const T*)(data.Buffer() + table.Offset);
+	}
+
+	bool LevelFileReader::Init(ArrayView<unsigned char> fileData)
+	{
+		if (fileData.Count() < (int)sizeof(LevelFileHeader))
+			return false;
+		auto fileHeader = (const LevelFileHeader*)fileData.Buffer();
+		if (fileHeader->Magic != LevelFileMagic || fileHeader->Version != LevelFileVersion ||
+			fileHeader->FileSize != (unsigned int)fileData.Count())
+			return false;
+		data = fileData;
+		header = fileHeader;
+		strings = GetTable<LevelFileString>(header->Strings);
+		resources = GetTable<LevelFileResource>(header->Resources);
+		actors = GetTable<LevelFileActor>(header->Actors);
+		properties = GetTable<LevelFileProperty>(header->Properties);
+		hiddenSections = GetTable<unsigned int>(header->HiddenSections);
+		if (!strings || !resources || !actors || !properties || !hiddenSections)
+			return false;
+
+		// validate every id once, so that accessors do not need to check bounds
+		unsigned int size = (unsigned int)data.Count();
+		unsigned int stringCount = header->Strings.Count;
+		for (unsigned int i = 0; i < stringCount; i++)
+		{
+			if ((unsigned long long)strings[i].Offset + strings[i].Length >= size || data[strings[i].Offset + strings[i].Length] != 0)
+				return false;
+		}
+		for (unsigned int i = 0; i < header->Resources.Count; i++)
+		{
+			if (resources[i].TypeName >= stringCount || resources[i].FileName >= stringCount)
+				return false;
+		}
+		for (unsigned int i = 0; i < header->Properties.Count; i++)
+		{
+			auto & entry = properties[i];
+			if (entry.Name >= stringCount)
+				return false;
+			switch (entry.Encoding)
+			{
+			case LevelFilePropertyEncoding::Binary:
+				if ((unsigned long long)entry.Offset + entry.Size > size)
+					return false;
+				break;
+			case LevelFilePropertyEncoding::Text:
+				if (entry.Offset >= stringCount)
+					return false;
+				break;
+			case LevelFilePropertyEncoding::Resource:
+				if (entry.Offset >= header->Resources.Count)
+					return false;
+				break;
+			default:
+				return false;
+			}
+		}
+		for (unsigned int i = 0; i < header->Actors.Count; i++)
+		{
+			auto & actor = actors[i];
+			if (actor.ClassName >= stringCount || (actor.Fields != LevelFileNone && actor.Fields >= stringCount) ||
+				(unsigned long long)actor.FirstProperty + actor.PropertyCount > header->Properties.Count)
+				return false;
+		}
+		for (unsigned int i = 0; i < header->HiddenSections.Count; i++)
+		{
+			if (hiddenSections[i] >= stringCount)
+				return false;
+		}
+		return true;
+	}
+
+	String LevelFileReader::GetString(unsigned int id)
+	{
+		StringBuilder sb((int)strings[id].Length);
+		sb.Append(GetStringBuffer(id), (int)strings[id].Length);
+		return sb.ProduceString();
+	}
+
+	bool LevelFileReader::ReadProperties(int actorId, PropertyContainer * container, List<String> & errors)
+	{
+		auto & actor = actors[actorId];
+		bool succeeded = true;
+		for (unsigned int i = 0; i < actor.PropertyCount; i++)
+		{
+			auto & entry = properties[actor.FirstProperty + i];
+			auto name = GetStringBuffer(entry.Name);
+			auto prop = container->FindProperty(name);
+			if (!prop)
+			{
+				errors.Add(String("property '") + name + "' does not exist.");
+				succeeded = false;
+				continue;
+			}
+			try
+			{
+				switch (entry.Encoding)
+				{
+				case LevelFilePropertyEncoding::Binary:
+					prop->ParseBinary(ArrayView<unsigned char>(data.Buffer() + entry.Offset, (int)entry.Size));
+					break;
+				case LevelFilePropertyEncoding::Resource:
+				{
+					auto & fileName = strings[resources[entry.Offset].FileName];
+					prop->ParseBinary(ArrayView<unsigned char>(data.Buffer() + fileName.Offset, (int)fileName.Length));
+					break;
+				}
+				case LevelFilePropertyEncoding::Text:
+				{
+					Text::TokenReader parser(GetString(entry.Offset));
+					prop->ParseValue(parser);
+					break;
+				}
+				}
+			}
+			catch (const Exception & e)
+			{
+				errors.Add(String("cannot parse property '") + name + "': " + e.Message);
+				succeeded = false;
+			}
+		}
+		return succeeded;
+	}
+}
@@ -0,0 +1,144 @@
+#ifndef GAME_ENGINE_LEVEL_FILE_H
+#define GAME_ENGINE_LEVEL_FILE_H
+
+#include "CoreLib/Basic.h"
+#include "Property.h"
+
+namespace GameEngine
+{
+	// Compiled level file (.clevel). The file starts with a LevelFileHeader, all tables are arrays of
+	// the structs below addressed by byte offsets from the start of the file, and strings are stored
+	// once, null-terminated, so a memory-mapped file is read in place without a tokenizing pass.
+	const unsigned int LevelFileMagic = 0x4C564C43; // "CLVL"
+	const unsigned int LevelFileVersion = 1;
+	const unsigned int LevelFileNone = 0xFFFFFFFF;
+
+	struct LevelFileTable
+	{
+		unsigned int Offset = 0;
+		unsigned int Count = 0;
+	};
+
+	struct LevelFileHeader
+	{
+		unsigned int Magic = LevelFileMagic;
+		unsigned int Version = LevelFileVersion;
+		unsigned int FileSize = 0;
+		LevelFileTable Strings;        // LevelFileString
+		LevelFileTable Resources;      // LevelFileResource
+		LevelFileTable Actors;         // LevelFileActor
+		LevelFileTable Properties;     // LevelFileProperty
+		LevelFileTable HiddenSections; // string ids
+	};
+
+	struct LevelFileString
+	{
+		unsigned int Offset;
+		unsigned int Length; // in bytes, not counting the terminating zero
+	};
+
+	// A file referenced by a string property with a "resource(Type, ext)" attribute. Each
+	// (type, file) pair is stored once, so a loader can list the files of a level up front.
+	struct LevelFileResource
+	{
+		unsigned int TypeName; // string id
+		unsigned int FileName; // string id
+	};
+
+	struct LevelFileActor
+	{
+		unsigned int ClassName; // string id
+		unsigned int FirstProperty;
+		unsigned int PropertyCount;
+		unsigned int Fields; // string id of the text written by Actor::SerializeFields, or LevelFileNone
+	};
+
+	enum class LevelFilePropertyEncoding : unsigned int
+	{
+		Binary,   // Offset and Size locate the value written by Property::SerializeBinary
+		Text,     // Offset is the string id of the value written by Property::Serialize
+		Resource  // Offset is the id of a LevelFileResource holding the value
+	};
+
+	struct LevelFileProperty
+	{
+		unsigned int Name; // string id
+		LevelFilePropertyEncoding Encoding;
+		unsigned int Offset;
+		unsigned int Size;
+	};
+
+	class LevelFileWriter
+	{
+	private:
+		CoreLib::List<LevelFileString> strings;
+		CoreLib::List<char> stringData;
+		CoreLib::Dictionary<CoreLib::String, int> stringIds;
+		CoreLib::List<LevelFileResource> resources;
+		CoreLib::Dictionary<CoreLib::String, int> resourceIds;
+		CoreLib::List<LevelFileActor> actors;
+		CoreLib::List<LevelFileProperty> properties;
+		CoreLib::List<unsigned char> propertyData;
+		CoreLib::List<unsigned int> hiddenSections;
+		CoreLib::List<unsigned char> valueBuffer;
+		int AddString(const CoreLib::String & str);
+		int AddResource(const CoreLib::String & typeName, const CoreLib::String & fileName);
+	public:
+		void AddActor(const CoreLib::String & className, PropertyContainer * container, const CoreLib::String & fields);
+		void AddHiddenSection(const CoreLib::String & text);
+		void WriteToBuffer(CoreLib::List<unsigned char> & buffer);
+	};
+
+	// Reads a compiled level in place. The data passed to Init must outlive the reader.
+	class LevelFileReader
+	{
+	private:
+		CoreLib::ArrayView<unsigned char> data;
+		const LevelFileHeader * header = nullptr;
+		const LevelFileString * strings = nullptr;
+		const LevelFileResource * resources = nullptr;
+		const LevelFileActor * actors = nullptr;
+		const LevelFileProperty * properties = nullptr;
+		const unsigned int * hiddenSections = nullptr;
+		template<typename T>
+		const T * GetTable(const LevelFileTable & table);
+	public:
+		// Validates the header and table bounds, returns false if data is not a compiled level.
+		bool Init(CoreLib::ArrayView<unsigned char> fileData);
+		int GetActorCount()
+		{
+			return (int)header->Actors.Count;
+		}
+		const LevelFileActor & GetActor(int id)
+		{
+			return actors[id];
+		}
+		int GetResourceCount()
+		{
+			return (int)header->Resources.Count;
+		}
+		const LevelFileResource & GetResource(int id)
+		{
+			return resources[id];
+		}
+		int GetHiddenSectionCount()
+		{
+			return (int)header->HiddenSections.Count;
+		}
+		CoreLib::String GetHiddenSection(int id)
+		{
+			return GetString(hiddenSections[id]);
+		}
+		// null-terminated string within the file data
+		const char * GetStringBuffer(unsigned int id)
+		{
+			return (const char *)data.Buffer() + strings[id].Offset;
+		}
+		CoreLib::String GetString(unsigned int id);
+		// Reads the properties of an actor record into container. Properties that are missing or fail
+		// to parse are skipped and reported in errors; returns false if there were any.
+		bool ReadProperties(int actorId, PropertyContainer * container, CoreLib::List<CoreLib::String> & errors);
+	};
+}
+
+#endif
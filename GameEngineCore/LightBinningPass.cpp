@@ -0,0 +1,267 @@
+#include "LightBinningPass.h"
+#include "LightingData.h"
+#include "CoreLib/JobSystem.h"
+#include <xmmintrin.h>
+
+using namespace CoreLib;
+using namespace VectorMath;
+
+namespace GameEngine
+{
+	const int ClustersPerSlice = LightClusterTilesX * LightClusterTilesY;
+	const int MaxLightsPerCluster = 4095;
+
+	// light volumes in SoA layout for SSE tests, padded to a multiple of 4 with lights that never pass
+	struct LightVolumeStreams
+	{
+		List<float> X, Y, Z, RadiusSq, Range;
+		List<float> DirX, DirY, DirZ, CosAngle, SinAngle, IsSpot;
+		List<int> LightIds;
+		int Count = 0;
+		void Clear()
+		{
+			X.Clear(); Y.Clear(); Z.Clear(); RadiusSq.Clear(); Range.Clear();
+			DirX.Clear(); DirY.Clear(); DirZ.Clear(); CosAngle.Clear(); SinAngle.Clear(); IsSpot.Clear();
+			LightIds.Clear();
+			Count = 0;
+		}
+		void Add(const LightVolumeStreams & src, int i)
+		{
+			X.Add(src.X[i]); Y.Add(src.Y[i]); Z.Add(src.Z[i]); RadiusSq.Add(src.RadiusSq[i]); Range.Add(src.Range[i]);
+			DirX.Add(src.DirX[i]); DirY.Add(src.DirY[i]); DirZ.Add(src.DirZ[i]);
+			CosAngle.Add(src.CosAngle[i]); SinAngle.Add(src.SinAngle[i]); IsSpot.Add(src.IsSpot[i]);
+			LightIds.Add(src.LightIds[i]);
+			Count++;
+		}
+		void Pad()
+		{
+			while (X.Count() & 3)
+			{
+				X.Add(0.0f); Y.Add(0.0f); Z.Add(0.0f); RadiusSq.Add(-1.0f); Range.Add(0.0f);
+				DirX.Add(0.0f); DirY.Add(0.0f); DirZ.Add(-1.0f); CosAngle.Add(1.0f); SinAngle.Add(0.0f); IsSpot.Add(0.0f);
+				LightIds.Add(0);
+			}
+		}
+	};
+
+	class LightBinningPassImpl
+	{
+	public:
+		struct SliceBins
+		{
+			// lights overlapping the slice, and those overlapping the tile row being binned
+			LightVolumeStreams SliceLights, RowLights;
+			List<unsigned short> Indices;
+		};
+		// view space rays through the tile corners, scaled to a depth of 1
+		Vec3 cornerRays[(LightClusterTilesX + 1) * (LightClusterTilesY + 1)];
+		float sliceDepth[LightClusterSlices + 1];
+		int clusterCounts[ClustersPerSlice * LightClusterSlices];
+		SliceBins slices[LightClusterSlices];
+		// view space volumes of the local lights
+		LightVolumeStreams volumes;
+		List<int> firstSlice, lastSlice;
+		void Setup(const StandardViewUniforms & view, float zNear, float zFar, ArrayView<GpuLightData> lights, int firstLocalLight);
+		void BinSlice(int slice);
+	};
+
+	// returns the mask of the four lights starting at i that intersect the box, with spot lights tested by
+	// their cone against the bounding sphere of the box
+	static inline int TestLights(const LightVolumeStreams & lights, int i, const Vec3 & boundsMin, const Vec3 & boundsMax)
+	{
+		__m128 zero = _mm_setzero_ps();
+		__m128 lx = _mm_loadu_ps(lights.X.Buffer() + i);
+		__m128 ly = _mm_loadu_ps(lights.Y.Buffer() + i);
+		__m128 lz = _mm_loadu_ps(lights.Z.Buffer() + i);
+		// distance from the light center to the box
+		__m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(boundsMin.x), lx), _mm_sub_ps(lx, _mm_set1_ps(boundsMax.x))), zero);
+		__m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(boundsMin.y), ly), _mm_sub_ps(ly, _mm_set1_ps(boundsMax.y))), zero);
+		__m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(boundsMin.z), lz), _mm_sub_ps(lz, _mm_set1_ps(boundsMax.z))), zero);
+		__m128 distSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		__m128 inside = _mm_cmple_ps(distSq, _mm_loadu_ps(lights.RadiusSq.Buffer() + i));
+		int mask = _mm_movemask_ps(inside);
+		__m128 isSpot = _mm_loadu_ps(lights.IsSpot.Buffer() + i);
+		if (!(mask & _mm_movemask_ps(isSpot)))
+			return mask;
+		// cone culling: the closest point of the cone to the sphere center is beyond the sphere radius,
+		// or the sphere lies in front of the cone's range or behind its apex
+		auto center = (boundsMin + boundsMax) * 0.5f;
+		__m128 sphereRadius = _mm_set1_ps((boundsMax - boundsMin).Length() * 0.5f);
+		__m128 vx = _mm_sub_ps(_mm_set1_ps(center.x), lx), vy = _mm_sub_ps(_mm_set1_ps(center.y), ly), vz = _mm_sub_ps(_mm_set1_ps(center.z), lz);
+		__m128 lenSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz));
+		__m128 axial = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, _mm_loadu_ps(lights.DirX.Buffer() + i)),
+			_mm_mul_ps(vy, _mm_loadu_ps(lights.DirY.Buffer() + i))), _mm_mul_ps(vz, _mm_loadu_ps(lights.DirZ.Buffer() + i)));
+		__m128 radial = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(lenSq, _mm_mul_ps(axial, axial)), zero));
+		__m128 closest = _mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(lights.CosAngle.Buffer() + i), radial),
+			_mm_mul_ps(axial, _mm_loadu_ps(lights.SinAngle.Buffer() + i)));
+		__m128 culled = _mm_or_ps(_mm_cmpgt_ps(closest, sphereRadius),
+			_mm_or_ps(_mm_cmpgt_ps(axial, _mm_add_ps(sphereRadius, _mm_loadu_ps(lights.Range.Buffer() + i))),
+				_mm_cmplt_ps(axial, _mm_sub_ps(zero, sphereRadius))));
+		return mask & ~_mm_movemask_ps(_mm_and_ps(culled, isSpot));
+	}
+
+	void LightBinningPass::GetDepthSliceParams(float zNear, float zFar, float & depthScale, float & depthBias)
+	{
+		depthScale = LightClusterSlices / log(zFar / zNear);
+		depthBias = -log(zNear) * depthScale;
+	}
+
+	void LightBinningPassImpl::Setup(const StandardViewUniforms & view, float zNear, float zFar, ArrayView<GpuLightData> lights, int firstLocalLight)
+	{
+		for (int y = 0; y <= LightClusterTilesY; y++)
+		{
+			for (int x = 0; x <= LightClusterTilesX; x++)
+			{
+				// any depth within the clip space depth range lies on the ray through the tile corner
+				auto ndc = Vec3::Create(x * (2.0f / LightClusterTilesX) - 1.0f, y * (2.0f / LightClusterTilesY) - 1.0f, 0.5f);
+				auto worldPos = view.InvViewProjTransform.TransformHomogeneous(ndc);
+				Vec3 viewPos;
+				view.ViewTransform.Transform(viewPos, worldPos);
+				cornerRays[y * (LightClusterTilesX + 1) + x] = viewPos * (-1.0f / viewPos.z);
+			}
+		}
+		float depthScale, depthBias;
+		LightBinningPass::GetDepthSliceParams(zNear, zFar, depthScale, depthBias);
+		for (int i = 0; i <= LightClusterSlices; i++)
+			sliceDepth[i] = zNear * pow(zFar / zNear, i / (float)LightClusterSlices);
+		auto getSlice = [&](float depth)
+		{
+			return Math::Clamp((int)floor(log(depth) * depthScale + depthBias), 0, LightClusterSlices - 1);
+		};
+
+		volumes.Clear();
+		firstSlice.Clear();
+		lastSlice.Clear();
+		for (int i = firstLocalLight; i < lights.Count(); i++)
+		{
+			auto & light = lights[i];
+			Vec3 center;
+			view.ViewTransform.Transform(center, light.position);
+			float depth = -center.z;
+			if (depth + light.radius < zNear || depth - light.radius > zFar)
+				continue;
+			firstSlice.Add(getSlice(Math::Max(depth - light.radius, zNear)));
+			lastSlice.Add(getSlice(Math::Min(depth + light.radius, zFar)));
+			auto dir = view.ViewTransform.TransformNormal(UnpackDirection(light.direction)).Normalize();
+			volumes.X.Add(center.x); volumes.Y.Add(center.y); volumes.Z.Add(center.z);
+			volumes.RadiusSq.Add(light.radius * light.radius);
+			volumes.Range.Add(light.radius);
+			// the light direction points from lit surfaces back to the light, the cone opens the other way
+			volumes.DirX.Add(-dir.x); volumes.DirY.Add(-dir.y); volumes.DirZ.Add(-dir.z);
+			volumes.CosAngle.Add(cos(light.endAngle));
+			volumes.SinAngle.Add(sin(light.endAngle));
+			// all bits set, so it can be used as a mask; cones wider than a half space are only culled by their sphere
+			unsigned int spotMask = (light.lightType == GpuLightType_Spot && light.endAngle < Math::Pi * 0.5f) ? 0xFFFFFFFF : 0;
+			float isSpot;
+			memcpy(&isSpot, &spotMask, sizeof(float));
+			volumes.IsSpot.Add(isSpot);
+			volumes.LightIds.Add(i);
+			volumes.Count++;
+		}
+	}
+
+	void LightBinningPassImpl::BinSlice(int slice)
+	{
+		auto & bins = slices[slice];
+		bins.Indices.Clear();
+		bins.SliceLights.Clear();
+		for (int i = 0; i < volumes.Count; i++)
+			if (firstSlice[i] <= slice && slice <= lastSlice[i])
+				bins.SliceLights.Add(volumes, i);
+		bins.SliceLights.Pad();
+
+		float zNear = sliceDepth[slice], zFar = sliceDepth[slice + 1];
+		auto getTileBounds = [&](int x0, int x1, int y0, int y1, Vec3 & boundsMin, Vec3 & boundsMax)
+		{
+			// view space bounds of the tiles within the slice, the camera looks along -z
+			boundsMin = Vec3::Create(FLT_MAX, FLT_MAX, -zFar);
+			boundsMax = Vec3::Create(-FLT_MAX, -FLT_MAX, -zNear);
+			for (int c = 0; c < 4; c++)
+			{
+				auto & ray = cornerRays[((c >> 1) ? y1 : y0) * (LightClusterTilesX + 1) + ((c & 1) ? x1 : x0)];
+				boundsMin.x = Math::Min(boundsMin.x, Math::Min(ray.x * zNear, ray.x * zFar));
+				boundsMin.y = Math::Min(boundsMin.y, Math::Min(ray.y * zNear, ray.y * zFar));
+				boundsMax.x = Math::Max(boundsMax.x, Math::Max(ray.x * zNear, ray.x * zFar));
+				boundsMax.y = Math::Max(boundsMax.y, Math::Max(ray.y * zNear, ray.y * zFar));
+			}
+		};
+		for (int y = 0; y < LightClusterTilesY; y++)
+		{
+			// most lights only reach a few rows, so the lights of a row are selected first
+			Vec3 boundsMin, boundsMax;
+			getTileBounds(0, LightClusterTilesX, y, y + 1, boundsMin, boundsMax);
+			auto & rowLights = bins.RowLights;
+			rowLights.Clear();
+			for (int i = 0; i < bins.SliceLights.Count; i += 4)
+			{
+				int mask = TestLights(bins.SliceLights, i, boundsMin, boundsMax);
+				for (int j = 0; j < 4; j++)
+					if (mask & (1 << j))
+						rowLights.Add(bins.SliceLights, i + j);
+			}
+			rowLights.Pad();
+			for (int x = 0; x < LightClusterTilesX; x++)
+			{
+				int firstIndex = bins.Indices.Count();
+				if (rowLights.Count)
+				{
+					getTileBounds(x, x + 1, y, y + 1, boundsMin, boundsMax);
+					for (int i = 0; i < rowLights.Count; i += 4)
+					{
+						int mask = TestLights(rowLights, i, boundsMin, boundsMax);
+						for (int j = 0; j < 4; j++)
+							if (mask & (1 << j))
+								bins.Indices.Add((unsigned short)rowLights.LightIds[i + j]);
+					}
+				}
+				int count = bins.Indices.Count() - firstIndex;
+				if (count > MaxLightsPerCluster)
+				{
+					bins.Indices.SetSize(firstIndex + MaxLightsPerCluster);
+					count = MaxLightsPerCluster;
+				}
+				clusterCounts[slice * ClustersPerSlice + y * LightClusterTilesX + x] = count;
+			}
+		}
+	}
+
+	LightBinningPass::LightBinningPass()
+	{
+		impl = new LightBinningPassImpl();
+	}
+
+	LightBinningPass::~LightBinningPass()
+	{
+		delete impl;
+	}
+
+	int LightBinningPass::Execute(const StandardViewUniforms & view, float zNear, float zFar, CoreLib::ArrayView<GpuLightData> lights, int firstLocalLight,
+		unsigned int * clusterData, unsigned short * indexData)
+	{
+		impl->Setup(view, zNear, zFar, lights, firstLocalLight);
+		Threading::JobSystem::Instance()->ParallelFor(0, LightClusterSlices, [this](int slice)
+		{
+			impl->BinSlice(slice);
+		}, 1);
+
+		// concatenate the lists of all slices, clusters beyond the capacity of the index data get no lights
+		int offset = 0;
+		for (int slice = 0; slice < LightClusterSlices; slice++)
+		{
+			auto & indices = impl->slices[slice].Indices;
+			int sliceOffset = 0;
+			for (int i = 0; i < ClustersPerSlice; i++)
+			{
+				int clusterId = slice * ClustersPerSlice + i;
+				int count = impl->clusterCounts[clusterId];
+				int writeCount = Math::Min(count, MaxClusterLightIndices - offset);
+				clusterData[clusterId] = ((unsigned int)offset << 12) | (unsigned int)writeCount;
+				if (writeCount)
+					memcpy(indexData + offset, indices.Buffer() + sliceOffset, writeCount * sizeof(unsigned short));
+				offset += writeCount;
+				sliceOffset += count;
+			}
+		}
+		return offset;
+	}
+}
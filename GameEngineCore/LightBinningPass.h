@@ -1,19 +1,37 @@
 #ifndef GAME_ENGINE_COMPUTE_PASS_H
 #define GAME_ENGINE_COMPUTE_PASS_H
 
-#include "HardwareRenderer.h"
+#include "CoreLib/Basic.h"
+#include "EngineLimits.h"
 
 namespace GameEngine
 {
+	struct GpuLightData;
+	class StandardViewUniforms;
 	class LightBinningPassImpl;
 
+	// Assigns point and spot lights to the clusters of a view. The view frustum is split into
+	// LightClusterTilesX x LightClusterTilesY screen tiles and LightClusterSlices depth slices
+	// that are uniform in log(depth), so a pixel only shades the lights listed for its cluster.
+	// Light volumes are tested against the view space bounds of the clusters four lights at a
+	// time with SSE, one depth slice per job.
+	// Cluster (x, y, slice) is entry (slice * LightClusterTilesY + y) * LightClusterTilesX + x
+	// of the cluster data, which holds (offset << 12) | count; the light indices of a cluster are
+	// the 16 bit values at offset .. offset + count - 1 of the index data.
 	class LightBinningPass
 	{
 	private:
 		LightBinningPassImpl * impl;
 	public:
-		void Execute(HardwareRenderer * renderer);
+		LightBinningPass();
+		~LightBinningPass();
+		// a pixel at view space depth d lies in slice floor(log(d) * depthScale + depthBias)
+		static void GetDepthSliceParams(float zNear, float zFar, float & depthScale, float & depthBias);
+		// bins lights[firstLocalLight..] (no directional lights) and writes the cluster data and at most
+		// MaxClusterLightIndices light indices, returns the number of indices written
+		int Execute(const StandardViewUniforms & view, float zNear, float zFar, CoreLib::ArrayView<GpuLightData> lights, int firstLocalLight,
+			unsigned int * clusterData, unsigned short * indexData);
 	};
 }
 
-#endif
\ No newline at end of file
+#endif
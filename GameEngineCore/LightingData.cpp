@@ -5,6 +5,7 @@
 #include "WorldRenderPass.h"
 #include "Engine.h"
 #include "AmbientLightActor.h"
+#include "CoreLib/Profiler.h"
 
 using namespace CoreLib;
 using namespace VectorMath;
@@ -12,6 +13,8 @@ using namespace VectorMath;
 namespace GameEngine
 {
 	const int MaxLights = 1024;
+	// drawables are cached as static shadow casters once their transform is unchanged for this many frames
+	const int StaticShadowCasterFrames = 8;
 
 	Vec3 UnpackDirection(unsigned int dir)
 	{
@@ -31,140 +34,216 @@ namespace GameEngine
 			(unsigned int)(Math::Clamp(((beta + Math::Pi * 0.5f) / Math::Pi), 0.0f, 1.0f)*65535.0f);
 	}
 
-	void GetDrawable(List<Drawable*> & drawableBuffer, DrawableSink * objSink, bool transparent, CullFrustum cf)
+	void GetDrawable(List<Drawable*> & drawableBuffer, DrawableSink * objSink, bool transparent, MultiFrustumCuller & culler, int frustumId)
 	{
-		for (auto obj : objSink->GetDrawables(transparent))
+		auto drawables = objSink->GetDrawables(transparent);
+		for (int i = 0; i < drawables.Count(); i++)
 		{
-			if (!obj->CastShadow)
+			if (!drawables[i]->CastShadow)
 				continue;
-			if (cf.IsBoxInFrustum(obj->Bounds))
-				drawableBuffer.Add(obj);
+			if (culler.IsVisible(transparent, i, frustumId))
+				drawableBuffer.Add(drawables[i]);
 		}
 	}
 
-	void LightingEnvironment::AddShadowPass(FrameRenderTask & tasks, WorldRenderPass * shadowRenderPass, DrawableSink * sink, ShadowMapResource & shadowMapRes, int shadowMapId,
-		StandardViewUniforms & shadowMapView, int & shadowMapViewInstancePtr)
+	void LightingEnvironment::AddShadowView(MultiFrustumCuller & culler, int shadowMapId, StandardViewUniforms & shadowMapView)
 	{
-		auto pass = shadowRenderPass->CreateInstance(shadowMapRes.shadowMapRenderOutputs[shadowMapId].Ptr(), true);
+		ShadowView view;
+		view.ShadowMapId = shadowMapId;
+		view.FrustumId = culler.AddFrustum(CullFrustum(shadowMapView.InvViewProjTransform));
+		view.View = shadowMapView;
+		shadowViews.Add(view);
+	}
 
-		ModuleInstance * shadowMapPassModuleInstance = nullptr;
+	ModuleInstance * LightingEnvironment::GetShadowViewInstance(int & shadowMapViewInstancePtr)
+	{
 		if (shadowMapViewInstancePtr < shadowViewInstances.Count())
+			return &shadowViewInstances[shadowMapViewInstancePtr++];
+		shadowViewInstances.Add(ModuleInstance());
+		sharedRes->CreateModuleInstance(shadowViewInstances.Last(), spEnvFindModule(sharedRes->sharedSpireEnvironment, "ForwardBasePassParams"), &sharedRes->transientUniformMemory);
+		shadowMapViewInstancePtr = shadowViewInstances.Count();
+		auto shadowMapPassModuleInstance = &shadowViewInstances.Last();
+		for (int j = 0; j < DynamicBufferLengthMultiplier; j++)
 		{
-			shadowMapPassModuleInstance = &shadowViewInstances[shadowMapViewInstancePtr++];
+			auto descSet = shadowMapPassModuleInstance->GetDescriptorSet(j);
+			descSet->BeginUpdate();
+			descSet->Update(1, sharedRes->textureSampler.Ptr());
+			descSet->EndUpdate();
 		}
-		else
+		return shadowMapPassModuleInstance;
+	}
+
+	int LightingEnvironment::AllocShadowMaps(ShadowMapResource & shadowMapRes, int count)
+	{
+		int id = shadowMapRes.AllocShadowMaps(count);
+		if (id == -1 && shadowMapCache.Count())
 		{
-			shadowViewInstances.Add(ModuleInstance());
-			sharedRes->CreateModuleInstance(shadowViewInstances.Last(), spEnvFindModule(sharedRes->sharedSpireEnvironment, "ForwardBasePassParams"), uniformMemory);
-			shadowMapViewInstancePtr = shadowViewInstances.Count();
-			shadowMapPassModuleInstance = &shadowViewInstances.Last();
-			for (int j = 0; j < DynamicBufferLengthMultiplier; j++)
+			ReleaseShadowMapCache();
+			id = shadowMapRes.AllocShadowMaps(count);
+		}
+		return id;
+	}
+
+	void LightingEnvironment::ReleaseShadowMapCache()
+	{
+		for (auto & entry : shadowMapCache)
+		{
+			if (entry.Layer != -1)
+				sharedRes->shadowMapResources.FreeShadowMaps(entry.Layer, 1);
+		}
+		shadowMapCache.Clear();
+	}
+
+	inline unsigned long long MixHash(unsigned long long x)
+	{
+		x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ull;
+		x ^= x >> 27; x *= 0x94d049bb133111ebull;
+		return x ^ (x >> 31);
+	}
+
+	int LightingEnvironment::GetShadowMapCacheLayer(ShadowMapResource & shadowMapRes, const ShadowView & view, int frameId, bool & layerValid)
+	{
+		// drawables count as static casters once their transform has stayed unchanged for a while. The hash
+		// of the static casters is a sum, so it does not depend on the order of the drawables, and covers
+		// their meshes, materials and last transform change, so moved, added and removed casters change it.
+		staticCasterBuffer.Clear();
+		dynamicCasterBuffer.Clear();
+		unsigned long long staticCasterHash = 0;
+		for (auto drawable : drawableBuffer)
+		{
+			if (drawable->GetType() == DrawableType::Static && frameId - drawable->GetTransformChangeFrame() >= StaticShadowCasterFrames)
 			{
-				auto descSet = shadowMapPassModuleInstance->GetDescriptorSet(j);
-				descSet->BeginUpdate();
-				descSet->Update(1, sharedRes->textureSampler.Ptr());
-				descSet->EndUpdate();
+				staticCasterBuffer.Add(drawable);
+				auto hash = MixHash((unsigned long long)(CoreLib::PtrInt)drawable);
+				hash = MixHash(hash ^ (unsigned long long)(CoreLib::PtrInt)drawable->GetMesh());
+				hash = MixHash(hash ^ (unsigned long long)(CoreLib::PtrInt)drawable->GetMaterial());
+				staticCasterHash += MixHash(hash ^ (unsigned int)drawable->GetTransformChangeFrame());
 			}
+			else
+				dynamicCasterBuffer.Add(drawable);
 		}
-		shadowMapPassModuleInstance->SetUniformData(&shadowMapView, sizeof(shadowMapView));
-		sharedRes->pipelineManager.PushModuleInstance(shadowMapPassModuleInstance);
-		drawableBuffer.Clear();
-		auto cullFrustum = CullFrustum(shadowMapView.InvViewProjTransform);
-		GetDrawable(drawableBuffer, sink, true, cullFrustum);
-		GetDrawable(drawableBuffer, sink, false, cullFrustum);
-		pass->SetDrawContent(sharedRes->pipelineManager, reorderBuffer, drawableBuffer.GetArrayView());
-		sharedRes->pipelineManager.PopModuleInstance();
-		tasks.AddTask(pass);
+		while (shadowMapCache.Count() <= view.ShadowMapId)
+			shadowMapCache.Add(ShadowMapCacheEntry());
+		auto & entry = shadowMapCache[view.ShadowMapId];
+		bool unchanged = entry.LastFrame != -1 && entry.LastFrame == frameId - 1 && entry.StaticCasterHash == staticCasterHash &&
+			memcmp(&entry.ViewProjection, &view.View.ViewProjectionTransform, sizeof(Matrix4)) == 0;
+		entry.ViewProjection = view.View.ViewProjectionTransform;
+		entry.StaticCasterHash = staticCasterHash;
+		entry.LastFrame = frameId;
+		if (!unchanged)
+		{
+			// a view that changes every frame (e.g. a moving light) is cheaper to draw without cache,
+			// so it is only cached once it stays unchanged for a frame
+			if (entry.Layer != -1)
+				shadowMapRes.FreeShadowMaps(entry.Layer, 1);
+			entry.Layer = -1;
+			entry.LayerValid = false;
+			return -1;
+		}
+		if (entry.Layer == -1)
+		{
+			entry.Layer = shadowMapRes.AllocPersistentShadowMaps(1);
+			if (entry.Layer == -1)
+				return -1;
+		}
+		layerValid = entry.LayerValid;
+		entry.LayerValid = true;
+		return entry.Layer;
 	}
 
-	void LightingEnvironment::GatherInfo(FrameRenderTask & tasks, DrawableSink * sink, const RenderProcedureParameters & params, int w, int h, StandardViewUniforms & viewUniform, WorldRenderPass * shadowRenderPass)
+	void LightingEnvironment::GatherInfo(MultiFrustumCuller & culler, const RenderProcedureParameters & params, int w, int h, StandardViewUniforms & viewUniform)
 	{
 		auto renderer = params.renderer;
 		auto level = params.level;
 
 		lightProbes.Clear();
 		lights.Clear();
+		shadowViews.Clear();
 		uniformData.sunLightEnabled = false;
-		auto shadowMapRes = renderer->GetSharedResource()->shadowMapResources;
+		auto & shadowMapRes = renderer->GetSharedResource()->shadowMapResources;
 		shadowMapRes.Reset();
+		useShadowMapCache = params.useShadowMapCache;
+		if (!useShadowMapCache)
+			ReleaseShadowMapCache();
 		CoreLib::Graphics::BBox levelBounds;
 		levelBounds.Min = Vec3::Create(-10.0f);
 		levelBounds.Max = Vec3::Create(10.0f);
+		levelBounds.Union(level->GetCullingTree().GetBounds());
 		DirectionalLightActor * sunlight = nullptr;
-		for (auto & actor : level->Actors)
+		// directional lights are shaded everywhere and come first, the following lights are binned
+		int directionalLightCount = 0;
+		// actors that are not culled do not contribute to the culling tree bounds
+		for (auto actor : level->GetCullingTree().GetUnculledActors())
+			levelBounds.Union(actor->Bounds);
+		for (auto actor : level->GetActorsOfType(EngineActorType::Light))
 		{
-			levelBounds.Union(actor.Value->Bounds);
-			auto actorType = actor.Value->GetEngineType();
-			if (actorType == EngineActorType::Light)
+			auto light = static_cast<LightActor*>(actor);
+			if (light->lightType == LightType::Directional)
 			{
-				auto light = dynamic_cast<LightActor*>(actor.Value.Ptr());
-				if (light->lightType == LightType::Directional)
+				auto dirLight = (DirectionalLightActor*)(light);
+				GpuLightData lightData;
+				lightData.lightType = GpuLightType_Directional;
+				lightData.color = dirLight->Color.GetValue();
+				lightData.direction = PackDirection(dirLight->GetDirection());
+				auto localTransform = dirLight->GetLocalTransform();
+				lightData.position = Vec3::Create(localTransform.values[12], localTransform.values[13], localTransform.values[14]);
+				lightData.radius = 0.0f;
+				lightData.startAngle = lightData.endAngle = 0.0f;
+				lightData.shaderMapId = 0xFFFF;
+				lightData.decay = 0.0f;
+				if (dirLight->EnableCascadedShadows && !uniformData.sunLightEnabled)
 				{
-					auto dirLight = (DirectionalLightActor*)(light);
-					GpuLightData lightData;
-					lightData.lightType = GpuLightType_Directional;
-					lightData.color = dirLight->Color.GetValue();
-					lightData.direction = PackDirection(dirLight->GetDirection());
-					auto localTransform = dirLight->GetLocalTransform();
-					lightData.position = Vec3::Create(localTransform.values[12], localTransform.values[13], localTransform.values[14]);
-					lightData.radius = 0.0f;
-					lightData.startAngle = lightData.endAngle = 0.0f;
-					lightData.shaderMapId = 0xFFFF;
-					lightData.decay = 0.0f;
-					if (dirLight->EnableCascadedShadows && !uniformData.sunLightEnabled)
-					{
-						uniformData.sunLightEnabled = true;
-						sunlight = dirLight;
-						uniformData.lightColor = lightData.color;
-						uniformData.lightDir = dirLight->GetDirection();
-						
-					}
-					else
-					{
-						lights.Add(lightData);
-					}
+					uniformData.sunLightEnabled = true;
+					sunlight = dirLight;
+					uniformData.lightColor = lightData.color;
+					uniformData.lightDir = dirLight->GetDirection();
+					
 				}
-				else if (light->lightType == LightType::Point)
+				else
 				{
-					auto pointLight = (PointLightActor*)(light);
-					GpuLightData lightData;
-					lightData.lightType = pointLight->IsSpotLight ? GpuLightType_Spot: GpuLightType_Point;
-					lightData.color = pointLight->Color.GetValue();
-					lightData.direction = PackDirection(pointLight->GetDirection());
-					auto localTransform = pointLight->GetLocalTransform();
-					lightData.position = Vec3::Create(localTransform.values[12], localTransform.values[13], localTransform.values[14]);
-					lightData.radius = pointLight->Radius.GetValue();
-					lightData.startAngle = pointLight->SpotLightStartAngle.GetValue() * (Math::Pi / 180.0f * 0.5f);
-					lightData.endAngle = pointLight->SpotLightEndAngle.GetValue() * (Math::Pi / 180.0f * 0.5f);
-					lightData.shaderMapId = 0xFFFF;
-					if (pointLight->EnableShadows.GetValue())
-						lightData.shaderMapId = (unsigned short)shadowMapRes.AllocShadowMaps(1);
-					if (lightData.shaderMapId == -1)
-					{
-						lightData.shaderMapId = 0xFFFF;
-						Engine::Print("Cannot allocate shadow map for light '%s', out of resource limit!", light->Name.GetValue().Buffer());
-					}
-					lightData.decay = 10.0f / (pointLight->DecayDistance90Percent.GetValue() * pointLight->DecayDistance90Percent.GetValue());
-					lights.Add(lightData);
+					lights.Insert(directionalLightCount++, lightData);
 				}
-                else if (light->lightType == LightType::Ambient)
-                {
-                    auto ambientLight = (AmbientLightActor*)(light);
-                    uniformData.ambient = ambientLight->Ambient.GetValue();
-                }
 			}
-			else if (actorType == EngineActorType::EnvMap)
+			else if (light->lightType == LightType::Point)
 			{
-				auto envMap = (EnvMapActor*)(actor.Value.Ptr());
-				if (envMap->GetEnvMapId() != -1)
+				auto pointLight = (PointLightActor*)(light);
+				GpuLightData lightData;
+				lightData.lightType = pointLight->IsSpotLight ? GpuLightType_Spot: GpuLightType_Point;
+				lightData.color = pointLight->Color.GetValue();
+				lightData.direction = PackDirection(pointLight->GetDirection());
+				auto localTransform = pointLight->GetLocalTransform();
+				lightData.position = Vec3::Create(localTransform.values[12], localTransform.values[13], localTransform.values[14]);
+				lightData.radius = pointLight->Radius.GetValue();
+				lightData.startAngle = pointLight->SpotLightStartAngle.GetValue() * (Math::Pi / 180.0f * 0.5f);
+				lightData.endAngle = pointLight->SpotLightEndAngle.GetValue() * (Math::Pi / 180.0f * 0.5f);
+				lightData.shaderMapId = 0xFFFF;
+				if (pointLight->EnableShadows.GetValue())
+					lightData.shaderMapId = (unsigned short)AllocShadowMaps(shadowMapRes, 1);
+				if (lightData.shaderMapId == -1)
 				{
-					GpuLightProbeData probe;
-					probe.position = envMap->GetPosition();
-					probe.radius = envMap->Radius.GetValue();
-					probe.tintColor = envMap->TintColor.GetValue();
-					probe.envMapId = envMap->GetEnvMapId();
-					lightProbes.Add(probe);
+					lightData.shaderMapId = 0xFFFF;
+					Engine::Print("Cannot allocate shadow map for light '%s', out of resource limit!", light->Name.GetValue().Buffer());
 				}
+				lightData.decay = 10.0f / (pointLight->DecayDistance90Percent.GetValue() * pointLight->DecayDistance90Percent.GetValue());
+				lights.Add(lightData);
+			}
+            else if (light->lightType == LightType::Ambient)
+            {
+                auto ambientLight = (AmbientLightActor*)(light);
+                uniformData.ambient = ambientLight->Ambient.GetValue();
+            }
+		}
+		for (auto actor : level->GetActorsOfType(EngineActorType::EnvMap))
+		{
+			auto envMap = static_cast<EnvMapActor*>(actor);
+			if (envMap->GetEnvMapId() != -1)
+			{
+				GpuLightProbeData probe;
+				probe.position = envMap->GetPosition();
+				probe.radius = envMap->Radius.GetValue();
+				probe.tintColor = envMap->TintColor.GetValue();
+				probe.envMapId = envMap->GetEnvMapId();
+				lightProbes.Add(probe);
 			}
 		}
 		if (lightProbes.Count() == 0)
@@ -176,18 +255,15 @@ namespace GameEngine
 			probe.envMapId = 0;
 			lightProbes.Add(probe);
 		}
-		tasks.AddImageTransferTask(MakeArrayView(dynamic_cast<Texture*>(shadowMapRes.shadowMapArray.Ptr())), ArrayView<Texture*>());
 		float zmin = params.view.ZNear;
-		int shadowMapViewInstancePtr = 0;
 		int shadowMapSize = Engine::Instance()->GetGraphicsSettings().ShadowMapResolution;
 		float aspect = w / (float)h;
 		auto camFrustum = params.view.GetFrustum(aspect);
 
-		// generate cascaded shadow map passes for sunlight
-		shadowRenderPass->Bind();
+		// generate cascaded shadow map views for sunlight
 		if (uniformData.sunLightEnabled)
 		{
-			int shadowMapStartId = shadowMapRes.AllocShadowMaps(sunlight->NumShadowCascades.GetValue());
+			int shadowMapStartId = AllocShadowMaps(shadowMapRes, sunlight->NumShadowCascades.GetValue());
 			uniformData.shadowMapId = shadowMapStartId;
 			if (shadowMapStartId != -1)
 			{
@@ -262,11 +338,11 @@ namespace GameEngine
 					viewportMatrix.m[1][1] = 0.5f; viewportMatrix.m[3][1] = 0.5f;
 					viewportMatrix.m[2][2] = 1.0f; viewportMatrix.m[3][2] = 0.0f;
 					Matrix4::Multiply(uniformData.lightMatrix[i], viewportMatrix, shadowMapView.ViewProjectionTransform);
-					AddShadowPass(tasks, shadowRenderPass, sink, shadowMapRes, i + shadowMapStartId, shadowMapView, shadowMapViewInstancePtr);
+					AddShadowView(culler, i + shadowMapStartId, shadowMapView);
 				}
 			}
 		}
-		// generate shadow map passes for spot lights
+		// generate shadow map views for spot lights
 		for (auto & light : lights)
 		{
 			if (light.shaderMapId != 0xFFFF)
@@ -300,20 +376,114 @@ namespace GameEngine
 				viewportMatrix.m[1][1] = 0.5f; viewportMatrix.m[3][1] = 0.5f;
 				viewportMatrix.m[2][2] = 1.0f; viewportMatrix.m[3][2] = 0.0f;
 				Matrix4::Multiply(light.lightMatrix, viewportMatrix, shadowMapView.ViewProjectionTransform);
-				AddShadowPass(tasks, shadowRenderPass, sink, shadowMapRes, light.shaderMapId, shadowMapView, shadowMapViewInstancePtr);
+				AddShadowView(culler, light.shaderMapId, shadowMapView);
 			}
 		}
-		tasks.AddImageTransferTask(ArrayView<Texture*>(), MakeArrayView(dynamic_cast<Texture*>(shadowMapRes.shadowMapArray.Ptr())));
+		if (lights.Count() > MaxLights)
+		{
+			static bool lightLimitReported = false;
+			if (!lightLimitReported)
+			{
+				Engine::Print("too many lights, only the first %d lights are shaded.\n", MaxLights);
+				lightLimitReported = true;
+			}
+			lights.SetSize(MaxLights);
+		}
 		uniformData.lightCount = lights.Count();
 		uniformData.lightProbeCount = lightProbes.Count();
+		uniformData.directionalLightCount = Math::Min(directionalLightCount, lights.Count());
+		LightBinningPass::GetDepthSliceParams(params.view.ZNear, params.view.ZFar, uniformData.clusterDepthScale, uniformData.clusterDepthBias);
 
 		moduleInstance.SetUniformData(&uniformData, sizeof(uniformData));
 		auto lightPtr = (GpuLightData*)((char*)lightBufferPtr + moduleInstance.GetCurrentVersion() * lightBufferSize);
 		memcpy(lightPtr, lights.Buffer(), lights.Count() * sizeof(GpuLightData));
+		{
+			PROFILE_ZONE("BinLights");
+			auto clusterPtr = (unsigned int*)((char*)lightClusterBufferPtr + moduleInstance.GetCurrentVersion() * lightClusterBufferSize);
+			auto indexPtr = (unsigned short*)((char*)lightIndexBufferPtr + moduleInstance.GetCurrentVersion() * lightIndexBufferSize);
+			int indexCount = lightBinning.Execute(viewUniform, params.view.ZNear, params.view.ZFar, lights.GetArrayView(), uniformData.directionalLightCount,
+				clusterPtr, indexPtr);
+			if (indexCount == MaxClusterLightIndices)
+			{
+				static bool overflowReported = false;
+				if (!overflowReported)
+				{
+					Engine::Print("light cluster index buffer is full, some lights are not shaded.\n");
+					overflowReported = true;
+				}
+			}
+		}
 		auto lightProbePtr = (GpuLightProbeData*)((char*)lightProbeBufferPtr + moduleInstance.GetCurrentVersion() * lightProbeBufferSize);
 		memcpy(lightProbePtr, lightProbes.Buffer(), Math::Min(MaxEnvMapCount, lightProbes.Count()) * sizeof(GpuLightProbeData));
 	}
 
+	void LightingEnvironment::AddShadowPasses(FrameRenderTask & tasks, WorldRenderPass * shadowRenderPass, DrawableSink * sink, MultiFrustumCuller & culler)
+	{
+		auto & shadowMapRes = sharedRes->shadowMapResources;
+		int shadowMapViewInstancePtr = 0;
+		int frameId = Engine::Instance()->GetFrameId();
+		tasks.AddImageTransferTask(MakeArrayView(dynamic_cast<Texture*>(shadowMapRes.shadowMapArray.Ptr())), ArrayView<Texture*>());
+		shadowRenderPass->Bind();
+		// the static casters of new cache layers are drawn first, then the cache layers are copied to
+		// their shadow maps, and the remaining casters are drawn on top
+		shadowPassTasks.Clear();
+		cacheCopySrcLayers.Clear();
+		cacheCopyDstLayers.Clear();
+		for (auto & view : shadowViews)
+		{
+			auto shadowMapPassModuleInstance = GetShadowViewInstance(shadowMapViewInstancePtr);
+			shadowMapPassModuleInstance->SetUniformData(&view.View, sizeof(view.View));
+			sharedRes->pipelineManager.PushModuleInstance(shadowMapPassModuleInstance);
+			drawableBuffer.Clear();
+			GetDrawable(drawableBuffer, sink, true, culler, view.FrustumId);
+			GetDrawable(drawableBuffer, sink, false, culler, view.FrustumId);
+			auto viewOrigin = Vec3::Create(view.View.InvViewTransform.values[12], view.View.InvViewTransform.values[13], view.View.InvViewTransform.values[14]);
+			bool cacheLayerValid = false;
+			int cacheLayer = useShadowMapCache ? GetShadowMapCacheLayer(shadowMapRes, view, frameId, cacheLayerValid) : -1;
+			auto casters = drawableBuffer.GetArrayView();
+			if (cacheLayer != -1)
+			{
+				if (!cacheLayerValid)
+				{
+					auto cachePass = shadowRenderPass->CreateInstance(shadowMapRes.shadowMapRenderOutputs[cacheLayer].Ptr(), true);
+					cachePass->SetDrawContent(sharedRes->pipelineManager, reorderBuffer, staticCasterBuffer.GetArrayView(), DrawOrder::StateSorted, viewOrigin);
+					tasks.AddTask(cachePass);
+				}
+				cacheCopySrcLayers.Add(cacheLayer);
+				cacheCopyDstLayers.Add(view.ShadowMapId);
+				casters = dynamicCasterBuffer.GetArrayView();
+			}
+			if (cacheLayer == -1 || casters.Count())
+			{
+				auto pass = shadowRenderPass->CreateInstance(shadowMapRes.shadowMapRenderOutputs[view.ShadowMapId].Ptr(), cacheLayer == -1);
+				pass->SetDrawContent(sharedRes->pipelineManager, reorderBuffer, casters, DrawOrder::StateSorted, viewOrigin);
+				shadowPassTasks.Add(pass);
+			}
+			sharedRes->pipelineManager.PopModuleInstance();
+		}
+		// layers of shadow maps that are no longer drawn
+		for (auto & entry : shadowMapCache)
+		{
+			if (entry.LastFrame != frameId && entry.Layer != -1)
+			{
+				shadowMapRes.FreeShadowMaps(entry.Layer, 1);
+				entry.Layer = -1;
+				entry.LayerValid = false;
+			}
+		}
+		if (cacheCopySrcLayers.Count())
+			tasks.AddTextureLayerCopyTask(shadowMapRes.shadowMapArray.Ptr(), cacheCopyDstLayers.GetArrayView(), cacheCopySrcLayers.GetArrayView(), TextureLayout::DepthStencilAttachment);
+		for (auto & pass : shadowPassTasks)
+			tasks.AddTask(pass);
+		shadowPassTasks.Clear();
+		tasks.AddImageTransferTask(ArrayView<Texture*>(), MakeArrayView(dynamic_cast<Texture*>(shadowMapRes.shadowMapArray.Ptr())));
+	}
+
+	LightingEnvironment::~LightingEnvironment()
+	{
+		if (sharedRes)
+			ReleaseShadowMapCache();
+	}
 
 	void LightingEnvironment::Init(RendererSharedResource & pSharedRes, DeviceMemory * pUniformMemory, bool pUseEnvMap)
 	{
@@ -327,6 +497,10 @@ namespace GameEngine
 		lightBuffer = sharedRes->hardwareRenderer->CreateMappedBuffer(GameEngine::BufferUsage::StorageBuffer, lightBufferSize * DynamicBufferLengthMultiplier);
 		lightProbeBufferSize = Math::RoundUpToAlignment((int)sizeof(GpuLightProbeData) * MaxEnvMapCount, sharedRes->hardwareRenderer->UniformBufferAlignment());
 		lightProbeBuffer = sharedRes->hardwareRenderer->CreateMappedBuffer(GameEngine::BufferUsage::StorageBuffer, lightProbeBufferSize * DynamicBufferLengthMultiplier);
+		lightClusterBufferSize = Math::RoundUpToAlignment((int)sizeof(unsigned int) * LightClusterTilesX * LightClusterTilesY * LightClusterSlices, sharedRes->hardwareRenderer->UniformBufferAlignment());
+		lightClusterBuffer = sharedRes->hardwareRenderer->CreateMappedBuffer(GameEngine::BufferUsage::StorageBuffer, lightClusterBufferSize * DynamicBufferLengthMultiplier);
+		lightIndexBufferSize = Math::RoundUpToAlignment((int)sizeof(unsigned short) * MaxClusterLightIndices, sharedRes->hardwareRenderer->UniformBufferAlignment());
+		lightIndexBuffer = sharedRes->hardwareRenderer->CreateMappedBuffer(GameEngine::BufferUsage::StorageBuffer, lightIndexBufferSize * DynamicBufferLengthMultiplier);
 		for (int i = 0; i < DynamicBufferLengthMultiplier; i++)
 		{
 			auto descSet = moduleInstance.GetDescriptorSet(i);
@@ -340,11 +514,14 @@ namespace GameEngine
 				descSet->Update(6, sharedRes->envMapArray.Ptr(), TextureAspect::Color);
 			else
 				descSet->Update(6, emptyEnvMapArray.Ptr(), TextureAspect::Color);
-
+			descSet->Update(7, lightClusterBuffer.Ptr(), lightClusterBufferSize * i, lightClusterBufferSize);
+			descSet->Update(8, lightIndexBuffer.Ptr(), lightIndexBufferSize * i, lightIndexBufferSize);
 			descSet->EndUpdate();
 		}
 		lightBufferPtr = lightBuffer->Map();
 		lightProbeBufferPtr = lightProbeBuffer->Map();
+		lightClusterBufferPtr = lightClusterBuffer->Map();
+		lightIndexBufferPtr = lightIndexBuffer->Map();
 	}
 
 	void LightingEnvironment::UpdateSharedResourceBinding()
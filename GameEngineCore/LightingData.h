@@ -8,6 +8,8 @@
 #include "Level.h"
 #include "RenderProcedure.h"
 #include "StandardViewUniforms.h"
+#include "FrustumCulling.h"
+#include "LightBinningPass.h"
 
 namespace GameEngine
 {
@@ -29,6 +31,9 @@ namespace GameEngine
 		VectorMath::Matrix4 lightMatrix;
 	};
 
+	VectorMath::Vec3 UnpackDirection(unsigned int dir);
+	unsigned int PackDirection(VectorMath::Vec3 dir);
+
 	struct GpuLightProbeData
 	{
 		VectorMath::Vec3 position;
@@ -43,11 +48,15 @@ namespace GameEngine
 		VectorMath::Vec3 lightDir; int sunLightEnabled = 0;
 		int shadowMapId = -1;
 		int numCascades = 0;
-		int lightCount = 0, lightProbeCount = 0;
+		int lightCount = 0, lightProbeCount = 0; // lights starts with the directional lights
 		VectorMath::Matrix4 lightMatrix[MaxShadowCascades];
 		float zPlanes[MaxShadowCascades];
 		VectorMath::Vec3 ambient = VectorMath::Vec3::Create(0.2f);
         float padding1;
+		int directionalLightCount = 0;
+		int clusterTilesX = LightClusterTilesX, clusterTilesY = LightClusterTilesY, clusterSlices = LightClusterSlices;
+		float clusterDepthScale = 1.0f, clusterDepthBias = 0.0f; // see LightBinningPass::GetDepthSliceParams
+		float padding2[2];
 	};
 
 	class LightingEnvironment
@@ -55,8 +64,36 @@ namespace GameEngine
 	private:
 		bool useEnvMap = true;
 		CoreLib::RefPtr<TextureCubeArray> emptyEnvMapArray;
-		void AddShadowPass(FrameRenderTask & tasks, WorldRenderPass * shadowRenderPass, DrawableSink * sink, ShadowMapResource & shadowMapRes, int shadowMapId,
-			StandardViewUniforms & shadowMapView, int & shadowMapViewInstancePtr);
+		struct ShadowView
+		{
+			StandardViewUniforms View;
+			int ShadowMapId;
+			int FrustumId;
+		};
+		CoreLib::List<ShadowView> shadowViews;
+		// The static casters of a shadow map, drawn into a persistent layer of the shadow map array.
+		// While the view and its static casters stay unchanged, the layer is copied to the shadow map
+		// each frame and only the other casters are drawn on top of it.
+		struct ShadowMapCacheEntry
+		{
+			VectorMath::Matrix4 ViewProjection;
+			unsigned long long StaticCasterHash = 0;
+			int Layer = -1;
+			bool LayerValid = false;
+			int LastFrame = -1; // frame of the last shadow view using the entry
+		};
+		bool useShadowMapCache = false;
+		CoreLib::List<ShadowMapCacheEntry> shadowMapCache; // indexed by shadow map id
+		CoreLib::List<int> cacheCopySrcLayers, cacheCopyDstLayers;
+		CoreLib::List<CoreLib::RefPtr<WorldPassRenderTask>> shadowPassTasks;
+		void AddShadowView(MultiFrustumCuller & culler, int shadowMapId, StandardViewUniforms & shadowMapView);
+		ModuleInstance * GetShadowViewInstance(int & shadowMapViewInstancePtr);
+		// allocates from the shadow maps not held by the cache, releasing the cache if they do not suffice
+		int AllocShadowMaps(ShadowMapResource & shadowMapRes, int count);
+		// returns the cache layer for the static casters of view, or -1 if the view is drawn without cache;
+		// splits drawableBuffer into staticCasterBuffer and dynamicCasterBuffer
+		int GetShadowMapCacheLayer(ShadowMapResource & shadowMapRes, const ShadowView & view, int frameId, bool & layerValid);
+		void ReleaseShadowMapCache();
 	public:
 		DeviceMemory * uniformMemory;
 		ModuleInstance moduleInstance;
@@ -64,14 +101,21 @@ namespace GameEngine
 		CoreLib::List<GpuLightProbeData> lightProbes;
 		CoreLib::List<Texture*> lightProbeTextures;
 		CoreLib::List<CoreLib::RefPtr<Texture2D>> shadowMaps;
-		CoreLib::RefPtr<Buffer> lightBuffer, lightProbeBuffer;
+		CoreLib::RefPtr<Buffer> lightBuffer, lightProbeBuffer, lightClusterBuffer, lightIndexBuffer;
+		LightBinningPass lightBinning;
 		CoreLib::List<ModuleInstance> shadowViewInstances;
-		CoreLib::List<Drawable*> drawableBuffer, reorderBuffer;
-		RendererSharedResource * sharedRes;
-		void* lightBufferPtr, *lightProbeBufferPtr;
-		int lightBufferSize, lightProbeBufferSize;
+		CoreLib::List<Drawable*> drawableBuffer, reorderBuffer, staticCasterBuffer, dynamicCasterBuffer;
+		RendererSharedResource * sharedRes = nullptr;
+		void* lightBufferPtr, *lightProbeBufferPtr, *lightClusterBufferPtr, *lightIndexBufferPtr;
+		int lightBufferSize, lightProbeBufferSize, lightClusterBufferSize, lightIndexBufferSize;
 		LightingUniform uniformData;
-		void GatherInfo(FrameRenderTask & tasks, DrawableSink * sink, const RenderProcedureParameters & params, int w, int h, StandardViewUniforms & cameraView, WorldRenderPass * shadowPass);
+		// collects the lights of the level, bins the point and spot lights into the clusters of
+		// the view and adds a frustum to culler for every shadow view
+		void GatherInfo(MultiFrustumCuller & culler, const RenderProcedureParameters & params, int w, int h, StandardViewUniforms & cameraView);
+		// records the shadow passes of the gathered shadow views, culler must have culled sink
+		// and the drawable transforms must be updated
+		void AddShadowPasses(FrameRenderTask & tasks, WorldRenderPass * shadowPass, DrawableSink * sink, MultiFrustumCuller & culler);
+		~LightingEnvironment();
 		void Init(RendererSharedResource & sharedRes, DeviceMemory * uniformMemory, bool pUseEnvMap);
 		void UpdateSharedResourceBinding();
 	};
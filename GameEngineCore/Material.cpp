@@ -1,13 +1,14 @@
 #include "Material.h"
 #include "CoreLib/LibIO.h"
+#include <atomic>
 
 namespace GameEngine
 {
 	Material::Material()
 	{
-		static int idAlloc = 0;
-		Id = idAlloc;
-		idAlloc++;
+		// materials are also created on streaming threads
+		static std::atomic<int> idAlloc(0);
+		Id = idAlloc++;
 	}
 
 	void Material::SetVariable(CoreLib::String name, DynamicVariable value)
@@ -8,7 +8,7 @@ using namespace VectorMath;
 
 namespace GameEngine
 {
-	int Mesh::uid = 0;
+	std::atomic<int> Mesh::uid(0);
 	void Mesh::LoadFromFile(const CoreLib::Basic::String & pfileName)
 	{
 		RefPtr<FileStream> stream = new FileStream(pfileName);
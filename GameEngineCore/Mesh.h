@@ -7,6 +7,7 @@
 #include "CoreLib/LibIO.h"
 #include "Spire/Spire.h"
 #include <assert.h>
+#include <atomic>
 
 namespace GameEngine
 {
@@ -95,7 +96,7 @@ namespace GameEngine
 	class Mesh : public CoreLib::Object 
 	{
 	private:
-		static int uid;
+		static std::atomic<int> uid; // meshes are also created on resource streaming threads
 		MeshVertexFormat vertexFormat;
 		CoreLib::Basic::List<unsigned char> vertexData;
 		int vertCount = 0;
@@ -32,6 +32,14 @@ namespace GameEngine
 		LoadFromString(level, File::ReadAllText(fileName));
 	}
 	void Model::LoadFromString(Level * level, CoreLib::String content)
+	{
+		List<String> errors;
+		LoadGeometryFromString(content, errors);
+		for (auto & error : errors)
+			Print("error: %S\n", error.ToWString());
+		ResolveMaterials(level);
+	}
+	void Model::LoadGeometryFromString(CoreLib::String content, CoreLib::List<CoreLib::String> & errors)
 	{
 		materials.Clear();
 		materialFileNames.Clear();
@@ -52,7 +60,7 @@ namespace GameEngine
 				}
 				else
 				{
-					Print("error: cannot load mesh \'%S\'\n", meshFileName.ToWString());
+					errors.Add("cannot load mesh '" + meshFileName + "'");
 				}
 			}
 			else if (word == "skeleton")
@@ -65,20 +73,24 @@ namespace GameEngine
 				}
 				else
 				{
-					Print("error: cannot load skeleton \'%S\'\n", skeletonFileName.ToWString());
+					errors.Add("cannot load skeleton '" + skeletonFileName + "'");
 				}
 			}
 			else if (word == "material")
 			{
-				auto materialFileName = parser.ReadStringLiteral();
-				materialFileNames.Add(materialFileName);
-				materials.Add(level->LoadMaterial(materialFileName));
+				materialFileNames.Add(parser.ReadStringLiteral());
 			}
 		}
 		parser.Read("}");
+		InitPhysicsModel();
+	}
+	void Model::ResolveMaterials(Level * level)
+	{
+		materials.Clear();
+		for (auto & materialFileName : materialFileNames)
+			materials.Add(level->LoadMaterial(materialFileName));
 		for (int i = materials.Count(); i < mesh.ElementRanges.Count(); i++)
 			materials.Add(level->LoadMaterial("Error.material"));
-		InitPhysicsModel();
 	}
 	void Model::SaveToFile(CoreLib::String fileName)
 	{
@@ -182,10 +194,21 @@ namespace GameEngine
 		for (auto & drawable : Drawables)
 			drawable->UpdateTransformUniform(localTransform);
 	}
-	void ModelDrawableInstance::UpdateTransformUniform(VectorMath::Matrix4 localTransform, Pose & pose, RetargetFile * retargetFile)
+	void ModelDrawableInstance::UpdateTransformUniform(VectorMath::Matrix4 localTransform, Pose & pose, RetargetFile * retargetFile, bool keepCopy)
 	{
 		for (auto & drawable : Drawables)
-			drawable->UpdateTransformUniform(localTransform, pose, retargetFile);
+			drawable->UpdateTransformUniform(localTransform, pose, retargetFile, keepCopy);
+	}
+	bool ModelDrawableInstance::ReuseTransformUniform(VectorMath::Matrix4 localTransform)
+	{
+		// nothing is written unless every drawable can reuse its pose, since each write advances the drawable's
+		// uniform ring and the caller falls back to a full update that would advance it a second time this frame
+		for (auto & drawable : Drawables)
+			if (!drawable->CanReuseTransformUniform())
+				return false;
+		for (auto & drawable : Drawables)
+			drawable->ReuseTransformUniform(localTransform);
+		return true;
 	}
 	void ModelPhysicsInstance::SetTransform(VectorMath::Matrix4 localTransform)
 	{
@@ -22,7 +22,9 @@ namespace GameEngine
 			return Drawables.Count() == 0;
 		}
 		void UpdateTransformUniform(VectorMath::Matrix4 localTransform);
-		void UpdateTransformUniform(VectorMath::Matrix4 localTransform, Pose & pose, RetargetFile * retargetFile);
+		void UpdateTransformUniform(VectorMath::Matrix4 localTransform, Pose & pose, RetargetFile * retargetFile, bool keepCopy = false);
+		// see Drawable::ReuseTransformUniform, returns false without updating any drawable if one of them has no copy of its last pose
+		bool ReuseTransformUniform(VectorMath::Matrix4 localTransform);
 	};
 
 	class ModelPhysicsInstance
@@ -47,7 +49,7 @@ namespace GameEngine
 		}
 	};
 
-	class Model : public CoreLib::RefObject
+	class Model : public CoreLib::ThreadSafeRefObject
 	{
 	private:
 		Mesh mesh;
@@ -64,6 +66,14 @@ namespace GameEngine
 
 		void LoadFromFile(Level * level, CoreLib::String fileName);
 		void LoadFromString(Level * level, CoreLib::String content);
+		// Parses a model file and loads its mesh and skeleton without touching the level, so that it can
+		// run on a streaming thread. Materials are resolved by a ResolveMaterials call on the main thread.
+		void LoadGeometryFromString(CoreLib::String content, CoreLib::List<CoreLib::String> & errors);
+		void ResolveMaterials(Level * level);
+		const CoreLib::List<CoreLib::String> & GetMaterialFileNames()
+		{
+			return materialFileNames;
+		}
 		void SaveToFile(CoreLib::String fileName);
 		CoreLib::Graphics::BBox GetBounds()
 		{
@@ -0,0 +1,573 @@
+#include "../HardwareRenderer.h"
+#include "../Spire/Spire.h"
+
+using namespace GameEngine;
+using namespace CoreLib;
+
+// A HardwareRenderer that executes nothing. Buffers live in CPU memory so that the engine can map and
+// update them as usual, texture contents are not retained, and submitted commands are only counted.
+// It allows the CPU side of the renderer to be run and profiled on machines without a GPU.
+namespace NullAPI
+{
+	class Buffer : public GameEngine::Buffer
+	{
+	private:
+		List<unsigned char> data;
+	public:
+		Buffer(int size)
+		{
+			data.SetSize(size);
+			memset(data.Buffer(), 0, size);
+		}
+		virtual void SetDataAsync(int offset, void * srcData, int size) override
+		{
+			SetData(offset, srcData, size);
+		}
+		virtual void SetData(int offset, void * srcData, int size) override
+		{
+			memcpy(data.Buffer() + offset, srcData, size);
+		}
+		virtual void SetData(void * srcData, int size) override
+		{
+			SetData(0, srcData, size);
+		}
+		virtual void GetData(void * buffer, int offset, int size) override
+		{
+			memcpy(buffer, data.Buffer() + offset, size);
+		}
+		virtual int GetSize() override
+		{
+			return data.Count();
+		}
+		virtual void * Map(int offset, int /*size*/) override
+		{
+			return data.Buffer() + offset;
+		}
+		virtual void * Map() override
+		{
+			return data.Buffer();
+		}
+		virtual void Flush(int /*offset*/, int /*size*/) override
+		{
+		}
+		virtual void Flush() override
+		{
+		}
+		virtual void Unmap() override
+		{
+		}
+	};
+
+	class Texture2D : public GameEngine::Texture2D
+	{
+	private:
+		int width, height;
+	public:
+		Texture2D(int w, int h)
+			: width(w), height(h)
+		{
+		}
+		virtual void SetCurrentLayout(TextureLayout /*layout*/) override
+		{
+		}
+		virtual void GetSize(int & w, int & h) override
+		{
+			w = width;
+			h = height;
+		}
+		virtual void SetData(int /*level*/, int /*width*/, int /*height*/, int /*samples*/, DataType /*inputType*/, void * /*data*/) override
+		{
+		}
+		virtual void SetData(int /*width*/, int /*height*/, int /*samples*/, DataType /*inputType*/, void * /*data*/) override
+		{
+		}
+		virtual void GetData(int /*mipLevel*/, void * data, int bufSize) override
+		{
+			memset(data, 0, bufSize);
+		}
+		virtual void BuildMipmaps() override
+		{
+		}
+	};
+
+	class Texture2DArray : public GameEngine::Texture2DArray
+	{
+	private:
+		int width, height, layers;
+	public:
+		Texture2DArray(int w, int h, int l)
+			: width(w), height(h), layers(l)
+		{
+		}
+		virtual void SetCurrentLayout(TextureLayout /*layout*/) override
+		{
+		}
+		virtual void GetSize(int & w, int & h, int & l) override
+		{
+			w = width;
+			h = height;
+			l = layers;
+		}
+		virtual void SetData(int /*mipLevel*/, int /*xOffset*/, int /*yOffset*/, int /*layerOffset*/, int /*width*/, int /*height*/, int /*layerCount*/, DataType /*inputType*/, void * /*data*/) override
+		{
+		}
+		virtual void BuildMipmaps() override
+		{
+		}
+	};
+
+	class Texture3D : public GameEngine::Texture3D
+	{
+	private:
+		int width, height, depth;
+	public:
+		Texture3D(int w, int h, int d)
+			: width(w), height(h), depth(d)
+		{
+		}
+		virtual void SetCurrentLayout(TextureLayout /*layout*/) override
+		{
+		}
+		virtual void GetSize(int & w, int & h, int & d) override
+		{
+			w = width;
+			h = height;
+			d = depth;
+		}
+		virtual void SetData(int /*mipLevel*/, int /*xOffset*/, int /*yOffset*/, int /*zOffset*/, int /*width*/, int /*height*/, int /*depth*/, DataType /*inputType*/, void * /*data*/) override
+		{
+		}
+	};
+
+	class TextureCube : public GameEngine::TextureCube
+	{
+	private:
+		int size;
+	public:
+		TextureCube(int s)
+			: size(s)
+		{
+		}
+		virtual void SetCurrentLayout(TextureLayout /*layout*/) override
+		{
+		}
+		virtual void GetSize(int & s) override
+		{
+			s = size;
+		}
+	};
+
+	class TextureCubeArray : public GameEngine::TextureCubeArray
+	{
+	private:
+		int size, cubemapCount;
+	public:
+		TextureCubeArray(int s, int count)
+			: size(s), cubemapCount(count)
+		{
+		}
+		virtual void SetCurrentLayout(TextureLayout /*layout*/) override
+		{
+		}
+		virtual void GetSize(int & s, int & layerCount) override
+		{
+			s = size;
+			layerCount = cubemapCount;
+		}
+	};
+
+	class TextureSampler : public GameEngine::TextureSampler
+	{
+	private:
+		TextureFilter filter = TextureFilter::Linear;
+		WrapMode wrapMode = WrapMode::Repeat;
+		CompareFunc compareFunc = CompareFunc::Disabled;
+	public:
+		virtual TextureFilter GetFilter() override
+		{
+			return filter;
+		}
+		virtual void SetFilter(TextureFilter pFilter) override
+		{
+			filter = pFilter;
+		}
+		virtual WrapMode GetWrapMode() override
+		{
+			return wrapMode;
+		}
+		virtual void SetWrapMode(WrapMode wrap) override
+		{
+			wrapMode = wrap;
+		}
+		virtual CompareFunc GetCompareFunc() override
+		{
+			return compareFunc;
+		}
+		virtual void SetDepthCompare(CompareFunc op) override
+		{
+			compareFunc = op;
+		}
+	};
+
+	class Shader : public GameEngine::Shader
+	{
+	};
+
+	class FrameBuffer : public GameEngine::FrameBuffer
+	{
+	private:
+		RenderAttachments attachments;
+	public:
+		FrameBuffer(const RenderAttachments & pAttachments)
+			: attachments(pAttachments)
+		{
+		}
+		virtual RenderAttachments & GetRenderAttachments() override
+		{
+			return attachments;
+		}
+	};
+
+	class RenderTargetLayout : public GameEngine::RenderTargetLayout
+	{
+	public:
+		virtual GameEngine::FrameBuffer * CreateFrameBuffer(const RenderAttachments & attachments) override
+		{
+			return new FrameBuffer(attachments);
+		}
+	};
+
+	class Fence : public GameEngine::Fence
+	{
+	public:
+		virtual void Reset() override
+		{
+		}
+		virtual void Wait() override
+		{
+		}
+	};
+
+	class DescriptorSetLayout : public GameEngine::DescriptorSetLayout
+	{
+	};
+
+	class DescriptorSet : public GameEngine::DescriptorSet
+	{
+	public:
+		virtual void BeginUpdate() override
+		{
+		}
+		virtual void Update(int /*location*/, GameEngine::Texture * /*texture*/, TextureAspect /*aspect*/) override
+		{
+		}
+		virtual void Update(int /*location*/, GameEngine::TextureSampler * /*sampler*/) override
+		{
+		}
+		virtual void Update(int /*location*/, GameEngine::Buffer * /*buffer*/, int /*offset*/, int /*length*/) override
+		{
+		}
+		virtual void EndUpdate() override
+		{
+		}
+	};
+
+	class Pipeline : public GameEngine::Pipeline
+	{
+	};
+
+	class PipelineBuilder : public GameEngine::PipelineBuilder
+	{
+	public:
+		virtual void SetShaders(CoreLib::ArrayView<GameEngine::Shader*> /*shaders*/) override
+		{
+		}
+		virtual void SetVertexLayout(VertexFormat /*vertexFormat*/) override
+		{
+		}
+		virtual void SetBindingLayout(CoreLib::ArrayView<GameEngine::DescriptorSetLayout*> /*descriptorSets*/) override
+		{
+		}
+		virtual void SetDebugName(CoreLib::String /*name*/) override
+		{
+		}
+		virtual GameEngine::Pipeline * ToPipeline(GameEngine::RenderTargetLayout * /*renderTargetLayout*/) override
+		{
+			return new Pipeline();
+		}
+		virtual GameEngine::Pipeline * CreateComputePipeline(CoreLib::ArrayView<GameEngine::DescriptorSetLayout*> /*descriptorSets*/, GameEngine::Shader * /*shader*/) override
+		{
+			return new Pipeline();
+		}
+	};
+
+	// commands are counted per command buffer, so that buffers can be recorded on different threads
+	class CommandBuffer : public GameEngine::CommandBuffer
+	{
+	public:
+		SubmittedCommandStats Stats;
+		virtual void BeginRecording() override
+		{
+			Stats = SubmittedCommandStats();
+		}
+		virtual void BeginRecording(GameEngine::FrameBuffer * /*frameBuffer*/) override
+		{
+			Stats = SubmittedCommandStats();
+		}
+		virtual void BeginRecording(GameEngine::RenderTargetLayout * /*renderTargetLayout*/) override
+		{
+			Stats = SubmittedCommandStats();
+		}
+		virtual void EndRecording() override
+		{
+		}
+		virtual void SetViewport(int /*x*/, int /*y*/, int /*width*/, int /*height*/) override
+		{
+		}
+		virtual void BindVertexBuffer(GameEngine::Buffer * /*vertexBuffer*/, int /*byteOffset*/) override
+		{
+			Stats.BufferBinds++;
+		}
+		virtual void BindIndexBuffer(GameEngine::Buffer * /*indexBuffer*/, int /*byteOffset*/) override
+		{
+			Stats.BufferBinds++;
+		}
+		virtual void BindPipeline(GameEngine::Pipeline * /*pipeline*/) override
+		{
+			Stats.PipelineBinds++;
+		}
+		virtual void BindDescriptorSet(int /*binding*/, GameEngine::DescriptorSet * /*descSet*/) override
+		{
+			Stats.DescriptorSetBinds++;
+		}
+		virtual void Draw(int /*firstVertex*/, int /*vertexCount*/) override
+		{
+			Stats.DrawCalls++;
+		}
+		virtual void DrawInstanced(int /*numInstances*/, int /*firstVertex*/, int /*vertexCount*/) override
+		{
+			Stats.DrawCalls++;
+		}
+		virtual void DrawIndexed(int /*firstIndex*/, int /*indexCount*/) override
+		{
+			Stats.DrawCalls++;
+		}
+		virtual void DrawIndexedInstanced(int /*numInstances*/, int /*firstIndex*/, int /*indexCount*/) override
+		{
+			Stats.DrawCalls++;
+		}
+		virtual void DispatchCompute(int /*groupCountX*/, int /*groupCountY*/, int /*groupCountZ*/) override
+		{
+			Stats.Dispatches++;
+		}
+		virtual void TransferLayout(CoreLib::ArrayView<GameEngine::Texture*> /*attachments*/, TextureLayoutTransfer /*transferDirection*/) override
+		{
+		}
+		virtual void Blit(GameEngine::Texture2D * /*dstImage*/, GameEngine::Texture2D * /*srcImage*/, TextureLayout /*srcLayout*/, VectorMath::Vec2i /*destOffset*/) override
+		{
+			Stats.Blits++;
+		}
+		virtual void CopyTextureLayer(GameEngine::Texture2DArray * /*dstImage*/, int /*dstLayer*/, GameEngine::Texture2DArray * /*srcImage*/, int /*srcLayer*/, TextureLayout /*layout*/) override
+		{
+			Stats.TextureCopies++;
+		}
+		virtual void ClearAttachments(GameEngine::FrameBuffer * /*frameBuffer*/) override
+		{
+		}
+		virtual void MemoryAccessBarrier(MemoryBarrierType /*barrierType*/) override
+		{
+		}
+	};
+
+	class WindowSurface : public GameEngine::WindowSurface
+	{
+	private:
+		void * windowHandle;
+		int width, height;
+	public:
+		WindowSurface(void * handle, int w, int h)
+			: windowHandle(handle), width(w), height(h)
+		{
+		}
+		virtual void * GetWindowHandle() override
+		{
+			return windowHandle;
+		}
+		virtual void Resize(int w, int h) override
+		{
+			width = w;
+			height = h;
+		}
+		virtual void GetSize(int & w, int & h) override
+		{
+			w = width;
+			h = height;
+		}
+	};
+
+	class HardwareRenderer : public GameEngine::HardwareRenderer
+	{
+	public:
+		SubmittedCommandStats Stats;
+	private:
+		void ExecuteCommandBuffers(CoreLib::ArrayView<GameEngine::CommandBuffer*> commands)
+		{
+			for (auto cmd : commands)
+			{
+				auto & cmdStats = ((CommandBuffer*)cmd)->Stats;
+				Stats.CommandBuffers++;
+				Stats.DrawCalls += cmdStats.DrawCalls;
+				Stats.PipelineBinds += cmdStats.PipelineBinds;
+				Stats.DescriptorSetBinds += cmdStats.DescriptorSetBinds;
+				Stats.BufferBinds += cmdStats.BufferBinds;
+				Stats.Dispatches += cmdStats.Dispatches;
+				Stats.Blits += cmdStats.Blits;
+				Stats.TextureCopies += cmdStats.TextureCopies;
+			}
+		}
+	public:
+		virtual void ClearTexture(GameEngine::Texture2D * /*texture*/) override
+		{
+		}
+		virtual void ExecuteRenderPass(GameEngine::FrameBuffer * /*frameBuffer*/, CoreLib::ArrayView<GameEngine::CommandBuffer*> commands, GameEngine::Fence * /*fence*/) override
+		{
+			Stats.RenderPasses++;
+			ExecuteCommandBuffers(commands);
+		}
+		virtual void ExecuteNonRenderCommandBuffers(CoreLib::ArrayView<GameEngine::CommandBuffer*> commands) override
+		{
+			ExecuteCommandBuffers(commands);
+		}
+		virtual void Present(GameEngine::WindowSurface * /*surface*/, GameEngine::Texture2D * /*srcImage*/) override
+		{
+		}
+		virtual void Blit(GameEngine::Texture2D * /*dstImage*/, GameEngine::Texture2D * /*srcImage*/, VectorMath::Vec2i /*destOffset*/) override
+		{
+			Stats.Blits++;
+		}
+		virtual void Wait() override
+		{
+		}
+		virtual void SetMaxTempBufferVersions(int /*versionCount*/) override
+		{
+		}
+		virtual void ResetTempBufferVersion(int /*version*/) override
+		{
+		}
+		virtual GameEngine::Fence * CreateFence() override
+		{
+			return new Fence();
+		}
+		virtual GameEngine::Buffer * CreateBuffer(BufferUsage /*usage*/, int sizeInBytes) override
+		{
+			return new Buffer(sizeInBytes);
+		}
+		virtual GameEngine::Buffer * CreateMappedBuffer(BufferUsage /*usage*/, int sizeInBytes) override
+		{
+			return new Buffer(sizeInBytes);
+		}
+		virtual GameEngine::Texture2D * CreateTexture2D(int width, int height, StorageFormat /*format*/, DataType /*type*/, void * /*data*/) override
+		{
+			return new Texture2D(width, height);
+		}
+		virtual GameEngine::Texture2D * CreateTexture2D(TextureUsage /*usage*/, int width, int height, int /*mipLevelCount*/, StorageFormat /*format*/) override
+		{
+			return new Texture2D(width, height);
+		}
+		virtual GameEngine::Texture2D * CreateTexture2D(TextureUsage /*usage*/, int width, int height, int /*mipLevelCount*/, StorageFormat /*format*/, DataType /*type*/, CoreLib::ArrayView<void*> /*mipLevelData*/) override
+		{
+			return new Texture2D(width, height);
+		}
+		virtual GameEngine::Texture2DArray * CreateTexture2DArray(TextureUsage /*usage*/, int width, int height, int layers, int /*mipLevelCount*/, StorageFormat /*format*/) override
+		{
+			return new Texture2DArray(width, height, layers);
+		}
+		virtual GameEngine::TextureCube * CreateTextureCube(TextureUsage /*usage*/, int size, int /*mipLevelCount*/, StorageFormat /*format*/) override
+		{
+			return new TextureCube(size);
+		}
+		virtual GameEngine::TextureCubeArray * CreateTextureCubeArray(TextureUsage /*usage*/, int size, int /*mipLevelCount*/, int cubemapCount, StorageFormat /*format*/) override
+		{
+			return new TextureCubeArray(size, cubemapCount);
+		}
+		virtual GameEngine::Texture3D * CreateTexture3D(TextureUsage /*usage*/, int width, int height, int depth, int /*mipLevelCount*/, StorageFormat /*format*/) override
+		{
+			return new Texture3D(width, height, depth);
+		}
+		virtual GameEngine::TextureSampler * CreateTextureSampler() override
+		{
+			return new TextureSampler();
+		}
+		virtual GameEngine::Shader * CreateShader(ShaderType /*stage*/, const char * /*data*/, int /*size*/) override
+		{
+			return new Shader();
+		}
+		virtual GameEngine::RenderTargetLayout * CreateRenderTargetLayout(CoreLib::ArrayView<AttachmentLayout> /*bindings*/) override
+		{
+			return new RenderTargetLayout();
+		}
+		virtual GameEngine::PipelineBuilder * CreatePipelineBuilder() override
+		{
+			return new PipelineBuilder();
+		}
+		virtual GameEngine::DescriptorSetLayout * CreateDescriptorSetLayout(CoreLib::ArrayView<DescriptorLayout> /*descriptors*/) override
+		{
+			return new DescriptorSetLayout();
+		}
+		virtual GameEngine::DescriptorSet * CreateDescriptorSet(GameEngine::DescriptorSetLayout * /*layout*/) override
+		{
+			return new DescriptorSet();
+		}
+		virtual int GetDescriptorPoolCount() override
+		{
+			return 0;
+		}
+		virtual GameEngine::CommandBuffer * CreateCommandBuffer() override
+		{
+			return new CommandBuffer();
+		}
+		// shaders are still compiled for the Vulkan target so that shader compilation cost is measured
+		virtual int GetSpireTarget() override
+		{
+			return SPIRE_GLSL_VULKAN;
+		}
+		virtual int UniformBufferAlignment() override
+		{
+			return 256;
+		}
+		virtual int StorageBufferAlignment() override
+		{
+			return 256;
+		}
+		virtual GameEngine::WindowSurface * CreateSurface(void * windowHandle, int width, int height) override
+		{
+			return new WindowSurface(windowHandle, width, height);
+		}
+		virtual CoreLib::String GetRendererName() override
+		{
+			return "Null Renderer";
+		}
+		virtual void TransferBarrier(int /*barrierId*/) override
+		{
+		}
+		virtual VectorMath::ClipSpaceType GetClipSpaceType() override
+		{
+			return VectorMath::ClipSpaceType::ZeroToOne;
+		}
+	};
+}
+
+namespace GameEngine
+{
+	HardwareRenderer * CreateNullHardwareRenderer()
+	{
+		return new NullAPI::HardwareRenderer();
+	}
+
+	SubmittedCommandStats * GetNullHardwareRendererStats(HardwareRenderer * hwRenderer)
+	{
+		if (auto nullRenderer = dynamic_cast<NullAPI::HardwareRenderer*>(hwRenderer))
+			return &nullRenderer->Stats;
+		return nullptr;
+	}
+}
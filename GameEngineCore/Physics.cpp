@@ -1,4 +1,15 @@
 #include "Physics.h"
+#include "CoreLib/JobSystem.h"
+#include <emmintrin.h>
+#include <immintrin.h>
+
+// the AVX kernel is selected at runtime, so it must compile without enabling AVX for the whole file
+#if defined(__GNUC__) || defined(__clang__)
+#define PHYSICS_AVX_TARGET __attribute__((target("avx")))
+#else
+#define PHYSICS_AVX_TARGET
+#endif
+
 using namespace VectorMath;
 namespace GameEngine
 {
@@ -51,45 +62,527 @@ namespace GameEngine
 		return true;
 	}
 
+	inline bool RayBvhNodeTest(const PhysicsModel::BvhNode & node, const Vec3 & origin, const Vec3 & invDir, float tmin, float tmax)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			float t0 = (node.BoundsMin[i] - origin[i]) * invDir[i];
+			float t1 = (node.BoundsMax[i] - origin[i]) * invDir[i];
+			if (invDir[i] < 0.0f)
+			{
+				float tmp = t0;
+				t0 = t1;
+				t1 = tmp;
+			}
+			// written so that NaNs (axis-parallel rays through a slab boundary) leave the interval untouched
+			tmin = t0 > tmin ? t0 : tmin;
+			tmax = t1 < tmax ? t1 : tmax;
+		}
+		return tmin <= tmax;
+	}
+
+	const int BvhMaxDepth = 60;
+	const int BvhMaxLeafSize = 4;
+	// SoA leaves are larger: a block kernel tests up to 8 faces for roughly the cost of one
+	const int BvhMaxSoALeafSize = 16;
+	const int BvhBinCount = 16;
+
 	HitPoint PhysicsModel::TraceRay(VectorMath::Vec3 origin, VectorMath::Vec3 dir, float tmin, float tmax)
+	{
+		if (faceLayout == PhysicsFaceLayout::SoA)
+		{
+			if (faceBlocks8.Count())
+				return TraceRaySoA(faceBlocks8, origin, dir, tmin, tmax);
+			return TraceRaySoA(faceBlocks4, origin, dir, tmin, tmax);
+		}
+		HitPoint current;
+		current.Distance = tmax;
+		if (bvhNodes.Count() == 0)
+			return current;
+		Vec3 invDir = Vec3::Create(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+		int stack[BvhMaxDepth + 4];
+		int stackSize = 0;
+		int nodeId = 0;
+		while (true)
+		{
+			auto & node = bvhNodes[nodeId];
+			if (RayBvhNodeTest(node, origin, invDir, tmin, current.Distance))
+			{
+				if (node.FaceCount)
+				{
+					int faceEnd = node.ChildOrFaceStart + node.FaceCount;
+					for (int i = node.ChildOrFaceStart; i < faceEnd; i++)
+					{
+						HitPoint hit;
+						// break ties towards the larger face id so results match a linear scan over all faces
+						if (RayTriangleTest(hit, faces[i], origin, dir, tmin, current.Distance) &&
+							(hit.Distance < current.Distance || faceIds[i] > current.FaceId))
+						{
+							current = hit;
+							current.FaceId = faceIds[i];
+						}
+					}
+				}
+				else
+				{
+					// visit the child on the near side of the split plane first
+					if (invDir[node.SplitAxis] < 0.0f)
+					{
+						stack[stackSize++] = nodeId + 1;
+						nodeId = node.ChildOrFaceStart;
+					}
+					else
+					{
+						stack[stackSize++] = node.ChildOrFaceStart;
+						nodeId = nodeId + 1;
+					}
+					continue;
+				}
+			}
+			if (stackSize == 0)
+				break;
+			nodeId = stack[--stackSize];
+		}
+		return current;
+	}
+
+	// Block kernels: test one ray against the lanes of a MeshFaceBlock, performing the same
+	// arithmetic as RayTriangleTest. Hit distances are written to tHit, the lane mask of hits is returned.
+	struct FaceBlockRay
+	{
+		float OriginU, OriginV, OriginK;
+		float DirU, DirV, DirK;
+	};
+
+	inline int RayFaceBlockTest(const PhysicsModel::MeshFaceBlock<4> & block, const FaceBlockRay & ray, float tmin, float tmax, float * tHit)
+	{
+		__m128 planeU = _mm_loadu_ps(block.PlaneU);
+		__m128 planeV = _mm_loadu_ps(block.PlaneV);
+		__m128 nDotD = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeU, _mm_set1_ps(ray.DirU)), _mm_mul_ps(planeV, _mm_set1_ps(ray.DirV))), _mm_set1_ps(ray.DirK));
+		__m128 invNdotD = _mm_div_ps(_mm_set1_ps(1.0f), nDotD);
+		__m128 nDotO = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(planeU, _mm_set1_ps(ray.OriginU)), _mm_mul_ps(planeV, _mm_set1_ps(ray.OriginV))),
+			_mm_set1_ps(ray.OriginK)), _mm_loadu_ps(block.PlaneD));
+		__m128 t = _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), nDotO), invNdotD);
+		__m128 mask = _mm_and_ps(_mm_cmpnlt_ps(t, _mm_set1_ps(tmin)), _mm_cmpngt_ps(t, _mm_set1_ps(tmax)));
+		if (_mm_movemask_ps(mask) == 0)
+			return 0;
+		__m128 hitU = _mm_add_ps(_mm_set1_ps(ray.OriginU), _mm_mul_ps(_mm_set1_ps(ray.DirU), t));
+		__m128 hitV = _mm_add_ps(_mm_set1_ps(ray.OriginV), _mm_mul_ps(_mm_set1_ps(ray.DirV), t));
+		__m128 beta = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(block.K_beta_u), hitU),
+			_mm_mul_ps(_mm_loadu_ps(block.K_beta_v), hitV)), _mm_loadu_ps(block.K_beta_d));
+		__m128 gamma = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(block.K_gamma_u), hitU),
+			_mm_mul_ps(_mm_loadu_ps(block.K_gamma_v), hitV)), _mm_loadu_ps(block.K_gamma_d));
+		__m128 negEps = _mm_set1_ps(-Epsilon);
+		mask = _mm_and_ps(mask, _mm_cmpnlt_ps(beta, negEps));
+		mask = _mm_and_ps(mask, _mm_cmpnlt_ps(gamma, negEps));
+		mask = _mm_and_ps(mask, _mm_cmpngt_ps(_mm_add_ps(beta, gamma), _mm_set1_ps(1.0f + Epsilon)));
+		_mm_storeu_ps(tHit, t);
+		return _mm_movemask_ps(mask);
+	}
+
+	PHYSICS_AVX_TARGET int RayFaceBlockTest(const PhysicsModel::MeshFaceBlock<8> & block, const FaceBlockRay & ray, float tmin, float tmax, float * tHit)
+	{
+		__m256 planeU = _mm256_loadu_ps(block.PlaneU);
+		__m256 planeV = _mm256_loadu_ps(block.PlaneV);
+		__m256 nDotD = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeU, _mm256_set1_ps(ray.DirU)), _mm256_mul_ps(planeV, _mm256_set1_ps(ray.DirV))),
+			_mm256_set1_ps(ray.DirK));
+		__m256 invNdotD = _mm256_div_ps(_mm256_set1_ps(1.0f), nDotD);
+		__m256 nDotO = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeU, _mm256_set1_ps(ray.OriginU)),
+			_mm256_mul_ps(planeV, _mm256_set1_ps(ray.OriginV))), _mm256_set1_ps(ray.OriginK)), _mm256_loadu_ps(block.PlaneD));
+		__m256 t = _mm256_mul_ps(_mm256_sub_ps(_mm256_setzero_ps(), nDotO), invNdotD);
+		__m256 mask = _mm256_and_ps(_mm256_cmp_ps(t, _mm256_set1_ps(tmin), _CMP_NLT_UQ), _mm256_cmp_ps(t, _mm256_set1_ps(tmax), _CMP_NGT_UQ));
+		if (_mm256_movemask_ps(mask) == 0)
+			return 0;
+		__m256 hitU = _mm256_add_ps(_mm256_set1_ps(ray.OriginU), _mm256_mul_ps(_mm256_set1_ps(ray.DirU), t));
+		__m256 hitV = _mm256_add_ps(_mm256_set1_ps(ray.OriginV), _mm256_mul_ps(_mm256_set1_ps(ray.DirV), t));
+		__m256 beta = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(block.K_beta_u), hitU),
+			_mm256_mul_ps(_mm256_loadu_ps(block.K_beta_v), hitV)), _mm256_loadu_ps(block.K_beta_d));
+		__m256 gamma = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(block.K_gamma_u), hitU),
+			_mm256_mul_ps(_mm256_loadu_ps(block.K_gamma_v), hitV)), _mm256_loadu_ps(block.K_gamma_d));
+		__m256 negEps = _mm256_set1_ps(-Epsilon);
+		mask = _mm256_and_ps(mask, _mm256_cmp_ps(beta, negEps, _CMP_NLT_UQ));
+		mask = _mm256_and_ps(mask, _mm256_cmp_ps(gamma, negEps, _CMP_NLT_UQ));
+		mask = _mm256_and_ps(mask, _mm256_cmp_ps(_mm256_add_ps(beta, gamma), _mm256_set1_ps(1.0f + Epsilon), _CMP_NGT_UQ));
+		_mm256_storeu_ps(tHit, t);
+		return _mm256_movemask_ps(mask);
+	}
+
+	template<int Width>
+	HitPoint PhysicsModel::TraceRaySoA(const CoreLib::List<MeshFaceBlock<Width>> & faceBlocks, VectorMath::Vec3 origin, VectorMath::Vec3 dir, float tmin, float tmax)
+	{
+		HitPoint current;
+		current.Distance = tmax;
+		if (bvhNodes.Count() == 0)
+			return current;
+		const int mod3[] = { 0,1,2,0,1 };
+		FaceBlockRay blockRays[3];
+		for (int k = 0; k < 3; k++)
+		{
+			int u = mod3[k + 1];
+			int v = mod3[k + 2];
+			blockRays[k].OriginU = origin[u];
+			blockRays[k].OriginV = origin[v];
+			blockRays[k].OriginK = origin[k];
+			blockRays[k].DirU = dir[u];
+			blockRays[k].DirV = dir[v];
+			blockRays[k].DirK = dir[k];
+		}
+		float curT = tmax;
+		int curFaceId = -1, curFaceIndex = -1;
+		Vec3 invDir = Vec3::Create(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+		int stack[BvhMaxDepth + 4];
+		int stackSize = 0;
+		int nodeId = 0;
+		while (true)
+		{
+			auto & node = bvhNodes[nodeId];
+			if (RayBvhNodeTest(node, origin, invDir, tmin, curT))
+			{
+				if (node.FaceCount)
+				{
+					int blockEnd = node.ChildOrFaceStart + node.FaceCount;
+					for (int blockId = node.ChildOrFaceStart; blockId < blockEnd; blockId++)
+					{
+						auto & block = faceBlocks[blockId];
+						float tHit[Width];
+						int mask = RayFaceBlockTest(block, blockRays[block.ProjectionAxis], tmin, curT, tHit);
+						mask &= (1 << block.FaceCount) - 1;
+						// accept lanes in face order with the same rule as the scalar path
+						for (int lane = 0; mask; lane++, mask >>= 1)
+						{
+							if (!(mask & 1))
+								continue;
+							int faceIndex = block.FirstFace + lane;
+							if (!(tHit[lane] > curT) && (tHit[lane] < curT || faceIds[faceIndex] > curFaceId))
+							{
+								curT = tHit[lane];
+								curFaceId = faceIds[faceIndex];
+								curFaceIndex = faceIndex;
+							}
+						}
+					}
+				}
+				else
+				{
+					if (invDir[node.SplitAxis] < 0.0f)
+					{
+						stack[stackSize++] = nodeId + 1;
+						nodeId = node.ChildOrFaceStart;
+					}
+					else
+					{
+						stack[stackSize++] = node.ChildOrFaceStart;
+						nodeId = nodeId + 1;
+					}
+					continue;
+				}
+			}
+			if (stackSize == 0)
+				break;
+			nodeId = stack[--stackSize];
+		}
+		if (curFaceIndex != -1)
+		{
+			// recompute the hit record of the winning face with the scalar test
+			RayTriangleTest(current, faces[curFaceIndex], origin, dir, tmin, curT);
+			current.FaceId = curFaceId;
+		}
+		return current;
+	}
+
+	HitPoint PhysicsModel::TraceRayBruteForce(VectorMath::Vec3 origin, VectorMath::Vec3 dir, float tmin, float tmax)
 	{
 		HitPoint current;
 		current.Distance = tmax;
 		for (int i = 0; i < faces.Count(); i++)
 		{
 			HitPoint hit;
-			if (RayTriangleTest(hit, faces[i], origin, dir, tmin, current.Distance))
+			if (RayTriangleTest(hit, faces[i], origin, dir, tmin, current.Distance) &&
+				(hit.Distance < current.Distance || faceIds[i] > current.FaceId))
 			{
 				current = hit;
-				current.FaceId = i;
+				current.FaceId = faceIds[i];
 			}
 		}
 		return current;
 	}
 
+	struct PhysicsRayPacket
+	{
+		__m128 Origin[3];
+		__m128 Dir[3];
+		__m128 InvDir[3];
+		__m128 DirIsNeg[3];
+		void Init()
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				InvDir[i] = _mm_div_ps(_mm_set1_ps(1.0f), Dir[i]);
+				DirIsNeg[i] = _mm_cmplt_ps(InvDir[i], _mm_setzero_ps());
+			}
+		}
+		static float GetLane(__m128 v, int lane)
+		{
+			float values[4];
+			_mm_storeu_ps(values, v);
+			return values[lane];
+		}
+		Vec3 GetOrigin(int lane) const
+		{
+			return Vec3::Create(GetLane(Origin[0], lane), GetLane(Origin[1], lane), GetLane(Origin[2], lane));
+		}
+		Vec3 GetDir(int lane) const
+		{
+			return Vec3::Create(GetLane(Dir[0], lane), GetLane(Dir[1], lane), GetLane(Dir[2], lane));
+		}
+	};
+
+	inline __m128 SelectPs(__m128 mask, __m128 a, __m128 b)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+
+	// returns the lane mask of rays that overlap the box within [tmin, tmax], mirrors RayBvhNodeTest
+	inline int PacketBoxTest(const float boundsMin[3], const float boundsMax[3], const PhysicsRayPacket & packet, __m128 tmin, __m128 tmax)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			__m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(boundsMin[i]), packet.Origin[i]), packet.InvDir[i]);
+			__m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(boundsMax[i]), packet.Origin[i]), packet.InvDir[i]);
+			__m128 tNear = SelectPs(packet.DirIsNeg[i], t1, t0);
+			__m128 tFar = SelectPs(packet.DirIsNeg[i], t0, t1);
+			// _mm_max_ps/_mm_min_ps return the second operand for NaN inputs
+			tmin = _mm_max_ps(tNear, tmin);
+			tmax = _mm_min_ps(tFar, tmax);
+		}
+		return _mm_movemask_ps(_mm_cmple_ps(tmin, tmax));
+	}
+
+	// tests the four rays against one face using the projection-plane formulation of RayTriangleTest
+	inline int PacketTriangleTest(const PhysicsModel::MeshFace & face, const PhysicsRayPacket & packet, __m128 tmin, __m128 tmax, __m128 & tHit)
+	{
+		const int mod3[] = { 0,1,2,0,1 };
+		int k = face.ProjectionAxis;
+		int u = mod3[k + 1];
+		int v = mod3[k + 2];
+		__m128 planeU = _mm_set1_ps(face.PlaneU);
+		__m128 planeV = _mm_set1_ps(face.PlaneV);
+		__m128 nDotD = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeU, packet.Dir[u]), _mm_mul_ps(planeV, packet.Dir[v])), packet.Dir[k]);
+		__m128 invNdotD = _mm_div_ps(_mm_set1_ps(1.0f), nDotD);
+		__m128 nDotO = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(planeU, packet.Origin[u]), _mm_mul_ps(planeV, packet.Origin[v])),
+			packet.Origin[k]), _mm_set1_ps(face.PlaneD));
+		__m128 t = _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), nDotO), invNdotD);
+		// use negated comparisons so that NaNs behave exactly as in the scalar test
+		__m128 mask = _mm_and_ps(_mm_cmpnlt_ps(t, tmin), _mm_cmpngt_ps(t, tmax));
+		if (_mm_movemask_ps(mask) == 0)
+			return 0;
+		__m128 hitU = _mm_add_ps(packet.Origin[u], _mm_mul_ps(packet.Dir[u], t));
+		__m128 hitV = _mm_add_ps(packet.Origin[v], _mm_mul_ps(packet.Dir[v], t));
+		__m128 beta = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(face.K_beta_u), hitU), _mm_mul_ps(_mm_set1_ps(face.K_beta_v), hitV)),
+			_mm_set1_ps(face.K_beta_d));
+		__m128 gamma = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(face.K_gamma_u), hitU), _mm_mul_ps(_mm_set1_ps(face.K_gamma_v), hitV)),
+			_mm_set1_ps(face.K_gamma_d));
+		__m128 negEps = _mm_set1_ps(-Epsilon);
+		mask = _mm_and_ps(mask, _mm_cmpnlt_ps(beta, negEps));
+		mask = _mm_and_ps(mask, _mm_cmpnlt_ps(gamma, negEps));
+		mask = _mm_and_ps(mask, _mm_cmpngt_ps(_mm_add_ps(beta, gamma), _mm_set1_ps(1.0f + Epsilon)));
+		tHit = t;
+		return _mm_movemask_ps(mask);
+	}
+
+	void PhysicsModel::GetLeafFaceRange(const BvhNode & leaf, int & faceStart, int & faceEnd)
+	{
+		if (faceLayout == PhysicsFaceLayout::AoS)
+		{
+			faceStart = leaf.ChildOrFaceStart;
+			faceEnd = faceStart + leaf.FaceCount;
+		}
+		else if (faceBlocks8.Count())
+		{
+			auto & lastBlock = faceBlocks8[leaf.ChildOrFaceStart + leaf.FaceCount - 1];
+			faceStart = faceBlocks8[leaf.ChildOrFaceStart].FirstFace;
+			faceEnd = lastBlock.FirstFace + lastBlock.FaceCount;
+		}
+		else
+		{
+			auto & lastBlock = faceBlocks4[leaf.ChildOrFaceStart + leaf.FaceCount - 1];
+			faceStart = faceBlocks4[leaf.ChildOrFaceStart].FirstFace;
+			faceEnd = lastBlock.FirstFace + lastBlock.FaceCount;
+		}
+	}
+
+	void PhysicsModel::TraceRayPacket(const PhysicsRayPacket & packet, int activeMask, float tmin, const float tmax[4], RayTraceMode mode, HitPoint hits[4])
+	{
+		for (int i = 0; i < 4; i++)
+			hits[i] = HitPoint();
+		if (bvhNodes.Count() == 0)
+			return;
+		__m128 tminV = _mm_set1_ps(tmin);
+		__m128 curT = _mm_loadu_ps(tmax);
+		__m128i curFaceId = _mm_set1_epi32(-1);
+		__m128i curFaceIndex = _mm_set1_epi32(-1);
+		int hitMask = 0;
+		int stack[BvhMaxDepth + 4];
+		int stackSize = 0;
+		int nodeId = 0;
+		while (true)
+		{
+			auto & node = bvhNodes[nodeId];
+			if (PacketBoxTest(node.BoundsMin, node.BoundsMax, packet, tminV, curT) & activeMask)
+			{
+				if (node.FaceCount)
+				{
+					int faceStart, faceEnd;
+					GetLeafFaceRange(node, faceStart, faceEnd);
+					for (int i = faceStart; i < faceEnd; i++)
+					{
+						__m128 t;
+						int mask = PacketTriangleTest(faces[i], packet, tminV, curT, t) & activeMask;
+						if (mask == 0)
+							continue;
+						// same acceptance rule as TraceRay: closer hit, or equal distance and larger face id
+						__m128i faceIdV = _mm_set1_epi32(faceIds[i]);
+						__m128 accept = _mm_or_ps(_mm_cmplt_ps(t, curT), _mm_castsi128_ps(_mm_cmpgt_epi32(faceIdV, curFaceId)));
+						mask &= _mm_movemask_ps(accept);
+						if (mask == 0)
+							continue;
+						__m128 laneMask = _mm_castsi128_ps(_mm_set_epi32((mask & 8) ? -1 : 0, (mask & 4) ? -1 : 0, (mask & 2) ? -1 : 0, (mask & 1) ? -1 : 0));
+						curT = SelectPs(laneMask, t, curT);
+						curFaceId = _mm_castps_si128(SelectPs(laneMask, _mm_castsi128_ps(faceIdV), _mm_castsi128_ps(curFaceId)));
+						curFaceIndex = _mm_castps_si128(SelectPs(laneMask, _mm_castsi128_ps(_mm_set1_epi32(i)), _mm_castsi128_ps(curFaceIndex)));
+						hitMask |= mask;
+						if (mode == RayTraceMode::AnyHit)
+						{
+							activeMask &= ~mask;
+							if (activeMask == 0)
+								break;
+						}
+					}
+					if (activeMask == 0)
+						break;
+				}
+				else
+				{
+					// rays of a packet share direction signs, use the first active lane to order the children
+					int lane = 0;
+					while (!(activeMask & (1 << lane)))
+						lane++;
+					if (_mm_movemask_ps(packet.DirIsNeg[node.SplitAxis]) & (1 << lane))
+					{
+						stack[stackSize++] = nodeId + 1;
+						nodeId = node.ChildOrFaceStart;
+					}
+					else
+					{
+						stack[stackSize++] = node.ChildOrFaceStart;
+						nodeId = nodeId + 1;
+					}
+					continue;
+				}
+			}
+			if (stackSize == 0)
+				break;
+			nodeId = stack[--stackSize];
+		}
+		if (hitMask == 0)
+			return;
+		float bestT[4];
+		int bestFaceId[4], bestFaceIndex[4];
+		_mm_storeu_ps(bestT, curT);
+		_mm_storeu_si128((__m128i*)bestFaceId, curFaceId);
+		_mm_storeu_si128((__m128i*)bestFaceIndex, curFaceIndex);
+		for (int lane = 0; lane < 4; lane++)
+		{
+			if (!(hitMask & (1 << lane)))
+				continue;
+			// recompute the hit record of the winning face with the scalar test
+			RayTriangleTest(hits[lane], faces[bestFaceIndex[lane]], packet.GetOrigin(lane), packet.GetDir(lane), tmin, bestT[lane]);
+			hits[lane].FaceId = bestFaceId[lane];
+		}
+	}
+
+	void PhysicsObject::SetModelTransform(const VectorMath::Matrix4 & m)
+	{
+		modelTransform = m;
+		m.Inverse(inverseModelTransform);
+		if (!modelTransformChanged && scene)
+		{
+			// actors may move their physics objects from worker threads during a parallel actor tick
+			scene->dirtyObjectsLock.Lock();
+			scene->dirtyObjects.Add(this);
+			scene->dirtyObjectsLock.Unlock();
+		}
+		modelTransformChanged = true;
+		CoreLib::Graphics::BBox nullBox;
+		nullBox.Init();
+		bounds.Init();
+		if (nullBox != model->GetBounds())
+			CoreLib::Graphics::TransformBBox(bounds, m, model->GetBounds());
+	}
+
 	void PhysicsScene::AddObject(PhysicsObject * obj)
 	{
 		objects.Add(obj);
+		obj->scene = this;
+		obj->broadPhaseProxy = broadPhase.Insert(obj->GetBounds(), obj);
+		obj->ClearModelTransformDirtyBit();
 	}
 
 	void PhysicsScene::RemoveObject(PhysicsObject * obj)
 	{
+		if (obj->scene == this)
+		{
+			if (obj->CheckModelTransformDirtyBit())
+				dirtyObjects.FastRemove(obj);
+			broadPhase.Remove(obj->broadPhaseProxy);
+			obj->broadPhaseProxy = -1;
+			obj->scene = nullptr;
+		}
 		objects.Remove(obj);
 	}
 
+	void PhysicsScene::UpdateBroadPhase()
+	{
+		dirtyObjectsLock.Lock();
+		for (auto obj : dirtyObjects)
+		{
+			if (obj->CheckModelTransformDirtyBit())
+			{
+				broadPhase.Move(obj->broadPhaseProxy, obj->GetBounds());
+				obj->ClearModelTransformDirtyBit();
+			}
+		}
+		dirtyObjects.Clear();
+		dirtyObjectsLock.Unlock();
+	}
+
 	void PhysicsScene::Tick()
 	{
+		UpdateBroadPhase();
+	}
+
+	void PhysicsScene::BeginParallelQueries()
+	{
+		UpdateBroadPhase();
+		parallelQueries = true;
+	}
+
+	void PhysicsScene::EndParallelQueries()
+	{
+		parallelQueries = false;
 	}
 
 	TraceResult PhysicsScene::RayTraceFirst(const Ray & ray, PhysicsChannels channels, float maxDist)
 	{
+		if (!parallelQueries)
+			UpdateBroadPhase();
 		TraceResult rs;
 		HitPoint curHitPoint;
 		curHitPoint.Distance = maxDist;
-		for (auto obj : objects)
+		broadPhase.RayCast(ray.Origin, ray.Dir, maxDist, [&](PhysicsObject * obj, float /*tEntry*/, float curMaxDist)
 		{
-            if ((obj->Channels.value & channels.value) == 0)
-                continue;
+			if ((obj->Channels.value & channels.value) == 0)
+				return curMaxDist;
 			float tmin = 0.0f;
 			float tmax = 0.0f;
 			if (CoreLib::Graphics::RayBBoxIntersection(obj->GetBounds(), ray.Origin, ray.Dir, tmin, tmax))
@@ -104,28 +597,220 @@ namespace GameEngine
 					objDir *= 1.0f / distScale;
 					// perform object space ray casting
 					auto hit = obj->GetModel()->TraceRay(objOrigin, objDir, 0.0f, 1e30f);
-                    if (hit.IsHit)
-                    {
-                        hit.Position = obj->GetModelTransform().TransformHomogeneous(hit.Position);
-                        hit.Distance = (ray.Origin - hit.Position).Length();
+					if (hit.IsHit)
+					{
+						hit.Position = obj->GetModelTransform().TransformHomogeneous(hit.Position);
+						hit.Distance = (ray.Origin - hit.Position).Length();
 
-                        if (hit.Distance < curHitPoint.Distance && hit.FaceId != -1)
-                        {
-                            curHitPoint = hit;
-                            rs.Object = obj.Ptr();
-                        }
-                    }
+						if (hit.Distance < curHitPoint.Distance && hit.FaceId != -1)
+						{
+							curHitPoint = hit;
+							rs.Object = obj;
+						}
+					}
 				}
 			}
-		}
+			// objects whose bounds start beyond the closest hit cannot produce a closer one
+			return curHitPoint.Distance;
+		});
 		if (rs.Object)
 		{
 			rs.Object->GetInverseModelTransform().TransposeTransformNormal(rs.Normal, curHitPoint.GetNormal());
+			rs.Position = curHitPoint.Position;
 			rs.Distance = curHitPoint.Distance;
 		}
 		return rs;
 	}
 
+	const int RayBatchPacketsPerChunk = 16;
+
+	inline unsigned int SpreadBits10(unsigned int x)
+	{
+		x &= 0x3FF;
+		x = (x | (x << 16)) & 0x030000FF;
+		x = (x | (x << 8)) & 0x0300F00F;
+		x = (x | (x << 4)) & 0x030C30C3;
+		x = (x | (x << 2)) & 0x09249249;
+		return x;
+	}
+
+	void PhysicsScene::SortRayBatch(CoreLib::ArrayView<Ray> rays, CoreLib::List<int> & sortedRayIds)
+	{
+		int rayCount = rays.Count();
+		CoreLib::Graphics::BBox originBounds;
+		originBounds.Init();
+		for (int i = 0; i < rayCount; i++)
+			originBounds.Union(rays[i].Origin);
+		Vec3 originScale;
+		for (int i = 0; i < 3; i++)
+		{
+			float extent = originBounds.Max[i] - originBounds.Min[i];
+			originScale[i] = extent > 0.0f ? 511.0f / extent : 0.0f;
+		}
+		CoreLib::List<unsigned long long> sortKeys;
+		sortKeys.SetSize(rayCount);
+		for (int i = 0; i < rayCount; i++)
+		{
+			auto & ray = rays[i];
+			unsigned int octant = (ray.Dir.x < 0.0f ? 1 : 0) | (ray.Dir.y < 0.0f ? 2 : 0) | (ray.Dir.z < 0.0f ? 4 : 0);
+			unsigned int morton = 0;
+			for (int j = 0; j < 3; j++)
+				morton |= SpreadBits10((unsigned int)((ray.Origin[j] - originBounds.Min[j]) * originScale[j])) << j;
+			// 3 octant bits above a 27-bit Morton code, so the key fits in the upper half next to the ray index
+			unsigned long long key = ((unsigned long long)octant << 27) | morton;
+			sortKeys[i] = (key << 32) | (unsigned int)i;
+		}
+		sortKeys.Sort();
+		sortedRayIds.SetSize(rayCount);
+		for (int i = 0; i < rayCount; i++)
+			sortedRayIds[i] = (int)(sortKeys[i] & 0xFFFFFFFF);
+	}
+
+	void PhysicsScene::RayTraceBatch(CoreLib::ArrayView<Ray> rays, CoreLib::ArrayView<TraceResult> results, PhysicsChannels channels, RayTraceMode mode, float maxDist)
+	{
+		if (!parallelQueries)
+			UpdateBroadPhase();
+		int rayCount = rays.Count();
+		for (int i = 0; i < rayCount; i++)
+			results[i] = TraceResult();
+		if (rayCount == 0 || broadPhase.Count() == 0)
+			return;
+
+		CoreLib::List<int> sortedRayIds;
+		SortRayBatch(rays, sortedRayIds);
+
+		int packetCount = (rayCount + 3) >> 2;
+		int chunkCount = (packetCount + RayBatchPacketsPerChunk - 1) / RayBatchPacketsPerChunk;
+		CoreLib::Threading::JobSystem::Instance()->ParallelFor(0, chunkCount, [&](int chunk)
+		{
+			int packetEnd = Math::Min(packetCount, (chunk + 1) * RayBatchPacketsPerChunk);
+			for (int packet = chunk * RayBatchPacketsPerChunk; packet < packetEnd; packet++)
+			{
+				int rayStart = packet << 2;
+				TraceRayPacket(sortedRayIds.Buffer() + rayStart, Math::Min(4, rayCount - rayStart), rays, results, channels, mode, maxDist);
+			}
+		}, 1);
+	}
+
+	void PhysicsScene::TraceRayPacket(const int * rayIds, int rayCount, CoreLib::ArrayView<Ray> rays, CoreLib::ArrayView<TraceResult> results,
+		PhysicsChannels channels, RayTraceMode mode, float maxDist)
+	{
+		float origin[3][4] = {}, dir[3][4] = {};
+		for (int lane = 0; lane < rayCount; lane++)
+		{
+			for (int j = 0; j < 3; j++)
+			{
+				origin[j][lane] = rays[rayIds[lane]].Origin[j];
+				dir[j][lane] = rays[rayIds[lane]].Dir[j];
+			}
+		}
+		PhysicsRayPacket packet;
+		for (int j = 0; j < 3; j++)
+		{
+			packet.Origin[j] = _mm_loadu_ps(origin[j]);
+			packet.Dir[j] = _mm_loadu_ps(dir[j]);
+		}
+		packet.Init();
+		int activeMask = (1 << rayCount) - 1;
+		float bestDist[4] = { maxDist, maxDist, maxDist, maxDist };
+		HitPoint bestHit[4];
+		PhysicsObject * bestObject[4] = { nullptr, nullptr, nullptr, nullptr };
+		__m128 zero = _mm_setzero_ps();
+		int stack[CoreLib::Graphics::DynamicBvh<PhysicsObject*>::MaxTraversalStackSize];
+		int stackSize = 0;
+		stack[stackSize++] = broadPhase.GetRoot();
+		while (stackSize && activeMask)
+		{
+			auto & node = broadPhase.GetNode(stack[--stackSize]);
+			__m128 tmax = _mm_loadu_ps(bestDist);
+			int mask = PacketBoxTest(&node.Bounds.xMin, &node.Bounds.xMax, packet, zero, tmax) & activeMask;
+			if (!mask)
+				continue;
+			if (!node.IsLeaf())
+			{
+				// push the child farther along the first active ray last-visited
+				int lane = 0;
+				while (!(mask & (1 << lane)))
+					lane++;
+				auto & child1 = broadPhase.GetNode(node.Child1).Bounds;
+				auto & child2 = broadPhase.GetNode(node.Child2).Bounds;
+				Vec3 centerDiff = (child1.Min + child1.Max) - (child2.Min + child2.Max);
+				if (Vec3::Dot(centerDiff, packet.GetDir(lane)) > 0.0f)
+				{
+					stack[stackSize++] = node.Child1;
+					stack[stackSize++] = node.Child2;
+				}
+				else
+				{
+					stack[stackSize++] = node.Child2;
+					stack[stackSize++] = node.Child1;
+				}
+				continue;
+			}
+			auto obj = node.UserData;
+			if ((obj->Channels.value & channels.value) == 0)
+				continue;
+			auto objBounds = obj->GetBounds();
+			mask &= PacketBoxTest(&objBounds.xMin, &objBounds.xMax, packet, zero, tmax);
+			if (!mask)
+				continue;
+			// transform the active rays into object space
+			auto invTransform = obj->GetInverseModelTransform();
+			float objOrigin[3][4] = {}, objDir[3][4] = {}, objTMax[4] = {};
+			for (int lane = 0; lane < 4; lane++)
+			{
+				if (!(mask & (1 << lane)))
+					continue;
+				Vec3 o = invTransform.TransformHomogeneous(packet.GetOrigin(lane));
+				Vec3 d = invTransform.TransformNormal(packet.GetDir(lane));
+				float distScale = d.Length();
+				d *= 1.0f / distScale;
+				for (int j = 0; j < 3; j++)
+				{
+					objOrigin[j][lane] = o[j];
+					objDir[j][lane] = d[j];
+				}
+				// object space distances are world distances scaled by distScale, keep some slack for rounding
+				objTMax[lane] = Math::Min(FLT_MAX, bestDist[lane] * distScale * 1.0001f);
+			}
+			PhysicsRayPacket objPacket;
+			for (int j = 0; j < 3; j++)
+			{
+				objPacket.Origin[j] = _mm_loadu_ps(objOrigin[j]);
+				objPacket.Dir[j] = _mm_loadu_ps(objDir[j]);
+			}
+			objPacket.Init();
+			HitPoint hits[4];
+			obj->GetModel()->TraceRayPacket(objPacket, mask, 0.0f, objTMax, mode, hits);
+			for (int lane = 0; lane < 4; lane++)
+			{
+				if (!hits[lane].IsHit)
+					continue;
+				auto hit = hits[lane];
+				hit.Position = obj->GetModelTransform().TransformHomogeneous(hit.Position);
+				hit.Distance = (packet.GetOrigin(lane) - hit.Position).Length();
+				if (hit.Distance < bestDist[lane])
+				{
+					bestDist[lane] = hit.Distance;
+					bestHit[lane] = hit;
+					bestObject[lane] = obj;
+					if (mode == RayTraceMode::AnyHit)
+						activeMask &= ~(1 << lane);
+				}
+			}
+		}
+		for (int lane = 0; lane < rayCount; lane++)
+		{
+			if (!bestObject[lane])
+				continue;
+			auto & rs = results[rayIds[lane]];
+			rs.Object = bestObject[lane];
+			rs.Object->GetInverseModelTransform().TransposeTransformNormal(rs.Normal, bestHit[lane].GetNormal());
+			rs.Position = bestHit[lane].Position;
+			rs.Distance = bestHit[lane].Distance;
+		}
+	}
+
 	PhysicsModelBuilder::PhysicsModelBuilder()
 	{
 		model = new PhysicsModel();
@@ -168,12 +853,266 @@ namespace GameEngine
 		f.K_gamma_d = (c[u] * A[v] - c[v] * A[u]) * divisor;
 		f.PackedNormal = PackNormal(face.Normal);
 		model->faces.Add(f);
+		CoreLib::Graphics::BBox fbox;
+		fbox.Init();
 		for (int i = 0; i < 3; i++)
+		{
 			model->bounds.Union(face.Vertices[i]);
+			fbox.Union(face.Vertices[i]);
+		}
+		// pad face bounds to cover the epsilon tolerance of RayTriangleTest
+		float pad = Math::Max(fbox.xMax - fbox.xMin, Math::Max(fbox.yMax - fbox.yMin, fbox.zMax - fbox.zMin)) * 1e-5f + 1e-6f;
+		fbox.Min -= Vec3::Create(pad, pad, pad);
+		fbox.Max += Vec3::Create(pad, pad, pad);
+		faceBounds.Add(fbox);
+	}
+
+	struct BvhBuildContext
+	{
+		CoreLib::List<CoreLib::Graphics::BBox> * faceBounds;
+		CoreLib::List<Vec3> centroids;
+		CoreLib::List<int> faceIndices;
+		CoreLib::List<PhysicsModel::BvhNode> * nodes;
+		int maxLeafSize;
+	};
+
+	inline float BBoxHalfArea(const CoreLib::Graphics::BBox & box)
+	{
+		float dx = box.xMax - box.xMin;
+		float dy = box.yMax - box.yMin;
+		float dz = box.zMax - box.zMin;
+		if (dx < 0.0f || dy < 0.0f || dz < 0.0f)
+			return 0.0f;
+		return dx * dy + dy * dz + dz * dx;
+	}
+
+	int BuildBvhNode(BvhBuildContext & ctx, int start, int end, int depth)
+	{
+		int nodeId = ctx.nodes->Count();
+		ctx.nodes->Add(PhysicsModel::BvhNode());
+		CoreLib::Graphics::BBox nodeBounds, centroidBounds;
+		nodeBounds.Init();
+		centroidBounds.Init();
+		for (int i = start; i < end; i++)
+		{
+			nodeBounds.Union((*ctx.faceBounds)[ctx.faceIndices[i]]);
+			centroidBounds.Union(ctx.centroids[ctx.faceIndices[i]]);
+		}
+		int count = end - start;
+		int axis = centroidBounds.MaxDimension();
+		int mid = -1;
+		if (count > ctx.maxLeafSize && depth < BvhMaxDepth)
+		{
+			float axisMin = centroidBounds.Min[axis];
+			float axisExtent = centroidBounds.Max[axis] - axisMin;
+			if (axisExtent > 0.0f)
+			{
+				// binned surface area heuristic
+				CoreLib::Graphics::BBox binBounds[BvhBinCount];
+				int binCounts[BvhBinCount];
+				for (int i = 0; i < BvhBinCount; i++)
+				{
+					binBounds[i].Init();
+					binCounts[i] = 0;
+				}
+				float binScale = BvhBinCount * (1.0f - 1e-6f) / axisExtent;
+				auto getBin = [&](int faceIndex)
+				{
+					return Math::Clamp((int)((ctx.centroids[faceIndex][axis] - axisMin) * binScale), 0, BvhBinCount - 1);
+				};
+				for (int i = start; i < end; i++)
+				{
+					int b = getBin(ctx.faceIndices[i]);
+					binCounts[b]++;
+					binBounds[b].Union((*ctx.faceBounds)[ctx.faceIndices[i]]);
+				}
+				float rightCost[BvhBinCount];
+				CoreLib::Graphics::BBox accumBounds;
+				accumBounds.Init();
+				int accumCount = 0;
+				for (int i = BvhBinCount - 1; i > 0; i--)
+				{
+					accumBounds.Union(binBounds[i]);
+					accumCount += binCounts[i];
+					rightCost[i] = BBoxHalfArea(accumBounds) * accumCount;
+				}
+				accumBounds.Init();
+				accumCount = 0;
+				int bestSplit = -1;
+				float bestCost = FLT_MAX;
+				for (int i = 1; i < BvhBinCount; i++)
+				{
+					accumBounds.Union(binBounds[i - 1]);
+					accumCount += binCounts[i - 1];
+					float cost = BBoxHalfArea(accumBounds) * accumCount + rightCost[i];
+					if (accumCount != 0 && accumCount != count && cost < bestCost)
+					{
+						bestCost = cost;
+						bestSplit = i;
+					}
+				}
+				// traversal step is assumed to cost about as much as one triangle test
+				float leafCost = BBoxHalfArea(nodeBounds) * count;
+				float splitCost = BBoxHalfArea(nodeBounds) + bestCost;
+				if (bestSplit != -1 && (splitCost < leafCost || count > ctx.maxLeafSize * 4))
+				{
+					int left = start, right = end - 1;
+					while (left <= right)
+					{
+						if (getBin(ctx.faceIndices[left]) < bestSplit)
+							left++;
+						else
+						{
+							Swap(ctx.faceIndices[left], ctx.faceIndices[right]);
+							right--;
+						}
+					}
+					mid = left;
+				}
+			}
+			else if (count > ctx.maxLeafSize * 4)
+			{
+				// all centroids coincide, split by count to keep leaves small
+				mid = (start + end) >> 1;
+			}
+		}
+		if (mid == -1)
+		{
+			auto & node = (*ctx.nodes)[nodeId];
+			for (int i = 0; i < 3; i++)
+			{
+				node.BoundsMin[i] = nodeBounds.Min[i];
+				node.BoundsMax[i] = nodeBounds.Max[i];
+			}
+			node.ChildOrFaceStart = start;
+			node.FaceCount = count;
+			node.SplitAxis = 0;
+			return nodeId;
+		}
+		BuildBvhNode(ctx, start, mid, depth + 1);
+		int rightChild = BuildBvhNode(ctx, mid, end, depth + 1);
+		auto & node = (*ctx.nodes)[nodeId];
+		for (int i = 0; i < 3; i++)
+		{
+			node.BoundsMin[i] = nodeBounds.Min[i];
+			node.BoundsMax[i] = nodeBounds.Max[i];
+		}
+		node.ChildOrFaceStart = rightChild;
+		node.FaceCount = 0;
+		node.SplitAxis = axis;
+		return nodeId;
+	}
+
+	void PhysicsModelBuilder::BuildBvh()
+	{
+		int faceCount = model->faces.Count();
+		model->bvhNodes.Clear();
+		model->faceIds.Clear();
+		model->faceBlocks4.Clear();
+		model->faceBlocks8.Clear();
+		model->faceLayout = PhysicsFaceLayout::AoS;
+		if (faceCount == 0)
+			return;
+		BvhBuildContext ctx;
+		ctx.faceBounds = &faceBounds;
+		ctx.nodes = &model->bvhNodes;
+		ctx.maxLeafSize = faceLayout == PhysicsFaceLayout::SoA ? BvhMaxSoALeafSize : BvhMaxLeafSize;
+		ctx.centroids.SetSize(faceCount);
+		ctx.faceIndices.SetSize(faceCount);
+		for (int i = 0; i < faceCount; i++)
+		{
+			ctx.centroids[i] = (faceBounds[i].Min + faceBounds[i].Max) * 0.5f;
+			ctx.faceIndices[i] = i;
+		}
+		model->bvhNodes.Reserve(faceCount * 2 / ctx.maxLeafSize + 1);
+		BuildBvhNode(ctx, 0, faceCount, 0);
+		model->bvhNodes.Compress();
+		if (faceLayout == PhysicsFaceLayout::SoA)
+		{
+			// order the faces of each leaf by projection axis so that they can be packed into blocks
+			for (auto & node : model->bvhNodes)
+			{
+				if (node.FaceCount == 0)
+					continue;
+				int * leafFaces = ctx.faceIndices.Buffer() + node.ChildOrFaceStart;
+				for (int i = 1; i < (int)node.FaceCount; i++)
+				{
+					int faceIndex = leafFaces[i];
+					int axis = model->faces[faceIndex].ProjectionAxis;
+					int j = i - 1;
+					while (j >= 0 && (int)model->faces[leafFaces[j]].ProjectionAxis > axis)
+					{
+						leafFaces[j + 1] = leafFaces[j];
+						j--;
+					}
+					leafFaces[j + 1] = faceIndex;
+				}
+			}
+		}
+
+		// reorder faces so that every leaf references a contiguous range
+		CoreLib::List<PhysicsModel::MeshFace> orderedFaces;
+		orderedFaces.SetSize(faceCount);
+		for (int i = 0; i < faceCount; i++)
+			orderedFaces[i] = model->faces[ctx.faceIndices[i]];
+		model->faces = _Move(orderedFaces);
+		model->faceIds = _Move(ctx.faceIndices);
+		if (faceLayout == PhysicsFaceLayout::SoA)
+		{
+			// pick the widest kernel the CPU can run
+			if (CoreLib::Threading::ParallelSystemInfo::IsAVXSupported())
+				BuildFaceBlocks(model->faceBlocks8);
+			else
+				BuildFaceBlocks(model->faceBlocks4);
+		}
+	}
+
+	template<int Width>
+	void PhysicsModelBuilder::BuildFaceBlocks(CoreLib::List<PhysicsModel::MeshFaceBlock<Width>> & faceBlocks)
+	{
+		faceBlocks.Clear();
+		for (auto & node : model->bvhNodes)
+		{
+			if (node.FaceCount == 0)
+				continue;
+			// re-point the leaf from its faces to its blocks
+			int faceEnd = node.ChildOrFaceStart + node.FaceCount;
+			int blockStart = faceBlocks.Count();
+			for (int i = node.ChildOrFaceStart; i < faceEnd; )
+			{
+				PhysicsModel::MeshFaceBlock<Width> block;
+				memset(&block, 0, sizeof(block));
+				block.FirstFace = i;
+				block.ProjectionAxis = (unsigned short)model->faces[i].ProjectionAxis;
+				while (i < faceEnd && block.FaceCount < Width && model->faces[i].ProjectionAxis == block.ProjectionAxis)
+				{
+					auto & face = model->faces[i];
+					int lane = block.FaceCount;
+					block.PlaneU[lane] = face.PlaneU;
+					block.PlaneV[lane] = face.PlaneV;
+					block.PlaneD[lane] = face.PlaneD;
+					block.K_beta_u[lane] = face.K_beta_u;
+					block.K_beta_v[lane] = face.K_beta_v;
+					block.K_beta_d[lane] = face.K_beta_d;
+					block.K_gamma_u[lane] = face.K_gamma_u;
+					block.K_gamma_v[lane] = face.K_gamma_v;
+					block.K_gamma_d[lane] = face.K_gamma_d;
+					block.FaceCount++;
+					i++;
+				}
+				faceBlocks.Add(block);
+			}
+			node.ChildOrFaceStart = blockStart;
+			node.FaceCount = faceBlocks.Count() - blockStart;
+		}
+		faceBlocks.Compress();
+		model->faceLayout = PhysicsFaceLayout::SoA;
 	}
 
 	CoreLib::RefPtr<PhysicsModel> PhysicsModelBuilder::GetModel()
 	{
+		BuildBvh();
+		faceBounds = CoreLib::List<CoreLib::Graphics::BBox>();
 		auto rs = model;
 		model = nullptr;
 		return rs;
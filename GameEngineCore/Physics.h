@@ -4,6 +4,8 @@
 #include "CoreLib/Basic.h"
 #include "CoreLib/VectorMath.h"
 #include "CoreLib/Graphics/BBox.h"
+#include "CoreLib/Graphics/DynamicBvh.h"
+#include "CoreLib/Threading.h"
 
 namespace GameEngine
 {
@@ -12,6 +14,18 @@ namespace GameEngine
 		VectorMath::Vec3 Origin;
 		VectorMath::Vec3 Dir;
 	};
+	enum class RayTraceMode
+	{
+		ClosestHit, AnyHit
+	};
+	struct PhysicsRayPacket;
+
+	enum class PhysicsFaceLayout
+	{
+		AoS, // faces are tested one MeshFace record at a time
+		SoA  // faces of each BVH leaf are additionally grouped into SIMD blocks by projection axis
+	};
+
 	struct PhysicsModelFace
 	{
 		VectorMath::Vec3 Vertices[3];
@@ -39,10 +53,42 @@ namespace GameEngine
 			float K_beta_u, K_beta_v, K_beta_d;
 			float K_gamma_u, K_gamma_v, K_gamma_d;
 		};
+		// 32-byte BVH node. Interior nodes store their left child at the next
+		// index and the right child at ChildOrFaceStart; leaves reference a
+		// contiguous range of FaceCount faces starting at ChildOrFaceStart
+		// (or, with the SoA layout, a range of FaceCount face blocks).
+		struct BvhNode
+		{
+			float BoundsMin[3];
+			int ChildOrFaceStart;
+			float BoundsMax[3];
+			unsigned int SplitAxis : 2;
+			unsigned int FaceCount : 30;
+		};
+		// Structure-of-arrays copy of up to Width consecutive faces of one BVH leaf that share
+		// a projection axis, so that a ray can be tested against all of them with one SSE/AVX kernel.
+		template<int Width>
+		struct MeshFaceBlock
+		{
+			float PlaneU[Width], PlaneV[Width], PlaneD[Width];
+			float K_beta_u[Width], K_beta_v[Width], K_beta_d[Width];
+			float K_gamma_u[Width], K_gamma_v[Width], K_gamma_d[Width];
+			int FirstFace; // leaf-ordered index of the face in lane 0
+			unsigned short FaceCount;
+			unsigned short ProjectionAxis;
+		};
 	private:
 		CoreLib::Graphics::BBox bounds;
-		CoreLib::List<MeshFace> faces;
+		CoreLib::List<MeshFace> faces; // stored in BVH leaf order
+		CoreLib::List<int> faceIds; // maps leaf-ordered face index to the index passed to AddFace
+		CoreLib::List<BvhNode> bvhNodes;
+		CoreLib::List<MeshFaceBlock<4>> faceBlocks4; // SoA layout used with the SSE kernel
+		CoreLib::List<MeshFaceBlock<8>> faceBlocks8; // SoA layout used with the AVX kernel
+		PhysicsFaceLayout faceLayout = PhysicsFaceLayout::AoS;
 		friend class PhysicsModelBuilder;
+		void GetLeafFaceRange(const BvhNode & leaf, int & faceStart, int & faceEnd);
+		template<int Width>
+		HitPoint TraceRaySoA(const CoreLib::List<MeshFaceBlock<Width>> & faceBlocks, VectorMath::Vec3 origin, VectorMath::Vec3 dir, float tmin, float tmax);
 	public:
 		int GetFaceCount()
 		{
@@ -52,20 +98,42 @@ namespace GameEngine
 		{
 			return bounds;
 		}
+		int GetBvhNodeCount()
+		{
+			return bvhNodes.Count();
+		}
+		PhysicsFaceLayout GetFaceLayout()
+		{
+			return faceLayout;
+		}
 		HitPoint TraceRay(VectorMath::Vec3 origin, VectorMath::Vec3 dir, float tmin, float tmax);
+		// reference implementation that tests every face, used to validate and benchmark TraceRay
+		HitPoint TraceRayBruteForce(VectorMath::Vec3 origin, VectorMath::Vec3 dir, float tmin, float tmax);
+		// traces the rays of a 4-wide packet together, lanes not set in activeMask are ignored
+		void TraceRayPacket(const PhysicsRayPacket & packet, int activeMask, float tmin, const float tmax[4], RayTraceMode mode, HitPoint hits[4]);
 	};
 
 	class PhysicsModelBuilder
 	{
 	private:
 		CoreLib::RefPtr<PhysicsModel> model;
+		CoreLib::List<CoreLib::Graphics::BBox> faceBounds;
+		PhysicsFaceLayout faceLayout = PhysicsFaceLayout::SoA;
+		void BuildBvh();
+		template<int Width>
+		void BuildFaceBlocks(CoreLib::List<PhysicsModel::MeshFaceBlock<Width>> & faceBlocks);
 	public:
 		PhysicsModelBuilder();
+		void SetFaceLayout(PhysicsFaceLayout layout)
+		{
+			faceLayout = layout;
+		}
 		void AddFace(const PhysicsModelFace & face);
 		CoreLib::RefPtr<PhysicsModel> GetModel();
 	};
 
 	class Actor;
+	class PhysicsScene;
 
     class PhysicsChannels
     {
@@ -89,6 +157,9 @@ namespace GameEngine
 		VectorMath::Matrix4 modelTransform, inverseModelTransform;
 		CoreLib::Graphics::BBox bounds;
 		bool modelTransformChanged = false;
+		PhysicsScene * scene = nullptr;
+		int broadPhaseProxy = -1;
+		friend class PhysicsScene;
 	public:
 		void * Tag = nullptr;
 		Actor * ParentActor = nullptr;
@@ -106,17 +177,7 @@ namespace GameEngine
 		{
 			return modelTransform;
 		}
-		void SetModelTransform(const VectorMath::Matrix4 & m)
-		{
-			modelTransform = m;
-			m.Inverse(inverseModelTransform);
-			modelTransformChanged = true;
-			CoreLib::Graphics::BBox nullBox;
-			nullBox.Init();
-			bounds.Init();
-			if (nullBox != model->GetBounds())
-				CoreLib::Graphics::TransformBBox(bounds, m, model->GetBounds());
-		}
+		void SetModelTransform(const VectorMath::Matrix4 & m);
 		PhysicsObject(PhysicsModel * physModel)
 		{
 			model = physModel;
@@ -154,11 +215,32 @@ namespace GameEngine
 	{
 	private:
 		CoreLib::EnumerableHashSet<CoreLib::RefPtr<PhysicsObject>> objects;
+		CoreLib::Graphics::DynamicBvh<PhysicsObject*> broadPhase;
+		CoreLib::List<PhysicsObject*> dirtyObjects;
+		CoreLib::Threading::SpinLock dirtyObjectsLock;
+		bool parallelQueries = false;
+		friend class PhysicsObject;
+		void UpdateBroadPhase();
+		void TraceRayPacket(const int * rayIds, int rayCount, CoreLib::ArrayView<Ray> rays, CoreLib::ArrayView<TraceResult> results,
+			PhysicsChannels channels, RayTraceMode mode, float maxDist);
 	public:
 		void AddObject(PhysicsObject * obj);
 		void RemoveObject(PhysicsObject * obj);
+		// moves the broad phase entries of objects whose transform changed
 		void Tick();
+		// Queries first move the broad phase entries of objects whose transform changed. Between these calls
+		// they only read the scene instead, so that actors can trace rays concurrently during a parallel actor
+		// tick. Objects moved in the meantime may be missed until EndParallelQueries.
+		void BeginParallelQueries();
+		void EndParallelQueries();
 		TraceResult RayTraceFirst(const Ray & ray, PhysicsChannels channels = PhysicsChannels::All, float maxDist = 1e30f);
+		// Traces many rays at once. Rays are sorted into coherent 4-wide packets that are traced with SSE
+		// and distributed over worker threads. In AnyHit mode tracing of a ray stops at its first intersection.
+		void RayTraceBatch(CoreLib::ArrayView<Ray> rays, CoreLib::ArrayView<TraceResult> results, PhysicsChannels channels = PhysicsChannels::All,
+			RayTraceMode mode = RayTraceMode::ClosestHit, float maxDist = 1e30f);
+		// Order in which RayTraceBatch packs rays: grouped by direction octant, then by the Morton code
+		// of their origin, so that consecutive groups of 4 form coherent packets.
+		static void SortRayBatch(CoreLib::ArrayView<Ray> rays, CoreLib::List<int> & sortedRayIds);
 	};
 }
 
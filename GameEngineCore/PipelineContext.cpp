@@ -154,7 +154,7 @@ namespace GameEngine
 		{
 			if (descSet.Value.BindingPoint == -1)
 				continue;
-			if (descSet.Key == "NoAnimation")
+			if (descSet.Key == "NoAnimation" || descSet.Key == "InstancedNoAnimation")
 			{
 				for (auto & desc : descSet.Value.Descriptors)
 					desc.Stages = (StageFlags)(StageFlags::sfVertex | StageFlags::sfFragment);
@@ -171,13 +171,56 @@ namespace GameEngine
 		return pipelineClass.Ptr();
 	}
 
+	void ModuleInstance::SetStorageBuffer(int binding, Buffer * buffer, int offset, int length)
+	{
+		currentDescriptor++;
+		currentDescriptor = currentDescriptor % DynamicBufferLengthMultiplier;
+		auto descSet = descriptors[currentDescriptor].Ptr();
+		descSet->BeginUpdate();
+		descSet->Update(binding, buffer, offset, length);
+		descSet->EndUpdate();
+	}
+
+	void * ModuleInstance::MapUniformData(int length)
+	{
+#ifdef _DEBUG
+		if (length > BufferLength)
+			throw HardwareRendererException("insufficient uniform buffer.");
+#endif
+		if (!TransientMemory)
+			return nullptr;
+		int offset = TransientMemory->Alloc(BufferLength);
+		if (offset == -1)
+		{
+			static bool exhaustionReported = false;
+			if (!exhaustionReported)
+			{
+				Print("transient uniform memory exhausted, uniform data of '%S' is not updated.\n", BindingName.ToWString());
+				exhaustionReported = true;
+			}
+			return nullptr;
+		}
+		currentDescriptor++;
+		currentDescriptor = currentDescriptor % DynamicBufferLengthMultiplier;
+		auto descSet = descriptors[currentDescriptor].Ptr();
+		descSet->BeginUpdate();
+		descSet->Update(0, TransientMemory->GetBuffer(), offset, BufferLength);
+		descSet->EndUpdate();
+		return TransientMemory->GetPtr(offset);
+	}
+
 	void ModuleInstance::SetUniformData(void * data, int length)
 	{
 #ifdef _DEBUG
 		if (length > BufferLength)
 			throw HardwareRendererException("insufficient uniform buffer.");
 #endif
-		if (length && UniformMemory)
+		if (length && TransientMemory)
+		{
+			if (auto ptr = MapUniformData(length))
+				memcpy(ptr, data, length);
+		}
+		else if (length && UniformMemory)
 		{
 			currentDescriptor++;
 			currentDescriptor = currentDescriptor % DynamicBufferLengthMultiplier;
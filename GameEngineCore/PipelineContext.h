@@ -67,9 +67,21 @@ namespace GameEngine
 	public:
 		CoreLib::List<int> SpecializeParamOffsets;
 		DeviceMemory * UniformMemory = nullptr;
+		// when set, the uniform buffer is allocated from TransientMemory by every SetUniformData
+		// and UniformMemory is not used; the data must then be set in every frame it is drawn
+		TransientDeviceMemory * TransientMemory = nullptr;
 		int BufferOffset = 0, BufferLength = 0;
 		CoreLib::String BindingName;
+		bool HasUniformBuffer()
+		{
+			return UniformMemory || TransientMemory;
+		}
 		void SetUniformData(void * data, int length);
+		// allocates the next version of a transient uniform buffer and returns its mapped memory for the caller
+		// to fill, or nullptr if the module has no TransientMemory or it is exhausted
+		void * MapUniformData(int length);
+		// binds a range of a per-frame buffer to a storage buffer parameter in the next descriptor set version
+		void SetStorageBuffer(int binding, Buffer * buffer, int offset, int length);
 		ModuleInstance() = default;
 		void Init(SpireCompilationContext * ctx, SpireModule * m)
 		{
@@ -0,0 +1,289 @@
+#include "PoseEvaluator.h"
+#include "CoreLib/Threading.h"
+#include "CoreLib/JobSystem.h"
+#include <immintrin.h>
+
+// the AVX kernel is selected at runtime, so it must compile without enabling AVX for the whole file
+#if defined(__GNUC__) || defined(__clang__)
+#define POSE_AVX_TARGET __attribute__((target("avx")))
+#else
+#define POSE_AVX_TARGET
+#endif
+
+using namespace CoreLib;
+using namespace VectorMath;
+
+namespace GameEngine
+{
+	struct BoneStreams
+	{
+		const float * RotationX, * RotationY, * RotationZ, * RotationW;
+		const float * TranslationX, * TranslationY, * TranslationZ;
+		const float * ScaleX, * ScaleY, * ScaleZ;
+	};
+
+	// the columns of four matrices are computed as rows of lanes, so each group of four registers
+	// is transposed into one column of each matrix
+	inline void StoreBoneMatrices(Matrix4 * matrices, __m128 m[16])
+	{
+		_MM_TRANSPOSE4_PS(m[0], m[1], m[2], m[3]);
+		_MM_TRANSPOSE4_PS(m[4], m[5], m[6], m[7]);
+		_MM_TRANSPOSE4_PS(m[8], m[9], m[10], m[11]);
+		_MM_TRANSPOSE4_PS(m[12], m[13], m[14], m[15]);
+		for (int i = 0; i < 4; i++)
+		{
+			_mm_storeu_ps(matrices[i].values, m[i]);
+			_mm_storeu_ps(matrices[i].values + 4, m[i + 4]);
+			_mm_storeu_ps(matrices[i].values + 8, m[i + 8]);
+			_mm_storeu_ps(matrices[i].values + 12, m[i + 12]);
+		}
+	}
+
+	// performs the arithmetic of BoneTransformation::ToMatrix for four bones
+	inline void BoneBlockToMatrices(const BoneStreams & bones, int offset, Matrix4 * matrices)
+	{
+		__m128 x = _mm_loadu_ps(bones.RotationX + offset);
+		__m128 y = _mm_loadu_ps(bones.RotationY + offset);
+		__m128 z = _mm_loadu_ps(bones.RotationZ + offset);
+		__m128 w = _mm_loadu_ps(bones.RotationW + offset);
+		__m128 sx = _mm_loadu_ps(bones.ScaleX + offset);
+		__m128 sy = _mm_loadu_ps(bones.ScaleY + offset);
+		__m128 sz = _mm_loadu_ps(bones.ScaleZ + offset);
+		__m128 one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f);
+		__m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+		__m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+		__m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+		__m128 m[16];
+		m[0] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx);
+		m[1] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx);
+		m[2] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx);
+		m[3] = _mm_setzero_ps();
+		m[4] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy);
+		m[5] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy);
+		m[6] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy);
+		m[7] = _mm_setzero_ps();
+		m[8] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz);
+		m[9] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz);
+		m[10] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz);
+		m[11] = _mm_setzero_ps();
+		m[12] = _mm_loadu_ps(bones.TranslationX + offset);
+		m[13] = _mm_loadu_ps(bones.TranslationY + offset);
+		m[14] = _mm_loadu_ps(bones.TranslationZ + offset);
+		m[15] = one;
+		StoreBoneMatrices(matrices, m);
+	}
+
+	POSE_AVX_TARGET inline void StoreBoneMatrices(Matrix4 * matrices, __m256 m[16])
+	{
+		__m128 lower[16], upper[16];
+		for (int i = 0; i < 16; i++)
+		{
+			lower[i] = _mm256_castps256_ps128(m[i]);
+			upper[i] = _mm256_extractf128_ps(m[i], 1);
+		}
+		StoreBoneMatrices(matrices, lower);
+		StoreBoneMatrices(matrices + 4, upper);
+	}
+
+	// performs the arithmetic of BoneTransformation::ToMatrix for eight bones
+	POSE_AVX_TARGET void BoneBlockToMatricesAVX(const BoneStreams & bones, int offset, Matrix4 * matrices)
+	{
+		__m256 x = _mm256_loadu_ps(bones.RotationX + offset);
+		__m256 y = _mm256_loadu_ps(bones.RotationY + offset);
+		__m256 z = _mm256_loadu_ps(bones.RotationZ + offset);
+		__m256 w = _mm256_loadu_ps(bones.RotationW + offset);
+		__m256 sx = _mm256_loadu_ps(bones.ScaleX + offset);
+		__m256 sy = _mm256_loadu_ps(bones.ScaleY + offset);
+		__m256 sz = _mm256_loadu_ps(bones.ScaleZ + offset);
+		__m256 one = _mm256_set1_ps(1.0f), two = _mm256_set1_ps(2.0f);
+		__m256 xx = _mm256_mul_ps(x, x), yy = _mm256_mul_ps(y, y), zz = _mm256_mul_ps(z, z);
+		__m256 xy = _mm256_mul_ps(x, y), xz = _mm256_mul_ps(x, z), yz = _mm256_mul_ps(y, z);
+		__m256 wx = _mm256_mul_ps(w, x), wy = _mm256_mul_ps(w, y), wz = _mm256_mul_ps(w, z);
+		__m256 m[16];
+		m[0] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(yy, zz))), sx);
+		m[1] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xy, wz)), sx);
+		m[2] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xz, wy)), sx);
+		m[3] = _mm256_setzero_ps();
+		m[4] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xy, wz)), sy);
+		m[5] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, zz))), sy);
+		m[6] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(yz, wx)), sy);
+		m[7] = _mm256_setzero_ps();
+		m[8] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xz, wy)), sz);
+		m[9] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(yz, wx)), sz);
+		m[10] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, yy))), sz);
+		m[11] = _mm256_setzero_ps();
+		m[12] = _mm256_loadu_ps(bones.TranslationX + offset);
+		m[13] = _mm256_loadu_ps(bones.TranslationY + offset);
+		m[14] = _mm256_loadu_ps(bones.TranslationZ + offset);
+		m[15] = one;
+		StoreBoneMatrices(matrices, m);
+	}
+
+	// out = a * b for a bone matrix b, whose last row is (0, 0, 0, 1)
+	inline void MultiplyAffine(Matrix4 & out, const Matrix4_M128 & a, const Matrix4 & b)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			__m128 column = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a.C1, _mm_set1_ps(b.values[i * 4])), _mm_mul_ps(a.C2, _mm_set1_ps(b.values[i * 4 + 1]))),
+				_mm_mul_ps(a.C3, _mm_set1_ps(b.values[i * 4 + 2])));
+			_mm_storeu_ps(out.values + i * 4, column);
+		}
+		__m128 translation = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a.C1, _mm_set1_ps(b.values[12])), _mm_mul_ps(a.C2, _mm_set1_ps(b.values[13]))),
+			_mm_add_ps(_mm_mul_ps(a.C3, _mm_set1_ps(b.values[14])), a.C4));
+		_mm_storeu_ps(out.values + 12, translation);
+	}
+
+	void PoseBatchEvaluator::ResizeStreams(int size)
+	{
+		List<float> * streams[] = { &rotationX, &rotationY, &rotationZ, &rotationW, &translationX, &translationY, &translationZ, &scaleX, &scaleY, &scaleZ };
+		// grow geometrically, since every added pose extends the streams
+		int capacity = rotationX.Capacity();
+		if (size > capacity)
+			capacity = Math::Max(size, capacity * 2);
+		for (auto stream : streams)
+		{
+			stream->Reserve(capacity);
+			stream->SetSize(size);
+		}
+	}
+
+	void PoseBatchEvaluator::SetBone(int index, const BoneTransformation & transform)
+	{
+		rotationX[index] = transform.Rotation.x;
+		rotationY[index] = transform.Rotation.y;
+		rotationZ[index] = transform.Rotation.z;
+		rotationW[index] = transform.Rotation.w;
+		translationX[index] = transform.Translation.x;
+		translationY[index] = transform.Translation.y;
+		translationZ[index] = transform.Translation.z;
+		scaleX[index] = transform.Scale.x;
+		scaleY[index] = transform.Scale.y;
+		scaleZ[index] = transform.Scale.z;
+	}
+
+	void PoseBatchEvaluator::Add(const Skeleton * skeleton, const Pose & pose, const VectorMath::Matrix4 & localTransform, VectorMath::Matrix4 * output,
+		bool multiplyInversePose, RetargetFile * retarget, VectorMath::Matrix4 * copy)
+	{
+		PoseEntry entry;
+		entry.skeleton = skeleton;
+		entry.inversePose = nullptr;
+		if (multiplyInversePose)
+			entry.inversePose = retarget ? retarget->RetargetedInversePose.Buffer() : skeleton->InversePose.Buffer();
+		entry.localTransform = localTransform;
+		entry.output = output;
+		entry.copy = copy;
+		entry.firstBone = rotationX.Count();
+		poses.Add(entry);
+
+		auto & bones = skeleton->Bones;
+		int streamSize = entry.firstBone + ((bones.Count() + BlockSize - 1) & ~(BlockSize - 1));
+		ResizeStreams(streamSize);
+
+		// same bone transform selection as Pose::GetMatrices
+		int mappedBoneCount = skeleton->BoneMapping.Count();
+		for (int i = 0; i < bones.Count(); i++)
+		{
+			if (i >= mappedBoneCount)
+			{
+				SetBone(entry.firstBone + i, bones[i].BindPose);
+				continue;
+			}
+			BoneTransformation transform = bones[i].BindPose;
+			if (retarget)
+			{
+				int targetId = retarget->ModelBoneIdToAnimationBoneId[i];
+				if (targetId != -1)
+					transform = pose.Transforms[targetId];
+				if (i == 0)
+				{
+					transform.Translation.x *= retarget->RootTranslationScale.x;
+					transform.Translation.y *= retarget->RootTranslationScale.y;
+					transform.Translation.z *= retarget->RootTranslationScale.z;
+				}
+				else
+					transform.Translation = retarget->RetargetedBoneOffsets[i];
+			}
+			else
+			{
+				if (i < pose.Transforms.Count())
+					transform = pose.Transforms[i];
+				if (i != 0)
+					transform.Translation = bones[i].BindPose.Translation;
+			}
+			SetBone(entry.firstBone + i, transform);
+		}
+		BoneTransformation identity;
+		for (int i = entry.firstBone + bones.Count(); i < streamSize; i++)
+			SetBone(i, identity);
+	}
+
+	void PoseBatchEvaluator::EvaluatePose(const PoseEntry & entry, bool useAVX)
+	{
+		int boneCount = entry.skeleton->Bones.Count();
+		if (boneCount == 0)
+			return;
+		BoneStreams streams;
+		streams.RotationX = rotationX.Buffer(); streams.RotationY = rotationY.Buffer();
+		streams.RotationZ = rotationZ.Buffer(); streams.RotationW = rotationW.Buffer();
+		streams.TranslationX = translationX.Buffer(); streams.TranslationY = translationY.Buffer();
+		streams.TranslationZ = translationZ.Buffer();
+		streams.ScaleX = scaleX.Buffer(); streams.ScaleY = scaleY.Buffer(); streams.ScaleZ = scaleZ.Buffer();
+		auto matrices = boneMatrices.Buffer() + entry.firstBone;
+		int blockEnd = entry.firstBone + ((boneCount + BlockSize - 1) & ~(BlockSize - 1));
+		if (useAVX)
+		{
+			for (int i = entry.firstBone; i < blockEnd; i += 8)
+				BoneBlockToMatricesAVX(streams, i, boneMatrices.Buffer() + i);
+		}
+		else
+		{
+			for (int i = entry.firstBone; i < blockEnd; i += 4)
+				BoneBlockToMatrices(streams, i, boneMatrices.Buffer() + i);
+		}
+
+		// bones are topologically sorted, so a parent is always transformed before its children;
+		// the local transform is applied to the root and inherited by all other bones
+		auto & bones = entry.skeleton->Bones;
+		MultiplyAffine(matrices[0], Matrix4_M128(entry.localTransform), matrices[0]);
+		for (int i = 1; i < boneCount; i++)
+			MultiplyAffine(matrices[i], Matrix4_M128(matrices[bones[i].ParentId]), matrices[i]);
+		for (int i = 0; i < boneCount; i++)
+		{
+			if (entry.inversePose)
+			{
+				Matrix4_M128 skinning;
+				Matrix4_M128(matrices[i]).Multiply(skinning, entry.inversePose[i]);
+				skinning.ToMatrix4(entry.output[i]);
+				if (entry.copy)
+					skinning.ToMatrix4(entry.copy[i]);
+			}
+			else
+			{
+				entry.output[i] = matrices[i];
+				if (entry.copy)
+					entry.copy[i] = matrices[i];
+			}
+		}
+	}
+
+	void PoseBatchEvaluator::Evaluate()
+	{
+		if (poses.Count() == 0)
+			return;
+		boneMatrices.SetSize(rotationX.Count());
+		bool useAVX = Threading::ParallelSystemInfo::IsAVXSupported();
+		Threading::JobSystem::Instance()->ParallelFor(0, poses.Count(), [&](int i)
+		{
+			EvaluatePose(poses[i], useAVX);
+		});
+		Clear();
+	}
+
+	void PoseBatchEvaluator::Clear()
+	{
+		poses.Clear();
+		rotationX.Clear(); rotationY.Clear(); rotationZ.Clear(); rotationW.Clear();
+		translationX.Clear(); translationY.Clear(); translationZ.Clear();
+		scaleX.Clear(); scaleY.Clear(); scaleZ.Clear();
+	}
+}
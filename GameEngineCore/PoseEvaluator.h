@@ -0,0 +1,50 @@
+#ifndef GAME_ENGINE_POSE_EVALUATOR_H
+#define GAME_ENGINE_POSE_EVALUATOR_H
+
+#include "Skeleton.h"
+
+namespace GameEngine
+{
+	// Evaluates the skinning matrices of many poses in one batch. The bone transforms of a pose are
+	// gathered into SoA streams when it is added, so the pose does not need to outlive the call.
+	// Evaluate() converts them to matrices 8 (AVX) or 4 (SSE) bones at a time, walks each hierarchy
+	// with SSE matrix products and writes localTransform * boneTransform * inversePose straight to the
+	// output of each pose, which is usually mapped uniform memory and is never read back.
+	// The results match Pose::GetMatrices followed by a multiplication with localTransform.
+	class PoseBatchEvaluator
+	{
+	private:
+		struct PoseEntry
+		{
+			const Skeleton * skeleton;
+			const VectorMath::Matrix4 * inversePose; // nullptr if the inverse pose is not applied
+			VectorMath::Matrix4 localTransform;
+			VectorMath::Matrix4 * output;
+			VectorMath::Matrix4 * copy; // optional second destination that can be read back
+			int firstBone;
+		};
+		CoreLib::List<PoseEntry> poses;
+		// bone streams of all added poses, the bones of each pose start at a multiple of BlockSize
+		CoreLib::List<float> rotationX, rotationY, rotationZ, rotationW;
+		CoreLib::List<float> translationX, translationY, translationZ;
+		CoreLib::List<float> scaleX, scaleY, scaleZ;
+		CoreLib::List<VectorMath::Matrix4> boneMatrices;
+		void ResizeStreams(int size);
+		void SetBone(int index, const BoneTransformation & transform);
+		void EvaluatePose(const PoseEntry & entry, bool useAVX);
+	public:
+		static const int BlockSize = 8;
+		// output (and copy, if not null) must hold skeleton->Bones.Count() matrices and stay valid until Evaluate()
+		void Add(const Skeleton * skeleton, const Pose & pose, const VectorMath::Matrix4 & localTransform, VectorMath::Matrix4 * output,
+			bool multiplyInversePose = true, RetargetFile * retarget = nullptr, VectorMath::Matrix4 * copy = nullptr);
+		// evaluates all added poses in parallel and clears the batch
+		void Evaluate();
+		void Clear();
+		int GetPoseCount()
+		{
+			return poses.Count();
+		}
+	};
+}
+
+#endif
@@ -38,6 +38,13 @@ namespace GameEngine
 	public:
 		virtual void ParseValue(CoreLib::Text::TokenReader & parser) = 0;
 		virtual void Serialize(CoreLib::StringBuilder & sb) = 0;
+		// Binary form stored in compiled level files. Properties returning false have no binary
+		// form and are stored as the text produced by Serialize.
+		virtual bool SerializeBinary(CoreLib::List<unsigned char> & /*buffer*/) { return false; }
+		virtual void ParseBinary(CoreLib::ArrayView<unsigned char> /*data*/)
+		{
+			throw CoreLib::NotSupportedException("property has no binary form.");
+		}
 	public:
 		CoreLib::Event<> OnChanged;
 		CoreLib::String GetStringValue()
@@ -104,6 +111,29 @@ namespace GameEngine
 	void Serialize(CoreLib::StringBuilder & sb, const VectorMath::Matrix4 & v);
 	void Serialize(CoreLib::StringBuilder & sb, bool v);
 
+	template<typename T>
+	inline void SerializeBinaryValue(CoreLib::List<unsigned char> & buffer, const T & value)
+	{
+		buffer.AddRange((const unsigned char *)&value, (int)sizeof(T));
+	}
+	inline void SerializeBinaryValue(CoreLib::List<unsigned char> & buffer, const CoreLib::String & value)
+	{
+		buffer.AddRange((const unsigned char *)value.Buffer(), value.Length());
+	}
+	template<typename T>
+	inline void ParseBinaryValue(CoreLib::ArrayView<unsigned char> data, T & value)
+	{
+		if (data.Count() != (int)sizeof(T))
+			throw CoreLib::ArgumentException("binary property value has the wrong size.");
+		memcpy(&value, data.Buffer(), sizeof(T));
+	}
+	inline void ParseBinaryValue(CoreLib::ArrayView<unsigned char> data, CoreLib::String & value)
+	{
+		CoreLib::StringBuilder sb(data.Count());
+		sb.Append((const char *)data.Buffer(), data.Count());
+		value = sb.ProduceString();
+	}
+
 #define PROPERTY_ATTRIB(type, name, attrib) GameEngine::GenericProperty<type> name = GameEngine::GenericProperty<type>(this, #name "\0" #type "\0" attrib, type());
 #define PROPERTY_DEF_ATTRIB(type, name, value, attrib) GameEngine::GenericProperty<type> name = GameEngine::GenericProperty<type>(this, #name "\0" #type "\0" attrib, value);
 #define PROPERTY(type, name) GameEngine::GenericProperty<type> name = GameEngine::GenericProperty<type>(this,  #name "\0" #type "\0\0", type());
@@ -239,6 +269,18 @@ namespace GameEngine
 			OnChanging(newValue);
 			value = newValue;
 		}
+		virtual bool SerializeBinary(CoreLib::List<unsigned char> & buffer) override
+		{
+			SerializeBinaryValue(buffer, value);
+			return true;
+		}
+		virtual void ParseBinary(CoreLib::ArrayView<unsigned char> data) override
+		{
+			T newValue;
+			ParseBinaryValue(data, newValue);
+			OnChanging(newValue);
+			value = newValue;
+		}
 	public:
 		PUBLIC_METHODS(T)
 	};
@@ -308,6 +350,19 @@ namespace GameEngine
             value = newValue;\
 			OnChanged();\
 		}\
+		virtual bool SerializeBinary(CoreLib::List<unsigned char> & buffer) override\
+		{\
+			SerializeBinaryValue(buffer, value);\
+			return true;\
+		}\
+		virtual void ParseBinary(CoreLib::ArrayView<unsigned char> data) override\
+		{\
+			type newValue;\
+			ParseBinaryValue(data, newValue);\
+			OnChanging(newValue);\
+			value = newValue;\
+			OnChanged();\
+		}\
 		PUBLIC_METHODS(type)\
 	};
 	BASIC_TYPE_PROPERTY(int, ReadInt, value)
@@ -337,6 +392,19 @@ namespace GameEngine
 			value = newValue;
 			OnChanged();
 		}
+		virtual bool SerializeBinary(CoreLib::List<unsigned char> & buffer) override
+		{
+			SerializeBinaryValue(buffer, value);
+			return true;
+		}
+		virtual void ParseBinary(CoreLib::ArrayView<unsigned char> data) override
+		{
+			bool newValue;
+			ParseBinaryValue(data, newValue);
+			OnChanging(newValue);
+			value = newValue;
+			OnChanged();
+		}
 	public:
 		PUBLIC_METHODS(bool)
 	};
@@ -367,6 +435,19 @@ namespace GameEngine
 				values(newValue, i) = parser.ReadFloat();\
 			parser.Read("]");\
 			OnChanging(newValue);\
+            value = newValue;\
+			OnChanged();\
+		}\
+		virtual bool SerializeBinary(CoreLib::List<unsigned char> & buffer) override\
+		{\
+			SerializeBinaryValue(buffer, value);\
+			return true;\
+		}\
+		virtual void ParseBinary(CoreLib::ArrayView<unsigned char> data) override\
+		{\
+			VectorMath::type newValue;\
+			ParseBinaryValue(data, newValue);\
+			OnChanging(newValue);\
             value = newValue;\
 			OnChanged();\
 		}\
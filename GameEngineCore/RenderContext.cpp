@@ -7,6 +7,9 @@
 #include "TextureCompressor.h"
 #include "WorldRenderPass.h"
 #include "CoreLib/LibIO.h"
+#include "CoreLib/RadixSort.h"
+#include "CoreLib/JobSystem.h"
+#include "CoreLib/Profiler.h"
 #include "CoreLib/Graphics/TextureFile.h"
 #include <assert.h>
 
@@ -14,6 +17,7 @@ namespace GameEngine
 {
 	using namespace CoreLib;
 	using namespace CoreLib::IO;
+	using namespace CoreLib::Threading;
 	using namespace VectorMath;
 
 	String GetSpireOutput(SpireDiagnosticSink * sink)
@@ -83,16 +87,20 @@ namespace GameEngine
 	{
 		if (type != DrawableType::Static)
 			throw InvalidOperationException("cannot update non-static drawable with static transform data.");
-		if (!transformModule->UniformMemory)
+		if (!transformModule->HasUniformBuffer())
 			throw InvalidOperationException("invalid buffer.");
+		if (memcmp(&transform, &localTransform, sizeof(Matrix4)) != 0)
+			transformChangeFrame = Engine::Instance()->GetFrameId();
+		transform = localTransform;
 		transformModule->SetUniformData((void*)&localTransform, sizeof(Matrix4));
 	}
 
-	void Drawable::UpdateTransformUniform(const VectorMath::Matrix4 & localTransform, const Pose & pose, RetargetFile * retarget)
+	void Drawable::UpdateTransformUniform(const VectorMath::Matrix4 & localTransform, const Pose & pose, RetargetFile * retarget,
+		bool keepCopy)
 	{
 		if (type != DrawableType::Skeletal)
 			throw InvalidOperationException("cannot update static drawable with skeletal transform data.");
-		if (!transformModule->UniformMemory)
+		if (!transformModule->HasUniformBuffer())
 			throw InvalidOperationException("invalid buffer.");
 
 		const int poseMatrixSize = skeleton->Bones.Count() * sizeof(Matrix4);
@@ -100,24 +108,93 @@ namespace GameEngine
 		// ensure allocated transform buffer is sufficient
 		_ASSERT(transformModule->BufferLength >= poseMatrixSize);
 
+		if (keepCopy)
+		{
+			poseCopy.SetSize(skeleton->Bones.Count());
+			poseCopyTransform = localTransform;
+		}
+		else
+			poseCopy.Clear();
+		if (transformModule->TransientMemory)
+		{
+			// the pose is evaluated with the rest of the frame's batch directly into the mapped uniform buffer
+			if (auto matrices = (Matrix4*)transformModule->MapUniformData(poseMatrixSize))
+				scene->poseEvaluator.Add(skeleton, pose, localTransform, matrices, true, retarget, keepCopy ? poseCopy.Buffer() : nullptr);
+			else
+				poseCopy.Clear();
+			return;
+		}
 		List<Matrix4> matrices;
 		pose.GetMatrices(skeleton, matrices, true, retarget);
 		for (int i = 0; i < matrices.Count(); i++)
 		{
 			Matrix4::Multiply(matrices[i], localTransform, matrices[i]);
 		}
+		if (keepCopy)
+			poseCopy = matrices;
 		transformModule->SetUniformData((void*)matrices.Buffer(), sizeof(Matrix4) * matrices.Count());
 	}
+
+	bool Drawable::ReuseTransformUniform(const VectorMath::Matrix4 & localTransform)
+	{
+		if (type != DrawableType::Skeletal)
+			throw InvalidOperationException("cannot update static drawable with skeletal transform data.");
+		if (poseCopy.Count() == 0)
+			return false;
+		// the transient uniform memory of the last update has been recycled, so the matrices are always written again
+		const int poseMatrixSize = poseCopy.Count() * sizeof(Matrix4);
+		if (memcmp(&localTransform, &poseCopyTransform, sizeof(Matrix4)) == 0)
+		{
+			transformModule->SetUniformData((void*)poseCopy.Buffer(), poseMatrixSize);
+			return true;
+		}
+		Matrix4 invCopyTransform, delta;
+		poseCopyTransform.Inverse(invCopyTransform);
+		Matrix4::Multiply(delta, localTransform, invCopyTransform);
+		if (transformModule->TransientMemory)
+		{
+			if (auto matrices = (Matrix4*)transformModule->MapUniformData(poseMatrixSize))
+			{
+				// the mapped memory is write-combined, so each matrix is computed aside and stored once
+				for (int i = 0; i < poseCopy.Count(); i++)
+				{
+					Matrix4 matrix;
+					Matrix4::Multiply(matrix, delta, poseCopy[i]);
+					matrices[i] = matrix;
+				}
+			}
+			return true;
+		}
+		List<Matrix4> matrices;
+		matrices.SetSize(poseCopy.Count());
+		for (int i = 0; i < poseCopy.Count(); i++)
+			Matrix4::Multiply(matrices[i], delta, poseCopy[i]);
+		transformModule->SetUniformData((void*)matrices.Buffer(), poseMatrixSize);
+		return true;
+	}
     RefPtr<DrawableMesh> SceneResource::CreateDrawableMesh(Mesh * mesh)
     {
         RefPtr<DrawableMesh> result = new DrawableMesh(rendererResource);
-        result->vertexBufferOffset = (int)((char*)rendererResource->vertexBufferMemory.Alloc(mesh->GetVertexCount() * mesh->GetVertexSize()) - (char*)rendererResource->vertexBufferMemory.BufferPtr());
-        result->indexBufferOffset = (int)((char*)rendererResource->indexBufferMemory.Alloc(mesh->Indices.Count() * sizeof(mesh->Indices[0])) - (char*)rendererResource->indexBufferMemory.BufferPtr());
         result->vertexFormat = rendererResource->pipelineManager.LoadVertexFormat(mesh->GetVertexFormat());
+        int vertexDataSize = mesh->GetVertexCount() * result->vertexFormat.Size();
+        int indexDataSize = mesh->Indices.Count() * sizeof(mesh->Indices[0]);
+        auto vertexOffset = rendererResource->vertexBufferMemory.Alloc(vertexDataSize);
+        auto indexOffset = rendererResource->indexBufferMemory.Alloc(indexDataSize);
+        if ((vertexDataSize && vertexOffset == DeviceHeap::InvalidOffset) || (indexDataSize && indexOffset == DeviceHeap::InvalidOffset))
+        {
+            if (vertexOffset != DeviceHeap::InvalidOffset)
+                rendererResource->vertexBufferMemory.Free(vertexOffset);
+            if (indexOffset != DeviceHeap::InvalidOffset)
+                rendererResource->indexBufferMemory.Free(indexOffset);
+            throw OutofPoolMemoryException();
+        }
+        // the hardware renderer addresses buffers with 32-bit offsets
+        result->vertexBufferOffset = (int)vertexOffset;
+        result->indexBufferOffset = (int)indexOffset;
         result->vertexCount = mesh->GetVertexCount();
-        rendererResource->indexBufferMemory.SetDataAsync(result->indexBufferOffset, mesh->Indices.Buffer(), mesh->Indices.Count() * sizeof(mesh->Indices[0]));
-        rendererResource->vertexBufferMemory.SetDataAsync(result->vertexBufferOffset, mesh->GetVertexBuffer(), mesh->GetVertexCount() * result->vertexFormat.Size());
         result->indexCount = mesh->Indices.Count();
+        rendererResource->indexBufferMemory.SetDataAsync(indexOffset, mesh->Indices.Buffer(), indexDataSize);
+        rendererResource->vertexBufferMemory.SetDataAsync(vertexOffset, mesh->GetVertexBuffer(), vertexDataSize);
         return result;
     }
 	RefPtr<DrawableMesh> SceneResource::LoadDrawableMesh(Mesh * mesh)
@@ -205,39 +282,46 @@ namespace GameEngine
 		textures[name] = rs;
 		return rs;
 	}
-	Texture2D * SceneResource::LoadTexture(const String & filename)
+	bool SceneResource::ReadTextureFile(const String & filename, CoreLib::Graphics::TextureFile & file)
 	{
-		RefPtr<Texture2D> value;
-		if (textures.TryGetValue(filename, value))
-			return value.Ptr();
-
 		auto actualFilename = Engine::Instance()->FindFile(Path::ReplaceExt(filename, "texture"), ResourceType::Texture);
 		if (!actualFilename.Length())
 			actualFilename = Engine::Instance()->FindFile(filename, ResourceType::Texture);
-		if (actualFilename.Length())
+		if (!actualFilename.Length())
+			return false;
+		if (actualFilename.ToLower().EndsWith(".texture"))
 		{
-			if (actualFilename.ToLower().EndsWith(".texture"))
-			{
-				CoreLib::Graphics::TextureFile file(actualFilename);
-				return LoadTexture2D(filename, file);
-			}
-			else
-			{
-				CoreLib::Imaging::Bitmap bmp(actualFilename);
-				List<unsigned int> pixelsInversed;
-				int * sourcePixels = (int*)bmp.GetPixels();
-				pixelsInversed.SetSize(bmp.GetWidth() * bmp.GetHeight());
-				for (int i = 0; i < bmp.GetHeight(); i++)
-				{
-					for (int j = 0; j < bmp.GetWidth(); j++)
-						pixelsInversed[i*bmp.GetWidth() + j] = sourcePixels[(bmp.GetHeight() - 1 - i)*bmp.GetWidth() + j];
-				}
-				CoreLib::Graphics::TextureFile texFile;
-				TextureCompressor::CompressRGBA_BC1(texFile, MakeArrayView((unsigned char*)pixelsInversed.Buffer(), pixelsInversed.Count() * 4), bmp.GetWidth(), bmp.GetHeight());
-				texFile.SaveToFile(Path::ReplaceExt(actualFilename, "texture"));
-				return LoadTexture2D(filename, texFile);
-			}
+			file = CoreLib::Graphics::TextureFile(actualFilename);
+			return true;
 		}
+		CoreLib::Imaging::Bitmap bmp(actualFilename);
+		List<unsigned int> pixelsInversed;
+		int * sourcePixels = (int*)bmp.GetPixels();
+		pixelsInversed.SetSize(bmp.GetWidth() * bmp.GetHeight());
+		for (int i = 0; i < bmp.GetHeight(); i++)
+		{
+			for (int j = 0; j < bmp.GetWidth(); j++)
+				pixelsInversed[i*bmp.GetWidth() + j] = sourcePixels[(bmp.GetHeight() - 1 - i)*bmp.GetWidth() + j];
+		}
+		TextureCompressor::CompressRGBA_BC1(file, MakeArrayView((unsigned char*)pixelsInversed.Buffer(), pixelsInversed.Count() * 4), bmp.GetWidth(), bmp.GetHeight());
+		file.SaveToFile(Path::ReplaceExt(actualFilename, "texture"));
+		return true;
+	}
+	Texture2D * SceneResource::FindTexture(const String & filename)
+	{
+		RefPtr<Texture2D> value;
+		textures.TryGetValue(filename, value);
+		return value.Ptr();
+	}
+	Texture2D * SceneResource::LoadTexture(const String & filename)
+	{
+		RefPtr<Texture2D> value;
+		if (textures.TryGetValue(filename, value))
+			return value.Ptr();
+
+		CoreLib::Graphics::TextureFile file;
+		if (ReadTextureFile(filename, file))
+			return LoadTexture2D(filename, file);
 		else
 		{
 			Print("cannot load texture '%S'\n", filename.ToWString());
@@ -383,6 +467,7 @@ namespace GameEngine
 		Destroy();
 		meshes = CoreLib::EnumerableDictionary<CoreLib::String, RefPtr<DrawableMesh>>();
 		textures = EnumerableDictionary<String, RefPtr<Texture2D>>();
+		poseEvaluator.Clear();
 		if (spireEnv)
 			spReleaseEnvironment(spireEnv);
 		spireEnv = spCreateEnvironment(spireContext, sharedSpireEnv);
@@ -427,6 +512,8 @@ namespace GameEngine
 			graphicsSettings.ShadowMapArraySize, 1, StorageFormat::Depth32);
 		shadowMapArrayFreeBits.SetMax(graphicsSettings.ShadowMapArraySize);
 		shadowMapArrayFreeBits.Clear();
+		persistentShadowMaps.SetMax(graphicsSettings.ShadowMapArraySize);
+		persistentShadowMaps.Clear();
 		shadowMapArraySize = graphicsSettings.ShadowMapArraySize;
 
 		shadowMapRenderTargetLayout = hwRenderer->CreateRenderTargetLayout(MakeArrayView(AttachmentLayout(TextureUsage::SampledDepthAttachment, StorageFormat::Depth32)));
@@ -456,6 +543,15 @@ namespace GameEngine
 	void ShadowMapResource::Reset()
 	{
 		shadowMapArrayFreeBits.Clear();
+		shadowMapArrayFreeBits.UnionWith(persistentShadowMaps);
+	}
+
+	int ShadowMapResource::AllocPersistentShadowMaps(int count)
+	{
+		int id = AllocShadowMaps(count);
+		for (int i = id; id != -1 && i < id + count; i++)
+			persistentShadowMaps.Add(i);
+		return id;
 	}
 
 	int ShadowMapResource::AllocShadowMaps(int count)
@@ -494,6 +590,7 @@ namespace GameEngine
 		{
 			assert(shadowMapArrayFreeBits.Contains(i));
 			shadowMapArrayFreeBits.Remove(i);
+			persistentShadowMaps.Remove(i);
 		}
 	}
 
@@ -508,12 +605,29 @@ namespace GameEngine
 	}
 
 	void RendererResource::CreateModuleInstance(ModuleInstance & rs, SpireModule * shaderModule, DeviceMemory * uniformMemory, int uniformBufferSize)
+	{
+		CreateModuleInstance(rs, shaderModule, uniformMemory, nullptr, uniformBufferSize);
+	}
+
+	void RendererResource::CreateModuleInstance(ModuleInstance & rs, SpireModule * shaderModule, TransientDeviceMemory * transientMemory, int uniformBufferSize)
+	{
+		CreateModuleInstance(rs, shaderModule, nullptr, transientMemory, uniformBufferSize);
+	}
+
+	void RendererResource::CreateModuleInstance(ModuleInstance & rs, SpireModule * shaderModule, DeviceMemory * uniformMemory, TransientDeviceMemory * transientMemory, int uniformBufferSize)
 	{
 		rs.Init(spireContext, shaderModule);
 
 		rs.BindingName = spGetModuleName(shaderModule);
 		rs.BufferLength = Math::Max(spModuleGetParameterBufferSize(shaderModule), uniformBufferSize);
-		if (rs.BufferLength > 0)
+		rs.UniformMemory = nullptr;
+		rs.TransientMemory = nullptr;
+		if (rs.BufferLength > 0 && transientMemory)
+		{
+			rs.BufferLength = Math::RoundUpToAlignment(rs.BufferLength, hardwareRenderer->UniformBufferAlignment());
+			rs.TransientMemory = transientMemory;
+		}
+		else if (rs.BufferLength > 0 && uniformMemory)
 		{
 			rs.BufferLength = Math::RoundUpToAlignment(rs.BufferLength, hardwareRenderer->UniformBufferAlignment());;
 			auto ptr = (unsigned char *)uniformMemory->Alloc(rs.BufferLength * DynamicBufferLengthMultiplier);
@@ -521,15 +635,13 @@ namespace GameEngine
 			rs.BufferOffset = (int)(ptr - (unsigned char*)uniformMemory->BufferPtr());
 			assert(rs.BufferOffset%hardwareRenderer->UniformBufferAlignment() == 0);
 		}
-		else
-			rs.UniformMemory = nullptr;
 		
 		RefPtr<DescriptorSetLayout> layout;
 		if (!descLayouts.TryGetValue(spGetModuleUID(shaderModule), layout))
 		{
 			int paramCount = spModuleGetParameterCount(shaderModule);
 			List<DescriptorLayout> descs;
-			if (rs.UniformMemory)
+			if (rs.HasUniformBuffer())
 				descs.Add(DescriptorLayout(sfGraphics, 0, BindingType::UniformBuffer));
 			for (int i = 0; i < paramCount; i++)
 			{
@@ -651,8 +763,10 @@ namespace GameEngine
 		
 		pipelineManager.Init(spireContext, sharedSpireEnvironment, hardwareRenderer.Ptr(), &renderStats);
 
-		indexBufferMemory.Init(hardwareRenderer.Ptr(), BufferUsage::IndexBuffer, false, 26, 256);
-		vertexBufferMemory.Init(hardwareRenderer.Ptr(), BufferUsage::ArrayBuffer, false, 28, 256);
+		indexBufferMemory.Init(hardwareRenderer.Ptr(), BufferUsage::IndexBuffer, 26, 256);
+		vertexBufferMemory.Init(hardwareRenderer.Ptr(), BufferUsage::ArrayBuffer, 28, 256);
+		transientUniformMemory.Init(hardwareRenderer.Ptr(), BufferUsage::UniformBuffer, 23, DynamicBufferLengthMultiplier, hardwareRenderer->UniformBufferAlignment());
+		transientStorageMemory.Init(hardwareRenderer.Ptr(), BufferUsage::StorageBuffer, 22, DynamicBufferLengthMultiplier, hardwareRenderer->StorageBufferAlignment());
 
 		spireSink = spCreateDiagnosticSink(spireContext);
 		envMapArray = hardwareRenderer->CreateTextureCubeArray(TextureUsage::SampledColorAttachment, EnvMapSize, Math::Log2Floor(EnvMapSize) + 1, MaxEnvMapCount, StorageFormat::RGBA_F16);
@@ -702,6 +816,13 @@ namespace GameEngine
 		FixedWidth = Width = w;
 		FixedHeight = Height = h;
 	}
+	DrawableMesh::DrawableMesh(RendererSharedResource * pRenderRes)
+	{
+		static int idAlloc = 0;
+		Id = idAlloc;
+		idAlloc++;
+		renderRes = pRenderRes;
+	}
 	Buffer * DrawableMesh::GetVertexBuffer()
 	{
 		return renderRes->vertexBufferMemory.GetBuffer();
@@ -713,9 +834,9 @@ namespace GameEngine
 	DrawableMesh::~DrawableMesh()
 	{
 		if (vertexCount)
-			renderRes->vertexBufferMemory.Free((char*)renderRes->vertexBufferMemory.BufferPtr() + vertexBufferOffset, vertexCount * vertexFormat.Size());
+			renderRes->vertexBufferMemory.Free(vertexBufferOffset);
 		if (indexCount)
-			renderRes->indexBufferMemory.Free((char*)renderRes->indexBufferMemory.BufferPtr() + indexBufferOffset, indexCount * sizeof(int));
+			renderRes->indexBufferMemory.Free(indexBufferOffset);
 	}
 	
 	inline void BindDescSet(DescriptorSet** curStates, CommandBuffer* cmdBuf, int id, DescriptorSet * descSet)
@@ -727,65 +848,113 @@ namespace GameEngine
 		}
 	}
 
+	// an instanced draw only pays off over the per-frame upload of its transforms with several instances
+	const int MinInstancesPerDraw = 4;
+	const int MaxInstancesPerDraw = 1024;
+
+	int WorldPassRenderTask::GetInstanceRunLength(CoreLib::ArrayView<Drawable*> drawables, int first)
+	{
+		auto obj = drawables[first];
+		if (obj->GetType() != DrawableType::Static)
+			return 1;
+		auto range = obj->GetElementRange();
+		int end = first + 1;
+		int maxEnd = Math::Min(drawables.Count(), first + MaxInstancesPerDraw);
+		while (end < maxEnd)
+		{
+			auto next = drawables[end];
+			auto nextRange = next->GetElementRange();
+			if (next->GetType() != DrawableType::Static || next->GetMesh() != obj->GetMesh() || next->GetMaterial() != obj->GetMaterial() ||
+				nextRange.StartIndex != range.StartIndex || nextRange.Count != range.Count)
+				break;
+			end++;
+		}
+		return end - first;
+	}
+
+	int WorldPassRenderTask::RecordDrawChunk(CommandBuffer * cmdBuf, DescriptorSetBindingArray & bindings, CoreLib::ArrayView<Drawable*> drawables, int begin, int end)
+	{
+		int shaderCount = 0;
+		cmdBuf->SetViewport(viewport.X, viewport.Y, viewport.Width, viewport.Height);
+		if (begin == 0 && clearOutput)
+			cmdBuf->ClearAttachments(renderOutput->GetFrameBuffer());
+		for (int i = 0; i < bindings.Count(); i++)
+			cmdBuf->BindDescriptorSet(i, bindings[i]);
+		if (begin == end)
+			return shaderCount;
+		Array<DescriptorSet*, 32> boundSets;
+		boundSets.SetSize(boundSets.GetCapacity());
+		for (auto & descSet : boundSets)
+			descSet = (DescriptorSet*)-1;
+		PipelineClass * lastPipeline = nullptr;
+		DrawableMesh * lastMesh = nullptr;
+		Material * lastMaterial = drawables[drawItems[begin].First]->GetMaterial();
+		cmdBuf->BindIndexBuffer(drawables[drawItems[begin].First]->GetMesh()->GetIndexBuffer(), 0);
+		BindDescSet(boundSets.Buffer(), cmdBuf, bindings.Count(), lastMaterial->MaterialGeometryModule.GetCurrentDescriptorSet());
+		BindDescSet(boundSets.Buffer(), cmdBuf, bindings.Count() + 1, lastMaterial->MaterialPatternModule.GetCurrentDescriptorSet());
+		for (int i = begin; i < end; i++)
+		{
+			auto & item = drawItems[i];
+			auto obj = drawables[item.First];
+			if (item.Pipeline != lastPipeline)
+			{
+				cmdBuf->BindPipeline(item.Pipeline->pipeline.Ptr());
+				lastPipeline = item.Pipeline;
+				shaderCount++;
+			}
+			auto newMaterial = obj->GetMaterial();
+			if (newMaterial != lastMaterial)
+			{
+				BindDescSet(boundSets.Buffer(), cmdBuf, bindings.Count(), newMaterial->MaterialGeometryModule.GetCurrentDescriptorSet());
+				BindDescSet(boundSets.Buffer(), cmdBuf, bindings.Count() + 1, newMaterial->MaterialPatternModule.GetCurrentDescriptorSet());
+				lastMaterial = newMaterial;
+			}
+			BindDescSet(boundSets.Buffer(), cmdBuf, bindings.Count() + 2, item.TransformModule->GetCurrentDescriptorSet());
+			auto mesh = obj->GetMesh();
+			if (mesh != lastMesh)
+			{
+				cmdBuf->BindVertexBuffer(mesh->GetVertexBuffer(), mesh->vertexBufferOffset);
+				lastMesh = mesh;
+			}
+			BindDescSet(boundSets.Buffer(), cmdBuf, bindings.Count() + 3, nullptr);
+
+			auto range = obj->GetElementRange();
+			if (item.Count > 1)
+				cmdBuf->DrawIndexedInstanced(item.Count, mesh->indexBufferOffset / sizeof(int) + range.StartIndex, range.Count);
+			else
+				cmdBuf->DrawIndexed(mesh->indexBufferOffset / sizeof(int) + range.StartIndex, range.Count);
+		}
+		return shaderCount;
+	}
+
 	void WorldPassRenderTask::SetFixedOrderDrawContent(PipelineContext & pipelineManager, CoreLib::ArrayView<Drawable*> drawables)
 	{
 		// Note: Intel's vulkan driver seem to have a limit on the size of a secondary command buffer
 		// to play safe, we create multiple secondary command buffers, each holds 128 draw calls.
+		const int drawsPerCommandBuffer = 128;
 		commandBuffers.Clear();
 		apiCommandBuffers.Clear();
 		renderOutput->GetSize(viewport.Width, viewport.Height);
-		auto cmd0 = pass->AllocCommandBuffer();
-		commandBuffers.Add(cmd0);
-		auto cmdBuf = cmd0->BeginRecording(renderOutput->GetFrameBuffer());
-		apiCommandBuffers.Add(cmdBuf);
-		cmdBuf->SetViewport(viewport.X, viewport.Y, viewport.Width, viewport.Height);
-		if (clearOutput)
-			cmdBuf->ClearAttachments(renderOutput->GetFrameBuffer());
 		DescriptorSetBindingArray bindings;
 		pipelineManager.GetBindings(bindings);
-		for (int i = 0; i < bindings.Count(); i++)
-			cmdBuf->BindDescriptorSet(i, bindings[i]);
-		PipelineClass * lastPipeline = nullptr;
-		numDrawCalls = 0;
 		numMaterials = 0;
 		numShaders = 0;
-		Array<DescriptorSet*, 32> boundSets;
-		boundSets.SetSize(boundSets.GetCapacity());
-		for (auto & descSet : boundSets)
-			descSet = (DescriptorSet*)-1;
-		DrawableMesh * lastMesh = nullptr;
+
+		// pipeline lookup may compile shaders and mutates the module stack of pipelineManager,
+		// so resolve all draw calls up front on this thread
+		drawItems.Clear();
 		if (drawables.Count())
 		{
+			PROFILE_ZONE("ResolvePipelines");
 			Material* lastMaterial = drawables[0]->GetMaterial();
 			pipelineManager.SetCullMode(lastMaterial->IsDoubleSided ? CullMode::Disabled : CullMode::CullBackFace);
-
-			cmdBuf->BindIndexBuffer(drawables[0]->GetMesh()->GetIndexBuffer(), 0);
 			pipelineManager.PushModuleInstance(&lastMaterial->MaterialGeometryModule);
 			pipelineManager.PushModuleInstance(&lastMaterial->MaterialPatternModule);
 			numMaterials++;
-			BindDescSet(boundSets.Buffer(), cmdBuf, bindings.Count(), lastMaterial->MaterialGeometryModule.GetCurrentDescriptorSet());
-			BindDescSet(boundSets.Buffer(), cmdBuf, bindings.Count() + 1, lastMaterial->MaterialPatternModule.GetCurrentDescriptorSet());
-			for (auto obj : drawables)
+			int i = 0;
+			while (i < drawables.Count())
 			{
-				numDrawCalls++;
-				if ((numDrawCalls & 127) == 0)
-				{
-					cmdBuf->EndRecording();
-					auto cmd = pass->AllocCommandBuffer();
-					commandBuffers.Add(cmd);
-					cmdBuf = cmd->BeginRecording(renderOutput->GetFrameBuffer());
-					cmdBuf->SetViewport(viewport.X, viewport.Y, viewport.Width, viewport.Height);
-					apiCommandBuffers.Add(cmdBuf);
-					for (int i = 0; i < boundSets.Count(); i++)
-						boundSets[i] = (DescriptorSet*)-1;
-					for (int i = 0; i < bindings.Count(); i++)
-						cmdBuf->BindDescriptorSet(i, bindings[i]);
-					cmdBuf->BindIndexBuffer(obj->GetMesh()->GetIndexBuffer(), 0);
-					BindDescSet(boundSets.Buffer(), cmdBuf, bindings.Count(), lastMaterial->MaterialGeometryModule.GetCurrentDescriptorSet());
-					BindDescSet(boundSets.Buffer(), cmdBuf, bindings.Count() + 1, lastMaterial->MaterialPatternModule.GetCurrentDescriptorSet());
-					lastPipeline = nullptr;
-					lastMesh = nullptr;
-				}
+				auto obj = drawables[i];
 				auto newMaterial = obj->GetMaterial();
 				if (newMaterial != lastMaterial)
 				{
@@ -795,46 +964,101 @@ namespace GameEngine
 					pipelineManager.PushModuleInstance(&newMaterial->MaterialGeometryModule);
 					pipelineManager.PushModuleInstance(&newMaterial->MaterialPatternModule);
 					pipelineManager.SetCullMode(newMaterial->IsDoubleSided ? CullMode::Disabled : CullMode::CullBackFace);
+					lastMaterial = newMaterial;
 				}
-				pipelineManager.PushModuleInstanceNoShaderChange(obj->GetTransformModule());
-				if (auto pipelineInst = obj->GetPipeline(renderPassId, pipelineManager))
+				DrawItem item;
+				item.First = i;
+				item.Count = 1;
+				item.TransformModule = obj->GetTransformModule();
+				int runLength = GetInstanceRunLength(drawables, i);
+				if (runLength >= MinInstancesPerDraw)
 				{
-					if (pipelineInst != lastPipeline)
+					// falls back to one draw call per drawable when the per-frame storage memory is exhausted
+					if (auto instanceModule = pass->AllocInstanceTransformModule(MakeArrayView(drawables.Buffer() + i, runLength)))
 					{
-						cmdBuf->BindPipeline(pipelineInst->pipeline.Ptr());
-						lastPipeline = pipelineInst;
-						numShaders++;
+						item.Count = runLength;
+						item.TransformModule = instanceModule;
 					}
-					auto mesh = obj->GetMesh();
-					if (newMaterial != lastMaterial)
-					{
-						BindDescSet(boundSets.Buffer(), cmdBuf, bindings.Count(), newMaterial->MaterialGeometryModule.GetCurrentDescriptorSet());
-						BindDescSet(boundSets.Buffer(), cmdBuf, bindings.Count() + 1, newMaterial->MaterialPatternModule.GetCurrentDescriptorSet());
-					}
-					BindDescSet(boundSets.Buffer(), cmdBuf, bindings.Count() + 2, obj->GetTransformModule()->GetCurrentDescriptorSet());
-					if (mesh != lastMesh)
-					{
-						cmdBuf->BindVertexBuffer(mesh->GetVertexBuffer(), mesh->vertexBufferOffset);
-						lastMesh = mesh;
-					}
-					BindDescSet(boundSets.Buffer(), cmdBuf, bindings.Count() + 3, nullptr);
-
-					auto range = obj->GetElementRange();
-					cmdBuf->DrawIndexed(mesh->indexBufferOffset / sizeof(int) + range.StartIndex, range.Count);
 				}
+				// the transform module decides between the instanced and the regular pipeline,
+				// so its change must be tracked for the pipeline lookup
+				pipelineManager.PushModuleInstance(item.TransformModule);
+				if (item.Count > 1)
+					item.Pipeline = pipelineManager.GetPipeline(&obj->GetVertexFormat());
 				else
-					throw "error";
-				lastMaterial = newMaterial;
+					item.Pipeline = obj->GetPipeline(renderPassId, pipelineManager);
 				pipelineManager.PopModuleInstance();
+				if (!item.Pipeline)
+					throw "error";
+				drawItems.Add(item);
+				i += item.Count;
 			}
 			pipelineManager.PopModuleInstance();
 			pipelineManager.PopModuleInstance();
 		}
-		cmdBuf->EndRecording();
+		numDrawCalls = drawItems.Count();
+
+		// command buffers are pooled by the pass and must be allocated on this thread,
+		// each one is then recorded independently and submitted in order
+		int chunkCount = Math::Max(1, (drawItems.Count() + drawsPerCommandBuffer - 1) / drawsPerCommandBuffer);
+		for (int i = 0; i < chunkCount; i++)
+		{
+			auto cmd = pass->AllocCommandBuffer();
+			commandBuffers.Add(cmd);
+			apiCommandBuffers.Add(cmd->BeginRecording(renderOutput->GetFrameBuffer()));
+		}
+		chunkShaderCounts.SetSize(chunkCount);
+		JobSystem::Instance()->ParallelFor(0, chunkCount, [&](int chunk)
+		{
+			PROFILE_ZONE("RecordDrawCommands");
+			int begin = chunk * drawsPerCommandBuffer;
+			int end = Math::Min(begin + drawsPerCommandBuffer, drawItems.Count());
+			auto cmdBuf = apiCommandBuffers[chunk];
+			chunkShaderCounts[chunk] = RecordDrawChunk(cmdBuf, bindings, drawables, begin, end);
+			cmdBuf->EndRecording();
+		}, 1);
+		for (auto count : chunkShaderCounts)
+			numShaders += count;
+	}
+	// the bit pattern of a non-negative float increases with its value, so its high bits quantize
+	// distances with constant relative precision and no fixed range
+	inline unsigned long long QuantizeDistance(float distance, int bits)
+	{
+		float clampedDistance = Math::Max(distance, 0.0f);
+		unsigned int floatBits;
+		memcpy(&floatBits, &clampedDistance, sizeof(float));
+		return (floatBits >> (31 - bits)) & ((1ull << bits) - 1);
+	}
+
+	// key layout, from the most significant bit:
+	// state sorted:  pass 4 | pipeline 16 | material 16 | mesh 12 | distance 16
+	// back to front: pass 4 | inverted distance 24 | pipeline 12 | material 12 | mesh 12
+	inline unsigned long long GetDrawSortKey(DrawOrder order, int passId, int pipelineId, int materialId, int meshId, float distance)
+	{
+		unsigned long long key = (unsigned long long)(passId & 0xF) << 60;
+		if (order == DrawOrder::StateSorted)
+		{
+			key |= (unsigned long long)(pipelineId & 0xFFFF) << 44;
+			key |= (unsigned long long)(materialId & 0xFFFF) << 28;
+			key |= (unsigned long long)(meshId & 0xFFF) << 16;
+			key |= QuantizeDistance(distance, 16);
+		}
+		else
+		{
+			key |= (0xFFFFFFull - QuantizeDistance(distance, 24)) << 36;
+			key |= (unsigned long long)(pipelineId & 0xFFF) << 24;
+			key |= (unsigned long long)(materialId & 0xFFF) << 12;
+			key |= (unsigned long long)(meshId & 0xFFF);
+		}
+		return key;
 	}
-	void WorldPassRenderTask::SetDrawContent(PipelineContext & pipelineManager, CoreLib::List<Drawable*>& reorderBuffer, CoreLib::ArrayView<Drawable*> drawables)
+
+	void WorldPassRenderTask::SetDrawContent(PipelineContext & pipelineManager, CoreLib::List<Drawable*>& reorderBuffer, CoreLib::ArrayView<Drawable*> drawables,
+		DrawOrder order, VectorMath::Vec3 viewPosition)
 	{
+		PROFILE_ZONE("WorldPassRenderTask::SetDrawContent");
 		reorderBuffer.Clear();
+		sortKeys.Clear();
 		Material* lastMaterial = nullptr;
 
 		if (drawables.Count())
@@ -844,9 +1068,9 @@ namespace GameEngine
 			pipelineManager.PushModuleInstance(&lastMaterial->MaterialPatternModule);
 		}
 
-		for (auto obj : drawables)
+		for (int i = 0; i < drawables.Count(); i++)
 		{
-			obj->ReorderKey = 0;
+			auto obj = drawables[i];
 			auto newMaterial = obj->GetMaterial();
 			if (newMaterial != lastMaterial)
 			{
@@ -857,17 +1081,22 @@ namespace GameEngine
 				lastMaterial = newMaterial;
 			}
 			pipelineManager.PushModuleInstanceNoShaderChange(obj->GetTransformModule());
-			obj->ReorderKey = (obj->GetPipeline(renderPassId, pipelineManager)->Id << 18) + newMaterial->Id;
+			DrawSortKey sortKey;
+			sortKey.Key = GetDrawSortKey(order, renderPassId, obj->GetPipeline(renderPassId, pipelineManager)->Id, newMaterial->Id,
+				obj->GetMesh()->Id, obj->Bounds.Distance(viewPosition));
+			sortKey.Index = i;
+			sortKeys.Add(sortKey);
 			pipelineManager.PopModuleInstance();
-
-			reorderBuffer.Add(obj);
 		}
 		if (drawables.Count())
 		{
 			pipelineManager.PopModuleInstance();
 			pipelineManager.PopModuleInstance();
 		}
-		reorderBuffer.Sort([](Drawable* d1, Drawable* d2) {return d1->ReorderKey < d2->ReorderKey; });
+		RadixSortByKey(sortKeys, sortScratch);
+		reorderBuffer.SetSize(sortKeys.Count());
+		for (int i = 0; i < sortKeys.Count(); i++)
+			reorderBuffer[i] = drawables[sortKeys[i].Index];
 		SetFixedOrderDrawContent(pipelineManager, reorderBuffer.GetArrayView());
 
 	}
@@ -7,6 +7,7 @@
 #include "HardwareRenderer.h"
 #include "Spire/Spire.h"
 #include "Skeleton.h"
+#include "PoseEvaluator.h"
 #include "DeviceMemory.h"
 #include "Mesh.h"
 #include "FrustumCulling.h"
@@ -45,6 +46,8 @@ namespace GameEngine
 		int NumMaterials = 0;
 		float CpuTime = 0.0f;
 		float PipelineLookupTime = 0.0f;
+		int NumAnimatedMeshes[AnimationLodCount] = {};
+		int NumPoseUpdates = 0;
 		CoreLib::Diagnostics::TimePoint StartTime;
 		void Clear()
 		{
@@ -55,6 +58,9 @@ namespace GameEngine
 			NumMaterials = 0;
 			CpuTime = 0.0f;
 			PipelineLookupTime = 0.0f;
+			for (auto & count : NumAnimatedMeshes)
+				count = 0;
+			NumPoseUpdates = 0;
 		}
 	};
 
@@ -96,8 +102,35 @@ namespace GameEngine
 		virtual void Execute(HardwareRenderer * hw, RenderStat & stats) = 0;
 	};
 
+	enum class DrawOrder
+	{
+		// groups draw calls by pipeline, material and mesh, front to back within a group
+		StateSorted,
+		// back to front by distance to the view, for blended geometry
+		BackToFront
+	};
+
 	class WorldPassRenderTask : public RenderTask
 	{
+	private:
+		struct DrawSortKey
+		{
+			unsigned long long Key;
+			int Index;
+		};
+		// a draw call of drawables [First, First + Count), which are instances of the same mesh when Count > 1
+		struct DrawItem
+		{
+			int First, Count;
+			PipelineClass * Pipeline;
+			ModuleInstance * TransformModule;
+		};
+		CoreLib::List<DrawSortKey> sortKeys, sortScratch;
+		// draw calls resolved for the current draw content, recording threads only read them
+		CoreLib::List<DrawItem> drawItems;
+		CoreLib::List<int> chunkShaderCounts;
+		int GetInstanceRunLength(CoreLib::ArrayView<Drawable*> drawables, int first);
+		int RecordDrawChunk(CommandBuffer * cmdBuf, DescriptorSetBindingArray & bindings, CoreLib::ArrayView<Drawable*> drawables, int begin, int end);
 	public:
 		int renderPassId = -1; 
 		int numDrawCalls = 0; 
@@ -112,8 +145,12 @@ namespace GameEngine
 		Viewport viewport; 
 		bool clearOutput = false;
 		virtual void Execute(HardwareRenderer * hw, RenderStat & stats) override;
+		// records drawables in the given order, splitting them into command buffers that are recorded in parallel;
+		// runs of adjacent static drawables sharing a mesh and material are drawn as one instanced draw call
 		void SetFixedOrderDrawContent(PipelineContext & pipelineManager, CoreLib::ArrayView<Drawable*> drawables);
-		void SetDrawContent(PipelineContext & pipelineManager, CoreLib::List<Drawable*>& reorderBuffer, CoreLib::ArrayView<Drawable*> drawables);
+		// sorts drawables into reorderBuffer by a 64-bit key of pass, pipeline, material, mesh and distance to viewPosition
+		void SetDrawContent(PipelineContext & pipelineManager, CoreLib::List<Drawable*>& reorderBuffer, CoreLib::ArrayView<Drawable*> drawables,
+			DrawOrder order, VectorMath::Vec3 viewPosition);
 	};
 
 	class PostPassRenderTask : public RenderTask
@@ -146,15 +183,19 @@ namespace GameEngine
 	private:
 		int shadowMapArraySize;
 		CoreLib::IntSet shadowMapArrayFreeBits;
+		CoreLib::IntSet persistentShadowMaps;
 		CoreLib::RefPtr<ViewResource> shadowView;
 	public:
 		CoreLib::RefPtr<Texture2DArray> shadowMapArray;
 		CoreLib::RefPtr<RenderTargetLayout> shadowMapRenderTargetLayout;
 		CoreLib::List<CoreLib::RefPtr<RenderOutput>> shadowMapRenderOutputs;
 		int AllocShadowMaps(int count);
+		// allocates shadow maps that are kept by Reset until they are freed
+		int AllocPersistentShadowMaps(int count);
 		void FreeShadowMaps(int id, int count);
 		void Init(HardwareRenderer * hwRenderer);
 		void Destroy();
+		// frees all shadow maps except the persistent ones
 		void Reset();
 	};
 
@@ -162,10 +203,13 @@ namespace GameEngine
 	{
 	protected:
 		CoreLib::EnumerableDictionary<unsigned int, CoreLib::RefPtr<DescriptorSetLayout>> descLayouts;
+		void CreateModuleInstance(ModuleInstance & mInst, SpireModule * shaderModule, DeviceMemory * uniformMemory, TransientDeviceMemory * transientMemory, int uniformBufferSize);
 	public:
 		SpireCompilationContext * spireContext = nullptr;
 		CoreLib::RefPtr<HardwareRenderer> hardwareRenderer;
 		void CreateModuleInstance(ModuleInstance & mInst, SpireModule * shaderModule, DeviceMemory * uniformMemory, int uniformBufferSize = 0);
+		// the uniform buffer of mInst is allocated from transientMemory each time its data is set
+		void CreateModuleInstance(ModuleInstance & mInst, SpireModule * shaderModule, TransientDeviceMemory * transientMemory, int uniformBufferSize = 0);
 		virtual void Destroy();
 	};
 
@@ -188,7 +232,9 @@ namespace GameEngine
 		CoreLib::RefPtr<TextureCubeArray> envMapArray;
 
 		CoreLib::RefPtr<Buffer> fullScreenQuadVertBuffer;
-		DeviceMemory indexBufferMemory, vertexBufferMemory;
+		DeviceHeap indexBufferMemory, vertexBufferMemory;
+		TransientDeviceMemory transientUniformMemory;
+		TransientDeviceMemory transientStorageMemory;
 		PipelineContext pipelineManager;
 	public:
 		RendererSharedResource(RenderAPI pAPI)
@@ -226,8 +272,16 @@ namespace GameEngine
 
 		Texture2D* LoadTexture2D(const CoreLib::String & name, CoreLib::Graphics::TextureFile & data);
 		Texture2D* LoadTexture(const CoreLib::String & filename);
+		// returns nullptr if the texture is not loaded yet
+		Texture2D* FindTexture(const CoreLib::String & filename);
+		// Reads the texture file that LoadTexture would load, converting other image formats to a cached
+		// .texture file. Returns false if the file cannot be found. Does not touch the scene resource, so
+		// it can run on a streaming thread.
+		static bool ReadTextureFile(const CoreLib::String & filename, CoreLib::Graphics::TextureFile & file);
 	public:
 		DeviceMemory instanceUniformMemory, transformMemory;
+		// skinning matrices of skeletal drawables updated in this frame, evaluated before their draw calls are recorded
+		PoseBatchEvaluator poseEvaluator;
 		void RegisterMaterial(Material * material);
 		
 	public:
@@ -16,6 +16,8 @@ namespace GameEngine
 		Level * level;
 		RendererService * rendererService;
 		bool isEditorMode = false;
+		bool useAnimationLod = false;
+		bool useShadowMapCache = false;
 	};
 
 	struct FrameRenderTask
@@ -49,6 +51,10 @@ namespace GameEngine
             for (auto tex : samplingTextures)
                 tex->SetCurrentLayout(TextureLayout::Sample);
 		}
+		void AddTextureLayerCopyTask(Texture2DArray * texture, CoreLib::ArrayView<int> dstLayers, CoreLib::ArrayView<int> srcLayers, TextureLayout layout)
+		{
+			subTasks[frameId].Add(imageLayoutTaskPool.NewTextureLayerCopyTask(texture, dstLayers, srcLayers, layout));
+		}
 		CoreLib::List<CoreLib::RefPtr<RenderTask>> & GetTasks()
 		{
 			return subTasks[frameId];
@@ -82,7 +82,9 @@ namespace GameEngine
 				rs->elementRange = mesh->ElementRanges[elementId];
 				rs->skeleton = skeleton;
 				int poseMatrixSize = skeleton->Bones.Count() * (sizeof(Vec4) * 4);
-				CreateTransformModuleInstance(*rs->transformModule, "SkeletalAnimation", poseMatrixSize);
+				// poses are uploaded every frame, so they live in per-frame transient memory
+				renderer->sharedRes.CreateModuleInstance(*rs->transformModule, spEnvFindModule(renderer->sharedRes.sharedSpireEnvironment, "SkeletalAnimation"),
+					&renderer->sharedRes.transientUniformMemory, poseMatrixSize);
 				rs->vertFormat = mesh->GetVertexFormat();
 				return rs;
 			}
@@ -117,6 +119,8 @@ namespace GameEngine
 			else
 				params.view = View();
 			params.rendererService = renderService.Ptr();
+			params.useAnimationLod = Engine::Instance()->GetGraphicsSettings().UseAnimationLod;
+			params.useShadowMapCache = Engine::Instance()->GetGraphicsSettings().UseShadowMapCache;
 			frameTask.NewFrame();
 			renderProcedure->Run(frameTask, params);
 		}
@@ -132,6 +136,9 @@ namespace GameEngine
 			case RenderAPI::OpenGL:
 				hardwareRenderer = CreateGLHardwareRenderer();
 				break;
+			case RenderAPI::Null:
+				hardwareRenderer = CreateNullHardwareRenderer();
+				break;
 			}
 			hardwareRenderer->SetMaxTempBufferVersions(DynamicBufferLengthMultiplier);
 
@@ -191,15 +198,12 @@ namespace GameEngine
 			if (!level) return;
 			LightProbeRenderer lpRenderer(this, renderService.Ptr(), cubemapRenderProc.Ptr(), cubemapRenderView.Ptr());
 			int lightProbeCount = 0;
-			for (auto & actor : level->Actors)
+			for (auto actor : level->GetActorsOfType(EngineActorType::EnvMap))
 			{
-				if (actor.Value->GetEngineType() == EngineActorType::EnvMap)
-				{
-					auto envMapActor = dynamic_cast<EnvMapActor*>(actor.Value.Ptr());
-					if (envMapActor->GetEnvMapId() != -1)
-						lpRenderer.RenderLightProbe(sharedRes.envMapArray.Ptr(), envMapActor->GetEnvMapId(), level, envMapActor->GetPosition());
-					lightProbeCount++;
-				}
+				auto envMapActor = static_cast<EnvMapActor*>(actor);
+				if (envMapActor->GetEnvMapId() != -1)
+					lpRenderer.RenderLightProbe(sharedRes.envMapArray.Ptr(), envMapActor->GetEnvMapId(), level, envMapActor->GetPosition());
+				lightProbeCount++;
 			}
 			if (lightProbeCount == 0)
 			{
@@ -0,0 +1,156 @@
+#include "ResourceStreamer.h"
+#include "CoreLib/PerformanceCounter.h"
+
+using namespace CoreLib;
+using namespace CoreLib::Threading;
+
+namespace GameEngine
+{
+	ResourceStreamer::ResourceStreamer(int pThreadCount)
+		: threadCount(Math::Max(1, pThreadCount))
+	{
+	}
+
+	ResourceStreamer::~ResourceStreamer()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			terminate = true;
+		}
+		requestQueued.notify_all();
+		for (auto & thread : threads)
+			thread->Join();
+		for (int i = 0; i < StreamingPriorityCount; i++)
+			DeleteRequests(queuedRequests[i], queuedRequestHeads[i]);
+		DeleteRequests(loadedRequests, 0);
+		DeleteRequests(finalizeQueue, finalizeHead);
+	}
+
+	void ResourceStreamer::ThreadLoop()
+	{
+		while (true)
+		{
+			Request * request = nullptr;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				// terminate is tested before popping and a popped request is always loaded, so none is taken off
+				// the queue and dropped; the destructor deletes the requests still queued
+				requestQueued.wait(lock, [&]() { return terminate || (request = PopQueuedRequest()) != nullptr; });
+				if (!request)
+					return;
+				loadingRequestCount++;
+			}
+			request->Load();
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				loadingRequestCount--;
+				loadedRequests.Add(request);
+			}
+			requestLoaded.notify_all();
+		}
+	}
+
+	ResourceStreamer::Request * ResourceStreamer::PopQueuedRequest()
+	{
+		for (int i = StreamingPriorityCount - 1; i >= 0; i--)
+		{
+			auto & queue = queuedRequests[i];
+			auto & head = queuedRequestHeads[i];
+			if (head == queue.Count())
+				continue;
+			auto request = queue[head++];
+			if (head == queue.Count())
+			{
+				queue.Clear();
+				head = 0;
+			}
+			return request;
+		}
+		return nullptr;
+	}
+
+	void ResourceStreamer::FinalizeRequest(Request * request)
+	{
+		request->Finalize();
+		delete request;
+		unfinishedRequestCount--;
+	}
+
+	void ResourceStreamer::DeleteRequests(List<Request*> & requests, int begin)
+	{
+		for (int i = begin; i < requests.Count(); i++)
+			delete requests[i];
+		requests.Clear();
+	}
+
+	void ResourceStreamer::Submit(const Func<void> & load, const Func<void> & finalize, StreamingPriority priority)
+	{
+		if (threads.Count() == 0)
+		{
+			for (int i = 0; i < threadCount; i++)
+				threads.Add(new Thread(new ThreadProc([this]() { ThreadLoop(); })));
+		}
+		auto request = new Request();
+		request->Load = load;
+		request->Finalize = finalize;
+		unfinishedRequestCount++;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			queuedRequests[(int)priority].Add(request);
+		}
+		requestQueued.notify_one();
+	}
+
+	void ResourceStreamer::Update(float timeBudget)
+	{
+		auto startTime = Diagnostics::PerformanceCounter::Start();
+		while (true)
+		{
+			if (finalizeHead == finalizeQueue.Count())
+			{
+				finalizeQueue.Clear();
+				finalizeHead = 0;
+				std::lock_guard<std::mutex> lock(mutex);
+				if (loadedRequests.Count() == 0)
+					return;
+				finalizeQueue.SwapWith(loadedRequests);
+			}
+			FinalizeRequest(finalizeQueue[finalizeHead++]);
+			if (Diagnostics::PerformanceCounter::EndSeconds(startTime) >= timeBudget)
+				return;
+		}
+	}
+
+	void ResourceStreamer::Flush()
+	{
+		while (unfinishedRequestCount)
+		{
+			if (finalizeHead == finalizeQueue.Count())
+			{
+				finalizeQueue.Clear();
+				finalizeHead = 0;
+				std::unique_lock<std::mutex> lock(mutex);
+				requestLoaded.wait(lock, [this]() { return loadedRequests.Count() != 0; });
+				finalizeQueue.SwapWith(loadedRequests);
+			}
+			FinalizeRequest(finalizeQueue[finalizeHead++]);
+		}
+	}
+
+	void ResourceStreamer::Cancel()
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			for (int i = 0; i < StreamingPriorityCount; i++)
+			{
+				DeleteRequests(queuedRequests[i], queuedRequestHeads[i]);
+				queuedRequestHeads[i] = 0;
+			}
+			requestLoaded.wait(lock, [this]() { return loadingRequestCount == 0; });
+			DeleteRequests(loadedRequests, 0);
+		}
+		DeleteRequests(finalizeQueue, finalizeHead);
+		finalizeHead = 0;
+		unfinishedRequestCount = 0;
+	}
+}
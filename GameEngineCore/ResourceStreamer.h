@@ -0,0 +1,67 @@
+#ifndef GAME_ENGINE_RESOURCE_STREAMER_H
+#define GAME_ENGINE_RESOURCE_STREAMER_H
+
+#include <condition_variable>
+#include "CoreLib/Basic.h"
+#include "CoreLib/Threading.h"
+
+namespace GameEngine
+{
+	enum class StreamingPriority
+	{
+		Low, Normal, High
+	};
+	const int StreamingPriorityCount = (int)StreamingPriority::High + 1;
+
+	// Loads resources on a pool of I/O threads. A request consists of a load function, which runs on
+	// an I/O thread and must neither throw nor touch engine state, and a finalize function, which runs
+	// on the main thread from Update once the load has returned. Queued requests start highest priority
+	// first, and in submission order within a priority.
+	// All members except the load functions are called on the main thread, which also owns the functions,
+	// so the non-atomic reference counts of Func and RefPtr objects they capture are never shared.
+	class ResourceStreamer
+	{
+	private:
+		struct Request
+		{
+			CoreLib::Func<void> Load, Finalize;
+		};
+		int threadCount;
+		CoreLib::List<CoreLib::RefPtr<CoreLib::Threading::Thread>> threads;
+		std::mutex mutex;
+		std::condition_variable requestQueued, requestLoaded;
+		CoreLib::List<Request*> queuedRequests[StreamingPriorityCount];
+		int queuedRequestHeads[StreamingPriorityCount] = {};
+		CoreLib::List<Request*> loadedRequests;
+		int loadingRequestCount = 0;
+		bool terminate = false;
+		// loaded requests taken over by the main thread, finalized from finalizeHead on
+		CoreLib::List<Request*> finalizeQueue;
+		int finalizeHead = 0;
+		int unfinishedRequestCount = 0;
+		void ThreadLoop();
+		Request * PopQueuedRequest();
+		void FinalizeRequest(Request * request);
+		void DeleteRequests(CoreLib::List<Request*> & requests, int begin);
+	public:
+		ResourceStreamer(int pThreadCount = 2);
+		~ResourceStreamer();
+		// I/O threads are started by the first request
+		void Submit(const CoreLib::Func<void> & load, const CoreLib::Func<void> & finalize, StreamingPriority priority);
+		// Finalizes loaded requests until timeBudget seconds have passed. At least one request is
+		// finalized if any has loaded, so the queue drains even with a zero budget.
+		void Update(float timeBudget);
+		// Blocks until every submitted request, including the ones submitted by finalize functions
+		// in the meantime, has loaded and been finalized.
+		void Flush();
+		// Drops queued requests and waits for the ones being loaded. None of them is finalized.
+		void Cancel();
+		// number of submitted requests that have not been finalized yet
+		int GetUnfinishedRequestCount()
+		{
+			return unfinishedRequestCount;
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,85 @@
+#include "SceneCullingTree.h"
+#include "Actor.h"
+
+using namespace CoreLib;
+using namespace CoreLib::Graphics;
+
+namespace GameEngine
+{
+	inline bool IsValidBounds(const BBox & bounds)
+	{
+		return bounds.xMin <= bounds.xMax && bounds.yMin <= bounds.yMax && bounds.zMin <= bounds.zMax;
+	}
+
+	void SceneCullingTree::Add(Actor * actor)
+	{
+		auto mobility = actor->GetDrawableMobility();
+		if (mobility == DrawableMobility::None)
+		{
+			unculledActors.Add(actor);
+			return;
+		}
+		int proxy = -1;
+		if (IsValidBounds(actor->Bounds))
+			proxy = tree.Insert(actor->Bounds, actor);
+		else
+			unboundedActors.Add(actor);
+		proxies[actor] = proxy;
+		if (mobility == DrawableMobility::Movable)
+			movableActors.Add(actor);
+	}
+
+	void SceneCullingTree::Remove(Actor * actor)
+	{
+		int proxy;
+		if (!proxies.TryGetValue(actor, proxy))
+		{
+			unculledActors.Remove(actor);
+			return;
+		}
+		if (proxy != -1)
+			tree.Remove(proxy);
+		else
+			unboundedActors.Remove(actor);
+		proxies.Remove(actor);
+		movableActors.Remove(actor);
+	}
+
+	void SceneCullingTree::UpdateActor(Actor * actor)
+	{
+		int proxy;
+		if (!proxies.TryGetValue(actor, proxy))
+			return;
+		if (IsValidBounds(actor->Bounds))
+		{
+			if (proxy == -1)
+			{
+				proxies[actor] = tree.Insert(actor->Bounds, actor);
+				unboundedActors.Remove(actor);
+			}
+			else
+				tree.Move(proxy, actor->Bounds);
+		}
+		else if (proxy != -1)
+		{
+			tree.Remove(proxy);
+			proxies[actor] = -1;
+			unboundedActors.Add(actor);
+		}
+	}
+
+	void SceneCullingTree::Refit()
+	{
+		for (auto actor : movableActors)
+			UpdateActor(actor);
+	}
+
+	BBox SceneCullingTree::GetBounds()
+	{
+		BBox bounds;
+		bounds.Init();
+		if (tree.GetRoot() != -1)
+			bounds = tree.GetNode(tree.GetRoot()).Bounds;
+		return bounds;
+	}
+}
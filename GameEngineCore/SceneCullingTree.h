@@ -0,0 +1,85 @@
+#ifndef GAME_ENGINE_SCENE_CULLING_TREE_H
+#define GAME_ENGINE_SCENE_CULLING_TREE_H
+
+#include "CoreLib/Basic.h"
+#include "CoreLib/Graphics/DynamicBvh.h"
+#include "FrustumCulling.h"
+
+namespace GameEngine
+{
+	class Actor;
+
+	// Persistent bounding volume hierarchy over the bounds of the drawable actors in a level.
+	// Static actors are inserted once when they are registered and only move when UpdateActor is
+	// called; movable actors are refit by Refit, which only restructures the tree when an actor
+	// leaves its enlarged bounds. Query rejects whole subtrees against a set of frusta, so finding
+	// the visible actors costs time proportional to the visible set rather than the level size.
+	// Actors with DrawableMobility::None are not culled and are listed by GetUnculledActors.
+	class SceneCullingTree
+	{
+	private:
+		CoreLib::Graphics::DynamicBvh<Actor*> tree;
+		CoreLib::Dictionary<Actor*, int> proxies; // -1 while the actor has no valid bounds
+		CoreLib::EnumerableHashSet<Actor*> movableActors;
+		CoreLib::EnumerableHashSet<Actor*> unboundedActors;
+		CoreLib::EnumerableHashSet<Actor*> unculledActors;
+		CoreLib::List<int> queryStack;
+	public:
+		void Add(Actor * actor);
+		void Remove(Actor * actor);
+		// call after the bounds of a static actor have changed
+		void UpdateActor(Actor * actor);
+		// refits the bounds of all movable actors, call once per frame before querying
+		void Refit();
+		CoreLib::EnumerableHashSet<Actor*> & GetUnculledActors()
+		{
+			return unculledActors;
+		}
+		// bounds of all actors in the tree, enlarged by the tree's margin
+		CoreLib::Graphics::BBox GetBounds();
+		// Calls f(actor) for every actor in the tree whose bounds intersect at least one of the frusta,
+		// and for every static or movable actor that currently has no valid bounds.
+		template<typename Func>
+		void Query(CoreLib::ArrayView<CullFrustum> frusta, const Func & f)
+		{
+			for (auto actor : unboundedActors)
+				f(actor);
+			if (tree.GetRoot() == -1)
+				return;
+			// nodes are pushed as (id << 1) | insideFlag; subtrees entirely inside a frustum are not tested further
+			queryStack.Clear();
+			queryStack.Add(tree.GetRoot() << 1);
+			while (queryStack.Count())
+			{
+				int entry = queryStack.Last();
+				queryStack.RemoveAt(queryStack.Count() - 1);
+				auto & node = tree.GetNode(entry >> 1);
+				bool inside = (entry & 1) != 0;
+				if (!inside)
+				{
+					bool visible = false;
+					for (auto & frustum : frusta)
+					{
+						if (frustum.IsBoxInFrustum(node.Bounds))
+						{
+							visible = true;
+							inside = !node.IsLeaf() && frustum.IsBoxInsideFrustum(node.Bounds);
+							break;
+						}
+					}
+					if (!visible)
+						continue;
+				}
+				if (node.IsLeaf())
+					f(node.UserData);
+				else
+				{
+					queryStack.Add((node.Child2 << 1) | (int)inside);
+					queryStack.Add((node.Child1 << 1) | (int)inside);
+				}
+			}
+		}
+	};
+}
+
+#endif
@@ -1,19 +1,43 @@
 #include "AnimationControllerActor.h"
 #include "SimpleAnimationControllerActor.h"
 #include "Level.h"
+#include "Engine.h"
+#include "CoreLib/LibIO.h"
 
 namespace GameEngine
 {
     void SimpleAnimationControllerActor::UpdateStates()
     {
-        if (this->simpleAnimation && this->skeleton)
+        if (this->compressedAnimation && this->skeleton)
+            simpleSynthesizer = new CompressedAnimationSynthesizer(skeleton, compressedAnimation);
+        else if (this->simpleAnimation && this->skeleton)
             simpleSynthesizer = new SimpleAnimationSynthesizer(skeleton, simpleAnimation);
+        reducedBones.Clear();
+        poseOutdated = true;
         Tick();
     }
+    void SimpleAnimationControllerActor::LoadAnimation(const CoreLib::String & fileName)
+    {
+        simpleAnimation = nullptr;
+        compressedAnimation = nullptr;
+        if (CoreLib::IO::Path::GetFileExt(fileName).ToLower() == "canim")
+            compressedAnimation = level->LoadCompressedAnimation(fileName);
+        else
+            simpleAnimation = level->LoadSkeletalAnimation(fileName);
+    }
+    void SimpleAnimationControllerActor::AnimationLoaded(const CoreLib::String & fileName, SkeletalAnimation * animation, CompressedSkeletalAnimation * compressed)
+    {
+        // ignore animations of a file that was replaced while it was streaming
+        if (AnimationFile.GetValue() != fileName)
+            return;
+        simpleAnimation = animation;
+        compressedAnimation = compressed;
+        UpdateStates();
+    }
     void SimpleAnimationControllerActor::AnimationFileName_Changing(CoreLib::String & newFileName)
     {
-        simpleAnimation = level->LoadSkeletalAnimation(newFileName);
-        if (!simpleAnimation)
+        LoadAnimation(newFileName);
+        if (!simpleAnimation && !compressedAnimation)
             newFileName = "";
         UpdateStates();
     }
@@ -29,6 +53,31 @@ namespace GameEngine
     {
         if (simpleSynthesizer)
         {
+            // targets throttled by their animation LOD keep their last pose, so the animation is only
+            // sampled if one of them is due, and only near the root if none is close enough for the fine bones
+            int frameId = Engine::Instance()->GetFrameId();
+            bool updateDue = false;
+            const AnimationLodSettings * lodSettings = nullptr;
+            int minLod = AnimationLodCount;
+            for (int i = 0; i < TargetActors->Count(); i++)
+            {
+                if (auto target = GetTargetActor(i))
+                {
+                    updateDue = updateDue || target->IsPoseUpdateDue(frameId);
+                    lodSettings = target->GetAnimationLodSettings();
+                    minLod = CoreLib::Math::Min(minLod, lodSettings ? target->GetAnimationLod(frameId) : 0);
+                }
+            }
+            if (!updateDue)
+            {
+                poseOutdated = true;
+                return;
+            }
+            poseOutdated = false;
+            bool reduceBones = skeleton && lodSettings && minLod >= lodSettings->ReducedBonesLod;
+            if (reduceBones && reducedBones.Count() != skeleton->Bones.Count())
+                GetReducedBoneSet(skeleton, lodSettings->ReducedBoneDepth, reducedBones);
+            simpleSynthesizer->SetAnimatedBones(reduceBones ? &reducedBones : nullptr);
             Pose pose;
             simpleSynthesizer->GetPose(pose, time);
             for (int i = 0; i < TargetActors->Count(); i++)
@@ -36,15 +85,39 @@ namespace GameEngine
                     target->SetPose(pose);
         }
     }
+    void SimpleAnimationControllerActor::Tick()
+    {
+        AnimationControllerActor::Tick();
+        // a skipped evaluation is caught up once a target is due, even if Time does not change again
+        if (poseOutdated)
+            EvalAnimation(Time.GetValue());
+    }
     void SimpleAnimationControllerActor::OnLoad()
     {
         AnimationControllerActor::OnLoad();
-        if (AnimationFile.GetValue().Length())
-            simpleAnimation = level->LoadSkeletalAnimation(*AnimationFile);
         if (SkeletonFile.GetValue().Length())
             skeleton = level->LoadSkeleton(*SkeletonFile);
         UpdateStates();
         AnimationFile.OnChanging.Bind(this, &SimpleAnimationControllerActor::AnimationFileName_Changing);
         SkeletonFile.OnChanging.Bind(this, &SimpleAnimationControllerActor::SkeletonFileName_Changing);
+
+        // the animation is streamed, targets keep their bind pose until it is loaded
+        auto animationFile = AnimationFile.GetValue();
+        if (!animationFile.Length())
+            return;
+        if (CoreLib::IO::Path::GetFileExt(animationFile).ToLower() == "canim")
+        {
+            level->LoadCompressedAnimationAsync(animationFile, this, [this, animationFile](CompressedSkeletalAnimation * animation)
+            {
+                AnimationLoaded(animationFile, nullptr, animation);
+            });
+        }
+        else
+        {
+            level->LoadSkeletalAnimationAsync(animationFile, this, [this, animationFile](SkeletalAnimation * animation)
+            {
+                AnimationLoaded(animationFile, animation, nullptr);
+            });
+        }
     }
 }
@@ -11,9 +11,16 @@ namespace GameEngine
     {
     protected:
         SkeletalAnimation * simpleAnimation = nullptr;
+        CompressedSkeletalAnimation * compressedAnimation = nullptr;
         Skeleton * skeleton = nullptr;
-        CoreLib::ObjPtr<SimpleAnimationSynthesizer> simpleSynthesizer;
+        CoreLib::ObjPtr<AnimationSynthesizer> simpleSynthesizer;
+        // bones sampled when all targets are at a reduced-bones animation LOD
+        CoreLib::List<bool> reducedBones;
+        // set when an evaluation was skipped because no target was due for a pose update
+        bool poseOutdated = false;
         virtual void EvalAnimation(float time) override;
+        void LoadAnimation(const CoreLib::String & fileName);
+        void AnimationLoaded(const CoreLib::String & fileName, SkeletalAnimation * animation, CompressedSkeletalAnimation * compressed);
         void UpdateStates();
         void AnimationFileName_Changing(CoreLib::String & newFileName);
         void SkeletonFileName_Changing(CoreLib::String & newFileName);
@@ -25,6 +32,7 @@ namespace GameEngine
             return "SimpleAnimationController";
         }
         virtual void OnLoad();
+        virtual void Tick() override;
     };
 }
 
@@ -1,6 +1,7 @@
 #include "SkeletalMeshActor.h"
 #include "Engine.h"
 #include "Skeleton.h"
+#include "RenderContext.h"
 
 namespace GameEngine
 {
@@ -39,6 +40,17 @@ namespace GameEngine
 		UpdateStates();
 	}
 
+	void SkeletalMeshActor::ModelLoaded(const CoreLib::String & fileName, Model * loadedModel)
+	{
+		// ignore models of a file that was replaced while it was streaming
+		if (ModelFileName.GetValue() != fileName)
+			return;
+		model = loadedModel;
+		modelInstance.Drawables.Clear();
+		nextPose.Transforms.Clear();
+		UpdateStates();
+	}
+
 	void SkeletalMeshActor::RetargetFileName_Changing(CoreLib::String & newFileName)
 	{
 		retargetFile = level->LoadRetargetFile(newFileName);
@@ -121,13 +133,32 @@ namespace GameEngine
 			return;
 		}
 		
-		modelInstance.UpdateTransformUniform(*LocalTransform, nextPose, disableRetargetFile ? nullptr : retargetFile);
+		bool updatePose = true;
+		if (params.AnimationLod)
+		{
+			bool inCameraView = params.CameraFrustum->IsBoxInFrustum(Bounds);
+			animationLod.Select(params.AnimationLod, params.FrameId, inCameraView,
+				inCameraView ? GetProjectedSize(Bounds, params.CameraPos, params.ProjectionScale) : 0.0f);
+			updatePose = animationLod.IsUpdateDue(params.FrameId) || !modelInstance.ReuseTransformUniform(*LocalTransform);
+			if (params.Stats)
+			{
+				params.Stats->NumAnimatedMeshes[animationLod.Lod]++;
+				if (updatePose)
+					params.Stats->NumPoseUpdates++;
+			}
+		}
+		else
+			animationLod.Select(nullptr, params.FrameId, true, 0.0f);
+		if (updatePose)
+			modelInstance.UpdateTransformUniform(*LocalTransform, nextPose, disableRetargetFile ? nullptr : retargetFile, animationLod.Lod > 0);
         AddDrawable(params, &modelInstance);
 	}
 
 	void SkeletalMeshActor::OnLoad()
 	{
-		model = level->LoadModel(*ModelFileName);
+		// consecutively loaded meshes update their throttled poses in different frames
+		static int nextAnimationLodPhase = 0;
+		animationLod.Phase = nextAnimationLodPhase++ & 0xFFFF;
 		if (RetargetFileName.GetValue().Length())
 			retargetFile = level->LoadRetargetFile(*RetargetFileName);
 		
@@ -136,6 +167,11 @@ namespace GameEngine
 
 		ModelFileName.OnChanging.Bind(this, &SkeletalMeshActor::ModelFileName_Changing);
 		RetargetFileName.OnChanging.Bind(this, &SkeletalMeshActor::RetargetFileName_Changing);
+
+		// the model is streamed, the error model is drawn until it is loaded
+		auto modelFile = ModelFileName.GetValue();
+		if (modelFile.Length())
+			level->LoadModelAsync(modelFile, this, [this, modelFile](Model * loadedModel) { ModelLoaded(modelFile, loadedModel); });
 	}
 
 	void SkeletalMeshActor::OnUnload()
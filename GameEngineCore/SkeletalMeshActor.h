@@ -5,6 +5,7 @@
 #include "RendererService.h"
 #include "Model.h"
 #include "AnimationSynthesizer.h"
+#include "AnimationLod.h"
 
 namespace GameEngine
 {
@@ -19,27 +20,52 @@ namespace GameEngine
 		bool disableRetargetFile = false;
 		Model * model = nullptr;
 		RetargetFile * retargetFile = nullptr;
+		AnimationLodState animationLod;
 	protected:
 		void UpdateBounds();
 		void UpdateStates();
 		void LocalTransform_Changing(VectorMath::Matrix4 & newTransform);
 		void ModelFileName_Changing(CoreLib::String & newFileName);
+		void ModelLoaded(const CoreLib::String & fileName, Model * loadedModel);
 		void RetargetFileName_Changing(CoreLib::String & newFileName);
 	public:
 		PROPERTY_ATTRIB(CoreLib::String, ModelFileName, "resource(Mesh, model)");
 		PROPERTY_ATTRIB(CoreLib::String, RetargetFileName, "resource(Animation, retarget)");
 	public:
 		virtual void Tick() override;
+		// once the model is loaded, Tick only updates this actor's pose and physics objects
+		virtual bool IsTickThreadSafe() override
+		{
+			return model && model->GetSkeleton() && !errorPhysInstance;
+		}
 		Model * GetModel()
 		{
 			return model;
 		}
         void SetPose(const Pose & p);
+		// animation LOD the renderer selected for this mesh, see AnimationLodState::GetLod
+		int GetAnimationLod(int frameId) const
+		{
+			return animationLod.GetLod(frameId);
+		}
+		const AnimationLodSettings * GetAnimationLodSettings() const
+		{
+			return animationLod.Settings;
+		}
+		// whether the pose set in frameId is drawn, throttled meshes keep drawing their last evaluated pose otherwise
+		bool IsPoseUpdateDue(int frameId) const
+		{
+			return animationLod.IsUpdateDue(frameId);
+		}
 		virtual void GetDrawables(const GetDrawablesParameter & params) override;
 		virtual EngineActorType GetEngineType() override
 		{
 			return EngineActorType::Drawable;
 		}
+		virtual DrawableMobility GetDrawableMobility() override
+		{
+			return DrawableMobility::Movable;
+		}
 		virtual CoreLib::String GetTypeName() override
 		{
 			return "SkeletalMesh";
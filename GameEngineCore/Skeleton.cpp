@@ -5,10 +5,19 @@ namespace GameEngine
 {
 	using namespace CoreLib::IO;
 
-	BoneTransformation AnimationChannel::Sample(float animTime)
+	BoneTransformation AnimationChannel::Sample(float animTime) const
+	{
+		return SampleKeyFrame(BinarySearchForKeyFrame(animTime), animTime);
+	}
+
+	BoneTransformation AnimationChannel::Sample(float animTime, int & keyFrameHint) const
+	{
+		keyFrameHint = FindKeyFrame(animTime, keyFrameHint);
+		return SampleKeyFrame(keyFrameHint, animTime);
+	}
+
+	BoneTransformation AnimationChannel::SampleKeyFrame(int frame0, float animTime) const
 	{
-		BoneTransformation result;
-		int frame0 = BinarySearchForKeyFrame(animTime);
 		int frame1 = frame0 + 1;
 		float t = 0.0f;
 		if (frame0 < KeyFrames.Count() - 1)
@@ -26,6 +35,25 @@ namespace GameEngine
 
 	}
 
+	void SkeletalAnimation::Sample(float animTime, AnimationSamplingContext & context, BoneTransformation * result, const bool * channelMask) const
+	{
+		if (context.KeyFrameIndices.Count() != Channels.Count())
+		{
+			context.KeyFrameIndices.SetSize(Channels.Count());
+			for (auto & index : context.KeyFrameIndices)
+				index = -1;
+		}
+		for (int i = 0; i < Channels.Count(); i++)
+		{
+			if (channelMask && !channelMask[i])
+				continue;
+			if (Channels[i].KeyFrames.Count())
+				result[i] = Channels[i].Sample(animTime, context.KeyFrameIndices[i]);
+			else
+				result[i] = BoneTransformation();
+		}
+	}
+
     Skeleton Skeleton::TopologySort()
     {
         Skeleton result;
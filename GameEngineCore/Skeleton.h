@@ -192,8 +192,11 @@ namespace GameEngine
 		CoreLib::String BoneName;
 		int BoneId = -1;
 		CoreLib::List<AnimationKeyFrame> KeyFrames;
-		BoneTransformation Sample(float time);
-		int BinarySearchForKeyFrame(float time)
+		BoneTransformation Sample(float time) const;
+		// samples starting the key frame search at keyFrameHint, which is updated to the key frame found
+		BoneTransformation Sample(float time, int & keyFrameHint) const;
+		BoneTransformation SampleKeyFrame(int frame0, float time) const;
+		int BinarySearchForKeyFrame(float time) const
 		{
 			int begin = 0;
 			int end = KeyFrames.Count();
@@ -215,6 +218,33 @@ namespace GameEngine
 				begin = 0;
 			return begin;
 		}
+		// walks forward from the key frame found for an earlier time, and falls back to a binary search
+		// when time moved backwards or too far ahead, as it does on loops and seeks
+		int FindKeyFrame(float time, int hint) const
+		{
+			const int maxSteps = 4;
+			if (hint < 0 || hint >= KeyFrames.Count() || (KeyFrames[hint].Time > time && hint > 0))
+				return BinarySearchForKeyFrame(time);
+			for (int i = 0; i < maxSteps; i++)
+			{
+				if (hint + 1 >= KeyFrames.Count() || KeyFrames[hint + 1].Time > time)
+					return hint;
+				hint++;
+			}
+			return BinarySearchForKeyFrame(time);
+		}
+	};
+
+	// Per playing instance state of an animation, caching the key frame sampled last in each channel
+	// so that sampling a forward moving time does not search the key frames again.
+	class AnimationSamplingContext
+	{
+	public:
+		CoreLib::List<int> KeyFrameIndices;
+		void Reset()
+		{
+			KeyFrameIndices.Clear();
+		}
 	};
 
 	class SkeletalAnimation
@@ -225,6 +255,9 @@ namespace GameEngine
 		float Duration;
 		int Reserved[15];
 		CoreLib::List<AnimationChannel> Channels;
+		// samples all channels at animTime, result must hold Channels.Count() transforms;
+		// channels whose channelMask entry is false are skipped and their result is left unchanged
+		void Sample(float animTime, AnimationSamplingContext & context, BoneTransformation * result, const bool * channelMask = nullptr) const;
 		void SaveToStream(CoreLib::IO::Stream * stream);
 		void LoadFromStream(CoreLib::IO::Stream * stream);
 		void SaveToFile(const CoreLib::String & filename);
@@ -91,6 +91,9 @@ namespace Spire
 				case ExternComponentCodeGenInfo::SystemVarType::PrimitiveId:
 					sb << "gl_PrimitiveID";
 					break;
+				case ExternComponentCodeGenInfo::SystemVarType::InstanceId:
+					sb << (useVulkanBinding ? "gl_InstanceIndex" : "gl_InstanceID");
+					break;
 				default:
 					sb << inputName;
 					break;
@@ -10,6 +10,7 @@
 #include "RenderProcedure.h"
 #include "StandardViewUniforms.h"
 #include "LightingData.h"
+#include "CoreLib/Profiler.h"
 
 using namespace VectorMath;
 
@@ -67,9 +68,12 @@ namespace GameEngine
 		DrawableSink sink;
 
 		List<Drawable*> reorderBuffer, drawableBuffer;
+		MultiFrustumCuller culler;
 		LightingEnvironment lighting;
 		AtmosphereParameters lastAtmosphereParams;
 		ToneMappingParameters lastToneMappingParams;
+		Level * lastLevel = nullptr;
+		int lastAtmosphereVersion = -1, lastToneMappingVersion = -1;
 
 		bool useAtmosphere = false;
 		bool postProcess = false;
@@ -192,27 +196,31 @@ namespace GameEngine
             Shadow, CustomDepth, Main, Transparent
         };
 
-		ArrayView<Drawable*> GetDrawable(DrawableSink * objSink, PassType pass, CullFrustum cf, bool append)
+		ArrayView<Drawable*> GetDrawable(DrawableSink * objSink, PassType pass, int frustumId, bool append)
 		{
 			if (!append)
 				drawableBuffer.Clear();
-			for (auto obj : objSink->GetDrawables(pass == PassType::Transparent))
+			bool transparent = pass == PassType::Transparent;
+			auto drawables = objSink->GetDrawables(transparent);
+			for (int i = 0; i < drawables.Count(); i++)
 			{
+				auto obj = drawables[i];
 				if (pass == PassType::Shadow && !obj->CastShadow)
 					continue;
                 if (pass == PassType::CustomDepth && !obj->RenderCustomDepth)
                     continue;
-				if (cf.IsBoxInFrustum(obj->Bounds))
+				if (culler.IsVisible(transparent, i, frustumId))
 					drawableBuffer.Add(obj);
 			}
             if (pass == PassType::CustomDepth)
             {
-                for (auto obj : objSink->GetDrawables(true))
+                auto transparentDrawables = objSink->GetDrawables(true);
+                for (int i = 0; i < transparentDrawables.Count(); i++)
                 {
-                    if (!obj->RenderCustomDepth)
+                    if (!transparentDrawables[i]->RenderCustomDepth)
                         continue;
-                    if (cf.IsBoxInFrustum(obj->Bounds))
-                        drawableBuffer.Add(obj);
+                    if (culler.IsVisible(true, i, frustumId))
+                        drawableBuffer.Add(transparentDrawables[i]);
                 }
             }
 			return drawableBuffer.GetArrayView();
@@ -222,6 +230,7 @@ namespace GameEngine
 		
 		virtual void Run(FrameRenderTask & task, const RenderProcedureParameters & params) override
 		{
+			PROFILE_ZONE("StandardRenderProcedure::Run");
 			int w = 0, h = 0;
 
 			forwardRenderPass->ResetInstancePool();
@@ -255,21 +264,44 @@ namespace GameEngine
 			
 			useAtmosphere = false;
 			sink.Clear();
-						
-			CoreLib::Graphics::BBox levelBounds;
-			// initialize bounds to a small extent to prevent error
-			levelBounds.Min = Vec3::Create(-10.0f);
-			levelBounds.Max = Vec3::Create(10.0f);
-            ToneMappingParameters toneMappingParameters;
-			for (auto & actor : params.level->Actors)
+			culler.ClearFrusta();
+			CullFrustum cameraFrustum(params.view.GetFrustum(aspect));
+			int cameraFrustumId = culler.AddFrustum(cameraFrustum);
+			// skeletal meshes pick their animation LOD from the camera frustum; a copy is passed
+			// because the culler's frusta move when the shadow views are added
+			if (params.useAnimationLod)
 			{
-				levelBounds.Union(actor.Value->Bounds);
-				actor.Value->GetDrawables(getDrawableParam);
-				auto actorType = actor.Value->GetEngineType();
-				if (actorType == EngineActorType::Atmosphere)
+				getDrawableParam.AnimationLod = &Engine::Instance()->GetGraphicsSettings().AnimationLod;
+				getDrawableParam.CameraFrustum = &cameraFrustum;
+				getDrawableParam.ProjectionScale = 0.5f / tan(params.view.FOV * (Math::Pi / 360.0f));
+				getDrawableParam.FrameId = Engine::Instance()->GetFrameId();
+				getDrawableParam.Stats = params.renderStats;
+			}
+			auto & cullingTree = params.level->GetCullingTree();
+			{
+				PROFILE_ZONE("RefitCullingTree");
+				cullingTree.Refit();
+			}
+
+			for (auto actor : cullingTree.GetUnculledActors())
+				actor->GetDrawables(getDrawableParam);
+
+			// atmosphere and tone mapping parameters are only re-read after an actor of that type changed
+			auto level = params.level;
+			if (level != lastLevel)
+			{
+				lastLevel = level;
+				lastAtmosphereVersion = lastToneMappingVersion = -1;
+			}
+			auto atmosphereActors = level->GetActorsOfType(EngineActorType::Atmosphere);
+			useAtmosphere = atmosphereActors.Count() != 0;
+			int atmosphereVersion = level->GetActorTypeVersion(EngineActorType::Atmosphere);
+			if (atmosphereVersion != lastAtmosphereVersion)
+			{
+				lastAtmosphereVersion = atmosphereVersion;
+				for (auto actor : atmosphereActors)
 				{
-					useAtmosphere = true;
-					auto atmosphere = dynamic_cast<AtmosphereActor*>(actor.Value.Ptr());
+					auto atmosphere = static_cast<AtmosphereActor*>(actor);
 					auto newParams = atmosphere->GetParameters();
 					if (!(lastAtmosphereParams == newParams))
 					{
@@ -279,14 +311,14 @@ namespace GameEngine
 						lastAtmosphereParams = newParams;
 					}
 				}
-				else if (postProcess && actorType == EngineActorType::ToneMapping)
-				{
-					auto toneMappingActor = dynamic_cast<ToneMappingActor*>(actor.Value.Ptr());
-                    toneMappingParameters = toneMappingActor->Parameters;
-				}
 			}
-            if (postProcess)
+            int toneMappingVersion = level->GetActorTypeVersion(EngineActorType::ToneMapping);
+            if (postProcess && toneMappingVersion != lastToneMappingVersion)
             {
+                lastToneMappingVersion = toneMappingVersion;
+                ToneMappingParameters toneMappingParameters;
+                for (auto actor : level->GetActorsOfType(EngineActorType::ToneMapping))
+                    toneMappingParameters = static_cast<ToneMappingActor*>(actor)->Parameters;
                 if (!(lastToneMappingParams == toneMappingParameters))
                 {
                     toneMappingFromAtmospherePass->SetParameters(&toneMappingParameters, sizeof(toneMappingParameters));
@@ -294,17 +326,39 @@ namespace GameEngine
                     lastToneMappingParams = toneMappingParameters;
                 }
             }
-			lighting.GatherInfo(task, &sink, params, w, h, viewUniform, shadowRenderPass.Ptr());
+			{
+				PROFILE_ZONE("GatherLighting");
+				lighting.GatherInfo(culler, params, w, h, viewUniform);
+			}
+
+			// only visit the culled actors that are visible to the camera or any shadow view,
+			// then cull their drawables against all views in one pass
+			{
+				PROFILE_ZONE("CullDrawables");
+				cullingTree.Query(culler.GetFrusta(), [&](Actor * actor)
+				{
+					actor->GetDrawables(getDrawableParam);
+				});
+				culler.Cull(&sink);
+			}
+			{
+				PROFILE_ZONE("EvaluatePoses");
+				params.renderer->GetSceneResource()->poseEvaluator.Evaluate();
+			}
+			{
+				PROFILE_ZONE("ShadowPasses");
+				lighting.AddShadowPasses(task, shadowRenderPass.Ptr(), &sink, culler);
+			}
 
 			forwardBasePassParams.SetUniformData(&viewUniform, (int)sizeof(viewUniform));
-			auto cameraCullFrustum = CullFrustum(params.view.GetFrustum(aspect));
 			
 
             customDepthOutput->GetFrameBuffer()->GetRenderAttachments().GetTextures(textures);
             task.AddImageTransferTask(textures.GetArrayView(), CoreLib::ArrayView<Texture*>());
             customDepthRenderPass->Bind();
             sharedRes->pipelineManager.PushModuleInstance(&forwardBasePassParams);
-            customDepthPassInstance->SetDrawContent(sharedRes->pipelineManager, reorderBuffer, GetDrawable(&sink, PassType::CustomDepth, cameraCullFrustum, false));
+            customDepthPassInstance->SetDrawContent(sharedRes->pipelineManager, reorderBuffer, GetDrawable(&sink, PassType::CustomDepth, cameraFrustumId, false),
+                DrawOrder::StateSorted, params.view.Position);
             sharedRes->pipelineManager.PopModuleInstance();
             task.AddTask(customDepthPassInstance);
             task.AddImageTransferTask(CoreLib::ArrayView<Texture*>(), textures.GetArrayView());
@@ -314,7 +368,8 @@ namespace GameEngine
 			forwardRenderPass->Bind();
 			sharedRes->pipelineManager.PushModuleInstance(&forwardBasePassParams);
 			sharedRes->pipelineManager.PushModuleInstance(&lighting.moduleInstance);
-			forwardBaseInstance->SetDrawContent(sharedRes->pipelineManager, reorderBuffer, GetDrawable(&sink, PassType::Main, cameraCullFrustum, false));
+			forwardBaseInstance->SetDrawContent(sharedRes->pipelineManager, reorderBuffer, GetDrawable(&sink, PassType::Main, cameraFrustumId, false),
+				DrawOrder::StateSorted, params.view.Position);
 			sharedRes->pipelineManager.PopModuleInstance();
 			sharedRes->pipelineManager.PopModuleInstance();
 			task.AddTask(forwardBaseInstance);
@@ -328,14 +383,9 @@ namespace GameEngine
 
 
 			// transparency pass
-			reorderBuffer.Clear();
-			for (auto drawable : GetDrawable(&sink, PassType::Transparent, cameraCullFrustum, false))
-			{
-				reorderBuffer.Add(drawable);
-			}
-			if (reorderBuffer.Count())
+			auto transparentDrawables = GetDrawable(&sink, PassType::Transparent, cameraFrustumId, false);
+			if (transparentDrawables.Count())
 			{
-				reorderBuffer.Sort([=](Drawable* d1, Drawable* d2) { return d1->Bounds.Distance(params.view.Position) > d2->Bounds.Distance(params.view.Position); });
 				if (useAtmosphere)
 				{
 					transparentPassInstance = forwardRenderPass->CreateInstance(transparentAtmosphereOutput, false);
@@ -351,7 +401,8 @@ namespace GameEngine
 				sharedRes->pipelineManager.PushModuleInstance(&forwardBasePassParams);
 				sharedRes->pipelineManager.PushModuleInstance(&lighting.moduleInstance);
 
-				transparentPassInstance->SetFixedOrderDrawContent(sharedRes->pipelineManager, reorderBuffer.GetArrayView());
+				transparentPassInstance->SetDrawContent(sharedRes->pipelineManager, reorderBuffer, transparentDrawables,
+					DrawOrder::BackToFront, params.view.Position);
 				sharedRes->pipelineManager.PopModuleInstance();
 				sharedRes->pipelineManager.PopModuleInstance();
 				task.AddImageTransferTask(textures.GetArrayView(), CoreLib::ArrayView<Texture*>());
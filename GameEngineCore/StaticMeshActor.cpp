@@ -110,7 +110,10 @@ namespace GameEngine
 	{
 		localTransformChanged = true;
 		if (model)
+		{
 			CoreLib::Graphics::TransformBBox(Bounds, value, model->GetBounds());
+			level->GetCullingTree().UpdateActor(this);
+		}
 		if (physInstance)
 			physInstance->SetTransform(value);
 	}
@@ -128,22 +131,63 @@ namespace GameEngine
 		modelInstance.Drawables.Clear();
 	}
 
+	void StaticMeshActor::MeshLoaded(const CoreLib::String & fileName, GameEngine::Mesh * loadedMesh)
+	{
+		// ignore meshes of a file that was replaced while it was streaming
+		if (MeshFile.GetValue() != fileName)
+			return;
+		Mesh = loadedMesh ? loadedMesh : level->LoadErrorMesh();
+		if (physInstance)
+		{
+			model = nullptr;
+			ModelChanged();
+		}
+	}
+
+	void StaticMeshActor::ModelLoaded(const CoreLib::String & fileName, GameEngine::Model * loadedModel)
+	{
+		if (ModelFile.GetValue() != fileName)
+			return;
+		model = loadedModel ? loadedModel : level->LoadErrorModel();
+		if (physInstance)
+			ModelChanged();
+	}
+
+	void StaticMeshActor::MaterialLoaded(const CoreLib::String & fileName, GameEngine::Material * loadedMaterial)
+	{
+		if (MaterialFile.GetValue() != fileName)
+			return;
+		MaterialInstance = loadedMaterial ? loadedMaterial : level->LoadErrorMaterial();
+		if (physInstance)
+		{
+			model = nullptr;
+			ModelChanged();
+		}
+	}
+
 	void StaticMeshActor::OnLoad()
 	{
-		if (ModelFile.GetValue().Length())
+		// mesh, model and material files are streamed, the error mesh and material stand in until they are
+		// loaded. Callbacks of files that are already loaded run right away, before the model is created.
+		auto modelFile = ModelFile.GetValue();
+		auto meshFile = MeshFile.GetValue();
+		if (modelFile.Length())
 		{
-			model = level->LoadModel(ModelFile.GetValue());
+			level->LoadModelAsync(modelFile, this, [this, modelFile](GameEngine::Model * loadedModel) { ModelLoaded(modelFile, loadedModel); });
+			if (!model)
+				model = level->LoadErrorModel();
 		}
 		else
 		{
-			if (MeshFile.GetValue().Length())
-				Mesh = level->LoadMesh(MeshFile.GetValue());
+			if (meshFile.Length())
+				level->LoadMeshAsync(meshFile, this, [this, meshFile](GameEngine::Mesh * loadedMesh) { MeshLoaded(meshFile, loadedMesh); });
 			if (!Mesh)
 				Mesh = level->LoadErrorMesh();
-			if (MaterialFile.GetValue().Length())
-				MaterialInstance = level->LoadMaterial(MaterialFile.GetValue());
+			auto materialFile = MaterialFile.GetValue();
+			if (materialFile.Length())
+				level->LoadMaterialAsync(materialFile, this, [this, materialFile](GameEngine::Material * loadedMaterial) { MaterialLoaded(materialFile, loadedMaterial); });
 			if (!MaterialInstance)
-				MaterialInstance = level->LoadMaterial("Error.material");
+				MaterialInstance = level->LoadErrorMaterial();
 		}
 		
 		LocalTransform.OnChanging.Bind(this, &StaticMeshActor::LocalTransform_Changing);
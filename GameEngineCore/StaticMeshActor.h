@@ -26,6 +26,9 @@ namespace GameEngine
 		void ModelFile_Changing(CoreLib::String & newModelFile);
 		void LocalTransform_Changing(VectorMath::Matrix4 & value);
 		void ModelChanged();
+		void MeshLoaded(const CoreLib::String & fileName, GameEngine::Mesh * loadedMesh);
+		void ModelLoaded(const CoreLib::String & fileName, GameEngine::Model * loadedModel);
+		void MaterialLoaded(const CoreLib::String & fileName, GameEngine::Material * loadedMaterial);
 	public:
 		PROPERTY_ATTRIB(CoreLib::String, MeshFile, "resource(Mesh, mesh)");
 		PROPERTY_ATTRIB(CoreLib::String, MaterialFile, "resource(Material, material)");
@@ -40,6 +43,10 @@ namespace GameEngine
 		{
 			return EngineActorType::Drawable;
 		}
+		virtual DrawableMobility GetDrawableMobility() override
+		{
+			return DrawableMobility::Static;
+		}
 		virtual CoreLib::String GetTypeName() override
 		{
 			return "StaticMesh";
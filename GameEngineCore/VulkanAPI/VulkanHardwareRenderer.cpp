@@ -459,7 +459,7 @@ namespace VK
 
 			State().transferCommandPool = State().device.createCommandPool(setupCommandPoolCreateInfo);
 
-			//TODO: multiple pools for multiple threads
+			// pool for the temporary primary buffers, secondary command buffers own their pools
 			vk::CommandPoolCreateInfo renderCommandPoolCreateInfo = vk::CommandPoolCreateInfo()
 				.setFlags(vk::CommandPoolCreateFlagBits::eResetCommandBuffer)
 				.setQueueFamilyIndex(State().renderQueueIndex);
@@ -626,6 +626,11 @@ namespace VK
 			return State().renderCommandPool;
 		}
 
+		static int RenderQueueIndex()
+		{
+			return State().renderQueueIndex;
+		}
+
 		static vk::CommandBuffer GetTempTransferCommandBuffer()
 		{
 			return GetTempCommandBuffer(State().transferCommandPool, *State().transferCommandBufferPool, State().transferCommandBufferAllocPtr);
@@ -3513,21 +3518,28 @@ namespace VK
 	{
 	public:
 		bool inRenderPass = false;
-		const vk::CommandPool& pool;
+		// Vulkan requires a command pool to be externally synchronized while any of its buffers
+		// is being recorded, each command buffer owns its pool so that the engine can record
+		// different command buffers on different threads.
+		vk::CommandPool pool;
 		vk::CommandBuffer buffer;
 		Pipeline* curPipeline = nullptr;
 		CoreLib::Array<vk::DescriptorSet, 32> pendingDescSets;
 
-		CommandBuffer(const vk::CommandPool& commandPool) : pool(commandPool)
+		CommandBuffer()
 		{
 			pendingDescSets.SetSize(32);
+			vk::CommandPoolCreateInfo poolCreateInfo = vk::CommandPoolCreateInfo()
+				.setFlags(vk::CommandPoolCreateFlagBits::eResetCommandBuffer)
+				.setQueueFamilyIndex(RendererState::RenderQueueIndex());
+			pool = RendererState::Device().createCommandPool(poolCreateInfo);
 			buffer = RendererState::CreateCommandBuffer(pool, vk::CommandBufferLevel::eSecondary);
 		}
-		CommandBuffer() : CommandBuffer(RendererState::RenderCommandPool()) {}
 
 		~CommandBuffer()
 		{
 			RendererState::DestroyCommandBuffer(pool, buffer);
+			RendererState::Device().destroyCommandPool(pool);
 		}
 
 		Buffer* lastVertBuffer = nullptr;
@@ -4005,6 +4017,73 @@ namespace VK
 				barriers
 			);
 		}
+		virtual void CopyTextureLayer(GameEngine::Texture2DArray* dstImage, int dstLayer, GameEngine::Texture2DArray* srcImage, int srcLayer, TextureLayout layout) override
+		{
+#if _DEBUG
+			if (inRenderPass == true)
+				throw HardwareRendererException("BeginRecording must take no parameters for CopyTextureLayer");
+#endif
+			auto src = dynamic_cast<VK::Texture2DArray*>(srcImage);
+			auto dst = dynamic_cast<VK::Texture2DArray*>(dstImage);
+			vk::ImageLayout oriLayout = TranslateImageLayout(layout);
+			vk::ImageAspectFlags aspectFlags = vk::ImageAspectFlagBits::eColor;
+			if (isDepthFormat(src->format))
+			{
+				aspectFlags = vk::ImageAspectFlagBits::eDepth;
+				if (src->format == StorageFormat::Depth24Stencil8)
+					aspectFlags |= vk::ImageAspectFlagBits::eStencil;
+			}
+			auto getBarrier = [&](VK::Texture2DArray * texture, int layer, vk::ImageLayout oldLayout, vk::ImageLayout newLayout)
+			{
+				return vk::ImageMemoryBarrier()
+					.setSrcAccessMask(LayoutFlags(oldLayout))
+					.setDstAccessMask(LayoutFlags(newLayout))
+					.setOldLayout(oldLayout)
+					.setNewLayout(newLayout)
+					.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+					.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+					.setImage(texture->image)
+					.setSubresourceRange(vk::ImageSubresourceRange().setAspectMask(aspectFlags).setBaseMipLevel(0).setLevelCount(1).setBaseArrayLayer(layer).setLayerCount(1));
+			};
+
+			// the destination layer is overwritten entirely, so its contents need not be preserved
+			std::array<vk::ImageMemoryBarrier, 2> barriers;
+			barriers[0] = getBarrier(dst, dstLayer, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal);
+			barriers[1] = getBarrier(src, srcLayer, oriLayout, vk::ImageLayout::eTransferSrcOptimal);
+			buffer.pipelineBarrier(
+				vk::PipelineStageFlagBits::eAllCommands,
+				vk::PipelineStageFlagBits::eAllCommands,
+				vk::DependencyFlags(),
+				nullptr,
+				nullptr,
+				barriers
+			);
+
+			vk::ImageCopy copyRegion = vk::ImageCopy()
+				.setSrcSubresource(vk::ImageSubresourceLayers().setAspectMask(aspectFlags).setMipLevel(0).setBaseArrayLayer(srcLayer).setLayerCount(1))
+				.setSrcOffset(vk::Offset3D(0, 0, 0))
+				.setDstSubresource(vk::ImageSubresourceLayers().setAspectMask(aspectFlags).setMipLevel(0).setBaseArrayLayer(dstLayer).setLayerCount(1))
+				.setDstOffset(vk::Offset3D(0, 0, 0))
+				.setExtent(vk::Extent3D(src->width, src->height, 1));
+			buffer.copyImage(
+				src->image,
+				vk::ImageLayout::eTransferSrcOptimal,
+				dst->image,
+				vk::ImageLayout::eTransferDstOptimal,
+				copyRegion
+			);
+
+			barriers[0] = getBarrier(dst, dstLayer, vk::ImageLayout::eTransferDstOptimal, oriLayout);
+			barriers[1] = getBarrier(src, srcLayer, vk::ImageLayout::eTransferSrcOptimal, oriLayout);
+			buffer.pipelineBarrier(
+				vk::PipelineStageFlagBits::eAllCommands,
+				vk::PipelineStageFlagBits::eAllCommands,
+				vk::DependencyFlags(),
+				nullptr,
+				nullptr,
+				barriers
+			);
+		}
 		virtual void ClearAttachments(GameEngine::FrameBuffer * frameBuffer) override
 		{
 			auto & renderAttachments = ((VK::FrameBuffer*)frameBuffer)->renderAttachments;
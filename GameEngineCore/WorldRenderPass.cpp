@@ -42,6 +42,26 @@ namespace GameEngine
 		return commandBufferPool[poolAllocPtr++].Ptr();
 	}
 
+	ModuleInstance * WorldRenderPass::AllocInstanceTransformModule(CoreLib::ArrayView<Drawable*> instances)
+	{
+		int length = instances.Count() * (int)sizeof(VectorMath::Matrix4);
+		int offset = sharedRes->transientStorageMemory.Alloc(length);
+		if (offset == -1)
+			return nullptr;
+		auto transforms = (VectorMath::Matrix4*)sharedRes->transientStorageMemory.GetPtr(offset);
+		for (int i = 0; i < instances.Count(); i++)
+			transforms[i] = instances[i]->GetTransform();
+		if (instanceTransformAllocPtr == instanceTransformPool.Count())
+		{
+			RefPtr<ModuleInstance> module = new ModuleInstance();
+			sharedRes->CreateModuleInstance(*module, spEnvFindModule(sharedRes->sharedSpireEnvironment, "InstancedNoAnimation"), (DeviceMemory*)nullptr);
+			instanceTransformPool.Add(module);
+		}
+		auto module = instanceTransformPool[instanceTransformAllocPtr++].Ptr();
+		module->SetStorageBuffer(0, sharedRes->transientStorageMemory.GetBuffer(), offset, length);
+		return module;
+	}
+
 	void WorldRenderPass::Create(Renderer * renderer)
 	{
 		renderTargetLayout = CreateRenderTargetLayout();
@@ -14,6 +14,8 @@ namespace GameEngine
 	protected:
 		CoreLib::List<CoreLib::RefPtr<AsyncCommandBuffer>> commandBufferPool;
 		int poolAllocPtr = 0;
+		CoreLib::List<CoreLib::RefPtr<ModuleInstance>> instanceTransformPool;
+		int instanceTransformAllocPtr = 0;
 		virtual const char * GetShaderSource() = 0;
 		virtual RenderTargetLayout * CreateRenderTargetLayout() = 0;
 		virtual void SetPipelineStates(FixedFunctionPipelineStates & state)
@@ -27,9 +29,13 @@ namespace GameEngine
 		void ResetInstancePool()
 		{
 			poolAllocPtr = 0;
+			instanceTransformAllocPtr = 0;
 		}
 		virtual void Bind();
 		AsyncCommandBuffer * AllocCommandBuffer();
+		// returns an InstancedNoAnimation module holding the transforms of instances for this frame,
+		// or nullptr if the per-frame storage memory is exhausted
+		ModuleInstance * AllocInstanceTransformModule(CoreLib::ArrayView<Drawable*> instances);
 		CoreLib::RefPtr<WorldPassRenderTask> CreateInstance(RenderOutput * output, bool clearOutput);
 		virtual int GetShaderId() override;
 	};
@@ -4,6 +4,7 @@
 #include "CoreLib/Basic.h"
 #include "CoreLib/LibIO.h"
 #include "Skeleton.h"
+#include "CompressedAnimation.h"
 #include "Mesh.h"
 #include "WinForm/WinButtons.h"
 #include "WinForm/WinCommonDlg.h"
@@ -100,6 +101,7 @@ public:
 	bool ExportSkeleton = true;
 	bool ExportMesh = true;
 	bool ExportAnimation = true;
+	bool CompressAnimation = true;
 	bool FlipUV = false;
 	bool FlipWindingOrder = false;
 	bool FlipYZ = false;
@@ -827,6 +829,18 @@ endOfSkeletonExport:
 		for (auto & c : anim.Channels)
 			maxKeyFrames = Math::Max(maxKeyFrames, c.KeyFrames.Count());
 		printf("animation converted. keyframes %d, bones %d\n", maxKeyFrames, anim.Channels.Count());
+		if (args.CompressAnimation)
+		{
+			CompressedSkeletalAnimation compressedAnim;
+			compressedAnim.Compress(anim);
+			compressedAnim.SaveToFile(Path::ReplaceExt(outFileName, "canim"));
+			int tracksAnimated = 0;
+			for (auto & track : compressedAnim.Tracks)
+				if (track.RotationOffset != -1 || track.TranslationOffset != -1 || track.ScaleOffset != -1)
+					tracksAnimated++;
+			printf("animation compressed. keyframes %d, animated tracks %d/%d, size %d bytes\n", compressedAnim.KeyCount, tracksAnimated,
+				compressedAnim.Tracks.Count(), compressedAnim.GetDataSize());
+		}
 	}
 	
 	// Destroy the SDK manager and all the other objects it was handling.
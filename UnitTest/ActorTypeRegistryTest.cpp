@@ -0,0 +1,79 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "../CoreLib/Basic.h"
+#include "../CoreLib/JobSystem.h"
+#include "../GameEngineCore/Level.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace CoreLib;
+using namespace CoreLib::Threading;
+using namespace GameEngine;
+
+namespace UnitTest
+{
+	class RegistryTestActor : public Actor
+	{
+	public:
+		EngineActorType Type;
+		RegistryTestActor(EngineActorType type)
+			: Type(type)
+		{}
+		virtual EngineActorType GetEngineType() override
+		{
+			return Type;
+		}
+	};
+
+	TEST_CLASS(ActorTypeRegistryTest)
+	{
+	public:
+		TEST_METHOD(TracksActorsAndVersionsPerType)
+		{
+			ActorTypeRegistry registry;
+			List<RefPtr<RegistryTestActor>> lights;
+			for (int i = 0; i < 4; i++)
+				lights.Add(new RegistryTestActor(EngineActorType::Light));
+			RefPtr<RegistryTestActor> camera = new RegistryTestActor(EngineActorType::Camera);
+			for (auto & light : lights)
+				registry.Add(light.Ptr());
+			registry.Add(camera.Ptr());
+			Assert::AreEqual(4, registry.GetVersion(EngineActorType::Light));
+			Assert::AreEqual(1, registry.GetVersion(EngineActorType::Camera));
+			Assert::AreEqual(0, registry.GetVersion(EngineActorType::Drawable));
+			auto typedLights = registry.GetActors(EngineActorType::Light);
+			Assert::AreEqual(4, typedLights.Count());
+			for (int i = 0; i < 4; i++)
+				Assert::IsTrue(typedLights[i] == lights[i].Ptr());
+
+			// a property change only bumps the version of the actor's type
+			registry.NotifyChanged(lights[2].Ptr());
+			Assert::AreEqual(5, registry.GetVersion(EngineActorType::Light));
+			Assert::AreEqual(1, registry.GetVersion(EngineActorType::Camera));
+
+			// removing moves the last actor of the type into the freed slot
+			registry.Remove(lights[1].Ptr());
+			Assert::AreEqual(6, registry.GetVersion(EngineActorType::Light));
+			typedLights = registry.GetActors(EngineActorType::Light);
+			Assert::AreEqual(3, typedLights.Count());
+			Assert::IsTrue(typedLights[0] == lights[0].Ptr());
+			Assert::IsTrue(typedLights[1] == lights[3].Ptr());
+			Assert::IsTrue(typedLights[2] == lights[2].Ptr());
+			registry.Remove(camera.Ptr());
+			Assert::AreEqual(0, registry.GetActors(EngineActorType::Camera).Count());
+			Assert::AreEqual(2, registry.GetVersion(EngineActorType::Camera));
+		}
+
+		TEST_METHOD(ConcurrentChangesAreCounted)
+		{
+			// actors ticked in parallel notify property changes from worker threads
+			ActorTypeRegistry registry;
+			RefPtr<RegistryTestActor> light = new RegistryTestActor(EngineActorType::Light);
+			registry.Add(light.Ptr());
+			JobSystem jobSystem(3);
+			jobSystem.ParallelFor(0, 10000, [&](int)
+			{
+				registry.NotifyChanged(light.Ptr());
+			}, 1);
+			Assert::AreEqual(10001, registry.GetVersion(EngineActorType::Light));
+		}
+	};
+}
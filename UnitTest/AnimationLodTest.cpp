@@ -0,0 +1,75 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "../CoreLib/Basic.h"
+#include "../GameEngineCore/AnimationLod.h"
+#include "../GameEngineCore/Skeleton.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace CoreLib;
+using namespace GameEngine;
+
+namespace UnitTest
+{
+	TEST_CLASS(AnimationLodTest)
+	{
+	public:
+		TEST_METHOD(SelectAndThrottle)
+		{
+			AnimationLodSettings settings;
+			AnimationLodState state;
+			state.Select(&settings, 10, true, 0.5f);
+			Assert::AreEqual(0, state.Lod);
+			state.Select(&settings, 10, true, 0.1f);
+			Assert::AreEqual(1, state.Lod);
+			state.Select(&settings, 10, true, 0.01f);
+			Assert::AreEqual(2, state.Lod);
+			state.Select(&settings, 10, false, 0.5f);
+			Assert::AreEqual(AnimationLodCount - 1, state.Lod);
+
+			// the selection applies to the next frame, a mesh that was not drawn counts as off-screen
+			state.Select(&settings, 10, true, 0.1f);
+			Assert::AreEqual(1, state.GetLod(11));
+			Assert::AreEqual(AnimationLodCount - 1, state.GetLod(12));
+
+			// meshes with different phases update in different frames, each once per interval
+			int updates[2] = {};
+			AnimationLodState states[2];
+			for (int i = 0; i < 2; i++)
+			{
+				states[i].Phase = i;
+				for (int frame = 100; frame < 108; frame++)
+				{
+					states[i].Select(&settings, frame, true, 0.1f);
+					if (states[i].IsUpdateDue(frame))
+					{
+						updates[i]++;
+						Assert::IsFalse(i == 1 && states[0].IsUpdateDue(frame));
+					}
+				}
+			}
+			Assert::AreEqual(4, updates[0]);
+			Assert::AreEqual(4, updates[1]);
+
+			// without settings every frame is due
+			state.Select(nullptr, 10, true, 0.0f);
+			Assert::IsTrue(state.IsUpdateDue(11) && state.IsUpdateDue(12));
+		}
+
+		TEST_METHOD(ReducedBoneSet)
+		{
+			// root -> 1 -> 2 -> 3, root -> 4
+			Skeleton skeleton;
+			int parents[] = { -1, 0, 1, 2, 0 };
+			for (int parent : parents)
+			{
+				Bone bone;
+				bone.ParentId = parent;
+				skeleton.Bones.Add(bone);
+			}
+			List<bool> animatedBones;
+			GetReducedBoneSet(&skeleton, 1, animatedBones);
+			Assert::AreEqual(5, animatedBones.Count());
+			Assert::IsTrue(animatedBones[0] && animatedBones[1] && animatedBones[4]);
+			Assert::IsFalse(animatedBones[2] || animatedBones[3]);
+		}
+	};
+}
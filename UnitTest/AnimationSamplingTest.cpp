@@ -0,0 +1,59 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "../CoreLib/Basic.h"
+#include "../GameEngineCore/Skeleton.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace CoreLib;
+using namespace VectorMath;
+using namespace GameEngine;
+
+namespace UnitTest
+{
+	TEST_CLASS(AnimationSamplingTest)
+	{
+	public:
+		TEST_METHOD(ContextSamplingMatchesSearch)
+		{
+			Random random(3);
+			SkeletalAnimation anim;
+			anim.Speed = 1.0f;
+			anim.Duration = 0.0f;
+			anim.Channels.SetSize(4);
+			for (auto & channel : anim.Channels)
+			{
+				// unevenly spaced keys, and channels starting after the clip
+				float time = random.NextFloat(0.0f, 0.2f);
+				int keyCount = random.Next(1, 200);
+				for (int i = 0; i < keyCount; i++)
+				{
+					AnimationKeyFrame keyFrame;
+					keyFrame.Time = time;
+					keyFrame.Transform.Translation = Vec3::Create(random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f));
+					keyFrame.Transform.Rotation = Quaternion::FromAxisAngle(Vec3::Create(0.0f, 1.0f, 0.0f), random.NextFloat(0.0f, Math::Pi));
+					channel.KeyFrames.Add(keyFrame);
+					time += random.NextFloat(0.001f, 0.1f);
+				}
+				anim.Duration = Math::Max(anim.Duration, time);
+			}
+			AnimationSamplingContext context;
+			List<BoneTransformation> transforms;
+			transforms.SetSize(anim.Channels.Count());
+			float time = 0.0f;
+			for (int i = 0; i < 5000; i++)
+			{
+				// mostly small forward steps with loops, and an occasional seek
+				if (random.Next(0, 100) == 0)
+					time = random.NextFloat(-1.0f, anim.Duration + 1.0f);
+				else
+					time = fmod(time + random.NextFloat(0.0f, 0.05f), anim.Duration);
+				anim.Sample(time, context, transforms.Buffer());
+				for (int j = 0; j < anim.Channels.Count(); j++)
+				{
+					Assert::AreEqual(anim.Channels[j].BinarySearchForKeyFrame(time), context.KeyFrameIndices[j]);
+					auto expected = anim.Channels[j].Sample(time);
+					Assert::IsTrue(expected.Translation.x == transforms[j].Translation.x && expected.Rotation.w == transforms[j].Rotation.w);
+				}
+			}
+		}
+	};
+}
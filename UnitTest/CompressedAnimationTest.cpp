@@ -0,0 +1,129 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "../CoreLib/Basic.h"
+#include "../GameEngineCore/CompressedAnimation.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace CoreLib;
+using namespace CoreLib::IO;
+using namespace VectorMath;
+using namespace GameEngine;
+
+namespace UnitTest
+{
+	TEST_CLASS(CompressedAnimationTest)
+	{
+	private:
+		static const int FrameCount = 75;
+		// channel 0 animates everything, channel 1 only rotates, channel 2 is constant
+		static void CreateAnimation(Random & random, SkeletalAnimation & anim)
+		{
+			anim.Name = "test";
+			anim.Speed = 1.0f;
+			anim.Duration = FrameCount / 30.0f;
+			anim.Channels.SetSize(3);
+			for (int i = 0; i < anim.Channels.Count(); i++)
+			{
+				auto & channel = anim.Channels[i];
+				channel.BoneName = String("bone") + String(i);
+				auto axis = Vec3::Create(random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f)).Normalize();
+				float angularSpeed = random.NextFloat(1.0f, 4.0f);
+				auto translation = Vec3::Create(random.NextFloat(-2.0f, 2.0f), random.NextFloat(-2.0f, 2.0f), random.NextFloat(-2.0f, 2.0f));
+				for (int j = 0; j < FrameCount; j++)
+				{
+					AnimationKeyFrame keyFrame;
+					keyFrame.Time = j / 30.0f;
+					if (i < 2)
+						keyFrame.Transform.Rotation = Quaternion::FromAxisAngle(axis, keyFrame.Time * angularSpeed);
+					keyFrame.Transform.Translation = translation;
+					if (i == 0)
+					{
+						keyFrame.Transform.Translation.y += sin(keyFrame.Time * 3.0f);
+						keyFrame.Transform.Scale = Vec3::Create(1.0f + 0.5f * sin(keyFrame.Time), 1.0f, 1.0f);
+					}
+					channel.KeyFrames.Add(keyFrame);
+				}
+			}
+		}
+		static float RotationError(Quaternion expected, Quaternion actual)
+		{
+			expected = expected * (1.0f / expected.Length());
+			if (Quaternion::Dot(expected, actual) < 0.0f)
+				actual = -actual;
+			auto diff = expected - actual;
+			return Math::Max(Math::Max(fabs(diff.x), fabs(diff.y)), Math::Max(fabs(diff.z), fabs(diff.w)));
+		}
+		static float VectorError(const Vec3 & expected, const Vec3 & actual)
+		{
+			auto diff = expected - actual;
+			return Math::Max(fabs(diff.x), Math::Max(fabs(diff.y), fabs(diff.z)));
+		}
+	public:
+		TEST_METHOD(SampleMatchesSourceAnimation)
+		{
+			Random random(5);
+			SkeletalAnimation anim;
+			CreateAnimation(random, anim);
+			CompressedSkeletalAnimation compressed;
+			compressed.Compress(anim);
+			Assert::AreEqual(30.0f, compressed.SampleRate);
+			Assert::AreEqual(FrameCount + 1, compressed.KeyCount);
+			Assert::AreEqual(3, compressed.Tracks.Count());
+			Assert::IsTrue(compressed.Tracks[0].RotationOffset != -1 && compressed.Tracks[0].TranslationOffset != -1 && compressed.Tracks[0].ScaleOffset != -1);
+			Assert::IsTrue(compressed.Tracks[1].RotationOffset != -1 && compressed.Tracks[1].TranslationOffset == -1 && compressed.Tracks[1].ScaleOffset == -1);
+			Assert::IsTrue(compressed.Tracks[2].RotationOffset == -1 && compressed.Tracks[2].TranslationOffset == -1 && compressed.Tracks[2].ScaleOffset == -1);
+			Assert::AreEqual(compressed.KeyCount * 12, compressed.KeyData.Count());
+
+			float rotationError = 0.0f, translationError = 0.0f, scaleError = 0.0f;
+			List<BoneTransformation> transforms;
+			transforms.SetSize(compressed.Tracks.Count());
+			for (int i = 0; i < 1000; i++)
+			{
+				float time = random.NextFloat(0.0f, anim.Duration);
+				compressed.Sample(time, transforms.Buffer());
+				for (int j = 0; j < anim.Channels.Count(); j++)
+				{
+					auto expected = anim.Channels[j].Sample(time);
+					BoneTransformation single;
+					compressed.SampleTrack(j, time, single);
+					Assert::IsTrue(RotationError(transforms[j].Rotation, single.Rotation) < 1e-6f);
+					rotationError = Math::Max(rotationError, RotationError(expected.Rotation, transforms[j].Rotation));
+					translationError = Math::Max(translationError, VectorError(expected.Translation, transforms[j].Translation));
+					scaleError = Math::Max(scaleError, VectorError(expected.Scale, transforms[j].Scale));
+				}
+			}
+			// 15 bit rotation components and 16 bit translations over a range of about 2 units
+			Assert::IsTrue(rotationError < 1e-4f);
+			Assert::IsTrue(translationError < 1e-4f);
+			Assert::IsTrue(scaleError < 1e-4f);
+		}
+
+		TEST_METHOD(SaveLoadRoundTrip)
+		{
+			Random random(9);
+			SkeletalAnimation anim;
+			CreateAnimation(random, anim);
+			CompressedSkeletalAnimation compressed, loaded;
+			compressed.Compress(anim);
+			RefPtr<MemoryStream> writeStream = new MemoryStream();
+			compressed.SaveToStream(writeStream.Ptr());
+			RefPtr<MemoryStream> readStream = new MemoryStream((unsigned char*)writeStream->GetBuffer(), writeStream->GetBufferSize());
+			loaded.LoadFromStream(readStream.Ptr());
+			Assert::IsTrue(loaded.Name == compressed.Name);
+			Assert::AreEqual(compressed.KeyCount, loaded.KeyCount);
+			Assert::AreEqual(compressed.FrameStride, loaded.FrameStride);
+			Assert::AreEqual(compressed.Tracks.Count(), loaded.Tracks.Count());
+			Assert::AreEqual(compressed.KeyData.Count(), loaded.KeyData.Count());
+			for (int i = 0; i < compressed.KeyData.Count(); i++)
+				Assert::AreEqual(compressed.KeyData[i], loaded.KeyData[i]);
+			for (int i = 0; i < compressed.Tracks.Count(); i++)
+			{
+				BoneTransformation t0, t1;
+				compressed.SampleTrack(i, 1.234f, t0);
+				loaded.SampleTrack(i, 1.234f, t1);
+				Assert::IsTrue(RotationError(t0.Rotation, t1.Rotation) < 1e-6f);
+				Assert::AreEqual(0.0f, VectorError(t0.Translation, t1.Translation));
+				Assert::AreEqual(0.0f, VectorError(t0.Scale, t1.Scale));
+			}
+		}
+	};
+}
@@ -0,0 +1,84 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "../CoreLib/Basic.h"
+#include "../CoreLib/JobSystem.h"
+#include "../CoreLib/PerformanceCounter.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace CoreLib;
+using namespace CoreLib::Diagnostics;
+using namespace CoreLib::Threading;
+
+namespace UnitTest
+{
+	TEST_CLASS(JobSystemTest)
+	{
+	private:
+		static void EmptyJob(Job & /*job*/)
+		{
+		}
+	public:
+		TEST_METHOD(ParallelForVisitsEveryIndexOnce)
+		{
+			const int count = 100000;
+			JobSystem jobSystem(3);
+			List<int> visits;
+			visits.SetSize(count);
+			for (int grainSize : { 1, 7, 0 })
+			{
+				for (auto & v : visits)
+					v = 0;
+				jobSystem.ParallelFor(0, count, [&](int i) { visits[i]++; }, grainSize);
+				for (auto v : visits)
+					Assert::AreEqual(1, v);
+			}
+		}
+
+		TEST_METHOD(DependentJobsStartAfterDependency)
+		{
+			JobSystem jobSystem(3);
+			JobCounter firstStage, secondStage;
+			std::atomic<int> firstStageDone, outOfOrder;
+			firstStageDone = 0;
+			outOfOrder = 0;
+			for (int i = 0; i < 100; i++)
+				jobSystem.Schedule([&]() { firstStageDone++; }, &firstStage);
+			for (int i = 0; i < 100; i++)
+				jobSystem.Schedule([&]() { if (firstStageDone.load() != 100) outOfOrder++; }, &secondStage, &firstStage);
+			jobSystem.Wait(secondStage);
+			Assert::IsTrue(firstStage.IsDone());
+			Assert::AreEqual(0, outOfOrder.load());
+		}
+
+		TEST_METHOD(NestedWaitRunsPendingJobs)
+		{
+			JobSystem jobSystem(3);
+			std::atomic<long long> sum;
+			sum = 0;
+			jobSystem.ParallelFor(0, 64, [&](int)
+			{
+				jobSystem.ParallelFor(0, 1000, [&](int j) { sum += j; }, 1);
+			}, 1);
+			Assert::AreEqual(64LL * 499500LL, sum.load());
+		}
+
+		TEST_METHOD(JobSchedulingBenchmark)
+		{
+			const int jobCount = 200000;
+			auto jobSystem = JobSystem::Instance();
+			JobCounter counter;
+			auto scheduleStart = PerformanceCounter::Start();
+			for (int i = 0; i < jobCount; i++)
+				jobSystem->Schedule(EmptyJob, nullptr, &counter);
+			jobSystem->Wait(counter);
+			auto scheduleTime = PerformanceCounter::ToSeconds(PerformanceCounter::End(scheduleStart));
+			auto parallelForStart = PerformanceCounter::Start();
+			jobSystem->ParallelFor(0, jobCount, [](int) {}, 1);
+			auto parallelForTime = PerformanceCounter::ToSeconds(PerformanceCounter::End(parallelForStart));
+			StringBuilder sb;
+			sb << "workers: " << jobSystem->GetWorkerCount()
+				<< "\nschedule + run: " << (int)(scheduleTime * 1e9 / jobCount) << " ns/job"
+				<< "\nparallel for (grain 1): " << (int)(parallelForTime * 1e9 / jobCount) << " ns/iteration\n";
+			Logger::WriteMessage(sb.ProduceString().Buffer());
+		}
+	};
+}
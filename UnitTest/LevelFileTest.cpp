@@ -0,0 +1,110 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "../CoreLib/Basic.h"
+#include "../GameEngineCore/LevelFile.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace CoreLib;
+using namespace GameEngine;
+
+namespace UnitTest
+{
+	TEST_CLASS(LevelFileTest)
+	{
+	private:
+		struct TestActor : public PropertyContainer
+		{
+		public:
+			PROPERTY(String, Name);
+			PROPERTY(int, Count);
+			PROPERTY_DEF(float, Radius, 1.0f);
+			PROPERTY_DEF(bool, CastShadow, true);
+			PROPERTY(VectorMath::Vec3, Color);
+			PROPERTY(VectorMath::Matrix4, LocalTransform);
+			PROPERTY_ATTRIB(String, MeshFile, "resource(Mesh, mesh)");
+			PROPERTY(List<String>, Targets);
+		};
+		static void InitActor(TestActor & actor, int id)
+		{
+			actor.Name = String("actor") + String(id);
+			actor.Count = id * 7 - 3;
+			actor.Radius = 0.1f + id;
+			actor.CastShadow = (id & 1) != 0;
+			actor.Color = VectorMath::Vec3::Create(0.5f, 1.0f / (id + 1), 2.0f);
+			VectorMath::Matrix4 transform;
+			VectorMath::Matrix4::CreateRandomMatrix(transform);
+			actor.LocalTransform = transform;
+			// every other actor shares a mesh, so the resource table is deduplicated
+			actor.MeshFile = String("mesh") + String(id & 1) + ".mesh";
+			List<String> targets;
+			targets.Add("first \"quoted\"");
+			targets.Add(String(id));
+			actor.Targets = targets;
+		}
+		static String SerializeToText(PropertyContainer & container)
+		{
+			StringBuilder sb;
+			for (auto prop : container.GetPropertyList())
+			{
+				sb << prop->GetName() << " ";
+				prop->Serialize(sb);
+				sb << "\n";
+			}
+			return sb.ProduceString();
+		}
+	public:
+		TEST_METHOD(RoundTripMatchesTextFormat)
+		{
+			const int actorCount = 5;
+			TestActor actors[actorCount];
+			LevelFileWriter writer;
+			for (int i = 0; i < actorCount; i++)
+			{
+				InitActor(actors[i], i);
+				writer.AddActor("TestActor", &actors[i], i == 2 ? "mesh \"box.mesh\"" : "");
+			}
+			writer.AddHiddenSection("Editor { }");
+			List<unsigned char> buffer;
+			writer.WriteToBuffer(buffer);
+
+			LevelFileReader reader;
+			Assert::IsTrue(reader.Init(buffer.GetArrayView()));
+			Assert::AreEqual(actorCount, reader.GetActorCount());
+			Assert::AreEqual(2, reader.GetResourceCount());
+			Assert::AreEqual(1, reader.GetHiddenSectionCount());
+			Assert::AreEqual("Editor { }", reader.GetHiddenSection(0).Buffer());
+			for (int i = 0; i < actorCount; i++)
+			{
+				auto & record = reader.GetActor(i);
+				Assert::AreEqual("TestActor", reader.GetStringBuffer(record.ClassName));
+				if (i == 2)
+					Assert::AreEqual("mesh \"box.mesh\"", reader.GetStringBuffer(record.Fields));
+				else
+					Assert::IsTrue(record.Fields == LevelFileNone);
+				TestActor loaded;
+				List<String> errors;
+				Assert::IsTrue(reader.ReadProperties(i, &loaded, errors));
+				Assert::AreEqual(0, errors.Count());
+				Assert::AreEqual(SerializeToText(actors[i]).Buffer(), SerializeToText(loaded).Buffer());
+			}
+		}
+		TEST_METHOD(RejectsCorruptFile)
+		{
+			TestActor actor;
+			InitActor(actor, 1);
+			LevelFileWriter writer;
+			writer.AddActor("TestActor", &actor, "");
+			List<unsigned char> buffer;
+			writer.WriteToBuffer(buffer);
+
+			LevelFileReader reader;
+			Assert::IsFalse(reader.Init(buffer.GetArrayView(0, buffer.Count() - 1)));
+			auto header = (LevelFileHeader*)buffer.Buffer();
+			header->Properties.Count += 100;
+			Assert::IsFalse(reader.Init(buffer.GetArrayView()));
+			header->Properties.Count -= 100;
+			Assert::IsTrue(reader.Init(buffer.GetArrayView()));
+			header->Magic = 0;
+			Assert::IsFalse(reader.Init(buffer.GetArrayView()));
+		}
+	};
+}
@@ -0,0 +1,73 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "../CoreLib/Basic.h"
+#include "../GameEngineCore/LightingData.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace CoreLib;
+using namespace GameEngine;
+using namespace VectorMath;
+
+namespace UnitTest
+{
+	TEST_CLASS(LightBinningTest)
+	{
+	public:
+		TEST_METHOD(SpotLightBinnedAlongItsCone)
+		{
+			// the camera sits at the origin and looks along -z
+			const float zNear = 0.1f, zFar = 1000.0f;
+			StandardViewUniforms view;
+			Matrix4::CreateIdentityMatrix(view.ViewTransform);
+			Matrix4 projection;
+			Matrix4::CreatePerspectiveMatrixFromViewAngle(projection, 60.0f, 2.0f, zNear, zFar);
+			view.ViewProjectionTransform = projection;
+			projection.Inverse(view.InvViewProjTransform);
+			view.InvViewTransform = view.ViewTransform;
+
+			// a spot light 20 units in front of the camera shining away from it, and a point light at the same place
+			GpuLightData lights[2];
+			memset(lights, 0, sizeof(lights));
+			for (auto & light : lights)
+			{
+				light.position = Vec3::Create(0.0f, 0.0f, -20.0f);
+				light.radius = 30.0f;
+				light.direction = PackDirection(Vec3::Create(0.0f, 0.0f, 1.0f));
+			}
+			lights[0].lightType = GpuLightType_Spot;
+			lights[0].startAngle = 10.0f * Math::Pi / 180.0f;
+			lights[0].endAngle = 15.0f * Math::Pi / 180.0f;
+			lights[1].lightType = GpuLightType_Point;
+
+			List<unsigned int> clusterData;
+			clusterData.SetSize(LightClusterTilesX * LightClusterTilesY * LightClusterSlices);
+			List<unsigned short> indexData;
+			indexData.SetSize(MaxClusterLightIndices);
+			LightBinningPass binning;
+			binning.Execute(view, zNear, zFar, ArrayView<GpuLightData>(lights, 2), 0, clusterData.Buffer(), indexData.Buffer());
+
+			float depthScale, depthBias;
+			LightBinningPass::GetDepthSliceParams(zNear, zFar, depthScale, depthBias);
+			// returns the mask of the lights binned to the cluster containing the view space point
+			auto getClusterLights = [&](Vec3 pos)
+			{
+				auto ndc = projection.TransformHomogeneous(pos);
+				int x = (int)floor((ndc.x + 1.0f) * 0.5f * LightClusterTilesX);
+				int y = (int)floor((ndc.y + 1.0f) * 0.5f * LightClusterTilesY);
+				int slice = (int)floor(log(-pos.z) * depthScale + depthBias);
+				unsigned int cluster = clusterData[(slice * LightClusterTilesY + y) * LightClusterTilesX + x];
+				int mask = 0;
+				for (unsigned int i = 0; i < (cluster & 0xFFF); i++)
+					mask |= 1 << indexData[(cluster >> 12) + i];
+				return mask;
+			};
+			// inside the cone
+			Assert::AreEqual(3, getClusterLights(Vec3::Create(0.5f, 0.5f, -45.0f)));
+			// behind the apex
+			Assert::AreEqual(2, getClusterLights(Vec3::Create(0.5f, 0.5f, -8.0f)));
+			// beside the cone, within the light radius
+			Assert::AreEqual(2, getClusterLights(Vec3::Create(20.0f, 0.5f, -25.0f)));
+			// beyond the light radius
+			Assert::AreEqual(0, getClusterLights(Vec3::Create(0.5f, 0.5f, -85.0f)));
+		}
+	};
+}
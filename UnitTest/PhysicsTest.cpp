@@ -0,0 +1,298 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "../CoreLib/Basic.h"
+#include "../CoreLib/PerformanceCounter.h"
+#include "../CoreLib/JobSystem.h"
+#include "../GameEngineCore/Physics.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace CoreLib;
+using namespace CoreLib::Diagnostics;
+using namespace CoreLib::Threading;
+using namespace GameEngine;
+using namespace VectorMath;
+
+namespace UnitTest
+{
+	TEST_CLASS(PhysicsTest)
+	{
+	private:
+		static RefPtr<PhysicsModel> CreateRandomModel(Random & random, int faceCount, PhysicsFaceLayout layout = PhysicsFaceLayout::SoA)
+		{
+			PhysicsModelBuilder builder;
+			builder.SetFaceLayout(layout);
+			for (int i = 0; i < faceCount; i++)
+			{
+				PhysicsModelFace face;
+				Vec3 center = Vec3::Create(random.NextFloat(0.0f, 100.0f), random.NextFloat(0.0f, 100.0f), random.NextFloat(0.0f, 100.0f));
+				for (int j = 0; j < 3; j++)
+					face.Vertices[j] = center + Vec3::Create(random.NextFloat(-2.0f, 2.0f), random.NextFloat(-2.0f, 2.0f), random.NextFloat(-2.0f, 2.0f));
+				face.Normal = Vec3::Cross(face.Vertices[1] - face.Vertices[0], face.Vertices[2] - face.Vertices[0]).Normalize();
+				builder.AddFace(face);
+			}
+			return builder.GetModel();
+		}
+		static void CreateRandomRays(Random & random, List<Ray> & rays, int count)
+		{
+			rays.SetSize(count);
+			for (auto & ray : rays)
+			{
+				ray.Origin = Vec3::Create(random.NextFloat(-20.0f, 120.0f), random.NextFloat(-20.0f, 120.0f), random.NextFloat(-20.0f, 120.0f));
+				ray.Dir = Vec3::Create(random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f)).Normalize();
+			}
+		}
+	public:
+		TEST_METHOD(BvhMatchesLinearScan)
+		{
+			for (auto layout : { PhysicsFaceLayout::AoS, PhysicsFaceLayout::SoA })
+			{
+				Random random(1723);
+				auto model = CreateRandomModel(random, 5000, layout);
+				Assert::IsTrue(model->GetFaceLayout() == layout);
+				List<Ray> rays;
+				CreateRandomRays(random, rays, 2000);
+				for (auto & ray : rays)
+				{
+					auto hit0 = model->TraceRay(ray.Origin, ray.Dir, 0.0f, 1e30f);
+					auto hit1 = model->TraceRayBruteForce(ray.Origin, ray.Dir, 0.0f, 1e30f);
+					Assert::AreEqual(hit0.IsHit, hit1.IsHit);
+					Assert::AreEqual(hit0.FaceId, hit1.FaceId);
+					Assert::AreEqual(hit0.Distance, hit1.Distance);
+				}
+			}
+		}
+
+		TEST_METHOD(RayTraceBatchMatchesRayTraceFirst)
+		{
+			Random random(9127);
+			auto model = CreateRandomModel(random, 500);
+			PhysicsScene scene;
+			List<RefPtr<PhysicsObject>> objects;
+			for (int i = 0; i < 300; i++)
+			{
+				RefPtr<PhysicsObject> obj = new PhysicsObject(model.Ptr());
+				Matrix4 transform;
+				Matrix4::Translation(transform, random.NextFloat(-500.0f, 500.0f), random.NextFloat(-500.0f, 500.0f), random.NextFloat(-500.0f, 500.0f));
+				obj->SetModelTransform(transform);
+				scene.AddObject(obj.Ptr());
+				objects.Add(obj);
+			}
+			List<Ray> rays;
+			CreateRandomRays(random, rays, 1001);
+			List<TraceResult> batchResults, anyHitResults;
+			batchResults.SetSize(rays.Count());
+			anyHitResults.SetSize(rays.Count());
+			scene.RayTraceBatch(rays.GetArrayView(), batchResults.GetArrayView());
+			scene.RayTraceBatch(rays.GetArrayView(), anyHitResults.GetArrayView(), PhysicsChannels::All, RayTraceMode::AnyHit);
+			for (int i = 0; i < rays.Count(); i++)
+			{
+				auto rs = scene.RayTraceFirst(rays[i]);
+				Assert::IsTrue(rs.Object == batchResults[i].Object);
+				Assert::IsTrue((rs.Object != nullptr) == (anyHitResults[i].Object != nullptr));
+				if (rs.Object)
+					Assert::IsTrue(fabs(rs.Distance - batchResults[i].Distance) < 1e-3f);
+			}
+		}
+
+		TEST_METHOD(RayBatchPacketsShareDirectionOctant)
+		{
+			Random random(4411);
+			List<Ray> rays;
+			CreateRandomRays(random, rays, 256);
+			// every ray has a twin from the same origin with the opposite z direction, which only the octant separates
+			for (int i = 0; i < 128; i++)
+			{
+				rays[i + 128] = rays[i];
+				rays[i + 128].Dir.z = -rays[i].Dir.z;
+			}
+			auto getOctant = [&](int rayId)
+			{
+				auto & dir = rays[rayId].Dir;
+				return (dir.x < 0.0f ? 1 : 0) | (dir.y < 0.0f ? 2 : 0) | (dir.z < 0.0f ? 4 : 0);
+			};
+			List<int> sortedRayIds;
+			PhysicsScene::SortRayBatch(rays.GetArrayView(), sortedRayIds);
+			Assert::AreEqual(rays.Count(), sortedRayIds.Count());
+			List<bool> visited;
+			visited.SetSize(rays.Count());
+			for (auto & v : visited)
+				v = false;
+			for (int i = 0; i < sortedRayIds.Count(); i++)
+			{
+				Assert::IsFalse(visited[sortedRayIds[i]]);
+				visited[sortedRayIds[i]] = true;
+				if (i > 0)
+					Assert::IsTrue(getOctant(sortedRayIds[i - 1]) <= getOctant(sortedRayIds[i]));
+			}
+			// rays of an octant are contiguous, so only packets at the 7 octant boundaries can mix directions
+			int mixedPackets = 0;
+			for (int i = 0; i < sortedRayIds.Count(); i += 4)
+			{
+				for (int j = 1; j < 4; j++)
+				{
+					if (getOctant(sortedRayIds[i + j]) != getOctant(sortedRayIds[i]))
+					{
+						mixedPackets++;
+						break;
+					}
+				}
+			}
+			Assert::IsTrue(mixedPackets <= 7);
+		}
+
+		TEST_METHOD(ConcurrentTracesWhileObjectsMove)
+		{
+			Random random(3301);
+			auto model = CreateRandomModel(random, 200);
+			PhysicsScene scene;
+			List<RefPtr<PhysicsObject>> tracedObjects, movedObjects;
+			auto addObject = [&](List<RefPtr<PhysicsObject>> & list, float z)
+			{
+				RefPtr<PhysicsObject> obj = new PhysicsObject(model.Ptr());
+				Matrix4 transform;
+				Matrix4::Translation(transform, random.NextFloat(-300.0f, 300.0f), random.NextFloat(-300.0f, 300.0f), z);
+				obj->SetModelTransform(transform);
+				scene.AddObject(obj.Ptr());
+				list.Add(obj);
+			};
+			// rays stay in the z range of the traced objects, the moved objects are far above them
+			for (int i = 0; i < 100; i++)
+				addObject(tracedObjects, random.NextFloat(-20.0f, 20.0f));
+			for (int i = 0; i < 100; i++)
+				addObject(movedObjects, 10000.0f);
+			scene.Tick();
+			List<Ray> rays;
+			CreateRandomRays(random, rays, 2000);
+			for (auto & ray : rays)
+			{
+				ray.Origin.z = random.NextFloat(0.0f, 100.0f);
+				ray.Dir.z = 0.0f;
+				ray.Dir = ray.Dir.Normalize();
+			}
+			List<TraceResult> expected, results;
+			expected.SetSize(rays.Count());
+			results.SetSize(rays.Count());
+			for (int i = 0; i < rays.Count(); i++)
+				expected[i] = scene.RayTraceFirst(rays[i]);
+			List<Matrix4> newTransforms;
+			newTransforms.SetSize(movedObjects.Count());
+			for (auto & transform : newTransforms)
+				Matrix4::Translation(transform, random.NextFloat(-300.0f, 300.0f), random.NextFloat(-300.0f, 300.0f), random.NextFloat(9000.0f, 11000.0f));
+
+			// moving objects marks them dirty from worker threads while other workers trace, as in a parallel actor tick
+			JobSystem jobSystem(3);
+			int moveCount = movedObjects.Count();
+			scene.BeginParallelQueries();
+			jobSystem.ParallelFor(0, moveCount + rays.Count(), [&](int i)
+			{
+				if (i < moveCount)
+					movedObjects[i]->SetModelTransform(newTransforms[i]);
+				else
+					results[i - moveCount] = scene.RayTraceFirst(rays[i - moveCount]);
+			}, 1);
+			scene.EndParallelQueries();
+			for (int i = 0; i < rays.Count(); i++)
+			{
+				Assert::IsTrue(expected[i].Object == results[i].Object);
+				if (expected[i].Object)
+					Assert::AreEqual(expected[i].Distance, results[i].Distance);
+			}
+			for (auto & obj : movedObjects)
+				Assert::IsTrue(obj->CheckModelTransformDirtyBit());
+			scene.Tick();
+			for (auto & obj : movedObjects)
+				Assert::IsFalse(obj->CheckModelTransformDirtyBit());
+		}
+
+		TEST_METHOD(MovedObjectsFoundWithoutTick)
+		{
+			// a square of two faces in the z = 50 plane, covering x and y from 0 to 100
+			PhysicsModelBuilder builder;
+			Vec3 corners[4] = { Vec3::Create(0.0f, 0.0f, 50.0f), Vec3::Create(100.0f, 0.0f, 50.0f),
+				Vec3::Create(100.0f, 100.0f, 50.0f), Vec3::Create(0.0f, 100.0f, 50.0f) };
+			for (int i = 0; i < 2; i++)
+			{
+				PhysicsModelFace face;
+				face.Vertices[0] = corners[0];
+				face.Vertices[1] = corners[i + 1];
+				face.Vertices[2] = corners[i + 2];
+				face.Normal = Vec3::Create(0.0f, 0.0f, 1.0f);
+				builder.AddFace(face);
+			}
+			auto model = builder.GetModel();
+			PhysicsScene scene;
+			List<RefPtr<PhysicsObject>> objects;
+			for (int i = 0; i < 20; i++)
+			{
+				RefPtr<PhysicsObject> obj = new PhysicsObject(model.Ptr());
+				Matrix4 transform;
+				Matrix4::Translation(transform, i * 200.0f, 0.0f, 0.0f);
+				obj->SetModelTransform(transform);
+				scene.AddObject(obj.Ptr());
+				objects.Add(obj);
+			}
+			scene.Tick();
+			// move every other object far outside the fat bounds of its broad phase entry
+			for (int i = 0; i < objects.Count(); i += 2)
+			{
+				Matrix4 transform;
+				Matrix4::Translation(transform, i * 200.0f, 5000.0f, 0.0f);
+				objects[i]->SetModelTransform(transform);
+			}
+			// rays along z through the center of each object's old and new position
+			List<Ray> rays;
+			for (int i = 0; i < objects.Count(); i++)
+			{
+				for (float y : { 50.0f, 5050.0f })
+				{
+					Ray ray;
+					ray.Origin = Vec3::Create(i * 200.0f + 50.0f, y, -100.0f);
+					ray.Dir = Vec3::Create(0.0f, 0.0f, 1.0f);
+					rays.Add(ray);
+				}
+			}
+			List<TraceResult> batchResults;
+			batchResults.SetSize(rays.Count());
+			scene.RayTraceBatch(rays.GetArrayView(), batchResults.GetArrayView());
+			for (int i = 0; i < rays.Count(); i++)
+			{
+				auto result = scene.RayTraceFirst(rays[i]);
+				int objId = i >> 1;
+				bool moved = (objId & 1) == 0;
+				bool atNewPosition = moved ? (i & 1) == 1 : (i & 1) == 0;
+				Assert::IsTrue(result.Object == (atNewPosition ? objects[objId].Ptr() : nullptr));
+				Assert::IsTrue(batchResults[i].Object == result.Object);
+			}
+		}
+
+		TEST_METHOD(BvhTraceRayBenchmark)
+		{
+			Random random(5531);
+			auto model = CreateRandomModel(random, 200000, PhysicsFaceLayout::SoA);
+			Random aosRandom(5531);
+			auto aosModel = CreateRandomModel(aosRandom, 200000, PhysicsFaceLayout::AoS);
+			List<Ray> rays;
+			CreateRandomRays(random, rays, 200);
+			int hitCount = 0, aosHitCount = 0, linearHitCount = 0;
+			auto bvhStart = PerformanceCounter::Start();
+			for (auto & ray : rays)
+				hitCount += model->TraceRay(ray.Origin, ray.Dir, 0.0f, 1e30f).IsHit ? 1 : 0;
+			auto bvhTime = PerformanceCounter::ToSeconds(PerformanceCounter::End(bvhStart));
+			auto aosStart = PerformanceCounter::Start();
+			for (auto & ray : rays)
+				aosHitCount += aosModel->TraceRay(ray.Origin, ray.Dir, 0.0f, 1e30f).IsHit ? 1 : 0;
+			auto aosTime = PerformanceCounter::ToSeconds(PerformanceCounter::End(aosStart));
+			auto linearStart = PerformanceCounter::Start();
+			for (auto & ray : rays)
+				linearHitCount += model->TraceRayBruteForce(ray.Origin, ray.Dir, 0.0f, 1e30f).IsHit ? 1 : 0;
+			auto linearTime = PerformanceCounter::ToSeconds(PerformanceCounter::End(linearStart));
+			Assert::AreEqual(linearHitCount, hitCount);
+			Assert::AreEqual(linearHitCount, aosHitCount);
+			StringBuilder sb;
+			sb << "faces: " << model->GetFaceCount() << ", bvh nodes: " << model->GetBvhNodeCount()
+				<< "\nbvh (soa): " << (int)(rays.Count() / bvhTime) << " rays/s"
+				<< "\nbvh (aos): " << (int)(rays.Count() / aosTime) << " rays/s"
+				<< "\nlinear: " << (int)(rays.Count() / linearTime) << " rays/s\n";
+			Logger::WriteMessage(sb.ProduceString().Buffer());
+		}
+	};
+}
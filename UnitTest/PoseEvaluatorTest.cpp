@@ -0,0 +1,83 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "../CoreLib/Basic.h"
+#include "../GameEngineCore/PoseEvaluator.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace CoreLib;
+using namespace VectorMath;
+using namespace GameEngine;
+
+namespace UnitTest
+{
+	TEST_CLASS(PoseEvaluatorTest)
+	{
+	private:
+		static BoneTransformation RandomTransform(Random & random)
+		{
+			BoneTransformation transform;
+			auto axis = Vec3::Create(random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f)).Normalize();
+			transform.Rotation = Quaternion::FromAxisAngle(axis, random.NextFloat(0.0f, Math::Pi));
+			transform.Translation = Vec3::Create(random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f));
+			transform.Scale = Vec3::Create(random.NextFloat(0.5f, 1.5f), random.NextFloat(0.5f, 1.5f), random.NextFloat(0.5f, 1.5f));
+			return transform;
+		}
+		static void CreateSkeleton(Random & random, Skeleton & skeleton, int boneCount, int mappedBoneCount)
+		{
+			for (int i = 0; i < boneCount; i++)
+			{
+				Bone bone;
+				bone.Name = String("bone") + String(i);
+				bone.ParentId = i == 0 ? -1 : random.Next(0, i);
+				bone.BindPose = RandomTransform(random);
+				skeleton.Bones.Add(bone);
+				skeleton.InversePose.Add(RandomTransform(random).ToMatrix());
+				if (i < mappedBoneCount)
+					skeleton.BoneMapping[bone.Name] = i;
+			}
+		}
+	public:
+		TEST_METHOD(BatchMatchesGetMatrices)
+		{
+			Random random(11);
+			const int poseCount = 16;
+			Skeleton skeletons[2];
+			CreateSkeleton(random, skeletons[0], 37, 33);
+			CreateSkeleton(random, skeletons[1], 5, 5);
+			List<Pose> poses;
+			List<Matrix4> localTransforms;
+			List<List<Matrix4>> outputs;
+			PoseBatchEvaluator evaluator;
+			poses.SetSize(poseCount);
+			localTransforms.SetSize(poseCount);
+			outputs.SetSize(poseCount);
+			for (int i = 0; i < poseCount; i++)
+			{
+				auto & skeleton = skeletons[i & 1];
+				// shorter poses leave the remaining bones in their bind pose
+				int transformCount = skeleton.Bones.Count() - (i & 2);
+				for (int j = 0; j < transformCount; j++)
+					poses[i].Transforms.Add(RandomTransform(random));
+				localTransforms[i] = RandomTransform(random).ToMatrix();
+				outputs[i].SetSize(skeleton.Bones.Count());
+				evaluator.Add(&skeleton, poses[i], localTransforms[i], outputs[i].Buffer(), (i & 4) == 0);
+			}
+			Assert::AreEqual(poseCount, evaluator.GetPoseCount());
+			evaluator.Evaluate();
+			Assert::AreEqual(0, evaluator.GetPoseCount());
+
+			float maxError = 0.0f;
+			for (int i = 0; i < poseCount; i++)
+			{
+				List<Matrix4> expected;
+				poses[i].GetMatrices(&skeletons[i & 1], expected, (i & 4) == 0);
+				for (int j = 0; j < expected.Count(); j++)
+				{
+					Matrix4::Multiply(expected[j], localTransforms[i], expected[j]);
+					for (int k = 0; k < 16; k++)
+						maxError = Math::Max(maxError, fabs(expected[j].values[k] - outputs[i][j].values[k]) / Math::Max(1.0f, fabs(expected[j].values[k])));
+				}
+			}
+			Assert::IsTrue(maxError < 1e-4f);
+		}
+	};
+}
@@ -0,0 +1,76 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "../CoreLib/Basic.h"
+#include "../CoreLib/Threading.h"
+#include "../CoreLib/Profiler.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace CoreLib;
+using namespace CoreLib::Diagnostics;
+using namespace CoreLib::Threading;
+
+namespace UnitTest
+{
+	TEST_CLASS(ProfilerTest)
+	{
+	private:
+		static int CountOccurrences(const String & text, const char * pattern)
+		{
+			int count = 0;
+			int pos = text.IndexOf(pattern);
+			while (pos != -1)
+			{
+				count++;
+				pos = text.IndexOf(pattern, pos + 1);
+			}
+			return count;
+		}
+	public:
+		TEST_METHOD(ZonesFromAllThreadsAreExported)
+		{
+			const int threadCount = 4;
+			const int zonesPerThread = 1000;
+			Profiler::BeginCapture();
+			List<RefPtr<Thread>> threads;
+			for (int i = 0; i < threadCount; i++)
+			{
+				threads.Add(new Thread(new ThreadProc([=]()
+				{
+					for (int j = 0; j < zonesPerThread; j++)
+					{
+						PROFILE_ZONE("WorkerZone");
+					}
+				})));
+			}
+			for (auto & thread : threads)
+				thread->Join();
+			{
+				PROFILE_ZONE("MainZone");
+			}
+			Profiler::EndCapture();
+			{
+				PROFILE_ZONE("ZoneOutsideCapture");
+			}
+			auto trace = Profiler::ExportChromeTrace();
+			Assert::AreEqual(threadCount * zonesPerThread, CountOccurrences(trace, "\"WorkerZone\""));
+			Assert::AreEqual(1, CountOccurrences(trace, "\"MainZone\""));
+			Assert::AreEqual(0, CountOccurrences(trace, "ZoneOutsideCapture"));
+		}
+
+		TEST_METHOD(RingBufferKeepsLatestZones)
+		{
+			Profiler::BeginCapture();
+			for (int i = 0; i < Profiler::ZonesPerThread + 100; i++)
+			{
+				PROFILE_ZONE("Zone");
+			}
+			Profiler::EndCapture();
+			auto trace = Profiler::ExportChromeTrace();
+			Assert::AreEqual(Profiler::ZonesPerThread, CountOccurrences(trace, "\"Zone\""));
+
+			// a new capture discards the zones of the previous one
+			Profiler::BeginCapture();
+			Profiler::EndCapture();
+			Assert::AreEqual(0, CountOccurrences(Profiler::ExportChromeTrace(), "\"Zone\""));
+		}
+	};
+}
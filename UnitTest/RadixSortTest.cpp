@@ -0,0 +1,67 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "../CoreLib/Basic.h"
+#include "../CoreLib/RadixSort.h"
+#include "../CoreLib/PerformanceCounter.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace CoreLib;
+using namespace CoreLib::Diagnostics;
+
+namespace UnitTest
+{
+	struct SortItem
+	{
+		unsigned long long Key;
+		int Index;
+	};
+
+	TEST_CLASS(RadixSortTest)
+	{
+	private:
+		static void CreateItems(Random & random, List<SortItem> & items, int count, int keyRange)
+		{
+			items.SetSize(count);
+			for (int i = 0; i < count; i++)
+			{
+				// keep the highest byte constant so that the pass skipping is exercised
+				items[i].Key = (0x5Aull << 56) | ((unsigned long long)random.Next(0, keyRange) << 20) | (unsigned long long)random.Next(0, 4);
+				items[i].Index = i;
+			}
+		}
+	public:
+		TEST_METHOD(RadixSortIsStable)
+		{
+			Random random(3);
+			List<SortItem> items, scratch;
+			CreateItems(random, items, 10000, 100);
+			RadixSortByKey(items, scratch);
+			Assert::AreEqual(10000, items.Count());
+			for (int i = 1; i < items.Count(); i++)
+			{
+				Assert::IsTrue(items[i - 1].Key <= items[i].Key);
+				if (items[i - 1].Key == items[i].Key)
+					Assert::IsTrue(items[i - 1].Index < items[i].Index);
+			}
+		}
+
+		TEST_METHOD(RadixSortBenchmark)
+		{
+			const int count = 100000;
+			Random random(5);
+			List<SortItem> items, scratch, reference;
+			CreateItems(random, items, count, 1 << 30);
+			reference.AddRange(items);
+			auto start = PerformanceCounter::Start();
+			RadixSortByKey(items, scratch);
+			auto radixTime = PerformanceCounter::ToSeconds(PerformanceCounter::End(start));
+			start = PerformanceCounter::Start();
+			reference.Sort([](const SortItem & a, const SortItem & b) { return a.Key < b.Key; });
+			auto comparisonTime = PerformanceCounter::ToSeconds(PerformanceCounter::End(start));
+			for (int i = 0; i < count; i++)
+				Assert::IsTrue(items[i].Key == reference[i].Key);
+			StringBuilder sb;
+			sb << "sorting " << count << " keys (ms): radix " << radixTime * 1000.0 << ", comparison " << comparisonTime * 1000.0 << "\n";
+			Logger::WriteMessage(sb.ProduceString().Buffer());
+		}
+	};
+}
@@ -0,0 +1,117 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "../CoreLib/Basic.h"
+#include "../CoreLib/Threading.h"
+#include "../CoreLib/PerformanceCounter.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace CoreLib;
+using namespace CoreLib::Diagnostics;
+using namespace CoreLib::Threading;
+
+namespace UnitTest
+{
+	struct PlainObject
+	{
+		int Value = 0;
+	};
+
+	struct CountedObject : public RefObject
+	{
+		int Value = 0;
+	};
+
+	struct AtomicCountedObject : public ThreadSafeRefObject
+	{
+		int Value = 0;
+	};
+
+	struct SharedObject : public ThreadSafeRefObject
+	{
+		static std::atomic<int> DestructorCalls;
+		int Value = 0;
+		~SharedObject()
+		{
+			DestructorCalls++;
+		}
+	};
+	std::atomic<int> SharedObject::DestructorCalls;
+
+	TEST_CLASS(RefPtrTest)
+	{
+	private:
+		template<typename T>
+		static double MeasureCopies(const RefPtr<T> & source, int count)
+		{
+			List<RefPtr<T>> copies;
+			copies.SetSize(64);
+			auto start = PerformanceCounter::Start();
+			for (int i = 0; i < count; i++)
+				copies[i & 63] = source;
+			copies.Clear();
+			return PerformanceCounter::ToSeconds(PerformanceCounter::End(start));
+		}
+		template<typename T>
+		static double MeasureCreation(int count)
+		{
+			List<RefPtr<T>> objects;
+			objects.SetSize(64);
+			auto start = PerformanceCounter::Start();
+			for (int i = 0; i < count; i++)
+				objects[i & 63] = new T();
+			objects.Clear();
+			return PerformanceCounter::ToSeconds(PerformanceCounter::End(start));
+		}
+	public:
+		TEST_METHOD(ThreadSafeRefObjectSharedAcrossThreads)
+		{
+			SharedObject::DestructorCalls = 0;
+			const int threadCount = 4;
+			const int iterations = 100000;
+			for (int round = 0; round < 10; round++)
+			{
+				RefPtr<SharedObject> shared = new SharedObject();
+				List<RefPtr<Thread>> threads;
+				for (int i = 0; i < threadCount; i++)
+				{
+					threads.Add(new Thread(new ThreadProc([=]()
+					{
+						RefPtr<SharedObject> local;
+						for (int j = 0; j < iterations; j++)
+						{
+							local = shared;
+							RefPtr<SharedObject> copy = local;
+							local = nullptr;
+						}
+					})));
+				}
+				shared = nullptr;
+				for (auto & thread : threads)
+					thread->Join();
+			}
+			Assert::AreEqual(10, SharedObject::DestructorCalls.load());
+		}
+
+		TEST_METHOD(RefCountBenchmark)
+		{
+			const int count = 10000000;
+			RefPtr<PlainObject> plain = new PlainObject();
+			RefPtr<CountedObject> counted = new CountedObject();
+			RefPtr<AtomicCountedObject> shared = new AtomicCountedObject();
+			auto plainCopy = MeasureCopies(plain, count);
+			auto countedCopy = MeasureCopies(counted, count);
+			auto sharedCopy = MeasureCopies(shared, count);
+			const int createCount = 1000000;
+			auto plainCreate = MeasureCreation<PlainObject>(createCount);
+			auto countedCreate = MeasureCreation<CountedObject>(createCount);
+			auto sharedCreate = MeasureCreation<AtomicCountedObject>(createCount);
+			StringBuilder sb;
+			sb << "copy (ns): external counter " << plainCopy * 1e9 / count
+				<< ", intrusive " << countedCopy * 1e9 / count
+				<< ", intrusive atomic " << sharedCopy * 1e9 / count
+				<< "\ncreate (ns): external counter " << plainCreate * 1e9 / createCount
+				<< ", intrusive " << countedCreate * 1e9 / createCount
+				<< ", intrusive atomic " << sharedCreate * 1e9 / createCount << "\n";
+			Logger::WriteMessage(sb.ProduceString().Buffer());
+		}
+	};
+}
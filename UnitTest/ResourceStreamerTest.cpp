@@ -0,0 +1,125 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "../CoreLib/Basic.h"
+#include "../GameEngineCore/ResourceStreamer.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace CoreLib;
+using namespace GameEngine;
+
+namespace UnitTest
+{
+	TEST_CLASS(ResourceStreamerTest)
+	{
+	public:
+		TEST_METHOD(LoadsInPriorityOrderAndFinalizesOnCaller)
+		{
+			ResourceStreamer streamer(1);
+			std::atomic<bool> blocked, started;
+			blocked = true;
+			started = false;
+			std::mutex orderLock;
+			List<int> loadOrder;
+			List<int> finalizeOrder;
+			auto callerThread = std::this_thread::get_id();
+			bool finalizedOnCaller = true;
+			// the first request holds the only I/O thread until all others are queued
+			streamer.Submit([&]()
+			{
+				started = true;
+				while (blocked.load())
+					std::this_thread::yield();
+			}, []() {}, StreamingPriority::Low);
+			// otherwise the thread could take the first of the other requests before the higher priority ones are queued
+			while (!started.load())
+				std::this_thread::yield();
+			StreamingPriority priorities[] = { StreamingPriority::Low, StreamingPriority::High, StreamingPriority::Normal };
+			for (int i = 0; i < 9; i++)
+			{
+				streamer.Submit([&, i]()
+				{
+					std::lock_guard<std::mutex> lock(orderLock);
+					loadOrder.Add(i);
+				},
+				[&, i]()
+				{
+					finalizedOnCaller = finalizedOnCaller && std::this_thread::get_id() == callerThread;
+					finalizeOrder.Add(i);
+				}, priorities[i % 3]);
+			}
+			Assert::AreEqual(10, streamer.GetUnfinishedRequestCount());
+			blocked = false;
+			streamer.Flush();
+			Assert::AreEqual(0, streamer.GetUnfinishedRequestCount());
+			int expectedOrder[] = { 1, 4, 7, 2, 5, 8, 0, 3, 6 };
+			Assert::AreEqual(9, loadOrder.Count());
+			for (int i = 0; i < 9; i++)
+				Assert::AreEqual(expectedOrder[i], loadOrder[i]);
+			// finalized in the order the requests finished loading
+			Assert::AreEqual(9, finalizeOrder.Count());
+			for (int i = 0; i < 9; i++)
+				Assert::AreEqual(expectedOrder[i], finalizeOrder[i]);
+			Assert::IsTrue(finalizedOnCaller);
+		}
+
+		TEST_METHOD(UpdateFinalizesLoadedRequests)
+		{
+			ResourceStreamer streamer(2);
+			int finalized = 0;
+			std::atomic<int> loaded;
+			loaded = 0;
+			for (int i = 0; i < 4; i++)
+				streamer.Submit([&]() { loaded++; }, [&]() { finalized++; }, StreamingPriority::Normal);
+			while (loaded.load() != 4)
+				std::this_thread::yield();
+			// a zero budget still finalizes one request per update
+			while (streamer.GetUnfinishedRequestCount())
+			{
+				int before = finalized;
+				streamer.Update(0.0f);
+				Assert::IsTrue(finalized == before || finalized == before + 1);
+			}
+			Assert::AreEqual(4, finalized);
+			// finalize functions may submit further requests
+			streamer.Submit([]() {}, [&]() { streamer.Submit([]() {}, [&]() { finalized++; }, StreamingPriority::High); }, StreamingPriority::Normal);
+			streamer.Flush();
+			Assert::AreEqual(5, finalized);
+		}
+
+		TEST_METHOD(CancelDropsUnfinishedRequests)
+		{
+			ResourceStreamer streamer(1);
+			std::atomic<bool> blocked;
+			blocked = true;
+			int finalized = 0;
+			streamer.Submit([&]() { while (blocked.load()) std::this_thread::yield(); }, [&]() { finalized++; }, StreamingPriority::Normal);
+			for (int i = 0; i < 10; i++)
+				streamer.Submit([]() {}, [&]() { finalized++; }, StreamingPriority::Normal);
+			std::thread release([&]()
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+				blocked = false;
+			});
+			streamer.Cancel();
+			release.join();
+			Assert::AreEqual(0, streamer.GetUnfinishedRequestCount());
+			streamer.Flush();
+			streamer.Update(1.0f);
+			Assert::AreEqual(0, finalized);
+		}
+
+		TEST_METHOD(DestructorReleasesPendingRequests)
+		{
+			// every request holds a reference, so a request lost by an exiting I/O thread keeps the count up
+			auto token = std::make_shared<int>(0);
+			for (int iteration = 0; iteration < 20; iteration++)
+			{
+				ResourceStreamer streamer(4);
+				for (int i = 0; i < 50; i++)
+					streamer.Submit([token]() { std::this_thread::yield(); }, [token]() {}, StreamingPriority::Normal);
+				if (iteration & 1)
+					streamer.Update(0.0f);
+			}
+			Assert::AreEqual(1, (int)token.use_count());
+		}
+	};
+}
@@ -0,0 +1,84 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "../CoreLib/Basic.h"
+#include "../GameEngineCore/Actor.h"
+#include "../GameEngineCore/SceneCullingTree.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace CoreLib;
+using namespace GameEngine;
+using namespace VectorMath;
+
+namespace UnitTest
+{
+	class CullingTestActor : public Actor
+	{
+	public:
+		DrawableMobility Mobility = DrawableMobility::Static;
+		virtual EngineActorType GetEngineType() override
+		{
+			return EngineActorType::Drawable;
+		}
+		virtual DrawableMobility GetDrawableMobility() override
+		{
+			return Mobility;
+		}
+	};
+
+	TEST_CLASS(SceneCullingTest)
+	{
+	public:
+		TEST_METHOD(QueryMatchesFrustumTest)
+		{
+			Random random(7);
+			List<RefPtr<CullingTestActor>> actors;
+			SceneCullingTree tree;
+			for (int i = 0; i < 20000; i++)
+			{
+				RefPtr<CullingTestActor> actor = new CullingTestActor();
+				actor->Mobility = (i % 8 == 0) ? DrawableMobility::Movable : DrawableMobility::Static;
+				Vec3 center = Vec3::Create(random.NextFloat(-500.0f, 500.0f), random.NextFloat(-20.0f, 20.0f), random.NextFloat(-500.0f, 500.0f));
+				float extent = random.NextFloat(0.5f, 5.0f);
+				actor->Bounds.Min = center - Vec3::Create(extent);
+				actor->Bounds.Max = center + Vec3::Create(extent);
+				tree.Add(actor.Ptr());
+				actors.Add(actor);
+			}
+			// actors without bounds are always returned
+			actors[1]->Bounds.Init();
+			tree.UpdateActor(actors[1].Ptr());
+			Matrix4 proj, viewProj, invViewProj;
+			Matrix4::CreatePerspectiveMatrixFromViewAngle(proj, 60.0f, 1.5f, 0.5f, 300.0f, ClipSpaceType::ZeroToOne);
+			for (int frame = 0; frame < 4; frame++)
+			{
+				for (auto & actor : actors)
+				{
+					if (actor->Mobility == DrawableMobility::Movable)
+					{
+						auto offset = Vec3::Create(random.NextFloat(-2.0f, 2.0f), 0.0f, random.NextFloat(-2.0f, 2.0f));
+						actor->Bounds.Min += offset;
+						actor->Bounds.Max += offset;
+					}
+				}
+				tree.Refit();
+				Matrix4 view;
+				Matrix4::RotationY(view, frame * 1.3f);
+				Matrix4::Multiply(viewProj, proj, view);
+				viewProj.Inverse(invViewProj);
+				List<CullFrustum> frusta;
+				frusta.Add(CullFrustum(invViewProj));
+				HashSet<Actor*> visible;
+				tree.Query(frusta.GetArrayView(), [&](Actor * actor) { visible.Add(actor); });
+				for (auto & actor : actors)
+				{
+					bool hasBounds = actor->Bounds.xMin <= actor->Bounds.xMax;
+					if (!hasBounds || frusta[0].IsBoxInFrustum(actor->Bounds))
+						Assert::IsTrue(visible.Contains(actor.Ptr()));
+				}
+				// the query may only return extra actors because of the enlarged bounds of the tree
+				Assert::IsTrue(visible.Count() < actors.Count() / 4);
+			}
+			for (auto & actor : actors)
+				tree.Remove(actor.Ptr());
+		}
+	};
+}
@@ -0,0 +1,93 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "../CoreLib/Basic.h"
+#include "../CoreLib/TlsfAllocator.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace CoreLib;
+
+namespace UnitTest
+{
+	struct TlsfTestRange
+	{
+		long long Offset, Size;
+	};
+
+	TEST_CLASS(TlsfAllocatorTest)
+	{
+	private:
+		static bool Overlaps(List<TlsfTestRange> & ranges)
+		{
+			ranges.Sort([](const TlsfTestRange & r0, const TlsfTestRange & r1) { return r0.Offset < r1.Offset; });
+			for (int i = 1; i < ranges.Count(); i++)
+			{
+				if (ranges[i - 1].Offset + ranges[i - 1].Size > ranges[i].Offset)
+					return true;
+			}
+			return false;
+		}
+	public:
+		TEST_METHOD(RoundsOnlyToAlignment)
+		{
+			TlsfAllocator allocator(1 << 20, 256);
+			auto offset = allocator.Alloc(65 * 1024 + 1);
+			Assert::AreEqual(0ll, offset);
+			auto stats = allocator.GetStats();
+			Assert::AreEqual(65ll * 1024 + 256, stats.BytesAllocated);
+			Assert::AreEqual((1ll << 20) - stats.BytesAllocated, stats.BytesFree);
+			Assert::AreEqual(1, stats.AllocationCount);
+			Assert::AreEqual(1, stats.FreeBlockCount);
+		}
+
+		TEST_METHOD(ExhaustedHeapReturnsInvalidOffset)
+		{
+			TlsfAllocator allocator(4096, 256);
+			Assert::AreEqual(0ll, allocator.Alloc(4096));
+			Assert::AreEqual(TlsfAllocator::InvalidOffset, allocator.Alloc(1));
+			allocator.Free(0);
+			Assert::AreEqual(TlsfAllocator::InvalidOffset, allocator.Alloc(4097));
+		}
+
+		TEST_METHOD(RandomAllocationsDoNotOverlapAndCoalesce)
+		{
+			const long long heapSize = 1ll << 26;
+			TlsfAllocator allocator(heapSize, 256);
+			Random random(7);
+			List<TlsfTestRange> live;
+			for (int i = 0; i < 20000; i++)
+			{
+				if (live.Count() && random.Next(0, 3) == 0)
+				{
+					int id = random.Next(0, live.Count());
+					allocator.Free(live[id].Offset);
+					live.FastRemoveAt(id);
+				}
+				else
+				{
+					TlsfTestRange range;
+					range.Size = random.Next(1, 1 << 16);
+					range.Offset = allocator.Alloc(range.Size);
+					if (range.Offset != TlsfAllocator::InvalidOffset)
+					{
+						Assert::IsTrue(range.Offset % 256 == 0 && range.Offset + range.Size <= heapSize);
+						live.Add(range);
+					}
+				}
+			}
+			Assert::IsTrue(!Overlaps(live));
+			long long requested = 0;
+			for (auto & range : live)
+				requested += range.Size;
+			auto stats = allocator.GetStats();
+			Assert::AreEqual(live.Count(), stats.AllocationCount);
+			Assert::AreEqual(requested, stats.BytesRequested);
+
+			for (auto & range : live)
+				allocator.Free(range.Offset);
+			stats = allocator.GetStats();
+			Assert::AreEqual(0ll, stats.BytesAllocated);
+			Assert::AreEqual(1, stats.FreeBlockCount);
+			Assert::AreEqual(heapSize, stats.LargestFreeBlock);
+			Assert::AreEqual(0ll, allocator.Alloc(heapSize));
+		}
+	};
+}